@@ -0,0 +1,231 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/all_to_all.h"
+
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+// Set true for greater intelligibility of debug mode log messages.
+#define READABLE_KEYS false
+
+namespace tensorflow {
+
+namespace {
+// Key to be used for BufRendezvous by AllToAll.
+string AllToAllBufKey(const string& exec_key, int phase, int src_rank,
+                      int dst_rank) {
+  if (READABLE_KEYS) {
+    return strings::StrCat("alltoall(", exec_key, "):phase(", phase, "):src(",
+                           src_rank, "):dst(", dst_rank, ")");
+  } else {
+    return strings::StrCat(exec_key, ":", phase, ":", src_rank, ":",
+                           dst_rank);
+  }
+}
+}  // namespace
+
+AllToAll::AllToAll() : col_ctx_(nullptr), col_params_(nullptr) {}
+
+Status AllToAll::InitializeCollectiveParams(CollectiveParams* col_params) {
+  DCHECK_EQ(col_params->instance.type, ALL_TO_ALL_COLLECTIVE);
+  DCHECK_EQ(col_params->instance.impl_details.collective_name, "AllToAll");
+  if (col_params->group.device_type != DEVICE_CPU) {
+    return errors::Unimplemented(
+        "AllToAll is only implemented for CPU devices, got ",
+        col_params->group.device_type.type_string(), " in ", col_params->name);
+  }
+  col_params->instance.impl_details.subdiv_permutations.clear();
+  col_params->subdiv_rank.clear();
+  return Status::OK();
+}
+
+Status AllToAll::InitializeCollectiveContext(CollectiveContext* col_ctx) {
+  CHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = &col_ctx->col_params;
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void AllToAll::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Every device communicates with every other device, so this doesn't
+  // require non-overlapping collectives either.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+  Status status = RunAllToAll();
+  VLOG(2) << "device=" << col_ctx_->device_name << " return status " << status;
+  done(status);
+}
+
+Status AllToAll::RunAllToAll() {
+  OpKernelContext* op_ctx = col_ctx_->op_ctx;
+  const int group_size = col_params_->group.group_size;
+  const Tensor& input = *col_ctx_->input;
+  const Tensor& split_sizes = op_ctx->input(1);
+  if (!TensorShapeUtils::IsVector(split_sizes.shape()) ||
+      split_sizes.NumElements() != group_size) {
+    return errors::InvalidArgument(
+        "split_sizes of ", col_params_->name, " must be a vector of ",
+        group_size, " elements, got shape ",
+        split_sizes.shape().DebugString());
+  }
+  const auto send_sizes = split_sizes.vec<int32>();
+  int64 total_send_rows = 0;
+  for (int i = 0; i < group_size; ++i) {
+    if (send_sizes(i) < 0) {
+      return errors::InvalidArgument("split_sizes of ", col_params_->name,
+                                     " must not be negative, got ",
+                                     send_sizes(i), " at index ", i);
+    }
+    total_send_rows += send_sizes(i);
+  }
+  if (total_send_rows != input.dim_size(0)) {
+    return errors::InvalidArgument(
+        "split_sizes of ", col_params_->name, " add up to ", total_send_rows,
+        " but the input has ", input.dim_size(0), " rows");
+  }
+
+  // Learn how many rows each device sends to this one.
+  Tensor* recv_split_sizes = nullptr;
+  TF_RETURN_IF_ERROR(
+      op_ctx->allocate_output(1, split_sizes.shape(), &recv_split_sizes));
+  std::vector<Tensor> send_pieces;
+  std::vector<Tensor> recv_pieces;
+  for (int i = 0; i < group_size; ++i) {
+    send_pieces.push_back(split_sizes.Slice(i, i + 1));
+    recv_pieces.push_back(recv_split_sizes->Slice(i, i + 1));
+  }
+  {
+    profiler::TraceMe activity("ExchangeSplitSizes",
+                               profiler::TraceMeLevel::kInfo);
+    TF_RETURN_IF_ERROR(Exchange(kSplitSizes, op_ctx->input_alloc_attr(1),
+                                send_pieces, op_ctx->output_alloc_attr(1),
+                                &recv_pieces));
+  }
+
+  const auto recv_sizes = recv_split_sizes->vec<int32>();
+  int64 total_recv_rows = 0;
+  for (int i = 0; i < group_size; ++i) {
+    total_recv_rows += recv_sizes(i);
+  }
+  TensorShape output_shape = input.shape();
+  output_shape.set_dim(0, total_recv_rows);
+  Tensor* output = nullptr;
+  TF_RETURN_IF_ERROR(op_ctx->allocate_output(0, output_shape, &output));
+  col_ctx_->output = output;
+
+  send_pieces.clear();
+  recv_pieces.clear();
+  int64 send_row = 0;
+  int64 recv_row = 0;
+  for (int i = 0; i < group_size; ++i) {
+    send_pieces.push_back(input.Slice(send_row, send_row + send_sizes(i)));
+    recv_pieces.push_back(output->Slice(recv_row, recv_row + recv_sizes(i)));
+    send_row += send_sizes(i);
+    recv_row += recv_sizes(i);
+  }
+  profiler::TraceMe activity("ExchangeData", profiler::TraceMeLevel::kInfo);
+  return Exchange(kData, op_ctx->input_alloc_attr(0), send_pieces,
+                  op_ctx->output_alloc_attr(0), &recv_pieces);
+}
+
+Status AllToAll::Exchange(Phase phase, const AllocatorAttributes& send_attr,
+                          const std::vector<Tensor>& send_pieces,
+                          const AllocatorAttributes& recv_attr,
+                          std::vector<Tensor>* recv_pieces) {
+  const int group_size = col_params_->group.group_size;
+  const int rank = col_params_->default_rank;
+  int num_transfers = 0;
+  for (int i = 0; i < group_size; ++i) {
+    if (send_pieces[i].NumElements() > 0) ++num_transfers;
+    if (i != rank && (*recv_pieces)[i].NumElements() > 0) ++num_transfers;
+  }
+
+  mutex mu;
+  Status status;
+  BlockingCounter pending(num_transfers);
+  auto done = [&mu, &status, &pending](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  DeviceContext* device_ctx = col_ctx_->op_ctx->op_device_context();
+  // Start with the peers following this device, so that the devices do not
+  // all send to the same peer at once.
+  for (int step = 0; step < group_size; ++step) {
+    const int peer = (rank + step) % group_size;
+    if (peer == rank) {
+      if (send_pieces[peer].NumElements() > 0) {
+        CollectiveRemoteAccessLocal::MemCpyAsync(
+            device_ctx, device_ctx, col_ctx_->device, col_ctx_->device,
+            send_attr, recv_attr, &send_pieces[peer], &(*recv_pieces)[peer],
+            0 /*dev_to_dev_stream_index*/, done);
+      }
+      continue;
+    }
+    if (send_pieces[peer].NumElements() > 0) {
+      const string send_buf_key =
+          AllToAllBufKey(col_ctx_->exec_key, phase, rank, peer);
+      VLOG(3) << "AllToAll device=" << col_ctx_->device_name << " send key "
+              << send_buf_key << " to "
+              << col_params_->instance.device_names[peer];
+      col_ctx_->col_exec->PostToPeer(
+          col_params_->instance.device_names[peer],
+          col_params_->instance.task_names[peer], send_buf_key,
+          col_ctx_->device, device_ctx, send_attr, &send_pieces[peer],
+          col_ctx_->device_locality, done);
+    }
+    if ((*recv_pieces)[peer].NumElements() > 0) {
+      const string recv_buf_key =
+          AllToAllBufKey(col_ctx_->exec_key, phase, peer, rank);
+      VLOG(3) << "AllToAll device=" << col_ctx_->device_name << " recv key "
+              << recv_buf_key << " from "
+              << col_params_->instance.device_names[peer];
+      col_ctx_->col_exec->RecvFromPeer(
+          col_params_->instance.device_names[peer],
+          col_params_->instance.task_names[peer],
+          col_params_->task.is_local[peer], recv_buf_key, col_ctx_->device,
+          device_ctx, recv_attr, &(*recv_pieces)[peer],
+          col_ctx_->device_locality, 0 /*stream_index*/, done);
+    }
+  }
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+namespace {
+REGISTER_COLLECTIVE(AllToAll, AllToAll);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,82 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_ALL_TO_ALL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_ALL_TO_ALL_H_
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+
+namespace tensorflow {
+
+// Implementation of collective all-to-all with variable split sizes.  The
+// input is split along dimension 0 into group_size pieces, the i-th piece
+// holding split_sizes[i] rows, and the i-th piece is sent to the device of
+// rank i.  Every device outputs the pieces it received, concatenated in rank
+// order, along with the number of rows received from each device.
+//
+// Since the size of the output is not known before the split sizes of all
+// devices have been exchanged, the implementation allocates its outputs
+// itself, and only supports devices whose memory may be allocated outside of
+// the executor thread, i.e. CPU.
+class AllToAll : public CollectiveImplementationInterface {
+ public:
+  AllToAll();
+  ~AllToAll() override = default;
+
+  // Checks that the group runs on CPU.  No subdivisions are used, since every
+  // device exchanges data directly with every other device.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(CollectiveContext* col_ctx) override;
+
+  // No-op for all-to-all.
+  Status InitializeCollectiveGroupRuntimeDetails(
+      CollGroupRuntimeDetails*) override {
+    return Status::OK();
+  }
+
+  // Exchanges the split sizes, then the pieces of the input, with all other
+  // devices in the group.
+  // Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ private:
+  // Phases of the algorithm, which distinguish the keys of their transfers.
+  enum Phase {
+    kSplitSizes = 0,
+    kData,
+  };
+
+  Status RunAllToAll();
+
+  // Sends send_pieces[i] to, and receives recv_pieces[i] from, the device of
+  // rank i, concurrently for all i.  The piece for this device is copied
+  // locally, and empty pieces are skipped.  Blocks until all transfers are
+  // complete.
+  Status Exchange(Phase phase, const AllocatorAttributes& send_attr,
+                  const std::vector<Tensor>& send_pieces,
+                  const AllocatorAttributes& recv_attr,
+                  std::vector<Tensor>* recv_pieces);
+
+  CollectiveContext* col_ctx_;          // Not owned
+  const CollectiveParams* col_params_;  // Not owned
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_ALL_TO_ALL_H_
@@ -0,0 +1,337 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/all_to_all.h"
+
+#include <atomic>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static int64 kStepId = 123;
+static const int kRowElements = 3;
+
+CollectiveParams SetUpCollectiveParams(int num_tasks, int num_devs_per_task) {
+  CollectiveParams cp;
+  cp.name = "test_collective";
+  cp.group.group_key = 5;
+  cp.group.group_size = num_tasks * num_devs_per_task;
+  cp.group.device_type = DEVICE_CPU;
+  cp.group.num_tasks = num_tasks;
+  cp.instance.instance_key = 17;
+  cp.instance.type = ALL_TO_ALL_COLLECTIVE;
+  cp.instance.impl_details.collective_name = "AllToAll";
+  cp.instance.shape = TensorShape({kRowElements});
+  for (int ti = 0; ti < num_tasks; ++ti) {
+    string task_name = strings::StrCat("/job:worker/replica:0/task:", ti);
+    for (int di = 0; di < num_devs_per_task; ++di) {
+      cp.instance.device_names.push_back(
+          strings::StrCat(task_name, "/cpu:", di));
+      cp.instance.task_names.push_back(task_name);
+      // This test runs in a single process so is_local is always true.
+      cp.task.is_local.push_back(true);
+    }
+  }
+  return cp;
+}
+
+class AllToAllTest : public ::testing::Test {
+ protected:
+  ~AllToAllTest() override {
+    for (auto i : instances_) delete i;
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(int num_tasks, int num_devs_per_task, DataType dtype) {
+    std::vector<std::unique_ptr<Device>> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    col_params_ = SetUpCollectiveParams(num_tasks, num_devs_per_task);
+    col_params_.instance.data_type = dtype;
+    for (const string& dev_name : col_params_.instance.device_names) {
+      local_devices.push_back(absl::make_unique<ThreadPoolDevice>(
+          sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+    }
+    dev_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(local_devices));
+    dev_resolver_ = absl::make_unique<DeviceResolverLocal>(dev_mgr_.get());
+    work_queue_ = std::make_shared<UnboundedWorkQueue>(Env::Default(), "test");
+    auto* rma = new CollectiveRemoteAccessLocal(
+        dev_mgr_.get(), dev_resolver_.get(), work_queue_, kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma, kStepId,
+                                           dev_mgr_.get(), &gpu_ring_order_);
+    for (int rank = 0; rank < col_params_.group.group_size; ++rank) {
+      instances_.push_back(new DeviceInstance(rank, this));
+    }
+  }
+
+  void RunAllToAll() {
+    std::atomic<int> done(0);
+    for (auto di : instances_) {
+      SchedClosure([di, &done] {
+        di->DoAllToAll();
+        ++done;
+      });
+    }
+    while (done < static_cast<int>(instances_.size())) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  // Number of rows the device of rank `src` sends to the device of rank
+  // `dst`.  Some are 0 so that empty pieces are covered.
+  static int32 SplitSize(int src, int dst, int max_rows) {
+    return (src * 7 + dst * 3) % (max_rows + 1);
+  }
+
+  // Value of element `i` of row `row` of the piece `src` sends to `dst`.
+  template <typename T>
+  static T Value(int src, int dst, int row, int i) {
+    return static_cast<T>(src * 1000 + dst * 100 + row * kRowElements + i);
+  }
+
+  template <typename T>
+  void RunTest(DataType dtype, int num_tasks, int num_devs_per_task,
+               int max_rows) {
+    Init(num_tasks, num_devs_per_task, dtype);
+    const int group_size = num_tasks * num_devs_per_task;
+    for (int src = 0; src < group_size; ++src) {
+      DeviceInstance* instance = instances_[src];
+      std::vector<T> values;
+      std::vector<int32> split_sizes;
+      for (int dst = 0; dst < group_size; ++dst) {
+        const int rows = SplitSize(src, dst, max_rows);
+        split_sizes.push_back(rows);
+        for (int row = 0; row < rows; ++row) {
+          for (int i = 0; i < kRowElements; ++i) {
+            values.push_back(Value<T>(src, dst, row, i));
+          }
+        }
+      }
+      const int64 num_rows = values.size() / kRowElements;
+      instance->input_ =
+          test::AsTensor<T>(values, TensorShape({num_rows, kRowElements}));
+      instance->split_sizes_ = test::AsTensor<int32>(split_sizes);
+    }
+    RunAllToAll();
+    for (int dst = 0; dst < group_size; ++dst) {
+      std::vector<T> expected;
+      std::vector<int32> expected_split_sizes;
+      for (int src = 0; src < group_size; ++src) {
+        const int rows = SplitSize(src, dst, max_rows);
+        expected_split_sizes.push_back(rows);
+        for (int row = 0; row < rows; ++row) {
+          for (int i = 0; i < kRowElements; ++i) {
+            expected.push_back(Value<T>(src, dst, row, i));
+          }
+        }
+      }
+      const int64 num_rows = expected.size() / kRowElements;
+      TF_EXPECT_OK(instances_[dst]->status_);
+      test::ExpectTensorEqual<T>(
+          instances_[dst]->output_,
+          test::AsTensor<T>(expected, TensorShape({num_rows, kRowElements})));
+      test::ExpectTensorEqual<int32>(
+          instances_[dst]->recv_split_sizes_,
+          test::AsTensor<int32>(expected_split_sizes));
+    }
+  }
+
+  class DeviceInstance {
+   public:
+    DeviceInstance(int rank, AllToAllTest* parent) : parent_(parent) {
+      col_params_.name = parent_->col_params_.name;
+      col_params_.group = parent_->col_params_.group;
+      col_params_.instance = parent_->col_params_.instance;
+      col_params_.task.is_local = parent_->col_params_.task.is_local;
+      col_params_.default_rank = rank;
+      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(
+          col_params_.instance.device_names[rank], &device_));
+      tensorflow::AllToAll all_to_all;
+      TF_CHECK_OK(all_to_all.InitializeCollectiveParams(&col_params_));
+    }
+
+    void DoAllToAll() {
+      const DataType dtype = col_params_.instance.data_type;
+
+      // Prepare an OpKernelContext.
+      OpKernelContext::Params op_params;
+      op_params.step_id = kStepId;
+      op_params.device = device_;
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      inputs.push_back(TensorValue(&input_));
+      inputs.push_back(TensorValue(&split_sizes_));
+      op_params.inputs = &inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
+          {AllocatorAttributes(), AllocatorAttributes()});
+      op_params.input_alloc_attrs = &input_aa;
+      DeviceContext* dev_ctx = new DeviceContext;
+      op_params.op_device_context = dev_ctx;
+      AllocatorAttributes generic_alloc_attr[2];
+      op_params.output_attr_array = generic_alloc_attr;
+      NodeDef node_def;
+      TF_CHECK_OK(NodeDefBuilder(
+                      strings::StrCat("collective_all_to_all_",
+                                      col_params_.default_rank),
+                      "CollectiveAllToAll")
+                      .Attr("T", dtype)
+                      .Attr("group_size", col_params_.group.group_size)
+                      .Attr("group_key", col_params_.group.group_key)
+                      .Attr("instance_key", col_params_.instance.instance_key)
+                      .Input(FakeInput(dtype))
+                      .Input(FakeInput(DT_INT32))
+                      .Finalize(&node_def));
+      Status status;
+      std::unique_ptr<OpKernel> op = CreateOpKernel(
+          DEVICE_CPU, device_, device_->GetAllocator(AllocatorAttributes()),
+          node_def, TF_GRAPH_DEF_VERSION, &status);
+      TF_CHECK_OK(status);
+      op_params.op_kernel = op.get();
+      OpKernelContext ctx(&op_params, 2);
+
+      // Like the kernel, leave the outputs to be allocated by the
+      // implementation.
+      string exec_key =
+          strings::StrCat(col_params_.instance.instance_key, ":0:0");
+      tensorflow::AllToAll all_to_all;
+      CollectiveContext col_ctx(parent_->col_exec_, parent_->dev_mgr_.get(),
+                                &ctx, &op_params, col_params_, exec_key,
+                                kStepId, &input_, nullptr);
+      TF_CHECK_OK(all_to_all.InitializeCollectiveContext(&col_ctx));
+
+      all_to_all.Run([this](Status s) { status_ = s; });
+      if (status_.ok()) {
+        CHECK_EQ(col_ctx.output, ctx.mutable_output(0));
+        output_ = *ctx.mutable_output(0);
+        recv_split_sizes_ = *ctx.mutable_output(1);
+      }
+      dev_ctx->Unref();
+    }
+
+    AllToAllTest* parent_;
+    Device* device_ = nullptr;
+    CollectiveParams col_params_;
+    Tensor input_;
+    Tensor split_sizes_;
+    Tensor output_;
+    Tensor recv_split_sizes_;
+    Status status_;
+  };
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  std::unique_ptr<DeviceMgr> dev_mgr_;
+  string gpu_ring_order_;
+  CollectiveParams col_params_;
+  std::vector<DeviceInstance*> instances_;
+};
+
+TEST_F(AllToAllTest, InitializeParamsRequiresCpu) {
+  CollectiveParams cp = SetUpCollectiveParams(1, 2);
+  cp.default_rank = 0;
+  cp.group.device_type = DEVICE_GPU;
+  tensorflow::AllToAll all_to_all;
+  EXPECT_TRUE(
+      errors::IsUnimplemented(all_to_all.InitializeCollectiveParams(&cp)));
+}
+
+TEST_F(AllToAllTest, InvalidSplitSizes) {
+  Init(1, 2, DT_FLOAT);
+  for (DeviceInstance* instance : instances_) {
+    instance->input_ = Tensor(DT_FLOAT, TensorShape({4, kRowElements}));
+    instance->split_sizes_ = test::AsTensor<int32>({1, 2});
+  }
+  RunAllToAll();
+  for (DeviceInstance* instance : instances_) {
+    EXPECT_TRUE(errors::IsInvalidArgument(instance->status_))
+        << instance->status_;
+  }
+}
+
+TEST_F(AllToAllTest, NegativeSplitSize) {
+  Init(1, 2, DT_FLOAT);
+  for (DeviceInstance* instance : instances_) {
+    instance->input_ = Tensor(DT_FLOAT, TensorShape({4, kRowElements}));
+    instance->split_sizes_ = test::AsTensor<int32>({5, -1});
+  }
+  RunAllToAll();
+  for (DeviceInstance* instance : instances_) {
+    EXPECT_TRUE(errors::IsInvalidArgument(instance->status_))
+        << instance->status_;
+  }
+}
+
+#define DEF_TEST(B, T, D, R)                              \
+  TEST_F(AllToAllTest,                                    \
+         DaTy##B##_Tasks##T##_DevPerTask##D##_Rows##R) {  \
+    DataType dtype = DT_##B;                              \
+    switch (dtype) {                                      \
+      case DT_FLOAT: {                                    \
+        RunTest<float>(dtype, T, D, R);                   \
+      } break;                                            \
+      case DT_DOUBLE: {                                   \
+        RunTest<double>(dtype, T, D, R);                  \
+      } break;                                            \
+      case DT_INT32: {                                    \
+        RunTest<int32>(dtype, T, D, R);                   \
+      } break;                                            \
+      case DT_INT64: {                                    \
+        RunTest<int64>(dtype, T, D, R);                   \
+      } break;                                            \
+      default:                                            \
+        LOG(FATAL) << "Unimplemented";                    \
+    }                                                     \
+  }
+
+// Test cases where all pieces are empty.
+DEF_TEST(FLOAT, 1, 2, 0)
+DEF_TEST(FLOAT, 2, 2, 0)
+// Regular test cases.
+DEF_TEST(FLOAT, 1, 1, 5)
+DEF_TEST(FLOAT, 1, 2, 1)
+DEF_TEST(FLOAT, 1, 4, 7)
+DEF_TEST(FLOAT, 2, 2, 100)
+DEF_TEST(FLOAT, 2, 4, 1001)
+DEF_TEST(DOUBLE, 3, 2, 17)
+DEF_TEST(INT32, 4, 2, 33)
+DEF_TEST(INT64, 2, 3, 9)
+
+}  // namespace
+}  // namespace tensorflow
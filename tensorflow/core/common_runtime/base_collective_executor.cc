@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/public/version.h"
 
 #define VALUE_IN_DEBUG_STRING false
 
@@ -210,10 +211,55 @@ CollectiveAdapter* MakeCollectiveAdapter(Tensor* output, int num_chunks,
   }
 }
 
+namespace {
+// Key identifying the bucket of a reduction among those of its step.
+string BucketKey(OpKernelContext* ctx, const CollectiveParams& col_params) {
+  return strings::StrCat(ctx->device()->name(), ":",
+                         col_params.group.group_key, ":",
+                         col_params.instance.impl_details.bucket_key, ":",
+                         ctx->frame_iter().frame_id, ":",
+                         ctx->frame_iter().iter_id);
+}
+
+string OpTypeString(const std::unique_ptr<OpKernel>& op) {
+  return op ? op->type_string() : "Id";
+}
+
+// Creates a kernel like `op` for a fused reduction, which owns its kernels.
+Status CopyOpKernel(OpKernelContext* ctx, const CollectiveParams& col_params,
+                    const std::unique_ptr<OpKernel>& op,
+                    std::unique_ptr<OpKernel>* copy) {
+  if (!op) return Status::OK();
+  Status status;
+  *copy = CreateOpKernel(col_params.group.device_type, ctx->device(),
+                         ctx->device()->GetAllocator(AllocatorAttributes()),
+                         op->def(), TF_GRAPH_DEF_VERSION, &status);
+  return status;
+}
+
+// State of a fused reduction, deleted once it completes.
+struct FusedBucket {
+  CollectiveParams col_params;
+  Tensor tensor;
+};
+}  // namespace
+
 BaseCollectiveExecutor::~BaseCollectiveExecutor() {}
 
 void BaseCollectiveExecutor::StartAbort(const Status& s) {
   VLOG(1) << "BaseCollectiveExecutor::StartAbort " << s;
+  // Reductions waiting for the rest of their bucket would otherwise never
+  // complete.
+  std::unordered_map<string, std::vector<BucketMember>> buckets;
+  {
+    mutex_lock l(bucket_mu_);
+    buckets.swap(buckets_);
+  }
+  for (auto& bucket : buckets) {
+    for (BucketMember& member : bucket.second) {
+      member.done(s);
+    }
+  }
   remote_access_->StartAbort(s);
 }
 
@@ -257,17 +303,32 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
         });
   }
 
+  if (col_params.instance.type == REDUCTION_COLLECTIVE &&
+      col_params.instance.impl_details.bucket_size > 1) {
+    AddToBucket({ctx, &col_params, exec_key, std::move(done_safe)});
+    return;
+  }
+
   Tensor* output = ctx->mutable_output(0);
   const Tensor* input = (col_params.instance.type == REDUCTION_COLLECTIVE ||
                          col_params.instance.type == GATHER_COLLECTIVE ||
+                         col_params.instance.type == ALL_TO_ALL_COLLECTIVE ||
                          (col_params.instance.type == BROADCAST_COLLECTIVE &&
                           col_params.is_source))
                             ? &ctx->input(0)
                             : nullptr;
+  RunCollective(ctx, col_params, exec_key, input, output, done_safe);
+}
+
+void BaseCollectiveExecutor::RunCollective(OpKernelContext* ctx,
+                                           const CollectiveParams& col_params,
+                                           const string& exec_key,
+                                           const Tensor* input, Tensor* output,
+                                           const StatusCallback& done) {
   CollectiveImplementationInterface* col_impl = nullptr;
   Status status = CreateCollective(col_params, &col_impl);
   if (!status.ok()) {
-    done_safe(status);
+    done(status);
     DCHECK_EQ(nullptr, col_impl);
     return;
   }
@@ -276,14 +337,14 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
                             exec_key, step_id_, input, output);
   status = col_impl->InitializeCollectiveContext(col_ctx);
   if (!status.ok()) {
-    done_safe(status);
+    done(status);
     delete col_ctx;
     delete col_impl;
     return;
   }
   // Run on an unbounded work queue that can handle blocking work so as to not
   // starve executor threads.
-  remote_access_->RunClosure([col_impl, col_ctx, done_safe, ctx]() {
+  remote_access_->RunClosure([col_impl, col_ctx, done, ctx]() {
     profiler::TraceMe activity(
         [&] {
           return strings::StrCat(ctx->op_kernel().name_view(), ":",
@@ -291,14 +352,145 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
                                  "#id=", ctx->step_id(), "#");
         },
         profiler::TraceMeLevel::kInfo);
-    col_impl->Run([col_impl, col_ctx, done_safe](const Status& s) {
-      done_safe(s);
+    col_impl->Run([col_impl, col_ctx, done](const Status& s) {
+      done(s);
       delete col_ctx;
       delete col_impl;
     });
   });
 }
 
+void BaseCollectiveExecutor::AddToBucket(BucketMember member) {
+  const string bucket_key = BucketKey(member.ctx, *member.col_params);
+  const int bucket_size = member.col_params->instance.impl_details.bucket_size;
+  std::vector<BucketMember> members;
+  {
+    mutex_lock l(bucket_mu_);
+    std::vector<BucketMember>& bucket = buckets_[bucket_key];
+    bucket.push_back(std::move(member));
+    VLOG(1) << "Collective bucket " << bucket_key << " has " << bucket.size()
+            << " of " << bucket_size << " members";
+    if (static_cast<int>(bucket.size()) < bucket_size) return;
+    members.swap(bucket);
+    buckets_.erase(bucket_key);
+  }
+  // The last member to arrive may be running in an executor thread, so
+  // assemble the bucket on the work queue.
+  remote_access_->RunClosure([this, members = std::move(members)]() mutable {
+    RunBucket(std::move(members));
+  });
+}
+
+void BaseCollectiveExecutor::RunBucket(std::vector<BucketMember> members) {
+  // Members arrive in the order their inputs are produced, which may differ
+  // between devices, so lay out the fused tensor by instance key.  The member
+  // with the smallest instance key leads the fused reduction.
+  std::sort(members.begin(), members.end(),
+            [](const BucketMember& a, const BucketMember& b) {
+              return a.col_params->instance.instance_key <
+                     b.col_params->instance.instance_key;
+            });
+  auto done_all = [members](const Status& s) {
+    for (const BucketMember& member : members) {
+      member.done(s);
+    }
+  };
+  const BucketMember& leader = members[0];
+  const CollectiveParams& leader_params = *leader.col_params;
+  int64 num_elements = 0;
+  for (const BucketMember& member : members) {
+    const CollectiveParams& cp = *member.col_params;
+    if (cp.instance.data_type != leader_params.instance.data_type ||
+        OpTypeString(cp.merge_op) != OpTypeString(leader_params.merge_op) ||
+        OpTypeString(cp.final_op) != OpTypeString(leader_params.final_op)) {
+      done_all(errors::InvalidArgument(
+          "Collective ", cp.name, " has a different type or reduction than ",
+          leader_params.name, " in bucket ",
+          cp.instance.impl_details.bucket_key));
+      return;
+    }
+    num_elements += member.ctx->input(0).NumElements();
+  }
+
+  FusedBucket* fused = new FusedBucket;
+  Status status = leader.ctx->allocate_temp(leader_params.instance.data_type,
+                                            TensorShape({num_elements}),
+                                            &fused->tensor);
+  CollectiveParams& cp = fused->col_params;
+  if (status.ok()) {
+    status = CopyOpKernel(leader.ctx, leader_params, leader_params.merge_op,
+                          &cp.merge_op);
+  }
+  if (status.ok()) {
+    status = CopyOpKernel(leader.ctx, leader_params, leader_params.final_op,
+                          &cp.final_op);
+  }
+  if (!status.ok()) {
+    delete fused;
+    done_all(status);
+    return;
+  }
+  int64 offset = 0;
+  for (const BucketMember& member : members) {
+    const Tensor& input = member.ctx->input(0);
+    Tensor piece = fused->tensor.Slice(offset, offset + input.NumElements());
+    memcpy(DMAHelper::base(&piece), DMAHelper::base(&input),
+           input.TotalBytes());
+    offset += input.NumElements();
+  }
+
+  // The leader's instance has been resolved like any other, so the fused
+  // reduction reuses its group, ranks, subdivisions and key.
+  cp.group = leader_params.group;
+  cp.instance = leader_params.instance;
+  cp.instance.impl_details = leader_params.instance.impl_details;
+  cp.instance.shape = TensorShape({num_elements});
+  cp.task = leader_params.task;
+  cp.name =
+      strings::StrCat(leader_params.name, " (bucket of ", members.size(), ")");
+  cp.default_rank = leader_params.default_rank;
+  cp.subdiv_rank = leader_params.subdiv_rank;
+  std::vector<int32>& dependencies = cp.instance.impl_details.dependencies;
+  dependencies.clear();
+  for (const BucketMember& member : members) {
+    for (int32 instance :
+         member.col_params->instance.impl_details.dependencies) {
+      if (std::none_of(members.begin(), members.end(),
+                       [instance](const BucketMember& m) {
+                         return m.col_params->instance.instance_key ==
+                                instance;
+                       })) {
+        dependencies.push_back(instance);
+      }
+    }
+  }
+  // The other members never run, so record their launch here for any
+  // collectives that wait for them.
+  for (int i = 1; i < members.size(); ++i) {
+    UnblockDependencies(*members[i].col_params);
+  }
+
+  VLOG(1) << "Running collective bucket " << cp.name << " of " << num_elements
+          << " elements";
+  RunCollective(
+      leader.ctx, cp, leader.exec_key, &fused->tensor, &fused->tensor,
+      [fused, members, done_all](const Status& s) {
+        if (s.ok()) {
+          int64 offset = 0;
+          for (const BucketMember& member : members) {
+            Tensor* output = member.ctx->mutable_output(0);
+            const Tensor piece =
+                fused->tensor.Slice(offset, offset + output->NumElements());
+            memcpy(DMAHelper::base(output), DMAHelper::base(&piece),
+                   output->TotalBytes());
+            offset += output->NumElements();
+          }
+        }
+        delete fused;
+        done_all(s);
+      });
+}
+
 void BaseCollectiveExecutor::CompleteParamsAsync(
     const string& device, CollectiveParams* cp, CancellationManager* cancel_mgr,
     StatusCallback done) {
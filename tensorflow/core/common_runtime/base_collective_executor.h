@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
 #include "tensorflow/core/framework/collective.h"
@@ -168,11 +169,36 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
   std::unordered_map<int32, int32> launched_ TF_GUARDED_BY(launch_mu_);
 
  private:
+  // A reduction waiting for the other members of its bucket.
+  struct BucketMember {
+    OpKernelContext* ctx;
+    const CollectiveParams* col_params;
+    string exec_key;
+    StatusCallback done;
+  };
+
+  // Runs the collective on `input` and `output` on the remote access work
+  // queue.  `done` must already handle timeouts.
+  void RunCollective(OpKernelContext* ctx, const CollectiveParams& col_params,
+                     const string& exec_key, const Tensor* input,
+                     Tensor* output, const StatusCallback& done);
+  // Adds `member` to its bucket, and runs the bucket once all its members
+  // have been launched.
+  void AddToBucket(BucketMember member);
+  // Runs the reductions of a full bucket as a single reduction of their
+  // concatenated inputs, then splits the result into their outputs.
+  void RunBucket(std::vector<BucketMember> members);
+
   Status CreateCollective(const CollectiveParams& col_params,
                           CollectiveImplementationInterface** col_impl);
   // Check if all ops on which this collective depends on have launched.
   bool CheckDependencies(const CollectiveParams& col_params)
       TF_EXCLUSIVE_LOCKS_REQUIRED(launch_mu_);
+
+  mutex bucket_mu_;
+  // bucket key -> members of the bucket launched so far.
+  std::unordered_map<string, std::vector<BucketMember>> buckets_
+      TF_GUARDED_BY(bucket_mu_);
 };
 
 }  // namespace tensorflow
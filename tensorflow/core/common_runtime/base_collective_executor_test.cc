@@ -0,0 +1,177 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static int64 kStepId = 123;
+
+std::unique_ptr<OpKernel> GetMergeOp(const string& type, DataType dtype,
+                                     Device* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("merge_op", type)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> op = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return op;
+}
+
+// A CollectiveReduce on a single device, which is a member of a bucket of two
+// reductions.
+class BucketedReduction {
+ public:
+  BucketedReduction(Device* device, int32 instance_key, int32 bucket_key,
+                    DataType dtype, const string& merge_op)
+      : input_(dtype, TensorShape({4})) {
+    col_params_.name = strings::StrCat("reduce_", instance_key);
+    col_params_.group.group_key = 5;
+    col_params_.group.group_size = 1;
+    col_params_.group.device_type = DEVICE_CPU;
+    col_params_.instance.type = REDUCTION_COLLECTIVE;
+    col_params_.instance.instance_key = instance_key;
+    col_params_.instance.data_type = dtype;
+    col_params_.instance.shape = input_.shape();
+    col_params_.instance.impl_details.bucket_key = bucket_key;
+    col_params_.instance.impl_details.bucket_size = 2;
+    col_params_.merge_op = GetMergeOp(merge_op, dtype, device);
+    inputs_.push_back(TensorValue(&input_));
+    op_params_.step_id = kStepId;
+    op_params_.device = device;
+    op_params_.inputs = &inputs_;
+    ctx_ = absl::make_unique<OpKernelContext>(&op_params_, 1);
+  }
+
+  void Launch(CollectiveExecutor* col_exec) {
+    col_exec->ExecuteAsync(
+        ctx_.get(), col_params_,
+        strings::StrCat(col_params_.instance.instance_key, ":0:0"),
+        [this](const Status& s) {
+          status_ = s;
+          done_.Notify();
+        });
+  }
+
+  Status Wait() {
+    done_.WaitForNotification();
+    return status_;
+  }
+
+  bool IsDone() const { return done_.HasBeenNotified(); }
+
+ private:
+  CollectiveParams col_params_;
+  Tensor input_;
+  gtl::InlinedVector<TensorValue, 4> inputs_;
+  OpKernelContext::Params op_params_;
+  std::unique_ptr<OpKernelContext> ctx_;
+  Status status_;
+  Notification done_;
+};
+
+class BaseCollectiveExecutorTest : public ::testing::Test {
+ protected:
+  BaseCollectiveExecutorTest() {
+    std::vector<std::unique_ptr<Device>> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    local_devices.push_back(absl::make_unique<ThreadPoolDevice>(
+        sess_opts, "/job:worker/replica:0/task:0/cpu:0", Bytes(4 << 20),
+        DeviceLocality(), cpu_allocator()));
+    device_ = local_devices[0].get();
+    dev_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(local_devices));
+    dev_resolver_ = absl::make_unique<DeviceResolverLocal>(dev_mgr_.get());
+    work_queue_ = std::make_shared<UnboundedWorkQueue>(Env::Default(), "test");
+    auto* rma = new CollectiveRemoteAccessLocal(
+        dev_mgr_.get(), dev_resolver_.get(), work_queue_, kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma, kStepId,
+                                           dev_mgr_.get(), &gpu_ring_order_);
+  }
+
+  ~BaseCollectiveExecutorTest() override { col_exec_->Unref(); }
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  Device* device_ = nullptr;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  std::unique_ptr<DeviceMgr> dev_mgr_;
+  string gpu_ring_order_;
+};
+
+TEST_F(BaseCollectiveExecutorTest, BucketWithDifferentTypes) {
+  BucketedReduction first(device_, 1, 1, DT_FLOAT, "Add");
+  BucketedReduction second(device_, 2, 1, DT_DOUBLE, "Add");
+  first.Launch(col_exec_);
+  second.Launch(col_exec_);
+  EXPECT_TRUE(errors::IsInvalidArgument(first.Wait()));
+  EXPECT_TRUE(errors::IsInvalidArgument(second.Wait()));
+}
+
+TEST_F(BaseCollectiveExecutorTest, BucketWithDifferentMergeOps) {
+  BucketedReduction first(device_, 1, 1, DT_FLOAT, "Add");
+  BucketedReduction second(device_, 2, 1, DT_FLOAT, "Mul");
+  first.Launch(col_exec_);
+  second.Launch(col_exec_);
+  EXPECT_TRUE(errors::IsInvalidArgument(first.Wait()));
+  EXPECT_TRUE(errors::IsInvalidArgument(second.Wait()));
+}
+
+TEST_F(BaseCollectiveExecutorTest, AbortCompletesPendingBuckets) {
+  // Each reduction waits for the second member of its bucket, which never
+  // comes.
+  BucketedReduction first(device_, 1, 1, DT_FLOAT, "Add");
+  BucketedReduction second(device_, 2, 2, DT_FLOAT, "Add");
+  first.Launch(col_exec_);
+  second.Launch(col_exec_);
+  EXPECT_FALSE(first.IsDone());
+  EXPECT_FALSE(second.IsDone());
+  col_exec_->StartAbort(errors::Aborted("test abort"));
+  EXPECT_TRUE(errors::IsAborted(first.Wait()));
+  EXPECT_TRUE(errors::IsAborted(second.Wait()));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,253 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+// ResourceMgr container holding the CollectiveCompressionResidual objects.
+constexpr char kResidualContainer[] = "_collective_compression";
+
+// A value sent by kTopK: its index within the chunk in the upper 32 bits and
+// the bits of the float in the lower 32 bits.
+int64 PackTopKValue(int64 index, float value) {
+  uint32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return static_cast<int64>((static_cast<uint64>(index) << 32) | bits);
+}
+
+void UnpackTopKValue(int64 packed, int64* index, float* value) {
+  *index = static_cast<int64>(static_cast<uint64>(packed) >> 32);
+  const uint32 bits = static_cast<uint32>(static_cast<uint64>(packed));
+  memcpy(value, &bits, sizeof(bits));
+}
+
+// Adds the difference between `chunk` and its 16-bit encoding `wire` to
+// `residual`.
+template <typename T>
+void AccumulateRoundingError(const float* chunk, const T* wire,
+                             int64 num_elements, float* residual) {
+  for (int64 i = 0; i < num_elements; ++i) {
+    residual[i] += chunk[i] - static_cast<float>(wire[i]);
+  }
+}
+
+}  // namespace
+
+Status ParseCollectiveCompression(const string& name,
+                                  CollectiveCompression* compression) {
+  if (name.empty() || name == "none") {
+    *compression = CollectiveCompression::kNone;
+  } else if (name == "float16") {
+    *compression = CollectiveCompression::kFloat16;
+  } else if (name == "bfloat16") {
+    *compression = CollectiveCompression::kBFloat16;
+  } else if (name == "topk") {
+    *compression = CollectiveCompression::kTopK;
+  } else {
+    return errors::InvalidArgument(
+        "Unknown collective compression ", name,
+        ", expected one of none, float16, bfloat16 or topk");
+  }
+  return Status::OK();
+}
+
+CollectiveChunkCodec::CollectiveChunkCodec(CollectiveCompression compression,
+                                           float topk_ratio)
+    : compression_(compression), topk_ratio_(topk_ratio) {
+  DCHECK(compression_ != CollectiveCompression::kTopK ||
+         (topk_ratio_ > 0 && topk_ratio_ <= 1))
+      << "topk_ratio " << topk_ratio_;
+}
+
+DataType CollectiveChunkCodec::wire_dtype() const {
+  switch (compression_) {
+    case CollectiveCompression::kFloat16:
+      return DT_HALF;
+    case CollectiveCompression::kBFloat16:
+      return DT_BFLOAT16;
+    case CollectiveCompression::kTopK:
+      return DT_INT64;
+    case CollectiveCompression::kNone:
+      return DT_FLOAT;
+  }
+  return DT_FLOAT;
+}
+
+TensorShape CollectiveChunkCodec::WireShape(int64 num_elements) const {
+  if (compression_ == CollectiveCompression::kTopK) {
+    return TensorShape({NumTopK(num_elements)});
+  }
+  return TensorShape({num_elements});
+}
+
+int64 CollectiveChunkCodec::NumTopK(int64 num_elements) const {
+  if (num_elements == 0) return 0;
+  const int64 k =
+      static_cast<int64>(std::round(static_cast<double>(topk_ratio_) *
+                                    static_cast<double>(num_elements)));
+  return std::min(num_elements, std::max<int64>(k, 1));
+}
+
+void CollectiveChunkCodec::Encode(const Tensor& chunk, Tensor* wire,
+                                  float* residual) const {
+  DCHECK_EQ(chunk.dtype(), DT_FLOAT);
+  DCHECK_EQ(wire->dtype(), wire_dtype());
+  const int64 num_elements = chunk.NumElements();
+  DCHECK_EQ(wire->shape(), WireShape(num_elements));
+  const float* values = chunk.unaligned_flat<float>().data();
+  switch (compression_) {
+    case CollectiveCompression::kFloat16: {
+      Eigen::half* encoded = wire->flat<Eigen::half>().data();
+      for (int64 i = 0; i < num_elements; ++i) {
+        encoded[i] = static_cast<Eigen::half>(values[i]);
+      }
+      if (residual != nullptr) {
+        AccumulateRoundingError(values, encoded, num_elements, residual);
+      }
+      break;
+    }
+    case CollectiveCompression::kBFloat16: {
+      bfloat16* encoded = wire->flat<bfloat16>().data();
+      for (int64 i = 0; i < num_elements; ++i) {
+        encoded[i] = static_cast<bfloat16>(values[i]);
+      }
+      if (residual != nullptr) {
+        AccumulateRoundingError(values, encoded, num_elements, residual);
+      }
+      break;
+    }
+    case CollectiveCompression::kTopK: {
+      const int64 k = NumTopK(num_elements);
+      // Partition the indices such that the first k refer to the values of
+      // largest magnitude.
+      std::vector<int64> indices(num_elements);
+      std::iota(indices.begin(), indices.end(), 0);
+      std::nth_element(indices.begin(), indices.begin() + k, indices.end(),
+                       [values](int64 a, int64 b) {
+                         return std::abs(values[a]) > std::abs(values[b]);
+                       });
+      int64* encoded = wire->flat<int64>().data();
+      for (int64 i = 0; i < k; ++i) {
+        encoded[i] = PackTopKValue(indices[i], values[indices[i]]);
+      }
+      if (residual != nullptr) {
+        for (int64 i = k; i < num_elements; ++i) {
+          residual[indices[i]] += values[indices[i]];
+        }
+      }
+      break;
+    }
+    case CollectiveCompression::kNone:
+      memcpy(wire->flat<float>().data(), values, num_elements * sizeof(float));
+      break;
+  }
+}
+
+void CollectiveChunkCodec::Decode(const Tensor& wire, Tensor* chunk) const {
+  DCHECK_EQ(chunk->dtype(), DT_FLOAT);
+  DCHECK_EQ(wire.dtype(), wire_dtype());
+  const int64 num_elements = chunk->NumElements();
+  float* values = chunk->unaligned_flat<float>().data();
+  switch (compression_) {
+    case CollectiveCompression::kFloat16: {
+      const Eigen::half* encoded = wire.flat<Eigen::half>().data();
+      for (int64 i = 0; i < num_elements; ++i) {
+        values[i] = static_cast<float>(encoded[i]);
+      }
+      break;
+    }
+    case CollectiveCompression::kBFloat16: {
+      const bfloat16* encoded = wire.flat<bfloat16>().data();
+      for (int64 i = 0; i < num_elements; ++i) {
+        values[i] = static_cast<float>(encoded[i]);
+      }
+      break;
+    }
+    case CollectiveCompression::kTopK: {
+      std::fill(values, values + num_elements, 0.0f);
+      auto encoded = wire.flat<int64>();
+      for (int64 i = 0; i < encoded.size(); ++i) {
+        int64 index;
+        float value;
+        UnpackTopKValue(encoded(i), &index, &value);
+        DCHECK_LT(index, num_elements);
+        if (index < num_elements) {
+          values[index] = value;
+        }
+      }
+      break;
+    }
+    case CollectiveCompression::kNone:
+      memcpy(values, wire.flat<float>().data(), num_elements * sizeof(float));
+      break;
+  }
+}
+
+void CollectiveCompressionResidual::ApplyTo(Tensor* value) {
+  mutex_lock l(mu_);
+  if (!residual_.IsInitialized() ||
+      residual_.NumElements() != value->NumElements()) {
+    return;
+  }
+  value->flat<float>() += residual_.flat<float>();
+  residual_.flat<float>().setZero();
+}
+
+void CollectiveCompressionResidual::Accumulate(const Tensor& residual) {
+  mutex_lock l(mu_);
+  if (!residual_.IsInitialized() ||
+      residual_.NumElements() != residual.NumElements()) {
+    residual_ = Tensor(DT_FLOAT, residual.shape());
+    residual_.flat<float>().setZero();
+  }
+  residual_.flat<float>() += residual.flat<float>();
+}
+
+string CollectiveCompressionResidual::DebugString() const {
+  mutex_lock l(mu_);
+  return strings::StrCat("CollectiveCompressionResidual ",
+                         residual_.shape().DebugString());
+}
+
+Status CollectiveCompressionResidual::LookupOrCreate(
+    ResourceMgr* resource_manager, int32 group_key, int32 instance_key,
+    CollectiveCompressionResidual** residual) {
+  if (resource_manager == nullptr) {
+    return errors::Internal(
+        "Collective compression requires a device with a ResourceMgr");
+  }
+  return resource_manager->LookupOrCreate<CollectiveCompressionResidual>(
+      kResidualContainer, strings::StrCat(group_key, ":", instance_key),
+      residual, [](CollectiveCompressionResidual** ret) {
+        *ret = new CollectiveCompressionResidual;
+        return Status::OK();
+      });
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,111 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+
+#include <string>
+
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+
+// Lossy encodings of the DT_FLOAT chunks that a collective exchanges between
+// devices.  Values are always accumulated in float; only the representation
+// on the wire is compressed.
+enum class CollectiveCompression {
+  kNone = 0,
+  // Each value is sent as an IEEE half-precision float.
+  kFloat16,
+  // Each value is sent as a bfloat16, i.e. rounded to an 8 bit mantissa.
+  kBFloat16,
+  // Only the values of largest magnitude are sent, together with their
+  // indices.  The values that are not sent are fed back into the next
+  // execution of the collective on the same device, see
+  // CollectiveCompressionResidual.
+  kTopK,
+};
+
+// Parses the value of the `compression` attr of collective ops, i.e. one of
+// "none", "float16", "bfloat16" or "topk".
+Status ParseCollectiveCompression(const string& name,
+                                  CollectiveCompression* compression);
+
+// Encodes chunks of DT_FLOAT values for a CollectiveCompression mode, and
+// decodes them on the receiving side.  The size of the encoding of a chunk
+// depends only on the number of values in it, so that receivers can allocate
+// the destination buffer up front.
+class CollectiveChunkCodec {
+ public:
+  // `topk_ratio` is the fraction of values sent for kTopK, in (0, 1].
+  CollectiveChunkCodec(CollectiveCompression compression, float topk_ratio);
+
+  CollectiveCompression compression() const { return compression_; }
+  bool enabled() const { return compression_ != CollectiveCompression::kNone; }
+
+  // Type and shape of the encoding of a chunk with `num_elements` values.
+  DataType wire_dtype() const;
+  TensorShape WireShape(int64 num_elements) const;
+
+  // Encodes the DT_FLOAT `chunk` into `wire`, which must have been allocated
+  // with wire_dtype() and WireShape().  If `residual` is not null, it must
+  // point to as many floats as `chunk` has values, and the difference between
+  // `chunk` and its decoded encoding is added to it.
+  void Encode(const Tensor& chunk, Tensor* wire, float* residual) const;
+
+  // Decodes `wire` into the DT_FLOAT `chunk`, overwriting all of its values.
+  void Decode(const Tensor& wire, Tensor* chunk) const;
+
+ private:
+  // Number of values sent by kTopK for a chunk of `num_elements` values.
+  int64 NumTopK(int64 num_elements) const;
+
+  const CollectiveCompression compression_;
+  const float topk_ratio_;
+};
+
+// Per-device state of an error-feedback compression mode: the values a device
+// did not send in previous executions of a collective instance.  Stored in
+// the ResourceMgr of the device, so that it persists across steps.
+class CollectiveCompressionResidual : public ResourceBase {
+ public:
+  // Adds the stored residual to the DT_FLOAT `value` and resets the residual.
+  // Does nothing if no residual with as many values is stored.
+  void ApplyTo(Tensor* value) TF_LOCKS_EXCLUDED(mu_);
+
+  // Adds `residual` to the stored residual, replacing it if its number of
+  // values differs.
+  void Accumulate(const Tensor& residual) TF_LOCKS_EXCLUDED(mu_);
+
+  string DebugString() const override;
+
+  // Looks up or creates the residual of a collective instance in the
+  // ResourceMgr of a device.  The caller owns a reference on the result.
+  static Status LookupOrCreate(ResourceMgr* resource_manager, int32 group_key,
+                               int32 instance_key,
+                               CollectiveCompressionResidual** residual);
+
+ private:
+  mutable mutex mu_;
+  Tensor residual_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
@@ -0,0 +1,191 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor MakeChunk(const std::vector<float>& values) {
+  Tensor chunk(DT_FLOAT, TensorShape({static_cast<int64>(values.size())}));
+  for (size_t i = 0; i < values.size(); ++i) {
+    chunk.flat<float>()(i) = values[i];
+  }
+  return chunk;
+}
+
+// Encodes and decodes `chunk`, adding the lost values to `residual` if it is
+// not null.
+Tensor RoundTrip(const CollectiveChunkCodec& codec, const Tensor& chunk,
+                 Tensor* residual) {
+  Tensor wire(codec.wire_dtype(), codec.WireShape(chunk.NumElements()));
+  codec.Encode(chunk, &wire,
+               residual != nullptr ? residual->flat<float>().data() : nullptr);
+  Tensor decoded(DT_FLOAT, chunk.shape());
+  codec.Decode(wire, &decoded);
+  return decoded;
+}
+
+TEST(CollectiveCompressionTest, Parse) {
+  CollectiveCompression compression;
+  TF_EXPECT_OK(ParseCollectiveCompression("none", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kNone);
+  TF_EXPECT_OK(ParseCollectiveCompression("float16", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kFloat16);
+  TF_EXPECT_OK(ParseCollectiveCompression("bfloat16", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kBFloat16);
+  TF_EXPECT_OK(ParseCollectiveCompression("topk", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kTopK);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      ParseCollectiveCompression("int8", &compression)));
+}
+
+TEST(CollectiveCompressionTest, Float16) {
+  CollectiveChunkCodec codec(CollectiveCompression::kFloat16, 0);
+  EXPECT_EQ(codec.wire_dtype(), DT_HALF);
+  EXPECT_EQ(codec.WireShape(7), TensorShape({7}));
+
+  const Tensor chunk = MakeChunk({0.0f, 1.0f, -2.5f, 1.0f / 3, 1000.1f});
+  Tensor residual = MakeChunk({0, 0, 0, 0, 0});
+  const Tensor decoded = RoundTrip(codec, chunk, &residual);
+  test::ExpectTensorEqual<float>(
+      decoded, MakeChunk({0.0f, 1.0f, -2.5f, 0.333251953125f, 1000.0f}));
+  // The residual holds exactly what was lost.
+  for (int i = 0; i < chunk.NumElements(); ++i) {
+    EXPECT_EQ(decoded.flat<float>()(i) + residual.flat<float>()(i),
+              chunk.flat<float>()(i));
+  }
+  // Decoded values are encoded exactly.
+  test::ExpectTensorEqual<float>(RoundTrip(codec, decoded, nullptr), decoded);
+}
+
+TEST(CollectiveCompressionTest, BFloat16) {
+  CollectiveChunkCodec codec(CollectiveCompression::kBFloat16, 0);
+  EXPECT_EQ(codec.wire_dtype(), DT_BFLOAT16);
+
+  const Tensor chunk = MakeChunk({0.0f, 1.0f, -2.5f, 1.0f / 3, 1000.1f});
+  const Tensor decoded = RoundTrip(codec, chunk, nullptr);
+  test::ExpectTensorEqual<float>(
+      decoded, MakeChunk({0.0f, 1.0f, -2.5f, 0.333984375f, 1000.0f}));
+  test::ExpectTensorEqual<float>(RoundTrip(codec, decoded, nullptr), decoded);
+}
+
+TEST(CollectiveCompressionTest, TopK) {
+  CollectiveChunkCodec codec(CollectiveCompression::kTopK, 0.3f);
+  EXPECT_EQ(codec.wire_dtype(), DT_INT64);
+  EXPECT_EQ(codec.WireShape(10), TensorShape({3}));
+  EXPECT_EQ(codec.WireShape(1), TensorShape({1}));
+  EXPECT_EQ(codec.WireShape(0), TensorShape({0}));
+
+  const Tensor chunk =
+      MakeChunk({0.5f, -4.0f, 0.25f, 3.0f, -0.125f, 0, 2.0f, 1.0f, 0, -1.5f});
+  Tensor residual = MakeChunk({1, 1, 1, 1, 1, 1, 1, 1, 1, 1});
+  const Tensor decoded = RoundTrip(codec, chunk, &residual);
+  test::ExpectTensorEqual<float>(
+      decoded, MakeChunk({0, -4.0f, 0, 3.0f, 0, 0, 2.0f, 0, 0, 0}));
+  test::ExpectTensorEqual<float>(
+      residual,
+      MakeChunk({1.5f, 1, 1.25f, 1, 0.875f, 1, 1, 2.0f, 1, -0.5f}));
+  // A chunk with no more than k non-zero values is encoded exactly.
+  test::ExpectTensorEqual<float>(RoundTrip(codec, decoded, nullptr), decoded);
+}
+
+TEST(CollectiveCompressionTest, TopKAll) {
+  CollectiveChunkCodec codec(CollectiveCompression::kTopK, 1.0f);
+  const Tensor chunk = MakeChunk({0.5f, -4.0f, 0.25f});
+  Tensor residual = MakeChunk({0, 0, 0});
+  test::ExpectTensorEqual<float>(RoundTrip(codec, chunk, &residual), chunk);
+  test::ExpectTensorEqual<float>(residual, MakeChunk({0, 0, 0}));
+}
+
+TEST(CollectiveCompressionTest, Residual) {
+  ResourceMgr resource_manager;
+  CollectiveCompressionResidual* residual = nullptr;
+  TF_ASSERT_OK(CollectiveCompressionResidual::LookupOrCreate(
+      &resource_manager, /*group_key=*/1, /*instance_key=*/2, &residual));
+  core::ScopedUnref unref(residual);
+
+  // Nothing is applied before anything was accumulated.
+  Tensor value = MakeChunk({1, 2, 3});
+  residual->ApplyTo(&value);
+  test::ExpectTensorEqual<float>(value, MakeChunk({1, 2, 3}));
+
+  residual->Accumulate(MakeChunk({0.5f, 0, -1}));
+  residual->Accumulate(MakeChunk({0.5f, 1, 0}));
+  residual->ApplyTo(&value);
+  test::ExpectTensorEqual<float>(value, MakeChunk({2, 3, 2}));
+  // The residual is reset once applied.
+  residual->ApplyTo(&value);
+  test::ExpectTensorEqual<float>(value, MakeChunk({2, 3, 2}));
+
+  // The same object is returned for the same instance.
+  CollectiveCompressionResidual* same_residual = nullptr;
+  TF_ASSERT_OK(CollectiveCompressionResidual::LookupOrCreate(
+      &resource_manager, /*group_key=*/1, /*instance_key=*/2, &same_residual));
+  core::ScopedUnref unref_same(same_residual);
+  EXPECT_EQ(residual, same_residual);
+  CollectiveCompressionResidual* other_residual = nullptr;
+  TF_ASSERT_OK(CollectiveCompressionResidual::LookupOrCreate(
+      &resource_manager, /*group_key=*/1, /*instance_key=*/3,
+      &other_residual));
+  core::ScopedUnref unref_other(other_residual);
+  EXPECT_NE(residual, other_residual);
+}
+
+static void BM_CollectiveChunkCodec(int iters,
+                                    CollectiveCompression compression,
+                                    int num_elements) {
+  testing::StopTiming();
+  CollectiveChunkCodec codec(compression, 0.01f);
+  Tensor chunk(DT_FLOAT, TensorShape({num_elements}));
+  chunk.flat<float>().setRandom();
+  Tensor wire(codec.wire_dtype(), codec.WireShape(num_elements));
+  Tensor decoded(DT_FLOAT, chunk.shape());
+  Tensor residual(DT_FLOAT, chunk.shape());
+  residual.flat<float>().setZero();
+  testing::BytesProcessed(static_cast<int64>(iters) * num_elements *
+                          sizeof(float));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    codec.Encode(chunk, &wire, residual.flat<float>().data());
+    codec.Decode(wire, &decoded);
+  }
+}
+
+static void BM_CollectiveChunkCodecFloat16(int iters, int num_elements) {
+  BM_CollectiveChunkCodec(iters, CollectiveCompression::kFloat16, num_elements);
+}
+static void BM_CollectiveChunkCodecBFloat16(int iters, int num_elements) {
+  BM_CollectiveChunkCodec(iters, CollectiveCompression::kBFloat16,
+                          num_elements);
+}
+static void BM_CollectiveChunkCodecTopK(int iters, int num_elements) {
+  BM_CollectiveChunkCodec(iters, CollectiveCompression::kTopK, num_elements);
+}
+BENCHMARK(BM_CollectiveChunkCodecFloat16)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK(BM_CollectiveChunkCodecBFloat16)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK(BM_CollectiveChunkCodecTopK)->Arg(1 << 12)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace tensorflow
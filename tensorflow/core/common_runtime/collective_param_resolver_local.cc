@@ -58,17 +58,49 @@ void CollectiveParamResolverLocal::CompleteGroupAsync(
 }
 
 namespace {
+// Returns true if the reduction of `cp` should use HierarchicalRingReduce,
+// which requires a group that spans several tasks with the same number, more
+// than one, of devices each.  Such groups use it by default on CPU, where the
+// tasks typically are separate hosts or sockets, and otherwise if indicated by
+// `communication_hint`.
+bool UseHierarchicalReduce(const CollectiveParams* cp) {
+  const CollImplDetails& impl_details = cp->instance.impl_details;
+  if (impl_details.communication_hint == "ring" ||
+      impl_details.communication_hint == "nccl") {
+    return false;
+  }
+  // On-the-wire compression is only implemented by RingReduce.
+  if (!impl_details.compression.empty() &&
+      impl_details.compression != "none") {
+    return false;
+  }
+  const int group_size = cp->group.group_size;
+  const int num_tasks = cp->group.num_tasks;
+  if (num_tasks < 2 || !cp->instance.same_num_devices_per_task ||
+      group_size % num_tasks != 0 || group_size / num_tasks < 2 ||
+      static_cast<int>(cp->instance.task_names.size()) != group_size) {
+    return false;
+  }
+  return impl_details.communication_hint == "hierarchical" ||
+         cp->group.device_type == DEVICE_CPU;
+}
+
 const char* GetCollectiveName(const CollectiveParams* cp, bool nccl) {
   switch (cp->instance.type) {
     case BROADCAST_COLLECTIVE:
       return "HierarchicalTreeBroadcast";
 
     case REDUCTION_COLLECTIVE:
-      return nccl ? "NcclReduce" : "RingReduce";
+      if (nccl) return "NcclReduce";
+      return UseHierarchicalReduce(cp) ? "HierarchicalRingReduce"
+                                       : "RingReduce";
 
     case GATHER_COLLECTIVE:
       return "RingGather";
 
+    case ALL_TO_ALL_COLLECTIVE:
+      return "AllToAll";
+
     default:
       return "undef";
   }
@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -60,6 +61,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/core/threadpool_options.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
@@ -686,6 +688,44 @@ Status DirectSession::RunInternal(
   }
   args.cancellation_manager = &step_cancellation_manager;
 
+  // Allocate the arenas of the partitions that have a static memory plan. They
+  // are released once all executors are done with the step.
+  bool has_static_memory_plan = false;
+  for (const auto& item : executors_and_keys->items) {
+    has_static_memory_plan |= (item.static_memory_plan != nullptr);
+  }
+  if (has_static_memory_plan) {
+    // The plans assume the static shapes of the fed tensors.
+    const auto& input_shapes = executors_and_keys->input_shapes;
+    for (int i = 0; i < input_shapes.size(); ++i) {
+      if (input_shapes[i].unknown_rank()) continue;
+      const Tensor* arg;
+      TF_RETURN_IF_ERROR(call_frame->GetArg(i, &arg));
+      if (!input_shapes[i].IsCompatibleWith(arg->shape())) {
+        return errors::InvalidArgument(
+            "Fed tensor ", i, " has shape ", arg->shape().DebugString(),
+            " which is incompatible with its declared shape ",
+            input_shapes[i].DebugString(),
+            ", as required by the static memory plan.");
+      }
+    }
+  }
+  auto release_static_memory_arenas = gtl::MakeCleanup([executors_and_keys,
+                                                        step_id]() {
+    for (const auto& item : executors_and_keys->items) {
+      if (item.static_memory_plan != nullptr) {
+        ReleaseStaticMemoryArena(*item.static_memory_plan, item.device,
+                                 step_id);
+      }
+    }
+  });
+  for (const auto& item : executors_and_keys->items) {
+    if (item.static_memory_plan != nullptr) {
+      TF_RETURN_IF_ERROR(AllocateStaticMemoryArena(*item.static_memory_plan,
+                                                   item.device, step_id));
+    }
+  }
+
   Status run_status;
 
   auto set_threadpool_args_for_item =
@@ -1308,10 +1348,20 @@ Status DirectSession::CreateExecutors(
 
   ek->callable_options = callable_options;
 
+  const DebugOptions& debug_options =
+      options.callable_options.run_options().debug_options();
+  // Static memory plans are only computed for function-convention graphs, and
+  // not when tfdbg inserts nodes that may retain tensors.
+  const bool use_static_memory_plan =
+      options_.config.experimental().use_static_memory_plan() &&
+      !run_state_args->is_partial_run &&
+      debug_options.debug_tensor_watch_opts().empty();
+
   std::unordered_map<string, std::unique_ptr<Graph>> graphs;
   TF_RETURN_IF_ERROR(CreateGraphs(
       options, &graphs, &func_info->flib_def, run_state_args, &ek->input_types,
-      &ek->output_types, &ek->collective_graph_key));
+      &ek->output_types, &ek->collective_graph_key,
+      use_static_memory_plan ? &ek->input_shapes : nullptr));
 
   if (run_state_args->is_partial_run) {
     ek->graph = std::move(run_state_args->graph);
@@ -1401,8 +1451,6 @@ Status DirectSession::CreateExecutors(
                        /*shape_map=*/nullptr);
 
     // TensorFlow Debugger (tfdbg) inserts debug nodes in the graph.
-    const DebugOptions& debug_options =
-        options.callable_options.run_options().debug_options();
     if (!debug_options.debug_tensor_watch_opts().empty()) {
       TF_RETURN_IF_ERROR(DecorateAndPublishGraphForDebug(
           debug_options, partition_graph.get(), params.device));
@@ -1412,6 +1460,17 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    if (use_static_memory_plan && device->device_type() == DEVICE_CPU) {
+      auto plan = absl::make_unique<StaticMemoryPlan>();
+      TF_RETURN_IF_ERROR(ComputeStaticMemoryPlan(
+          *partition_graph, ek->input_shapes, plan.get()));
+      if (!plan->empty()) {
+        TF_RETURN_IF_ERROR(
+            AnnotateGraphWithStaticMemoryPlan(*plan, partition_graph.get()));
+        item->static_memory_plan = std::move(plan);
+      }
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1582,7 +1641,8 @@ Status DirectSession::CreateGraphs(
     std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
     std::unique_ptr<FunctionLibraryDefinition>* flib_def,
     RunStateArgs* run_state_args, DataTypeVector* input_types,
-    DataTypeVector* output_types, int64* collective_graph_key) {
+    DataTypeVector* output_types, int64* collective_graph_key,
+    std::vector<PartialTensorShape>* input_shapes) {
   mutex_lock l(graph_state_lock_);
   if (finalized_) {
     return errors::FailedPrecondition("Session has been finalized.");
@@ -1649,6 +1709,29 @@ Status DirectSession::CreateGraphs(
 
   stateful_placements_ = execution_state->GetStatefulPlacements();
 
+  // The fed endpoints are replaced by arguments in the client graph, so take
+  // their static shapes from the placeholders of the full graph.
+  if (input_shapes != nullptr) {
+    std::unordered_map<StringPiece, const Node*, StringPieceHasher>
+        name_to_node;
+    for (const Node* n : execution_state->full_graph()->nodes()) {
+      name_to_node[n->name()] = n;
+    }
+    input_shapes->clear();
+    for (const string& feed : subgraph_options.callable_options.feed()) {
+      PartialTensorShape shape;
+      const TensorId id = ParseTensorName(feed);
+      auto it = name_to_node.find(id.node());
+      if (it != name_to_node.end() && id.index() == 0 &&
+          it->second->type_string() == "Placeholder") {
+        if (!GetNodeAttr(it->second->attrs(), "shape", &shape).ok()) {
+          shape = PartialTensorShape();
+        }
+      }
+      input_shapes->push_back(std::move(shape));
+    }
+  }
+
   // Remember the graph in run state if this is a partial run.
   if (run_state_args->is_partial_run) {
     run_state_args->graph.reset(new Graph(flib_def_.get()));
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_function_library_runtime.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -148,6 +149,9 @@ class DirectSession : public Session {
     Device* device = nullptr;                // not owned.
     FunctionLibraryRuntime* flib = nullptr;  // not owned.
     std::unique_ptr<Executor> executor;
+    // Set if ConfigProto.Experimental.use_static_memory_plan is enabled and
+    // the partition has tensors that could be planned.
+    std::unique_ptr<StaticMemoryPlan> static_memory_plan;
   };
 
   // An ExecutorsAndKeys is created for a given set of feeds/fetches.
@@ -176,6 +180,10 @@ class DirectSession : public Session {
     CallableOptions callable_options;
 
     int64 collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // The shapes of the fed tensors assumed by the static memory plans of
+    // `items`, if any.
+    std::vector<PartialTensorShape> input_shapes;
   };
 
   // A FunctionInfo object is created for every unique set of feeds/fetches.
@@ -261,7 +269,8 @@ class DirectSession : public Session {
       std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
       std::unique_ptr<FunctionLibraryDefinition>* flib_def,
       RunStateArgs* run_state_args, DataTypeVector* input_types,
-      DataTypeVector* output_types, int64* collective_graph_key);
+      DataTypeVector* output_types, int64* collective_graph_key,
+      std::vector<PartialTensorShape>* input_shapes);
 
   ::tensorflow::Status RunInternal(
       int64 step_id, const RunOptions& run_options,
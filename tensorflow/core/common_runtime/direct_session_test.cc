@@ -228,6 +228,51 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
       absl::StrContains(s.error_message(), "optimize_for_static_graph"));
 }
 
+TEST(DirectSessionTest, RunWithStaticMemoryPlan) {
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", TensorShape({4}))
+                   .Finalize(&g, &x));
+  // x -> Square -> Cast -> Square -> Cast -> Square, so that the intermediate
+  // tensors are allocated from the arena.
+  Node* y = x;
+  for (int i = 0; i < 2; ++i) {
+    y = test::graph::Unary(&g, "Square", y);
+    y = test::graph::Cast(&g, y, i % 2 == 0 ? DT_DOUBLE : DT_FLOAT);
+  }
+  y = test::graph::Unary(&g, "Square", y);
+  GraphDef def;
+  g.ToGraphDef(&def);
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_static_memory_plan(true);
+  auto session = absl::WrapUnique(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  Tensor x_tensor(DT_FLOAT, TensorShape({4}));
+  test::FillValues<float>(&x_tensor, {1, 2, -1, 0.5});
+  // Run a few steps, so that the arena of each step is released in turn.
+  for (int step = 0; step < 3; ++step) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{"x", x_tensor}}, {y->name() + ":0"}, {},
+                              &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({1, 256, 1, 0.00390625}), outputs[0]);
+  }
+
+  // The plan assumes the declared shape of the fed tensor.
+  Tensor bad_tensor(DT_FLOAT, TensorShape({8}));
+  test::FillValues<float>(&bad_tensor, {1, 2, 3, 4, 5, 6, 7, 8});
+  std::vector<Tensor> outputs;
+  Status s = session->Run({{"x", bad_tensor}}, {y->name() + ":0"}, {},
+                          &outputs);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
 TEST_F(DirectSessionMinusAXTest,
        RunSimpleNetwork_DisableOutputPartitionGraphs) {
   Initialize({3, 2, -1, 0});
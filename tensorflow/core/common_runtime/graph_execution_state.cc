@@ -875,7 +875,8 @@ Status GraphExecutionState::BuildGraph(const BuildGraphOptions& options,
             if (ndef.op() == "CollectiveReduce" ||
                 ndef.op() == "CollectiveBcastSend" ||
                 ndef.op() == "CollectiveBcastRecv" ||
-                ndef.op() == "CollectiveGather") {
+                ndef.op() == "CollectiveGather" ||
+                ndef.op() == "CollectiveAllToAll") {
               int32 instance_key;
               TF_RETURN_IF_ERROR(
                   GetNodeAttr(ndef, "instance_key", &instance_key));
@@ -0,0 +1,324 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_ring_reducer.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+// Set true for greater intelligibility of debug mode log messages.
+#define READABLE_KEYS false
+
+namespace tensorflow {
+
+namespace {
+// Key to be used for BufRendezvous by HierarchicalRingReducer.
+string HierarchicalReduceBufKey(const string& exec_key, int phase, int subdiv,
+                                int step, int src_rank) {
+  if (READABLE_KEYS) {
+    return strings::StrCat("hierarchicalreduce(", exec_key, "):phase(", phase,
+                           "):subdiv(", subdiv, "):step(", step, "):src(",
+                           src_rank, ")");
+  } else {
+    return strings::StrCat(exec_key, ":", phase, ":", subdiv, ":", step, ":",
+                           src_rank);
+  }
+}
+}  // namespace
+
+HierarchicalRingReducer::HierarchicalRingReducer()
+    : col_ctx_(nullptr),
+      col_params_(nullptr),
+      num_tasks_(0),
+      devices_per_task_(0),
+      chunk_elts_(0) {}
+
+Status HierarchicalRingReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
+  CHECK_EQ(col_params->instance.impl_details.collective_name,
+           "HierarchicalRingReduce");
+  const int group_size = col_params->group.group_size;
+  const int num_tasks = col_params->group.num_tasks;
+  if (num_tasks < 2 || !col_params->instance.same_num_devices_per_task ||
+      group_size % num_tasks != 0 || group_size / num_tasks < 2 ||
+      static_cast<int>(col_params->instance.task_names.size()) != group_size) {
+    return errors::InvalidArgument(
+        "HierarchicalRingReduce requires the same number of devices, more "
+        "than one, on each of several tasks, got group_size ", group_size,
+        " over ", num_tasks, " tasks in ", col_params->name);
+  }
+  const int devices_per_task = group_size / num_tasks;
+  // Precondition: device_names must be sorted so that all devices in the
+  // same task are adjacent.
+  const std::vector<string>& task_names = col_params->instance.task_names;
+  for (int di = 0; di < group_size; ++di) {
+    if (task_names[di] != task_names[di - di % devices_per_task]) {
+      return errors::Internal("Devices of task ", task_names[di],
+                              " are not adjacent in collective ",
+                              col_params->name);
+    }
+  }
+
+  CollImplDetails& impl_details = col_params->instance.impl_details;
+  impl_details.subdiv_permutations.clear();
+  impl_details.subdiv_permutations.resize(num_tasks + devices_per_task);
+  for (int ti = 0; ti < num_tasks; ++ti) {
+    for (int di = 0; di < devices_per_task; ++di) {
+      const int rank = ti * devices_per_task + di;
+      impl_details.subdiv_permutations[ti].push_back(rank);
+      impl_details.subdiv_permutations[num_tasks + di].push_back(rank);
+    }
+  }
+  const int task = col_params->default_rank / devices_per_task;
+  const int local_rank = col_params->default_rank % devices_per_task;
+  col_params->subdiv_rank.assign(num_tasks + devices_per_task, -1);
+  col_params->subdiv_rank[task] = local_rank;
+  col_params->subdiv_rank[num_tasks + local_rank] = task;
+
+  VLOG(2) << collective_util::SubdivPermDebugString(*col_params);
+  return Status::OK();
+}
+
+Status HierarchicalRingReducer::InitializeCollectiveContext(
+    CollectiveContext* col_ctx) {
+  CHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = &col_ctx->col_params;
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void HierarchicalRingReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Like `RingReducer`, this doesn't require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+  num_tasks_ = col_params_->group.num_tasks;
+  devices_per_task_ = col_params_->group.group_size / num_tasks_;
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  Status status;
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    Notification note;
+    profiler::TraceMe activity("MemCpyAsync", profiler::TraceMeLevel::kInfo);
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+  }
+  if (status.ok()) {
+    status = RunHierarchical();
+  }
+  VLOG(2) << "device=" << col_ctx_->device_name << " return status " << status;
+  done(status);
+}
+
+Status HierarchicalRingReducer::RunHierarchical() {
+  // The value is split into devices_per_task_ shards of num_tasks_ chunks
+  // each, so that the shards split evenly into aligned pieces for the rings
+  // between tasks.
+  const int num_chunks = devices_per_task_ * num_tasks_;
+  ca_.reset(MakeCollectiveAdapter(col_ctx_->output, num_chunks,
+                                  col_ctx_->device->GetAllocator(
+                                      col_ctx_->op_ctx->output_alloc_attr(0))));
+  chunk_elts_ = CollectiveAdapter::AlignedChunkElts(
+      DataTypeSize(col_ctx_->output->dtype()), ca_->Value().NumElements(),
+      num_chunks);
+
+  const int task = col_params_->default_rank / devices_per_task_;
+  const int local_rank = col_params_->default_rank % devices_per_task_;
+  const int local_subdiv = task;
+  const int cross_task_subdiv = num_tasks_ + local_rank;
+
+  std::vector<Tensor> shards;
+  for (int d = 0; d < devices_per_task_; ++d) {
+    shards.push_back(ChunkRange(d * num_tasks_, (d + 1) * num_tasks_));
+  }
+  TF_RETURN_IF_ERROR(ReduceScatter(local_subdiv, kLocalReduceScatter, shards));
+
+  // This device, like the devices of the same local rank on the other tasks,
+  // now holds the reduction over its task of this shard.
+  const int shard = (local_rank + 1) % devices_per_task_;
+  std::vector<Tensor> pieces;
+  for (int t = 0; t < num_tasks_; ++t) {
+    pieces.push_back(
+        ChunkRange(shard * num_tasks_ + t, shard * num_tasks_ + t + 1));
+  }
+  TF_RETURN_IF_ERROR(
+      ReduceScatter(cross_task_subdiv, kCrossTaskReduceScatter, pieces));
+  TF_RETURN_IF_ERROR(Finalize(&pieces[(task + 1) % num_tasks_]));
+  TF_RETURN_IF_ERROR(
+      AllGather(cross_task_subdiv, kCrossTaskAllGather, &pieces));
+  TF_RETURN_IF_ERROR(AllGather(local_subdiv, kLocalAllGather, &shards));
+
+  // Recover the output from the adaptor.
+  ca_->ConsumeFinalValue(col_ctx_->output);
+  return Status::OK();
+}
+
+Status HierarchicalRingReducer::ReduceScatter(
+    int subdiv, Phase phase, const std::vector<Tensor>& pieces) {
+  profiler::TraceMe activity(
+      [&] { return strings::StrCat("ReduceScatter:", subdiv); },
+      profiler::TraceMeLevel::kInfo);
+  const int n = pieces.size();
+  const int rank = col_params_->subdiv_rank[subdiv];
+  Allocator* allocator = col_ctx_->device->GetAllocator(
+      col_ctx_->op_ctx->output_alloc_attr(0));
+  for (int step = 0; step < n - 1; ++step) {
+    // Pass on the piece reduced in the previous step, and add the piece
+    // reduced by the previous device to our own.
+    const Tensor& send_piece = pieces[(rank - step + n) % n];
+    Tensor reduced_piece = pieces[(rank - step - 1 + 2 * n) % n];
+    Tensor recv_piece(allocator, reduced_piece.dtype(), reduced_piece.shape());
+    TF_RETURN_IF_ERROR(SendRecv(subdiv, phase, step, send_piece, &recv_piece));
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+        col_params_->merge_op.get(), &reduced_piece, &recv_piece));
+  }
+  return Status::OK();
+}
+
+Status HierarchicalRingReducer::AllGather(int subdiv, Phase phase,
+                                          std::vector<Tensor>* pieces) {
+  profiler::TraceMe activity(
+      [&] { return strings::StrCat("AllGather:", subdiv); },
+      profiler::TraceMeLevel::kInfo);
+  const int n = pieces->size();
+  const int rank = col_params_->subdiv_rank[subdiv];
+  for (int step = 0; step < n - 1; ++step) {
+    TF_RETURN_IF_ERROR(SendRecv(subdiv, phase, step,
+                                (*pieces)[(rank + 1 - step + n) % n],
+                                &(*pieces)[(rank - step + n) % n]));
+  }
+  return Status::OK();
+}
+
+Status HierarchicalRingReducer::SendRecv(int subdiv, Phase phase, int step,
+                                         const Tensor& send_tensor,
+                                         Tensor* recv_tensor) {
+  const std::vector<int>& perm =
+      col_params_->instance.impl_details.subdiv_permutations[subdiv];
+  const int n = perm.size();
+  const int rank = col_params_->subdiv_rank[subdiv];
+  const int send_to_idx = perm[(rank + 1) % n];
+  const int recv_from_rank = (rank + n - 1) % n;
+  const int recv_from_idx = perm[recv_from_rank];
+  const string send_buf_key = HierarchicalReduceBufKey(
+      col_ctx_->exec_key, phase, subdiv, step, rank);
+  const string recv_buf_key = HierarchicalReduceBufKey(
+      col_ctx_->exec_key, phase, subdiv, step, recv_from_rank);
+  VLOG(3) << "SendRecv device=" << col_ctx_->device_name << " send key "
+          << send_buf_key << " to "
+          << col_params_->instance.device_names[send_to_idx] << " recv key "
+          << recv_buf_key << " from "
+          << col_params_->instance.device_names[recv_from_idx];
+
+  mutex mu;
+  Status status;
+  BlockingCounter pending(2);
+  auto done = [&mu, &status, &pending](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  col_ctx_->col_exec->PostToPeer(
+      col_params_->instance.device_names[send_to_idx],
+      col_params_->instance.task_names[send_to_idx], send_buf_key,
+      col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), &send_tensor,
+      col_ctx_->device_locality, done);
+  col_ctx_->col_exec->RecvFromPeer(
+      col_params_->instance.device_names[recv_from_idx],
+      col_params_->instance.task_names[recv_from_idx],
+      col_params_->task.is_local[recv_from_idx], recv_buf_key,
+      col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), recv_tensor,
+      col_ctx_->device_locality, 0 /*stream_index*/, done);
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+Status HierarchicalRingReducer::Finalize(Tensor* value) {
+  if (!col_params_->final_op) return Status::OK();
+  Tensor group_size_val = ca_->Scalar(col_params_->group.group_size);
+  Tensor group_size_tensor = group_size_val;
+  if (col_params_->group.device_type != DEVICE_CPU) {
+    group_size_tensor =
+        ca_->Scalar(col_ctx_->device->GetAllocator(
+                        col_ctx_->op_ctx->input_alloc_attr(0)),
+                    AllocationAttributes());
+    Notification note;
+    Status status;
+    col_ctx_->op_ctx->op_device_context()->CopyCPUTensorToDevice(
+        &group_size_val, col_ctx_->device, &group_size_tensor,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    TF_RETURN_IF_ERROR(status);
+  }
+  return collective_util::ComputeBinOp(
+      col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+      col_params_->final_op.get(), value, &group_size_tensor);
+}
+
+Tensor HierarchicalRingReducer::ChunkRange(int begin, int end) const {
+  const Tensor& value = ca_->Value();
+  const int64 total_elts = value.NumElements();
+  const int64 start = std::min(total_elts, begin * chunk_elts_);
+  const int64 limit = std::min(total_elts, end * chunk_elts_);
+  // As in CollectiveAdapter::ChunkAlias, take empty ranges from the front of
+  // the value to avoid an illegal offset.
+  return (start < limit) ? value.Slice(start, limit) : value.Slice(0, 0);
+}
+
+namespace {
+REGISTER_COLLECTIVE(HierarchicalRingReduce, HierarchicalRingReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,103 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+
+namespace tensorflow {
+
+// Hierarchical implementation of collective all-reduce, for groups that span
+// several tasks with the same number D > 1 of devices each.  The value is
+// split into D shards, and
+//   1. each task reduce-scatters the shards in a ring over its devices, so
+//      that its d-th device holds the task-local reduction of one shard;
+//   2. the d-th devices of all tasks all-reduce that shard in a ring between
+//      tasks;
+//   3. each task all-gathers the shards in its ring of local devices.
+// Compared to a single ring over all devices, far fewer steps cross task
+// boundaries, and the traffic between tasks is spread over all devices.
+class HierarchicalRingReducer : public CollectiveImplementationInterface {
+ public:
+  HierarchicalRingReducer();
+  ~HierarchicalRingReducer() override = default;
+
+  // Establishes num_tasks intra-task subdivs, subdiv t being the ring of the
+  // devices of task t, followed by D inter-task subdivs, subdiv num_tasks + d
+  // being the ring of the d-th devices of all tasks.  Each device has rank -1
+  // in the subdivs it does not participate in.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(CollectiveContext* col_ctx) override;
+
+  // No-op for hierarchical ring reducer.
+  Status InitializeCollectiveGroupRuntimeDetails(
+      CollGroupRuntimeDetails*) override {
+    return Status::OK();
+  }
+
+  // Executes the hierarchical all-reduce.
+  // Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ private:
+  // Phases of the algorithm, which distinguish the keys of their transfers.
+  enum Phase {
+    kLocalReduceScatter = 0,
+    kCrossTaskReduceScatter,
+    kCrossTaskAllGather,
+    kLocalAllGather,
+  };
+
+  Status RunHierarchical();
+
+  // Reduces `pieces`, one per device in the ring of `subdiv`, such that the
+  // device of rank r ends up with the reduction of pieces[(r + 1) % n] over
+  // all devices of the ring.  The other pieces hold partial reductions.
+  Status ReduceScatter(int subdiv, Phase phase,
+                       const std::vector<Tensor>& pieces);
+
+  // Given that the device of rank r holds pieces[(r + 1) % n], passes the
+  // pieces around the ring of `subdiv` until all devices hold all of them.
+  Status AllGather(int subdiv, Phase phase, std::vector<Tensor>* pieces);
+
+  // Sends `send_tensor` to the next device in the ring of `subdiv` and
+  // receives `recv_tensor` from the previous one.  Blocks until both are
+  // complete.
+  Status SendRecv(int subdiv, Phase phase, int step, const Tensor& send_tensor,
+                  Tensor* recv_tensor);
+
+  // Applies final_op, if any, to the fully reduced `value`.
+  Status Finalize(Tensor* value);
+
+  // Returns the part of the value spanning chunks [begin, end).
+  Tensor ChunkRange(int begin, int end) const;
+
+  CollectiveContext* col_ctx_;          // Not owned
+  const CollectiveParams* col_params_;  // Not owned
+  std::unique_ptr<CollectiveAdapter> ca_;
+  int num_tasks_;
+  int devices_per_task_;
+  int64 chunk_elts_;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
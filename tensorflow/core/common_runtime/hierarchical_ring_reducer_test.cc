@@ -0,0 +1,321 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_ring_reducer.h"
+
+#include <atomic>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<OpKernel> GetKernel(const NodeDef& node, DeviceBase* device) {
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()), node,
+      TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder(strings::StrCat(op, "_node"), op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  return GetKernel(node_def, device);
+}
+
+static int64 kStepId = 123;
+
+CollectiveParams SetUpCollectiveParams(int num_tasks, int num_devs_per_task) {
+  CollectiveParams cp;
+  cp.name = "test_collective";
+  cp.group.group_key = 5;
+  cp.group.group_size = num_tasks * num_devs_per_task;
+  cp.group.device_type = DEVICE_CPU;
+  cp.group.num_tasks = num_tasks;
+  cp.instance.instance_key = 17;
+  cp.instance.type = REDUCTION_COLLECTIVE;
+  cp.instance.impl_details.collective_name = "HierarchicalRingReduce";
+  cp.instance.same_num_devices_per_task = true;
+  for (int ti = 0; ti < num_tasks; ++ti) {
+    string task_name = strings::StrCat("/job:worker/replica:0/task:", ti);
+    cp.instance.num_devices_per_task[task_name] = num_devs_per_task;
+    for (int di = 0; di < num_devs_per_task; ++di) {
+      cp.instance.device_names.push_back(
+          strings::StrCat(task_name, "/cpu:", di));
+      cp.instance.task_names.push_back(task_name);
+      // This test runs in a single process so is_local is always true.
+      cp.task.is_local.push_back(true);
+    }
+  }
+  return cp;
+}
+
+class HierarchicalRingReducerTest : public ::testing::Test {
+ protected:
+  ~HierarchicalRingReducerTest() override {
+    for (auto i : instances_) delete i;
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(int num_tasks, int num_devs_per_task, DataType dtype) {
+    std::vector<std::unique_ptr<Device>> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    col_params_ = SetUpCollectiveParams(num_tasks, num_devs_per_task);
+    col_params_.instance.data_type = dtype;
+    for (const string& dev_name : col_params_.instance.device_names) {
+      local_devices.push_back(absl::make_unique<ThreadPoolDevice>(
+          sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+    }
+    dev_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(local_devices));
+    dev_resolver_ = absl::make_unique<DeviceResolverLocal>(dev_mgr_.get());
+    work_queue_ = std::make_shared<UnboundedWorkQueue>(Env::Default(), "test");
+    auto* rma = new CollectiveRemoteAccessLocal(
+        dev_mgr_.get(), dev_resolver_.get(), work_queue_, kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma, kStepId,
+                                           dev_mgr_.get(), &gpu_ring_order_);
+    for (int rank = 0; rank < col_params_.group.group_size; ++rank) {
+      instances_.push_back(new DeviceInstance(rank, this));
+    }
+  }
+
+  void Reduce() {
+    std::atomic<int> done(0);
+    for (auto di : instances_) {
+      SchedClosure([di, &done] {
+        di->DoReduce();
+        ++done;
+      });
+    }
+    while (done < static_cast<int>(instances_.size())) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  template <typename T>
+  void RunTest(DataType dtype, int num_tasks, int num_devs_per_task,
+               int tensor_len) {
+    Init(num_tasks, num_devs_per_task, dtype);
+    const int group_size = num_tasks * num_devs_per_task;
+    std::vector<T> expected(tensor_len, 0);
+    for (int di = 0; di < group_size; ++di) {
+      Tensor* t = &instances_[di]->tensor_;
+      *t = Tensor(dtype, TensorShape({tensor_len}));
+      for (int i = 0; i < tensor_len; ++i) {
+        T value = static_cast<T>(di * 10 + i % 1000);
+        t->flat<T>()(i) = value;
+        expected[i] += value;
+      }
+    }
+    for (int i = 0; i < tensor_len; ++i) {
+      expected[i] /= group_size;
+    }
+    Reduce();
+    for (int di = 0; di < group_size; ++di) {
+      TF_EXPECT_OK(instances_[di]->status_);
+      test::ExpectTensorEqual<T>(
+          instances_[di]->tensor_,
+          test::AsTensor<T>(expected, TensorShape({tensor_len})));
+    }
+  }
+
+  class DeviceInstance {
+   public:
+    DeviceInstance(int rank, HierarchicalRingReducerTest* parent)
+        : parent_(parent) {
+      col_params_.name = parent_->col_params_.name;
+      col_params_.group = parent_->col_params_.group;
+      col_params_.instance = parent_->col_params_.instance;
+      col_params_.task.is_local = parent_->col_params_.task.is_local;
+      col_params_.default_rank = rank;
+      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(
+          col_params_.instance.device_names[rank], &device_));
+      HierarchicalRingReducer reducer;
+      TF_CHECK_OK(reducer.InitializeCollectiveParams(&col_params_));
+    }
+
+    void DoReduce() {
+      const DataType dtype = col_params_.instance.data_type;
+      col_params_.merge_op = GetBinOp("Add", dtype, device_);
+      col_params_.final_op = GetBinOp("Div", dtype, device_);
+
+      // Prepare an OpKernelContext.
+      OpKernelContext::Params op_params;
+      op_params.step_id = kStepId;
+      op_params.device = device_;
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      inputs.push_back(TensorValue(&tensor_));
+      op_params.inputs = &inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
+          {AllocatorAttributes()});
+      op_params.input_alloc_attrs = &input_aa;
+      DeviceContext* dev_ctx = new DeviceContext;
+      op_params.op_device_context = dev_ctx;
+      int forward_from = 0;
+      op_params.forward_from_array = &forward_from;
+      AllocatorAttributes generic_alloc_attr;
+      op_params.output_attr_array = &generic_alloc_attr;
+      NodeDef node_def;
+      TF_CHECK_OK(NodeDefBuilder(
+                      strings::StrCat("collective_reduce_",
+                                      col_params_.default_rank),
+                      "CollectiveReduce")
+                      .Attr("T", dtype)
+                      .Attr("merge_op", "Add")
+                      .Attr("final_op", "Div")
+                      .Attr("group_size", col_params_.group.group_size)
+                      .Attr("group_key", col_params_.group.group_key)
+                      .Attr("instance_key", col_params_.instance.instance_key)
+                      .Attr("subdiv_offsets", std::vector<int>())
+                      .Input(FakeInput(dtype))
+                      .Finalize(&node_def));
+      std::unique_ptr<OpKernel> op = GetKernel(node_def, device_);
+      op_params.op_kernel = op.get();
+      OpKernelContext ctx(&op_params, 1);
+
+      // We never actually execute the kernel, so we need to do the output
+      // allocation it would do, ourselves.
+      Tensor* output_tensor_ptr = nullptr;
+      TF_CHECK_OK(ctx.forward_input_or_allocate_output({0}, 0, tensor_.shape(),
+                                                       &output_tensor_ptr));
+      CHECK_EQ(output_tensor_ptr, ctx.mutable_output(0));
+
+      string exec_key =
+          strings::StrCat(col_params_.instance.instance_key, ":0:0");
+      HierarchicalRingReducer reducer;
+      CollectiveContext col_ctx(parent_->col_exec_, parent_->dev_mgr_.get(),
+                                &ctx, &op_params, col_params_, exec_key,
+                                kStepId, &tensor_, &tensor_);
+      TF_CHECK_OK(reducer.InitializeCollectiveContext(&col_ctx));
+
+      reducer.Run([this](Status s) { status_ = s; });
+      if (status_.ok()) {
+        CHECK(tensor_.CopyFrom(*ctx.mutable_output(0), tensor_.shape()));
+      }
+      dev_ctx->Unref();
+    }
+
+    HierarchicalRingReducerTest* parent_;
+    Device* device_ = nullptr;
+    CollectiveParams col_params_;
+    Tensor tensor_;
+    Status status_;
+  };
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  std::unique_ptr<DeviceMgr> dev_mgr_;
+  string gpu_ring_order_;
+  CollectiveParams col_params_;
+  std::vector<DeviceInstance*> instances_;
+};
+
+TEST_F(HierarchicalRingReducerTest, InitializeParams) {
+  CollectiveParams cp = SetUpCollectiveParams(/*num_tasks=*/3,
+                                              /*num_devs_per_task=*/2);
+  cp.default_rank = 3;
+  HierarchicalRingReducer reducer;
+  TF_ASSERT_OK(reducer.InitializeCollectiveParams(&cp));
+  const std::vector<std::vector<int>> expected_subdiv_perms = {
+      {0, 1}, {2, 3}, {4, 5}, {0, 2, 4}, {1, 3, 5}};
+  EXPECT_EQ(expected_subdiv_perms,
+            cp.instance.impl_details.subdiv_permutations);
+  const std::vector<int> expected_subdiv_rank = {-1, 1, -1, -1, 1};
+  EXPECT_EQ(expected_subdiv_rank, cp.subdiv_rank);
+}
+
+TEST_F(HierarchicalRingReducerTest, InitializeParamsRequiresTopology) {
+  HierarchicalRingReducer reducer;
+  CollectiveParams single_task = SetUpCollectiveParams(1, 4);
+  single_task.default_rank = 0;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      reducer.InitializeCollectiveParams(&single_task)));
+
+  CollectiveParams single_device = SetUpCollectiveParams(4, 1);
+  single_device.default_rank = 0;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      reducer.InitializeCollectiveParams(&single_device)));
+
+  CollectiveParams uneven = SetUpCollectiveParams(2, 2);
+  uneven.instance.same_num_devices_per_task = false;
+  uneven.default_rank = 0;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      reducer.InitializeCollectiveParams(&uneven)));
+}
+
+#define DEF_TEST(B, T, D, L)                                  \
+  TEST_F(HierarchicalRingReducerTest,                         \
+         DaTy##B##_Tasks##T##_DevPerTask##D##_Len##L) {       \
+    DataType dtype = DT_##B;                                  \
+    switch (dtype) {                                          \
+      case DT_FLOAT: {                                        \
+        RunTest<float>(dtype, T, D, L);                       \
+      } break;                                                \
+      case DT_DOUBLE: {                                       \
+        RunTest<double>(dtype, T, D, L);                      \
+      } break;                                                \
+      case DT_INT32: {                                        \
+        RunTest<int32>(dtype, T, D, L);                       \
+      } break;                                                \
+      default:                                                \
+        LOG(FATAL) << "Unimplemented";                        \
+    }                                                         \
+  }
+
+// Test cases with empty chunks.
+DEF_TEST(FLOAT, 2, 2, 1)
+DEF_TEST(FLOAT, 2, 4, 3)
+// Regular test cases.
+DEF_TEST(FLOAT, 2, 2, 1001)
+DEF_TEST(FLOAT, 2, 8, 4096)
+DEF_TEST(FLOAT, 3, 4, 4095)
+DEF_TEST(FLOAT, 4, 4, 1045991)
+DEF_TEST(DOUBLE, 2, 3, 1023)
+DEF_TEST(INT32, 3, 2, 1001)
+DEF_TEST(INT32, 4, 8, 4095)
+
+}  // namespace
+}  // namespace tensorflow
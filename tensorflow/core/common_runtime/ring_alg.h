@@ -80,6 +80,10 @@ class RingAlg : public CollectiveImplementationInterface {
     bool is_final = false;  // is the last field in the pass for this rank
     Tensor chunk;           // alias to field values
     Tensor tmp_chunk;
+    // If set, values are sent and recv'd in the encoded form wire_chunk,
+    // which the subclass converts from and to chunk or tmp_chunk.
+    bool use_wire_chunk = false;
+    Tensor wire_chunk;
     Status status;
     string DebugString() const;
   };
@@ -49,6 +49,41 @@ Status RingReducer::InitializeCollectiveParams(CollectiveParams* col_params) {
   // TODO(b/113171733): change CHECKs to return errors.
   CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
   CHECK_EQ(col_params->instance.impl_details.collective_name, "RingReduce");
+  const CollImplDetails& impl_details = col_params->instance.impl_details;
+  CollectiveCompression compression;
+  TF_RETURN_IF_ERROR(
+      ParseCollectiveCompression(impl_details.compression, &compression));
+  if (compression != CollectiveCompression::kNone) {
+    if (col_params->instance.data_type != DT_FLOAT) {
+      return errors::InvalidArgument(
+          "Collective compression ", impl_details.compression,
+          " requires float values, got ",
+          DataTypeString(col_params->instance.data_type), " in ",
+          col_params->name);
+    }
+    if (col_params->group.device_type != DEVICE_CPU) {
+      return errors::Unimplemented(
+          "Collective compression is only supported on CPU devices, got ",
+          col_params->group.device_type.type_string(), " in ",
+          col_params->name);
+    }
+    if (compression == CollectiveCompression::kTopK) {
+      if (!(impl_details.compression_topk_ratio > 0 &&
+            impl_details.compression_topk_ratio <= 1)) {
+        return errors::InvalidArgument(
+            "compression_topk_ratio must be in (0, 1], got ",
+            impl_details.compression_topk_ratio, " in ", col_params->name);
+      }
+      // The values that are not sent are fed back into the next reduction as
+      // if this device had contributed them, which requires a sum.
+      if (col_params->merge_op != nullptr &&
+          col_params->merge_op->type_string() != "Add") {
+        return errors::InvalidArgument(
+            "Collective compression topk requires merge_op Add, got ",
+            col_params->merge_op->type_string(), " in ", col_params->name);
+      }
+    }
+  }
   return RingAlg::InitializeCollectiveParams(col_params);
 }
 
@@ -116,6 +151,13 @@ void RingReducer::Run(StatusCallback done) {
 // Note that this function is blocking and must not run in any thread
 // which cannot be blocked.
 void RingReducer::ContinueAfterInputCopy() {
+  Status status = InitCompression();
+  if (!status.ok()) {
+    group_size_tensor_ready_.Notify();
+    done_(status);
+    return;
+  }
+
   AllocatorAttributes attr = col_ctx_->op_ctx->output_alloc_attr(0);
   ca_.reset(MakeCollectiveAdapter(col_ctx_->output, group_size_ * num_subdivs_,
                                   col_ctx_->device->GetAllocator(attr)));
@@ -158,7 +200,72 @@ void RingReducer::ContinueAfterInputCopy() {
     // Value won't be used, so no need to initialize.
     group_size_tensor_ready_.Notify();
   }
-  Finish(RunAsyncParts());
+  const bool ok = RunAsyncParts();
+  // If the reduction was aborted, the residual it applied is lost.
+  if (ok && residual_resource_) {
+    residual_resource_->Accumulate(residual_);
+  }
+  Finish(ok);
+}
+
+Status RingReducer::InitCompression() {
+  const CollImplDetails& impl_details = col_params_->instance.impl_details;
+  CollectiveCompression compression;
+  TF_RETURN_IF_ERROR(
+      ParseCollectiveCompression(impl_details.compression, &compression));
+  if (compression == CollectiveCompression::kNone || group_size_ == 1) {
+    return Status::OK();
+  }
+  codec_.reset(new CollectiveChunkCodec(compression,
+                                        impl_details.compression_topk_ratio));
+  if (compression == CollectiveCompression::kTopK) {
+    CollectiveCompressionResidual* residual_resource = nullptr;
+    TF_RETURN_IF_ERROR(CollectiveCompressionResidual::LookupOrCreate(
+        col_ctx_->device->resource_manager(), col_params_->group.group_key,
+        col_params_->instance.instance_key, &residual_resource));
+    residual_resource_.reset(residual_resource);
+    // Feed the values that previous executions did not send back into this
+    // one.
+    residual_resource_->ApplyTo(col_ctx_->output);
+    residual_ =
+        Tensor(DT_FLOAT, TensorShape({col_ctx_->output->NumElements()}));
+    residual_.flat<float>().setZero();
+  }
+  return Status::OK();
+}
+
+float* RingReducer::ResidualChunk(RingField* rf) {
+  const int64 offset = rf->chunk.unaligned_flat<float>().data() -
+                       ca_->Value().unaligned_flat<float>().data();
+  return residual_.flat<float>().data() + offset;
+}
+
+void RingReducer::EncodeChunk(RingField* rf) {
+  profiler::TraceMe activity("EncodeChunk", profiler::TraceMeLevel::kInfo);
+  if (!rf->second_pass) {
+    // A partial reduction, of which only this device keeps the values that
+    // are not sent.
+    codec_->Encode(rf->chunk, &rf->wire_chunk,
+                   residual_resource_ ? ResidualChunk(rf) : nullptr);
+  } else {
+    // The final value.  All devices must end up with what is sent, including
+    // the one that computed it, i.e. the one that did not recv it.
+    codec_->Encode(rf->chunk, &rf->wire_chunk, nullptr);
+    if (!rf->do_recv) {
+      codec_->Decode(rf->wire_chunk, &rf->chunk);
+    }
+  }
+}
+
+void RingReducer::DecodeChunk(RingField* rf) {
+  profiler::TraceMe activity("DecodeChunk", profiler::TraceMeLevel::kInfo);
+  codec_->Decode(rf->wire_chunk,
+                 rf->second_pass ? &rf->chunk : &rf->tmp_chunk);
+}
+
+void RingReducer::SparsifyFinalChunk(RingField* rf) {
+  codec_->Encode(rf->chunk, &rf->wire_chunk, ResidualChunk(rf));
+  codec_->Decode(rf->wire_chunk, &rf->chunk);
 }
 
 void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
@@ -167,6 +274,12 @@ void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
   if (rf->do_recv) {
     rf->tmp_chunk = ca_->TempChunk(rf->sc_idx);
   }
+  if (codec_ != nullptr && (rf->do_send || rf->do_recv)) {
+    rf->use_wire_chunk = true;
+    rf->wire_chunk = Tensor(
+        col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0)),
+        codec_->wire_dtype(), codec_->WireShape(rf->chunk.NumElements()));
+  }
 }
 
 // At the beginning of the algorithm initialize a RingField struct for
@@ -252,6 +365,9 @@ bool RingReducer::RunAsyncParts() {
           case RF_RECV:
             CHECK_GT(recv_pending_count, 0);
             --recv_pending_count;
+            if (rf->use_wire_chunk) {
+              DecodeChunk(rf);
+            }
             if (!rf->second_pass) {
               rf->action = RF_REDUCE;
               Status s = collective_util::ComputeBinOp(
@@ -266,6 +382,12 @@ bool RingReducer::RunAsyncParts() {
             }
             break;
           case RF_REDUCE:
+            if (!rf->second_pass && rf->is_final && codec_ != nullptr &&
+                codec_->compression() == CollectiveCompression::kTopK) {
+              // Sparsify the reduced value before it is finalized, so that
+              // the residual is in the units of the inputs.
+              SparsifyFinalChunk(rf);
+            }
             if (!rf->second_pass && col_params_->final_op.get() &&
                 rf->is_final) {
               rf->action = RF_FINALIZE;
@@ -287,6 +409,9 @@ bool RingReducer::RunAsyncParts() {
           case RF_SEND_READY:
             if (rf->do_send) {
               rf->action = RF_SEND;
+              if (rf->use_wire_chunk) {
+                EncodeChunk(rf);
+              }
               auto send_complete = [this, rf, &ready_queue,
                                     &aborted](Status s) {
                 if (!s.ok()) {
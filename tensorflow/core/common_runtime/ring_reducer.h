@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_compression.h"
 #include "tensorflow/core/common_runtime/ring_alg.h"
 #include "tensorflow/core/framework/collective.h"
 
@@ -49,9 +50,29 @@ class RingReducer : public RingAlg {
   void ContinueAfterInputCopy();
   bool RunAsyncParts();
 
+  // Sets up codec_ and residual_ for the compression requested in
+  // col_params_, if any.
+  Status InitCompression();
+  // Encodes rf->chunk into rf->wire_chunk before it is sent.
+  void EncodeChunk(RingField* rf);
+  // Decodes the rf->wire_chunk just recv'd into the chunk it is destined for.
+  void DecodeChunk(RingField* rf);
+  // Replaces rf->chunk, which holds a fully reduced value, with the top-k
+  // values sent in the second pass, and records the rest in residual_.
+  void SparsifyFinalChunk(RingField* rf);
+  // Returns the part of residual_ corresponding to rf->chunk.
+  float* ResidualChunk(RingField* rf);
+
   Tensor group_size_tensor_;
   Notification group_size_tensor_ready_;
 
+  // Encoding of the values sent between devices, null if not compressed.
+  std::unique_ptr<CollectiveChunkCodec> codec_;
+  // Values this device did not send, for error-feedback compression.  Added
+  // to the persistent residual_resource_ when the reduction completes.
+  Tensor residual_;
+  core::RefCountPtr<CollectiveCompressionResidual> residual_resource_;
+
   friend class RingReducerTest;
 };
 
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "absl/memory/memory.h"
 #include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_compression.h"
 #include "tensorflow/core/common_runtime/collective_rma_local.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
@@ -363,6 +365,67 @@ class RingReducerTest : public ::testing::Test {
     }
   }
 
+  // Runs a float reduction with on-the-wire `compression` on CPU and checks
+  // that all devices agree on a result within `tolerance` of the exact mean,
+  // once the values left in the error-feedback residuals are accounted for.
+  void RunCompressionTest(const string& compression, float topk_ratio,
+                          int num_workers, int num_devices, int num_subdivs,
+                          int tensor_len, float tolerance) {
+    col_params_.instance.impl_details.compression = compression;
+    col_params_.instance.impl_details.compression_topk_ratio = topk_ratio;
+    Init(num_workers, num_devices, DT_FLOAT, DEVICE_CPU, num_subdivs,
+         /*fail_after=*/0);
+    const int group_size = num_workers * num_devices;
+    std::vector<float> sum(tensor_len, 0.0f);
+    for (int di = 0; di < group_size; ++di) {
+      instances_[di]->InitTensor(
+          DT_FLOAT, TensorShape({tensor_len}), [&sum, di](Tensor* t) {
+            for (int i = 0; i < t->NumElements(); ++i) {
+              float value = ((i * 7 + di * 13) % 101 - 50) / 7.0f;
+              t->flat<float>()(i) = value;
+              sum[i] += value;
+            }
+          });
+    }
+    Reduce(/*fail_after=*/0);
+
+    for (int di = 0; di < group_size; ++di) {
+      TF_ASSERT_OK(instances_[di]->status_);
+      test::ExpectTensorEqual<float>(instances_[di]->tensor_,
+                                     instances_[0]->tensor_);
+    }
+    std::vector<float> residual_sum(tensor_len, 0.0f);
+    int num_residuals = 0;
+    if (compression == "topk") {
+      for (int di = 0; di < group_size; ++di) {
+        CollectiveCompressionResidual* residual = nullptr;
+        TF_ASSERT_OK(CollectiveCompressionResidual::LookupOrCreate(
+            instances_[di]->device_->resource_manager(),
+            col_params_.group.group_key, col_params_.instance.instance_key,
+            &residual));
+        core::ScopedUnref unref(residual);
+        Tensor values(DT_FLOAT, TensorShape({tensor_len}));
+        values.flat<float>().setZero();
+        residual->ApplyTo(&values);
+        for (int i = 0; i < tensor_len; ++i) {
+          residual_sum[i] += values.flat<float>()(i);
+          if (values.flat<float>()(i) != 0) ++num_residuals;
+        }
+      }
+    }
+    if (topk_ratio < 1.0f) {
+      EXPECT_GT(num_residuals, 0);
+    } else {
+      EXPECT_EQ(num_residuals, 0);
+    }
+    auto actual = instances_[0]->tensor_.flat<float>();
+    for (int i = 0; i < tensor_len; ++i) {
+      EXPECT_NEAR(actual(i), (sum[i] - residual_sum[i]) / group_size,
+                  tolerance)
+          << "Mismatch at index " << i;
+    }
+  }
+
   std::unique_ptr<OpKernel> GetCollectiveReduce(const CollectiveParams& params,
                                                 Tensor* input,
                                                 const DeviceType& device_type,
@@ -417,6 +480,10 @@ class RingReducerTest : public ::testing::Test {
       col_params_.group.device_type = parent_->col_params_.group.device_type;
       col_params_.group.group_size = parent_->col_params_.group.group_size;
       col_params_.instance = parent->col_params_.instance;
+      col_params_.instance.impl_details.compression =
+          parent->col_params_.instance.impl_details.compression;
+      col_params_.instance.impl_details.compression_topk_ratio =
+          parent->col_params_.instance.impl_details.compression_topk_ratio;
       col_params_.task.is_local = parent_->col_params_.task.is_local;
       col_params_.subdiv_rank = parent_->col_params_.subdiv_rank;
 
@@ -700,6 +767,31 @@ DEF_TEST(INT64, CPU, 2, 8, 3, 4095, 0)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 1)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 7)
 DEF_TEST(FLOAT, CPU, 2, 8, 2, 9408, 11)
+
+// Compression tests
+TEST_F(RingReducerTest, CompressionFloat16) {
+  RunCompressionTest("float16", 0, 2, 4, 1, 1001, 0.05);
+}
+
+TEST_F(RingReducerTest, CompressionFloat16Subdivs) {
+  RunCompressionTest("float16", 0, 2, 8, 3, 4095, 0.05);
+}
+
+TEST_F(RingReducerTest, CompressionBFloat16) {
+  RunCompressionTest("bfloat16", 0, 2, 4, 1, 1001, 0.3);
+}
+
+TEST_F(RingReducerTest, CompressionTopK) {
+  RunCompressionTest("topk", 0.1, 2, 4, 1, 1001, 1e-4);
+}
+
+TEST_F(RingReducerTest, CompressionTopKSubdivs) {
+  RunCompressionTest("topk", 0.05, 2, 8, 3, 4095, 1e-4);
+}
+
+TEST_F(RingReducerTest, CompressionTopKAll) {
+  RunCompressionTest("topk", 1.0, 2, 4, 1, 1001, 1e-5);
+}
 #endif
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
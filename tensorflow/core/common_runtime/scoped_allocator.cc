@@ -139,6 +139,25 @@ void ScopedAllocator::DeallocateRaw(void* p) {
   }
 }
 
+void ScopedAllocator::Retire() {
+  ScopedAllocatorContainer* container = nullptr;
+  bool dead = false;
+  {
+    mutex_lock l(mu_);
+    if (expected_call_count_ > 0) {
+      VLOG(1) << "ScopedAllocator " << name_ << " retired with "
+              << expected_call_count_ << " expected calls outstanding";
+    }
+    expected_call_count_ = 0;
+    std::swap(container, container_);
+    dead = (0 == live_alloc_count_);
+  }
+  if (container) container->Unref();
+  if (dead) {
+    delete this;
+  }
+}
+
 bool ScopedAllocator::VerifyPointer(const void* p) {
   void* base = tbuf_->data();
   CHECK_GE(p, base);
@@ -188,6 +207,23 @@ void ScopedAllocatorInstance::DropFromTable() {
   if (del) delete this;
 }
 
+void ScopedAllocatorInstance::DropFromTableAfterStep() {
+  bool del = false;
+  {
+    mutex_lock l(mu_);
+    CHECK(in_table_);
+    in_table_ = false;
+    VLOG(2) << "ScopedAllocatorInstance::DropFromTableAfterStep " << this
+            << " allocated_ " << allocated_ << " deallocated_ " << deallocated_;
+    // No further allocation can race with this call, so a slice that was
+    // never allocated will never be.
+    if (!allocated_ || deallocated_) {
+      del = true;
+    }
+  }
+  if (del) delete this;
+}
+
 void* ScopedAllocatorInstance::AllocateRaw(size_t alignment, size_t num_bytes) {
   void* ptr = scoped_allocator_->AllocateRaw(field_index_, num_bytes);
   {
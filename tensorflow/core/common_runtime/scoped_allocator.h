@@ -63,11 +63,16 @@ class ScopedAllocator {
   const string& name() const { return name_; }
 
  private:
+  friend class ScopedAllocatorContainer;
   friend class ScopedAllocatorInstance;
   // Only ScopedAllocatorInstances can call AllocateRaw and DeallocateRaw on a
   // ScopedAllocator
   void* AllocateRaw(int32 field_index, size_t num_bytes) TF_LOCKS_EXCLUDED(mu_);
   void DeallocateRaw(void* p) TF_LOCKS_EXCLUDED(mu_);
+  // Gives up on any remaining expected calls.  Called by the
+  // ScopedAllocatorContainer once it has dropped this object and its fields
+  // from its table.  May delete this.
+  void Retire() TF_LOCKS_EXCLUDED(mu_);
   Tensor backing_tensor_;
   TensorBuffer* tbuf_;
   int32 id_;
@@ -99,6 +104,10 @@ class ScopedAllocatorInstance : public Allocator {
   // on the underlying ScopedAllocatorInstance.  If this instance has already
   // deallocated the tensor slice, we can safely delete this.
   void DropFromTable() TF_LOCKS_EXCLUDED(mu_);
+  // Like DropFromTable(), but also deletes this instance if it was never
+  // allocated.  Only safe once no more calls to AllocateRaw can happen, i.e.
+  // after graph execution of the associated step has ceased.
+  void DropFromTableAfterStep() TF_LOCKS_EXCLUDED(mu_);
   void* AllocateRaw(size_t alignment, size_t num_bytes)
       TF_LOCKS_EXCLUDED(mu_) override;
   void* AllocateRaw(size_t alignment, size_t num_bytes,
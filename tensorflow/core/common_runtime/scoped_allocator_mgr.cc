@@ -96,6 +96,30 @@ void ScopedAllocatorContainer::Drop(int32 scope_id, ScopedAllocator* sa) {
   }
 }
 
+void ScopedAllocatorContainer::Release(int32 scope_id) {
+  VLOG(2) << "Release " << scope_id << " from container " << this << " step "
+          << step_id_ << " on " << mgr_->device_name();
+  ScopedAllocator* sa = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = allocators_.find(scope_id);
+    // Nothing to do if all of the expected allocations were made.
+    if (it == allocators_.end()) return;
+    CHECK_EQ(ScopedAllocator::kBackingIndex, it->second.field_index);
+    sa = it->second.scoped_allocator;
+    for (const auto& f : sa->fields_) {
+      auto field_it = allocators_.find(f.scope_id);
+      if (field_it != allocators_.end()) {
+        field_it->second.instance->DropFromTableAfterStep();
+        allocators_.erase(field_it);
+      }
+    }
+    allocators_.erase(it);
+  }
+  // May drop the last reference to this container.
+  sa->Retire();
+}
+
 ScopedAllocatorContainer::~ScopedAllocatorContainer() {
   VLOG(2) << "~ScopedAllocatorContainer " << this << " step " << step_id_
           << " on " << mgr_->device_name();
@@ -136,6 +160,18 @@ void ScopedAllocatorMgr::Cleanup(int64 step_id) {
   }
 }
 
+void ScopedAllocatorMgr::Release(int64 step_id, int32 scope_id) {
+  ScopedAllocatorContainer* sac = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = per_step_map_.find(step_id);
+    if (it == per_step_map_.end()) return;
+    sac = it->second;
+  }
+  // The reference held by per_step_map_ keeps sac alive until Cleanup().
+  sac->Release(scope_id);
+}
+
 ScopedAllocatorContainer* ScopedAllocatorMgr::GetContainer(int64 step_id) {
   VLOG(2) << "GetContainer " << step_id << " on " << device_name();
   ScopedAllocatorContainer* sac = nullptr;
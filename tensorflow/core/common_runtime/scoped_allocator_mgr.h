@@ -42,6 +42,13 @@ class ScopedAllocatorContainer : public core::RefCounted {
   // Retire the scope_id.
   void Drop(int32 scope_id, ScopedAllocator* sa);
 
+  // Retires the ScopedAllocator scope_id together with all of its fields, even
+  // if some of its expected allocations were never made (e.g. because a
+  // kernel produced an output without allocating it).  Slices that are still
+  // live remain valid until they are deallocated.  Must only be called once
+  // graph execution of the step has ceased.
+  void Release(int32 scope_id);
+
  protected:
   friend class ScopedAllocatorMgr;
   ScopedAllocatorContainer(const ScopedAllocatorMgr* mgr, int64 step_id)
@@ -87,6 +94,10 @@ class ScopedAllocatorMgr {
 
   void Cleanup(int64 step_id);
 
+  // Calls ScopedAllocatorContainer::Release on the container of step_id, if
+  // there is one.
+  void Release(int64 step_id, int32 scope_id);
+
   // Populate the bytes and offset members of Field.  Instance allocaters get
   // consecutive scope_id values following that of the base ScopedAllocator.
   // Returns the total number of bytes required to be allocated in the
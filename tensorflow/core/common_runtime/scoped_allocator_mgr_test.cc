@@ -177,6 +177,31 @@ TEST_F(ScopedAllocatorMgrTest, AllocatorSuccess) {
   inst2->DeallocateRaw(ptr2);
 }
 
+// Releasing a ScopedAllocator whose fields were only partially used should
+// drop all of its scopes, while keeping the used slice valid.
+TEST_F(ScopedAllocatorMgrTest, ReleaseUnusedFields) {
+  backing_tensor_shape_ = TensorShape({1024});
+  fields_shapes_ = std::vector<TensorShape>({{512}, {512}});
+  Status s = PrepScopedAllocatorMgr(2);
+  EXPECT_TRUE(s.ok());
+
+  ScopedAllocatorContainer* sac = sam_.GetContainer(step_id_);
+  ScopedAllocatorInstance* inst0 = sac->GetInstance(scope_id_ + 1);
+  char* ptr0 = static_cast<char*>(inst0->AllocateRaw(0, 512 * sizeof(float)));
+  EXPECT_NE(nullptr, ptr0);
+
+  // The second field is never allocated.
+  sam_.Release(step_id_, scope_id_);
+  EXPECT_EQ(nullptr, sac->GetAllocator(scope_id_));
+  // Releasing twice is a no-op.
+  sam_.Release(step_id_, scope_id_);
+
+  // The live slice is still usable, and is returned after the release.
+  ptr0[0] = 1;
+  inst0->DeallocateRaw(ptr0);
+  sam_.Cleanup(step_id_);
+}
+
 // ScopedAllocator initialization should fail because backing_tensor is not
 // large enough to hold all the fields
 TEST_F(ScopedAllocatorMgrTest, AllocatorInitFail) {
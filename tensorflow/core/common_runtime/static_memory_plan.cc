@@ -0,0 +1,370 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/flatset.h"
+
+namespace tensorflow {
+namespace {
+
+// The ancestor sets used to check that two tensors are never live at the same
+// time are quadratic in the number of nodes, so larger graphs aren't planned.
+constexpr int kMaxNodesForStaticMemoryPlan = 1 << 14;
+
+// Returns true if the kernel of `n` usually returns one of its inputs (or a
+// view of it) rather than allocating its output, so that planning its output
+// would only waste arena space.
+bool ForwardsInput(const Node* n) {
+  static const gtl::FlatSet<string>* const kForwardingOps =
+      new gtl::FlatSet<string>{
+          "Bitcast",         "CheckNumerics", "EnsureShape",
+          "ExpandDims",      "IdentityN",     "PreventGradient",
+          "Reshape",         "Squeeze",       "StopGradient"};
+  return n->IsIdentity() || kForwardingOps->count(n->type_string()) > 0;
+}
+
+// Returns true if a tensor consumed by `n` may outlive the step, or be kept
+// alive by something other than the dataflow of the graph.
+bool MayRetainInput(const Node* n) {
+  return n->IsRetval() || n->IsSend() || n->IsFunctionCall() ||
+         n->IsScopedAllocator() || n->op_def().is_stateful();
+}
+
+class StaticMemoryPlanner {
+ public:
+  StaticMemoryPlanner(const Graph& graph,
+                      const std::vector<PartialTensorShape>& arg_shapes)
+      : graph_(graph),
+        arg_shapes_(arg_shapes),
+        refiner_(graph.versions(), graph.op_registry()) {}
+
+  Status Plan(StaticMemoryPlan* plan);
+
+ private:
+  struct Buffer {
+    const Node* producer;
+    int output;
+    size_t bytes;
+    size_t aligned_bytes;
+    // Ids of the nodes that may hold a reference to the buffer, including its
+    // producer.
+    std::vector<int> holders;
+    size_t offset = 0;
+  };
+
+  Status InferShapes(const std::vector<Node*>& order);
+  // Returns the size of output `output` of `n`, or -1 if it isn't known.
+  int64 OutputBytes(const Node* n, int output) const;
+  bool IsPlannable(const Node* n) const;
+  // Collects the nodes that may hold a reference to the given output. Returns
+  // false if the output may escape the dataflow of the graph.
+  bool CollectHolders(const Node* n, int output, std::vector<int>* holders);
+  void ComputeAncestors(const std::vector<Node*>& order);
+  // Returns true if `a` and `b` may share memory: either all holders of `a`
+  // complete before `b` is produced, or vice versa.
+  bool CanShare(const Buffer& a, const Buffer& b) const;
+  bool AllHoldersPrecede(const Buffer& a, const Node* n) const;
+
+  const Graph& graph_;
+  const std::vector<PartialTensorShape>& arg_shapes_;
+  ShapeRefiner refiner_;
+  // ancestors_[id] is a bit vector of the ids of the ancestors of node id.
+  std::vector<std::vector<uint64>> ancestors_;
+};
+
+Status StaticMemoryPlanner::InferShapes(const std::vector<Node*>& order) {
+  for (const Node* n : order) {
+    TF_RETURN_IF_ERROR(refiner_.AddNode(n));
+    if (!n->IsArg()) continue;
+    int index;
+    TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "index", &index));
+    if (index >= 0 && index < arg_shapes_.size()) {
+      shape_inference::InferenceContext* ctx = refiner_.GetContext(n);
+      shape_inference::ShapeHandle shape;
+      TF_RETURN_IF_ERROR(
+          ctx->MakeShapeFromPartialTensorShape(arg_shapes_[index], &shape));
+      TF_RETURN_IF_ERROR(refiner_.SetShape(n, 0, shape));
+    }
+  }
+  return Status::OK();
+}
+
+int64 StaticMemoryPlanner::OutputBytes(const Node* n, int output) const {
+  shape_inference::InferenceContext* ctx = refiner_.GetContext(n);
+  if (ctx == nullptr || output >= ctx->num_outputs()) return -1;
+  shape_inference::ShapeHandle shape = ctx->output(output);
+  if (!ctx->FullyDefined(shape)) return -1;
+  return ctx->Value(ctx->NumElements(shape)) *
+         DataTypeSize(BaseType(n->output_type(output)));
+}
+
+bool StaticMemoryPlanner::IsPlannable(const Node* n) const {
+  if (!n->IsOp() || n->IsArg() || n->IsRecv() || n->IsConstant() ||
+      n->IsFunctionCall() || n->IsScopedAllocator() || ForwardsInput(n) ||
+      n->op_def().is_stateful()) {
+    return false;
+  }
+  // Nodes already using a ScopedAllocator (e.g. from the Grappler
+  // ScopedAllocatorOptimizer) are left alone.
+  return n->attrs().Find("_scoped_allocator") == nullptr;
+}
+
+bool StaticMemoryPlanner::CollectHolders(const Node* n, int output,
+                                         std::vector<int>* holders) {
+  holders->push_back(n->id());
+  std::vector<std::pair<const Node*, int>> stack = {{n, output}};
+  gtl::FlatSet<int64> visited;
+  while (!stack.empty()) {
+    const Node* src = stack.back().first;
+    const int src_output = stack.back().second;
+    stack.pop_back();
+    const int64 src_bytes = OutputBytes(src, src_output);
+    const DataType src_type = src->output_type(src_output);
+    for (const Edge* e : src->out_edges()) {
+      if (e->IsControlEdge() || e->src_output() != src_output) continue;
+      const Node* dst = e->dst();
+      if (MayRetainInput(dst)) return false;
+      holders->push_back(dst->id());
+      // Any output of a consumer may be a view of its input as long as it is
+      // not larger, in which case the consumers of that output hold the
+      // buffer as well.
+      for (int i = 0; i < dst->num_outputs(); ++i) {
+        if (dst->output_type(i) != src_type &&
+            dst->type_string() != "Bitcast") {
+          continue;
+        }
+        const int64 dst_bytes = OutputBytes(dst, i);
+        if (dst_bytes >= 0 && src_bytes >= 0 && dst_bytes > src_bytes) continue;
+        if (visited.insert((static_cast<int64>(dst->id()) << 32) | i).second) {
+          stack.emplace_back(dst, i);
+        }
+      }
+    }
+  }
+  std::sort(holders->begin(), holders->end());
+  holders->erase(std::unique(holders->begin(), holders->end()),
+                 holders->end());
+  return true;
+}
+
+void StaticMemoryPlanner::ComputeAncestors(const std::vector<Node*>& order) {
+  const int num_words = (graph_.num_node_ids() + 63) / 64;
+  ancestors_.assign(graph_.num_node_ids(), std::vector<uint64>(num_words, 0));
+  // The reverse post order visits the sources of the in-edges of a node before
+  // the node itself.
+  for (const Node* n : order) {
+    std::vector<uint64>& ancestors = ancestors_[n->id()];
+    for (const Edge* e : n->in_edges()) {
+      const int src_id = e->src()->id();
+      const std::vector<uint64>& src_ancestors = ancestors_[src_id];
+      for (int i = 0; i < num_words; ++i) {
+        ancestors[i] |= src_ancestors[i];
+      }
+      ancestors[src_id / 64] |= uint64{1} << (src_id % 64);
+    }
+  }
+}
+
+bool StaticMemoryPlanner::AllHoldersPrecede(const Buffer& a,
+                                            const Node* n) const {
+  const std::vector<uint64>& ancestors = ancestors_[n->id()];
+  for (int holder : a.holders) {
+    if ((ancestors[holder / 64] & (uint64{1} << (holder % 64))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StaticMemoryPlanner::CanShare(const Buffer& a, const Buffer& b) const {
+  return AllHoldersPrecede(a, b.producer) || AllHoldersPrecede(b, a.producer);
+}
+
+Status StaticMemoryPlanner::Plan(StaticMemoryPlan* plan) {
+  if (graph_.num_node_ids() > kMaxNodesForStaticMemoryPlan) {
+    VLOG(1) << "Not computing a static memory plan for a graph with "
+            << graph_.num_node_ids() << " nodes";
+    return Status::OK();
+  }
+  for (const Node* n : graph_.op_nodes()) {
+    if (n->IsControlFlow()) {
+      VLOG(1) << "Not computing a static memory plan for a graph with "
+              << "control flow";
+      return Status::OK();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph_, &order);
+  Status s = InferShapes(order);
+  if (!s.ok()) {
+    VLOG(1) << "Not computing a static memory plan: " << s;
+    return Status::OK();
+  }
+
+  std::vector<Buffer> buffers;
+  for (const Node* n : order) {
+    if (!IsPlannable(n)) continue;
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const DataType dtype = n->output_type(i);
+      if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype)) continue;
+      const int64 bytes = OutputBytes(n, i);
+      // Empty tensors are never allocated.
+      if (bytes <= 0) continue;
+      Buffer buffer;
+      buffer.producer = n;
+      buffer.output = i;
+      buffer.bytes = bytes;
+      buffer.aligned_bytes = Allocator::kAllocatorAlignment *
+                             ((bytes + Allocator::kAllocatorAlignment - 1) /
+                              Allocator::kAllocatorAlignment);
+      if (!CollectHolders(n, i, &buffer.holders)) continue;
+      buffers.push_back(std::move(buffer));
+    }
+  }
+  if (buffers.empty()) return Status::OK();
+
+  ComputeAncestors(order);
+
+  // Assign offsets greedily, largest buffers first, picking the smallest gap
+  // that fits among the buffers that may be live at the same time.
+  std::vector<Buffer*> sorted_buffers;
+  for (Buffer& buffer : buffers) sorted_buffers.push_back(&buffer);
+  std::stable_sort(sorted_buffers.begin(), sorted_buffers.end(),
+                   [](const Buffer* a, const Buffer* b) {
+                     return a->aligned_bytes > b->aligned_bytes;
+                   });
+  std::vector<const Buffer*> assigned;
+  size_t arena_bytes = 0;
+  size_t total_bytes = 0;
+  for (Buffer* buffer : sorted_buffers) {
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    for (const Buffer* other : assigned) {
+      if (!CanShare(*buffer, *other)) {
+        conflicts.emplace_back(other->offset,
+                               other->offset + other->aligned_bytes);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end());
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t current = 0;
+    for (const auto& conflict : conflicts) {
+      if (conflict.first > current) {
+        const size_t gap = conflict.first - current;
+        if (gap >= buffer->aligned_bytes && gap < best_gap) {
+          best_gap = gap;
+          best_offset = current;
+        }
+      }
+      current = std::max(current, conflict.second);
+    }
+    buffer->offset =
+        best_gap == std::numeric_limits<size_t>::max() ? current : best_offset;
+    arena_bytes = std::max(arena_bytes, buffer->offset + buffer->aligned_bytes);
+    total_bytes += buffer->aligned_bytes;
+    assigned.push_back(buffer);
+  }
+
+  plan->scope_id = kStaticMemoryPlanScopeId;
+  plan->arena_bytes = arena_bytes;
+  plan->total_bytes = total_bytes;
+  plan->fields.clear();
+  plan->outputs.clear();
+  for (const Buffer& buffer : buffers) {
+    ScopedAllocator::Field field;
+    field.scope_id = plan->scope_id + 1 + plan->fields.size();
+    field.offset = buffer.offset;
+    field.bytes_requested = buffer.bytes;
+    field.bytes_allocated = buffer.aligned_bytes;
+    plan->fields.push_back(field);
+    plan->outputs.emplace_back(buffer.producer->id(), buffer.output);
+  }
+  VLOG(1) << "Static memory plan for " << plan->fields.size()
+          << " tensors uses an arena of " << plan->arena_bytes << " bytes ("
+          << plan->total_bytes << " bytes without reuse)";
+  return Status::OK();
+}
+
+}  // namespace
+
+Status ComputeStaticMemoryPlan(
+    const Graph& graph, const std::vector<PartialTensorShape>& arg_shapes,
+    StaticMemoryPlan* plan) {
+  *plan = StaticMemoryPlan();
+  StaticMemoryPlanner planner(graph, arg_shapes);
+  return planner.Plan(plan);
+}
+
+Status AnnotateGraphWithStaticMemoryPlan(const StaticMemoryPlan& plan,
+                                         Graph* graph) {
+  std::unordered_map<Node*, std::vector<int>> scoped_allocator_attrs;
+  for (int i = 0; i < plan.fields.size(); ++i) {
+    Node* n = graph->FindNodeId(plan.outputs[i].first);
+    if (n == nullptr) {
+      return errors::Internal("Static memory plan refers to missing node ",
+                              plan.outputs[i].first);
+    }
+    std::vector<int>& attr = scoped_allocator_attrs[n];
+    attr.push_back(plan.outputs[i].second);
+    attr.push_back(plan.fields[i].scope_id);
+  }
+  for (auto& it : scoped_allocator_attrs) {
+    it.first->AddAttr("_scoped_allocator", it.second);
+  }
+  return Status::OK();
+}
+
+Status AllocateStaticMemoryArena(const StaticMemoryPlan& plan, Device* device,
+                                 int64 step_id) {
+  ScopedAllocatorMgr* sam = device->GetScopedAllocatorMgr();
+  if (sam == nullptr) {
+    return errors::Internal("Device ", device->name(),
+                            " does not support static memory plans");
+  }
+  Tensor arena(device->GetAllocator(AllocatorAttributes()), DT_INT8,
+               TensorShape({static_cast<int64>(plan.arena_bytes)}));
+  if (!arena.IsInitialized()) {
+    return errors::ResourceExhausted("OOM when allocating a static memory arena"
+                                     " of ",
+                                     plan.arena_bytes, " bytes on ",
+                                     device->name());
+  }
+  return sam->AddScopedAllocator(arena, step_id, plan.scope_id,
+                                 "static_memory_plan", plan.fields,
+                                 plan.fields.size());
+}
+
+void ReleaseStaticMemoryArena(const StaticMemoryPlan& plan, Device* device,
+                              int64 step_id) {
+  ScopedAllocatorMgr* sam = device->GetScopedAllocatorMgr();
+  if (sam != nullptr) {
+    sam->Release(step_id, plan.scope_id);
+  }
+}
+
+}  // namespace tensorflow
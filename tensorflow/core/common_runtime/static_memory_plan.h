@@ -0,0 +1,88 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/scoped_allocator.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// A static assignment of the intermediate tensors of a graph to offsets in a
+// single per-step arena.
+//
+// The plan is executed through the ScopedAllocator machinery: each planned
+// output is marked with a "_scoped_allocator" attribute pointing at one field
+// of a ScopedAllocator whose backing tensor is the arena. Before each step the
+// arena is allocated in one call to the device allocator and registered with
+// the device's ScopedAllocatorMgr; after the step it is released again.
+//
+// Two tensors only share arena memory if every node that may hold a reference
+// to the first one is an ancestor of the producer of the second one, so the
+// plan is valid for any schedule the executor may pick, including parallel
+// ones.
+struct StaticMemoryPlan {
+  // Scope id of the ScopedAllocator backing the arena. The fields use the
+  // consecutive ids that follow it.
+  int32 scope_id = 0;
+  // Size of the arena.
+  size_t arena_bytes = 0;
+  // Sum of the sizes of all planned tensors, i.e. the arena size that would be
+  // needed without any reuse.
+  size_t total_bytes = 0;
+  // One field per planned tensor.
+  std::vector<ScopedAllocator::Field> fields;
+  // The (node id, output index) pair producing each field.
+  std::vector<std::pair<int, int>> outputs;
+
+  bool empty() const { return fields.empty(); }
+};
+
+// Scope id used for the arena of static memory plans. It is far above the ids
+// handed out by the ScopedAllocatorOptimizer so that both can coexist.
+constexpr int32 kStaticMemoryPlanScopeId = 1 << 30;
+
+// Computes a static memory plan for the tensors of `graph` whose shapes are
+// fully defined. `arg_shapes[i]` is the shape of the i-th `_Arg` of the graph,
+// if known. Graphs with control flow or too many nodes get an empty plan.
+Status ComputeStaticMemoryPlan(
+    const Graph& graph, const std::vector<PartialTensorShape>& arg_shapes,
+    StaticMemoryPlan* plan);
+
+// Annotates the nodes of `graph` so that the executor allocates their planned
+// outputs from the arena. `graph` must be the graph the plan was computed
+// for.
+Status AnnotateGraphWithStaticMemoryPlan(const StaticMemoryPlan& plan,
+                                         Graph* graph);
+
+// Allocates the arena of `plan` for step `step_id` on `device`.
+Status AllocateStaticMemoryArena(const StaticMemoryPlan& plan, Device* device,
+                                 int64 step_id);
+
+// Releases the arena of `plan` for step `step_id` on `device`. Must be called
+// after graph execution for the step has ceased. Tensors that are still
+// referenced (e.g. fetched outputs) keep the arena alive until they are
+// deallocated.
+void ReleaseStaticMemoryArena(const StaticMemoryPlan& plan, Device* device,
+                              int64 step_id);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
@@ -0,0 +1,160 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the index of the field planned for output 0 of `n`, or -1.
+int FieldForNode(const StaticMemoryPlan& plan, const Node* n) {
+  for (int i = 0; i < plan.outputs.size(); ++i) {
+    if (plan.outputs[i] == std::make_pair(n->id(), 0)) return i;
+  }
+  return -1;
+}
+
+bool Overlap(const ScopedAllocator::Field& a, const ScopedAllocator::Field& b) {
+  return a.offset < b.offset + b.bytes_allocated &&
+         b.offset < a.offset + a.bytes_allocated;
+}
+
+class StaticMemoryPlanTest : public ::testing::Test {
+ protected:
+  StaticMemoryPlanTest() : graph_(OpRegistry::Global()) {}
+
+  // Builds arg -> Square -> Cast -> Square -> Cast -> Square -> Cast -> retval,
+  // alternating between float and double, so that no tensor can be forwarded
+  // to a consumer of a different type.
+  void BuildChain() {
+    Node* arg = test::graph::Arg(&graph_, 0, DT_FLOAT);
+    Node* prev = arg;
+    for (int i = 0; i < 3; ++i) {
+      Node* square = test::graph::Unary(&graph_, "Square", prev);
+      Node* cast =
+          test::graph::Cast(&graph_, square, i % 2 == 0 ? DT_DOUBLE : DT_FLOAT);
+      squares_.push_back(square);
+      casts_.push_back(cast);
+      prev = cast;
+    }
+    test::graph::Retval(&graph_, 0, prev);
+  }
+
+  Graph graph_;
+  std::vector<Node*> squares_;
+  std::vector<Node*> casts_;
+};
+
+TEST_F(StaticMemoryPlanTest, ReusesMemoryAlongChain) {
+  BuildChain();
+  StaticMemoryPlan plan;
+  TF_ASSERT_OK(
+      ComputeStaticMemoryPlan(graph_, {PartialTensorShape({256})}, &plan));
+  // Every intermediate tensor is planned, except the fetched one.
+  EXPECT_EQ(5, plan.fields.size());
+  EXPECT_EQ(-1, FieldForNode(plan, casts_[2]));
+  size_t sum_bytes = 0;
+  for (const auto& field : plan.fields) {
+    EXPECT_LE(field.offset + field.bytes_allocated, plan.arena_bytes);
+    EXPECT_EQ(0, field.offset % Allocator::kAllocatorAlignment);
+    sum_bytes += field.bytes_allocated;
+  }
+  EXPECT_EQ(sum_bytes, plan.total_bytes);
+  EXPECT_LT(plan.arena_bytes, sum_bytes);
+
+  const int first = FieldForNode(plan, squares_[0]);
+  const int second = FieldForNode(plan, squares_[1]);
+  const int third = FieldForNode(plan, squares_[2]);
+  const int first_cast = FieldForNode(plan, casts_[0]);
+  const int second_cast = FieldForNode(plan, casts_[1]);
+  ASSERT_GE(first, 0);
+  ASSERT_GE(second, 0);
+  ASSERT_GE(third, 0);
+  ASSERT_GE(first_cast, 0);
+  ASSERT_GE(second_cast, 0);
+  // The output of the first Square is dead once the first Cast is done, so it
+  // shares memory with the output of the second Square. Likewise, the output
+  // of the first Cast and its views are dead once the second Cast is done, so
+  // the third Square reuses its memory.
+  EXPECT_EQ(plan.fields[first].offset, plan.fields[second].offset);
+  EXPECT_EQ(plan.fields[first_cast].offset, plan.fields[third].offset);
+  // A tensor never shares memory with the tensor it is computed from.
+  EXPECT_FALSE(Overlap(plan.fields[first], plan.fields[first_cast]));
+  EXPECT_FALSE(Overlap(plan.fields[first_cast], plan.fields[second]));
+  EXPECT_FALSE(Overlap(plan.fields[second], plan.fields[second_cast]));
+  EXPECT_FALSE(Overlap(plan.fields[second_cast], plan.fields[third]));
+}
+
+TEST_F(StaticMemoryPlanTest, ParallelBranchesDontShare) {
+  Node* arg = test::graph::Arg(&graph_, 0, DT_FLOAT);
+  Node* a = test::graph::Unary(&graph_, "Square", arg);
+  Node* b = test::graph::Unary(&graph_, "Neg", arg);
+  Node* sum = test::graph::Binary(&graph_, "Add", a, b);
+  Node* cast = test::graph::Cast(&graph_, sum, DT_DOUBLE);
+  test::graph::Retval(&graph_, 0, cast);
+
+  StaticMemoryPlan plan;
+  TF_ASSERT_OK(
+      ComputeStaticMemoryPlan(graph_, {PartialTensorShape({64})}, &plan));
+  const int a_field = FieldForNode(plan, a);
+  const int b_field = FieldForNode(plan, b);
+  ASSERT_GE(a_field, 0);
+  ASSERT_GE(b_field, 0);
+  // `a` and `b` may be computed in any order, so they can't share memory.
+  EXPECT_FALSE(Overlap(plan.fields[a_field], plan.fields[b_field]));
+}
+
+TEST_F(StaticMemoryPlanTest, UnknownShapes) {
+  BuildChain();
+  StaticMemoryPlan plan;
+  TF_ASSERT_OK(
+      ComputeStaticMemoryPlan(graph_, {PartialTensorShape({-1})}, &plan));
+  EXPECT_TRUE(plan.empty());
+}
+
+TEST_F(StaticMemoryPlanTest, AnnotateAndAllocate) {
+  BuildChain();
+  StaticMemoryPlan plan;
+  TF_ASSERT_OK(
+      ComputeStaticMemoryPlan(graph_, {PartialTensorShape({256})}, &plan));
+  TF_ASSERT_OK(AnnotateGraphWithStaticMemoryPlan(plan, &graph_));
+  std::vector<int32> attr;
+  TF_ASSERT_OK(GetNodeAttr(squares_[0]->attrs(), "_scoped_allocator", &attr));
+  ASSERT_EQ(2, attr.size());
+  EXPECT_EQ(0, attr[0]);
+  EXPECT_EQ(plan.fields[FieldForNode(plan, squares_[0])].scope_id, attr[1]);
+
+  std::unique_ptr<Device> device = DeviceFactory::NewDevice(
+      "CPU", SessionOptions(), "/job:a/replica:0/task:0");
+  ASSERT_NE(nullptr, device);
+  const int64 step_id = 17;
+  TF_ASSERT_OK(AllocateStaticMemoryArena(plan, device.get(), step_id));
+  ScopedAllocatorContainer* sac =
+      device->GetScopedAllocatorMgr()->GetContainer(step_id);
+  EXPECT_NE(nullptr, sac->GetAllocator(plan.scope_id));
+  // Releasing the arena without using it doesn't leak any field.
+  ReleaseStaticMemoryArena(plan, device.get(), step_id);
+  EXPECT_EQ(nullptr, sac->GetAllocator(plan.scope_id));
+  device->GetScopedAllocatorMgr()->Cleanup(step_id);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
 #include "tensorflow/core/data/service/credentials_factory.h"
+#include "tensorflow/core/data/service/element_batch.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/master.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
@@ -113,11 +114,13 @@ Status DataServiceMasterClient::GetOrCreateJob(int64 dataset_id,
 }
 
 Status DataServiceMasterClient::GetTasks(int64 job_id,
+                                         const std::string& consumer_host,
                                          std::vector<TaskInfo>* tasks,
                                          bool* job_finished) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
   GetTasksRequest req;
   req.set_job_id(job_id);
+  req.set_consumer_host(consumer_host);
   GetTasksResponse resp;
   grpc_impl::ClientContext ctx;
   grpc::Status s = stub_->GetTasks(&ctx, req, &resp);
@@ -176,7 +179,55 @@ Status DataServiceWorkerClient::GetElement(int64 task_id,
   return Status::OK();
 }
 
+Status DataServiceWorkerClient::GetElements(
+    int64 task_id, int64 max_elements, BatchCompression codec,
+    std::vector<std::vector<Tensor>>* elements, bool* end_of_sequence) {
+  if (max_elements <= 0) {
+    return errors::InvalidArgument("max_elements must be positive, got ",
+                                   max_elements);
+  }
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  GetElementRequest req;
+  req.set_task_id(task_id);
+  req.set_max_elements(max_elements);
+  req.set_batch_compression(codec);
+  GetElementResponse resp;
+  grpc_impl::ClientContext ctx;
+  grpc::Status s = stub_->GetElement(&ctx, req, &resp);
+  if (!s.ok()) {
+    return grpc_util::WrapError("Failed to get elements", s);
+  }
+  *end_of_sequence = resp.end_of_sequence();
+  elements->clear();
+  if (resp.element_batch().empty()) {
+    return Status::OK();
+  }
+  ElementBatch batch;
+  TF_RETURN_IF_ERROR(
+      UncompressElementBatch(resp.element_batch(), codec, &batch));
+  elements->reserve(batch.elements_size() + batch.uncompressed_elements_size());
+  for (CompressedElement& compressed : *batch.mutable_elements()) {
+    Tensor tensor(DT_VARIANT, TensorShape{});
+    tensor.scalar<Variant>()() = std::move(compressed);
+    elements->push_back({std::move(tensor)});
+  }
+  for (const UncompressedElement& element : batch.uncompressed_elements()) {
+    elements->emplace_back();
+    for (const TensorProto& proto : element.components()) {
+      Tensor tensor;
+      if (!tensor.FromProto(cpu_allocator(), proto)) {
+        return errors::Internal("Failed to parse element component");
+      }
+      elements->back().push_back(std::move(tensor));
+    }
+  }
+  return Status::OK();
+}
+
 Status DataServiceWorkerClient::EnsureInitialized() {
+  if (stub_) {
+    return Status::OK();
+  }
   std::shared_ptr<grpc::ChannelCredentials> credentials;
   TF_RETURN_IF_ERROR(
       CredentialsFactory::CreateClientCredentials(protocol_, &credentials));
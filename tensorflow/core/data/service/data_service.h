@@ -91,10 +91,12 @@ class DataServiceMasterClient : public DataServiceClientBase {
                         int64* job_id);
 
   // Queries the master for the tasks associated with the specified job.
-  // The tasks will be stored in *tasks, and whether the job is finished will
-  // be stored in `*job_finished`.
-  Status GetTasks(int64 job_id, std::vector<TaskInfo>* tasks,
-                  bool* job_finished);
+  // The tasks will be stored in *tasks, in the order in which a consumer on
+  // host `consumer_host` should prefer reading from them, and whether the job
+  // is finished will be stored in `*job_finished`. `consumer_host` may be empty
+  // if the consumer's host is unknown.
+  Status GetTasks(int64 job_id, const std::string& consumer_host,
+                  std::vector<TaskInfo>* tasks, bool* job_finished);
 
   // Queries the master for its registered workers. The worker info will be
   // stored in `*workers`.
@@ -120,6 +122,21 @@ class DataServiceWorkerClient : public DataServiceClientBase {
   Status GetElement(int64 task_id, CompressedElement* element,
                     bool* end_of_sequence);
 
+  // Fetches up to `max_elements` elements for the specified task_id in a
+  // single request, with the batch compressed as a whole using `codec` while
+  // in transit. The worker returns as soon as it has one element, with the
+  // elements it had already produced after it. `*elements` holds the fetched
+  // elements: a scalar variant tensor holding the `CompressedElement` of
+  // elements which the dataset compressed, or the components of the others.
+  // If the end of the task was reached, `*end_of_sequence` will be `true` and
+  // `*elements` holds the elements produced before the end.
+  //
+  // Once the client is initialized, `GetElements` may be called concurrently
+  // to pipeline requests to the worker.
+  Status GetElements(int64 task_id, int64 max_elements, BatchCompression codec,
+                     std::vector<std::vector<Tensor>>* elements,
+                     bool* end_of_sequence);
+
  protected:
   Status EnsureInitialized() override;
 
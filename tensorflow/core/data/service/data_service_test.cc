@@ -15,10 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/data_service.h"
 
+#include <algorithm>
+
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/master.grpc.pb.h"
 #include "tensorflow/core/data/service/master.pb.h"
@@ -29,7 +32,9 @@ limitations under the License.
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/kernels/data/dataset_test_base.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -37,8 +42,25 @@ namespace data {
 
 namespace {
 constexpr const char kProtocol[] = "grpc+local";
+
+// Registers the dataset of `test_case` and creates a job reading it.
+Status CreateJob(TestCluster* cluster,
+                 const test_util::GraphDefTestCase& test_case, int64* job_id) {
+  DataServiceMasterClient master(cluster->MasterAddress(), kProtocol);
+  int64 dataset_id;
+  TF_RETURN_IF_ERROR(master.RegisterDataset(test_case.graph_def, &dataset_id));
+  return master.CreateJob(dataset_id, ProcessingMode::PARALLEL_EPOCHS, job_id);
 }
 
+std::vector<std::string> WorkerAddresses(const std::vector<TaskInfo>& tasks) {
+  std::vector<std::string> addresses;
+  for (const TaskInfo& task : tasks) {
+    addresses.push_back(task.worker_address());
+  }
+  return addresses;
+}
+}  // namespace
+
 TEST(DataService, ParseParallelEpochsProcessingMode) {
   ProcessingMode mode;
   TF_ASSERT_OK(ParseProcessingMode("parallel_epochs", &mode));
@@ -72,5 +94,208 @@ TEST(DataService, GetWorkers) {
   EXPECT_EQ(1, workers.size());
 }
 
+TEST(DataService, ConfiguredWorkers) {
+  WorkerConfig worker_config;
+  worker_config.set_num_producer_threads(2);
+  worker_config.set_prefetch_buffer_size(4);
+  TestCluster cluster(2, worker_config);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceMasterClient master(cluster.MasterAddress(), kProtocol);
+  std::vector<WorkerInfo> workers;
+  TF_EXPECT_OK(master.GetWorkers(&workers));
+  EXPECT_EQ(2, workers.size());
+}
+
+TEST(DataService, GetElementsWithProducerThreads) {
+  WorkerConfig worker_config;
+  worker_config.set_num_producer_threads(2);
+  worker_config.set_prefetch_buffer_size(4);
+  TestCluster cluster(2, worker_config);
+  TF_ASSERT_OK(cluster.Initialize());
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::compressed_map_test_case(&test_case));
+  DataServiceMasterClient master(cluster.MasterAddress(), kProtocol);
+  int64 dataset_id;
+  TF_ASSERT_OK(master.RegisterDataset(test_case.graph_def, &dataset_id));
+  int64 job_id;
+  TF_ASSERT_OK(
+      master.CreateJob(dataset_id, ProcessingMode::PARALLEL_EPOCHS, &job_id));
+  std::vector<TaskInfo> tasks;
+  bool job_finished;
+  TF_ASSERT_OK(master.GetTasks(job_id, "localhost", &tasks, &job_finished));
+  ASSERT_EQ(tasks.size(), 2);
+
+  std::vector<int64> expected;
+  for (const std::vector<Tensor>& element : test_case.output) {
+    expected.push_back(element[0].scalar<int64>()());
+  }
+  for (const TaskInfo& task : tasks) {
+    DataServiceWorkerClient worker(task.worker_address(), kProtocol);
+    std::vector<int64> elements;
+    bool end_of_sequence = false;
+    while (!end_of_sequence) {
+      CompressedElement compressed;
+      TF_ASSERT_OK(worker.GetElement(task.id(), &compressed, &end_of_sequence));
+      if (!end_of_sequence) {
+        std::vector<Tensor> element;
+        TF_ASSERT_OK(UncompressElement(compressed, &element));
+        ASSERT_EQ(element.size(), 1);
+        elements.push_back(element[0].scalar<int64>()());
+      }
+    }
+    // The producer threads may reorder the elements.
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ(elements, expected);
+    // The finished task keeps reporting its end.
+    CompressedElement compressed;
+    TF_ASSERT_OK(worker.GetElement(task.id(), &compressed, &end_of_sequence));
+    EXPECT_TRUE(end_of_sequence);
+  }
+}
+
+TEST(DataService, GetUncompressedElementsInBatches) {
+  WorkerConfig worker_config;
+  worker_config.set_num_producer_threads(2);
+  worker_config.set_prefetch_buffer_size(8);
+  TestCluster cluster(1, worker_config);
+  TF_ASSERT_OK(cluster.Initialize());
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::map_test_case(&test_case));
+  DataServiceMasterClient master(cluster.MasterAddress(), kProtocol);
+  int64 dataset_id;
+  TF_ASSERT_OK(master.RegisterDataset(test_case.graph_def, &dataset_id));
+  int64 job_id;
+  TF_ASSERT_OK(
+      master.CreateJob(dataset_id, ProcessingMode::PARALLEL_EPOCHS, &job_id));
+  std::vector<TaskInfo> tasks;
+  bool job_finished;
+  TF_ASSERT_OK(master.GetTasks(job_id, "localhost", &tasks, &job_finished));
+  ASSERT_EQ(tasks.size(), 1);
+
+  std::vector<int64> expected;
+  for (const std::vector<Tensor>& element : test_case.output) {
+    expected.push_back(element[0].scalar<int64>()());
+  }
+  DataServiceWorkerClient worker(tasks[0].worker_address(), kProtocol);
+  std::vector<int64> elements;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<std::vector<Tensor>> batch;
+    TF_ASSERT_OK(worker.GetElements(tasks[0].id(), /*max_elements=*/4,
+                                    BATCH_COMPRESSION_SNAPPY, &batch,
+                                    &end_of_sequence));
+    EXPECT_LE(batch.size(), 4);
+    // The elements are not compressed by the dataset, so they arrive as their
+    // components.
+    for (const std::vector<Tensor>& element : batch) {
+      ASSERT_EQ(element.size(), 1);
+      ASSERT_EQ(element[0].dtype(), DT_INT64);
+      elements.push_back(element[0].scalar<int64>()());
+    }
+  }
+  std::sort(elements.begin(), elements.end());
+  EXPECT_EQ(elements, expected);
+}
+
+TEST(DataService, GetTasksPrefersLocalWorkers) {
+  TestCluster cluster(0);
+  TF_ASSERT_OK(cluster.Initialize());
+  WorkerConfig remote_config;
+  remote_config.set_worker_host("remote_host");
+  TF_ASSERT_OK(cluster.AddWorker(remote_config));
+  // Reports the host name of this machine, while its address is "localhost".
+  TF_ASSERT_OK(cluster.AddWorker(WorkerConfig()));
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::map_test_case(&test_case));
+  int64 job_id;
+  TF_ASSERT_OK(CreateJob(&cluster, test_case, &job_id));
+
+  DataServiceMasterClient master(cluster.MasterAddress(), kProtocol);
+  std::vector<TaskInfo> tasks;
+  bool job_finished;
+  TF_ASSERT_OK(
+      master.GetTasks(job_id, port::Hostname(), &tasks, &job_finished));
+  EXPECT_FALSE(job_finished);
+  EXPECT_EQ(WorkerAddresses(tasks),
+            std::vector<std::string>(
+                {cluster.WorkerAddress(1), cluster.WorkerAddress(0)}));
+  TF_ASSERT_OK(master.GetTasks(job_id, "remote_host", &tasks, &job_finished));
+  EXPECT_EQ(WorkerAddresses(tasks),
+            std::vector<std::string>(
+                {cluster.WorkerAddress(0), cluster.WorkerAddress(1)}));
+  for (const TaskInfo& task : tasks) {
+    EXPECT_FALSE(task.straggler());
+  }
+}
+
+TEST(DataService, GetTasksPrefersWorkersWithBufferedElements) {
+  TestCluster cluster(0);
+  TF_ASSERT_OK(cluster.Initialize());
+  WorkerConfig idle_config;
+  idle_config.set_heartbeat_interval_ms(10);
+  // Produces elements on request, so it never has buffered elements.
+  TF_ASSERT_OK(cluster.AddWorker(idle_config));
+  WorkerConfig buffering_config = idle_config;
+  buffering_config.set_num_producer_threads(1);
+  buffering_config.set_prefetch_buffer_size(4);
+  TF_ASSERT_OK(cluster.AddWorker(buffering_config));
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::map_test_case(&test_case));
+  int64 job_id;
+  TF_ASSERT_OK(CreateJob(&cluster, test_case, &job_id));
+
+  // Without load reports, tasks are ordered by id, so the idle worker's task
+  // comes first until the buffering worker reports its elements.
+  DataServiceMasterClient master(cluster.MasterAddress(), kProtocol);
+  std::vector<TaskInfo> tasks;
+  bool job_finished;
+  const uint64 deadline_micros = Env::Default()->NowMicros() + 10 * 1000 * 1000;
+  while (true) {
+    TF_ASSERT_OK(master.GetTasks(job_id, /*consumer_host=*/"", &tasks,
+                                 &job_finished));
+    ASSERT_EQ(tasks.size(), 2);
+    if (tasks[0].worker_address() == cluster.WorkerAddress(1) ||
+        Env::Default()->NowMicros() > deadline_micros) {
+      break;
+    }
+    Env::Default()->SleepForMicroseconds(10 * 1000);
+  }
+  EXPECT_EQ(WorkerAddresses(tasks),
+            std::vector<std::string>(
+                {cluster.WorkerAddress(1), cluster.WorkerAddress(0)}));
+}
+
+TEST(DataService, GetElementFromUnknownTask) {
+  TestCluster cluster(1);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceWorkerClient worker(cluster.WorkerAddress(0), kProtocol);
+  CompressedElement element;
+  bool end_of_sequence = false;
+  Status s = worker.GetElement(/*task_id=*/100, &element, &end_of_sequence);
+  EXPECT_EQ(s.code(), error::NOT_FOUND);
+}
+
+TEST(DataService, GetElementsFromUnknownTask) {
+  TestCluster cluster(1);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceWorkerClient worker(cluster.WorkerAddress(0), kProtocol);
+  std::vector<std::vector<Tensor>> elements;
+  bool end_of_sequence = false;
+  Status s = worker.GetElements(/*task_id=*/100, /*max_elements=*/8,
+                                BATCH_COMPRESSION_SNAPPY, &elements,
+                                &end_of_sequence);
+  EXPECT_EQ(s.code(), error::NOT_FOUND);
+}
+
+TEST(DataService, GetElementsRequiresPositiveMaxElements) {
+  DataServiceWorkerClient worker("localhost:0", kProtocol);
+  std::vector<std::vector<Tensor>> elements;
+  bool end_of_sequence = false;
+  Status s = worker.GetElements(/*task_id=*/0, /*max_elements=*/0,
+                                BATCH_COMPRESSION_NONE, &elements,
+                                &end_of_sequence);
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -0,0 +1,105 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/element_batch.h"
+
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+constexpr const char kSnappy[] = "SNAPPY";
+}  // namespace
+
+Status ParseBatchCompression(const std::string& s, BatchCompression* codec) {
+  if (s.empty()) {
+    *codec = BATCH_COMPRESSION_NONE;
+  } else if (s == kSnappy) {
+    *codec = BATCH_COMPRESSION_SNAPPY;
+  } else {
+    return errors::InvalidArgument("Unrecognized batch compression: ", s);
+  }
+  return Status::OK();
+}
+
+std::string BatchCompressionToString(BatchCompression codec) {
+  switch (codec) {
+    case BATCH_COMPRESSION_NONE:
+      return "";
+    case BATCH_COMPRESSION_SNAPPY:
+      return kSnappy;
+    default:
+      DCHECK(false);
+      return "Unknown";
+  }
+}
+
+Status CompressElementBatch(const ElementBatch& batch, BatchCompression codec,
+                            std::string* out) {
+  switch (codec) {
+    case BATCH_COMPRESSION_NONE:
+      if (!batch.SerializeToString(out)) {
+        return errors::Internal("Failed to serialize element batch");
+      }
+      return Status::OK();
+    case BATCH_COMPRESSION_SNAPPY: {
+      std::string serialized;
+      if (!batch.SerializeToString(&serialized)) {
+        return errors::Internal("Failed to serialize element batch");
+      }
+      if (!port::Snappy_Compress(serialized.data(), serialized.size(), out)) {
+        return errors::Internal("Failed to compress using snappy.");
+      }
+      VLOG(3) << "Compressed batch of " << batch.elements_size()
+              << " elements from " << serialized.size() << " bytes to "
+              << out->size() << " bytes";
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unsupported batch compression: ", codec);
+  }
+}
+
+Status UncompressElementBatch(const std::string& data, BatchCompression codec,
+                              ElementBatch* batch) {
+  switch (codec) {
+    case BATCH_COMPRESSION_NONE:
+      if (!batch->ParseFromString(data)) {
+        return errors::Internal("Could not parse element batch");
+      }
+      return Status::OK();
+    case BATCH_COMPRESSION_SNAPPY: {
+      size_t uncompressed_size;
+      if (!port::Snappy_GetUncompressedLength(data.data(), data.size(),
+                                              &uncompressed_size)) {
+        return errors::Internal("Could not get snappy uncompressed length");
+      }
+      std::string serialized(uncompressed_size, '\0');
+      if (!port::Snappy_Uncompress(data.data(), data.size(), &serialized[0])) {
+        return errors::Internal("Failed to perform snappy decompression.");
+      }
+      if (!batch->ParseFromString(serialized)) {
+        return errors::Internal("Could not parse element batch");
+      }
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unsupported batch compression: ", codec);
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,48 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_BATCH_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_BATCH_H_
+
+#include <string>
+
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Parses a batch compression codec name. The empty string denotes no
+// compression.
+Status ParseBatchCompression(const std::string& s, BatchCompression* codec);
+
+// Converts a batch compression codec to its corresponding name.
+std::string BatchCompressionToString(BatchCompression codec);
+
+// Serializes `batch` and compresses it with `codec` into `out`.
+//
+// Elements fetched in batches are usually not compressed individually, and
+// compressing them together lets the codec exploit the redundancy between
+// them, such as their repeated component metadata.
+Status CompressElementBatch(const ElementBatch& batch, BatchCompression codec,
+                            std::string* out);
+
+// Uncompresses the output of `CompressElementBatch` into `batch`.
+Status UncompressElementBatch(const std::string& data, BatchCompression codec,
+                              ElementBatch* batch);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_ELEMENT_BATCH_H_
@@ -0,0 +1,96 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/element_batch.h"
+
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+ElementBatch MakeBatch(int64 num_elements) {
+  ElementBatch batch;
+  for (int64 i = 0; i < num_elements; ++i) {
+    TF_CHECK_OK(
+        CompressElement({test::AsScalar<int64>(i)}, batch.add_elements()));
+  }
+  return batch;
+}
+}  // namespace
+
+TEST(ElementBatchTest, ParseBatchCompression) {
+  BatchCompression codec;
+  TF_ASSERT_OK(ParseBatchCompression("", &codec));
+  EXPECT_EQ(codec, BATCH_COMPRESSION_NONE);
+  TF_ASSERT_OK(ParseBatchCompression("SNAPPY", &codec));
+  EXPECT_EQ(codec, BATCH_COMPRESSION_SNAPPY);
+  Status s = ParseBatchCompression("ZSTD", &codec);
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+}
+
+TEST(ElementBatchTest, BatchCompressionToString) {
+  EXPECT_EQ("", BatchCompressionToString(BATCH_COMPRESSION_NONE));
+  EXPECT_EQ("SNAPPY", BatchCompressionToString(BATCH_COMPRESSION_SNAPPY));
+}
+
+class ParameterizedElementBatchTest
+    : public ::testing::TestWithParam<BatchCompression> {};
+
+TEST_P(ParameterizedElementBatchTest, RoundTrip) {
+  ElementBatch batch = MakeBatch(/*num_elements=*/10);
+  std::string data;
+  TF_ASSERT_OK(CompressElementBatch(batch, GetParam(), &data));
+  ElementBatch round_trip_batch;
+  TF_ASSERT_OK(UncompressElementBatch(data, GetParam(), &round_trip_batch));
+  ASSERT_EQ(round_trip_batch.elements_size(), 10);
+  for (int64 i = 0; i < 10; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(UncompressElement(round_trip_batch.elements(i), &element));
+    ASSERT_EQ(element.size(), 1);
+    test::ExpectTensorEqual<int64>(element[0], test::AsScalar<int64>(i));
+  }
+}
+
+TEST_P(ParameterizedElementBatchTest, EmptyBatch) {
+  std::string data;
+  TF_ASSERT_OK(CompressElementBatch(ElementBatch(), GetParam(), &data));
+  ElementBatch round_trip_batch;
+  TF_ASSERT_OK(UncompressElementBatch(data, GetParam(), &round_trip_batch));
+  EXPECT_EQ(round_trip_batch.elements_size(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedElementBatchTest,
+                         ::testing::Values(BATCH_COMPRESSION_NONE,
+                                           BATCH_COMPRESSION_SNAPPY));
+
+TEST(ElementBatchTest, SnappyShrinksSmallElements) {
+  ElementBatch batch = MakeBatch(/*num_elements=*/100);
+  std::string data;
+  TF_ASSERT_OK(CompressElementBatch(batch, BATCH_COMPRESSION_SNAPPY, &data));
+  EXPECT_LT(data.size(), batch.ByteSizeLong());
+}
+
+TEST(ElementBatchTest, CorruptData) {
+  ElementBatch batch;
+  Status s =
+      UncompressElementBatch("not snappy", BATCH_COMPRESSION_SNAPPY, &batch);
+  EXPECT_EQ(s.code(), error::INTERNAL);
+}
+
+}  // namespace data
+}  // namespace tensorflow
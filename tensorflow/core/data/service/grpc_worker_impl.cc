@@ -27,8 +27,9 @@ using ::grpc::Status;
 
 GrpcWorkerImpl::GrpcWorkerImpl(ServerBuilder* server_builder,
                                const std::string& master_address,
-                               const std::string& protocol)
-    : impl_(master_address, protocol) {
+                               const std::string& protocol,
+                               const WorkerConfig& config)
+    : impl_(master_address, protocol, config) {
   server_builder->RegisterService(this);
   VLOG(1) << "Registered data service worker";
 }
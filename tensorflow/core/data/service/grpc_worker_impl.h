@@ -36,7 +36,8 @@ class GrpcWorkerImpl : public WorkerService::Service {
  public:
   explicit GrpcWorkerImpl(grpc::ServerBuilder* server_builder,
                           const std::string& master_address,
-                          const std::string& protocol);
+                          const std::string& protocol,
+                          const WorkerConfig& config = WorkerConfig());
   ~GrpcWorkerImpl() override {}
 
   void Start(const std::string& worker_address);
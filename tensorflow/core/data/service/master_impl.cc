@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/data_service.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/master.pb.h"
+#include "tensorflow/core/data/service/task_order.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
@@ -61,7 +62,12 @@ Status DataServiceMasterImpl::RegisterWorker(
   VLOG(3) << "Received register worker request";
   mutex_lock l(mu_);
   int64 worker_id = next_worker_id_++;
-  workers_.emplace_back(worker_id, request->worker_address());
+  // Workers which don't report their host are matched by their address.
+  const std::string worker_host =
+      request->worker_host().empty()
+          ? HostFromAddress(request->worker_address())
+          : request->worker_host();
+  workers_.emplace_back(worker_id, request->worker_address(), worker_host);
   response->set_worker_id(worker_id);
 
   // Allocate tasks to the worker.
@@ -88,6 +94,14 @@ Status DataServiceMasterImpl::WorkerUpdate(const WorkerUpdateRequest* request,
                                            WorkerUpdateResponse* response) {
   mutex_lock l(mu_);
   int64 worker_id = request->worker_id();
+  if (request->has_load()) {
+    for (auto& worker : workers_) {
+      if (worker.worker_id() == worker_id) {
+        worker.set_load(request->load());
+        break;
+      }
+    }
+  }
   for (auto& update : request->updates()) {
     int64 task_id = update.task_id();
     if (!tasks_.contains(task_id)) {
@@ -301,13 +315,30 @@ Status DataServiceMasterImpl::GetTasks(const GetTasksRequest* request,
                             "> not found.");
   }
   std::shared_ptr<Job> job = it->second;
+  // A restarted worker registers again with the same address, so later
+  // registrations take precedence.
+  absl::flat_hash_map<std::string, Worker*> workers_by_address;
+  for (auto& worker : workers_) {
+    workers_by_address[worker.address()] = &worker;
+  }
+  std::vector<TaskLocation> locations;
+  locations.reserve(job->task_ids().size());
   for (const auto& task_id : job->task_ids()) {
     auto task_iter = tasks_.find(task_id);
     DCHECK(task_iter != tasks_.end());
     Task& task = task_iter->second;
-    TaskInfo* task_info = response->mutable_task_info()->Add();
-    task_info->set_worker_address(task.worker_address());
-    task_info->set_id(task.task_id());
+    locations.emplace_back();
+    TaskLocation& location = locations.back();
+    location.task_id = task.task_id();
+    location.worker_address = task.worker_address();
+    auto worker_iter = workers_by_address.find(task.worker_address());
+    if (worker_iter != workers_by_address.end()) {
+      location.worker_host = worker_iter->second->host();
+      location.worker_load = worker_iter->second->load();
+    }
+  }
+  for (TaskInfo& task_info : OrderTasks(locations, request->consumer_host())) {
+    *response->add_task_info() = std::move(task_info);
   }
   response->set_job_finished(job->finished());
   VLOG(3) << "Found " << response->task_info_size() << " tasks for job id "
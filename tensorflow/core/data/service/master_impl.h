@@ -66,15 +66,21 @@ class DataServiceMasterImpl {
  private:
   class Worker {
    public:
-    Worker(int64 worker_id, const std::string address)
-        : worker_id_(worker_id), address_(address) {}
+    Worker(int64 worker_id, const std::string address, const std::string host)
+        : worker_id_(worker_id), address_(address), host_(host) {}
 
     int64 worker_id() { return worker_id_; }
     std::string address() { return address_; }
+    // The host reported by the worker, which consumers on the same host
+    // compare with their host name.
+    std::string host() { return host_; }
     WorkerService::Stub* stub() { return stub_.get(); }
     void set_stub(std::unique_ptr<WorkerService::Stub> stub) {
       stub_ = std::move(stub);
     }
+    // The load last reported by the worker.
+    const WorkerLoad& load() const { return load_; }
+    void set_load(const WorkerLoad& load) { load_ = load; }
 
     std::string DebugString() {
       return absl::StrCat("id: ", worker_id_, " address: ", address_);
@@ -83,7 +89,9 @@ class DataServiceMasterImpl {
    private:
     const int64 worker_id_;
     const std::string address_;
+    const std::string host_;
     std::unique_ptr<WorkerService::Stub> stub_;
+    WorkerLoad load_;
   };
 
   class Dataset {
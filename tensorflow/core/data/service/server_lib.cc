@@ -98,16 +98,18 @@ Status MasterGrpcDataServer::NumWorkers(int* num_workers) {
 WorkerGrpcDataServer::WorkerGrpcDataServer(int port,
                                            const std::string& protocol,
                                            const std::string& master_address,
-                                           const std::string& worker_address)
+                                           const std::string& worker_address,
+                                           const WorkerConfig& config)
     : GrpcDataServerBase(port, protocol),
       master_address_(master_address),
-      worker_address_(worker_address) {}
+      worker_address_(worker_address),
+      config_(config) {}
 
 WorkerGrpcDataServer::~WorkerGrpcDataServer() { delete service_; }
 
 void WorkerGrpcDataServer::AddServiceToBuilder(grpc::ServerBuilder* builder) {
-  auto service =
-      absl::make_unique<GrpcWorkerImpl>(builder, master_address_, protocol_);
+  auto service = absl::make_unique<GrpcWorkerImpl>(builder, master_address_,
+                                                   protocol_, config_);
   service_ = service.release();
 }
 
@@ -140,8 +142,17 @@ Status NewWorkerServer(int port, const std::string& protocol,
                        const std::string& master_address,
                        const std::string& worker_address,
                        std::unique_ptr<WorkerGrpcDataServer>* out_server) {
+  return NewWorkerServer(port, protocol, master_address, worker_address,
+                         WorkerConfig(), out_server);
+}
+
+Status NewWorkerServer(int port, const std::string& protocol,
+                       const std::string& master_address,
+                       const std::string& worker_address,
+                       const WorkerConfig& config,
+                       std::unique_ptr<WorkerGrpcDataServer>* out_server) {
   *out_server = absl::make_unique<WorkerGrpcDataServer>(
-      port, protocol, master_address, worker_address);
+      port, protocol, master_address, worker_address, config);
   return Status::OK();
 }
 
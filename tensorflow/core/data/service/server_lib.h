@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "grpcpp/server.h"
 #include "grpcpp/server_builder.h"
+#include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/lib/core/status.h"
 
 namespace tensorflow {
@@ -91,7 +92,8 @@ class WorkerGrpcDataServer : public GrpcDataServerBase {
  public:
   WorkerGrpcDataServer(int requested_port, const std::string& protocol,
                        const std::string& master_address,
-                       const std::string& worker_address);
+                       const std::string& worker_address,
+                       const WorkerConfig& config);
   ~WorkerGrpcDataServer() override;
 
  protected:
@@ -101,6 +103,7 @@ class WorkerGrpcDataServer : public GrpcDataServerBase {
  private:
   const std::string master_address_;
   const std::string worker_address_;
+  const WorkerConfig config_;
   // Owned. We use a raw pointer because GrpcWorkerImpl is forward-declared.
   GrpcWorkerImpl* service_;
 };
@@ -129,6 +132,14 @@ Status NewWorkerServer(int port, const std::string& protocol,
                        const std::string& master_address,
                        std::unique_ptr<WorkerGrpcDataServer>* out_server);
 
+// Creates a worker configured by `config`, e.g. to produce elements in
+// parallel ahead of requests. See `WorkerConfig` in common.proto.
+Status NewWorkerServer(int port, const std::string& protocol,
+                       const std::string& master_address,
+                       const std::string& worker_address,
+                       const WorkerConfig& config,
+                       std::unique_ptr<WorkerGrpcDataServer>* out_server);
+
 }  // namespace data
 }  // namespace tensorflow
 
@@ -0,0 +1,109 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/task_order.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/strip.h"
+
+namespace tensorflow {
+namespace data {
+
+std::string HostFromAddress(absl::string_view address) {
+  if (absl::ConsumePrefix(&address, "[")) {
+    // IPv6 address.
+    return std::string(address.substr(0, address.find(']')));
+  }
+  return std::string(address.substr(0, address.rfind(':')));
+}
+
+std::vector<TaskInfo> OrderTasks(const std::vector<TaskLocation>& tasks,
+                                 absl::string_view consumer_host) {
+  absl::flat_hash_map<std::string, int64> pending_requests;
+  for (const TaskLocation& task : tasks) {
+    pending_requests[task.worker_address] =
+        task.worker_load.pending_requests();
+  }
+  int64 total_pending_requests = 0;
+  for (const auto& entry : pending_requests) {
+    total_pending_requests += entry.second;
+  }
+  const int64 num_workers = pending_requests.size();
+  auto is_straggler = [&](const TaskLocation& task) {
+    const int64 pending = task.worker_load.pending_requests();
+    if (num_workers < 2 || pending < kMinStragglerPendingRequests) {
+      return false;
+    }
+    // Compares with the average of the other workers, without divisions.
+    const int64 others_pending = total_pending_requests - pending;
+    return pending * (num_workers - 1) > kStragglerFactor * others_pending;
+  };
+
+  struct Candidate {
+    const TaskLocation* task;
+    bool straggler;
+    bool local;
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve(tasks.size());
+  for (const TaskLocation& task : tasks) {
+    candidates.push_back(
+        {&task, is_straggler(task),
+         !consumer_host.empty() && task.worker_host == consumer_host});
+  }
+  auto key = [](const Candidate& c) {
+    return std::make_tuple(c.straggler, !c.local,
+                           c.task->worker_load.pending_requests(),
+                           -c.task->worker_load.elements_buffered(),
+                           c.task->task_id);
+  };
+  std::sort(candidates.begin(), candidates.end(),
+            [&](const Candidate& lhs, const Candidate& rhs) {
+              return key(lhs) < key(rhs);
+            });
+
+  std::vector<TaskInfo> task_infos;
+  task_infos.reserve(candidates.size());
+  for (const Candidate& candidate : candidates) {
+    task_infos.emplace_back();
+    TaskInfo& task_info = task_infos.back();
+    task_info.set_worker_address(candidate.task->worker_address);
+    task_info.set_id(candidate.task->task_id);
+    task_info.set_straggler(candidate.straggler);
+  }
+  return task_infos;
+}
+
+int64 PickTask(const std::vector<bool>& can_request, int64* next_index) {
+  const int64 num_tasks = can_request.size();
+  if (num_tasks == 0) {
+    return -1;
+  }
+  // Tasks may have been removed since the last pick.
+  const int64 start = *next_index < num_tasks ? *next_index : 0;
+  for (int64 i = 0; i < num_tasks; ++i) {
+    const int64 index = (start + i) % num_tasks;
+    if (can_request[index]) {
+      *next_index = (index + 1) % num_tasks;
+      return index;
+    }
+  }
+  return -1;
+}
+
+}  // namespace data
+}  // namespace tensorflow
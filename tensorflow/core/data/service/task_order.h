@@ -0,0 +1,70 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_TASK_ORDER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_TASK_ORDER_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/master.pb.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A task of a job, with the last reported load of the worker processing it.
+struct TaskLocation {
+  int64 task_id;
+  std::string worker_address;
+  // The host registered by the worker, see `RegisterWorkerRequest`.
+  std::string worker_host;
+  WorkerLoad worker_load;
+};
+
+// Thresholds for considering a worker a straggler, see `OrderTasks`.
+constexpr int64 kMinStragglerPendingRequests = 4;
+constexpr int64 kStragglerFactor = 2;
+
+// Returns the host of an address of the form "host:port" or "[host]:port".
+std::string HostFromAddress(absl::string_view address);
+
+// Orders the tasks of a job for a consumer on host `consumer_host`, which may
+// be empty if the consumer's host is unknown.
+//
+// Tasks processed by workers whose host is `consumer_host` come first, so that
+// the consumer avoids reading over the network when it can. Tasks are then
+// ordered by increasing number of pending GetElement requests on their worker,
+// and by decreasing number of buffered elements. Tasks of straggler workers
+// come last and are marked as such. A worker is a straggler if it has at least
+// `kMinStragglerPendingRequests` pending requests, and more than
+// `kStragglerFactor` times the average number of pending requests of the other
+// workers of the job.
+std::vector<TaskInfo> OrderTasks(const std::vector<TaskLocation>& tasks,
+                                 absl::string_view consumer_host);
+
+// Picks the task to send the next GetElement request to. The tasks are in the
+// order of `OrderTasks`, and `can_request[i]` tells whether task `i` can accept
+// another request. Tasks are picked round robin from `*next_index`, so that
+// every task which can accept a request gets one in turn, however few requests
+// are allowed: the order of preference only breaks ties within a round.
+// Returns the index of the picked task and moves `*next_index` past it, or
+// returns -1 if no task can accept a request.
+int64 PickTask(const std::vector<bool>& can_request, int64* next_index);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_TASK_ORDER_H_
@@ -0,0 +1,140 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/task_order.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+TaskLocation MakeTask(int64 task_id, const std::string& worker_address,
+                      int64 pending_requests, int64 elements_buffered = 0) {
+  TaskLocation task;
+  task.task_id = task_id;
+  task.worker_address = worker_address;
+  task.worker_host = HostFromAddress(worker_address);
+  task.worker_load.set_pending_requests(pending_requests);
+  task.worker_load.set_elements_buffered(elements_buffered);
+  return task;
+}
+
+std::vector<int64> TaskIds(const std::vector<TaskInfo>& task_infos) {
+  std::vector<int64> task_ids;
+  for (const TaskInfo& task_info : task_infos) {
+    task_ids.push_back(task_info.id());
+  }
+  return task_ids;
+}
+}  // namespace
+
+TEST(TaskOrderTest, HostFromAddress) {
+  EXPECT_EQ(HostFromAddress("localhost:5000"), "localhost");
+  EXPECT_EQ(HostFromAddress("10.0.0.1:5000"), "10.0.0.1");
+  EXPECT_EQ(HostFromAddress("[::1]:5000"), "::1");
+  EXPECT_EQ(HostFromAddress("localhost"), "localhost");
+}
+
+TEST(TaskOrderTest, PrefersLocalWorkers) {
+  std::vector<TaskInfo> task_infos = OrderTasks(
+      {MakeTask(0, "host_a:1", 0), MakeTask(1, "host_b:1", 1),
+       MakeTask(2, "host_c:1", 0)},
+      "host_b");
+  EXPECT_EQ(TaskIds(task_infos), std::vector<int64>({1, 0, 2}));
+}
+
+TEST(TaskOrderTest, MatchesRegisteredHost) {
+  // Workers are usually addressed by IP, while consumers know their host name.
+  TaskLocation local = MakeTask(1, "10.0.0.2:1", 1);
+  local.worker_host = "host_b";
+  std::vector<TaskInfo> task_infos =
+      OrderTasks({MakeTask(0, "10.0.0.1:1", 0), local}, "host_b");
+  EXPECT_EQ(TaskIds(task_infos), std::vector<int64>({1, 0}));
+  task_infos = OrderTasks({MakeTask(0, "10.0.0.1:1", 0), local}, "10.0.0.2");
+  EXPECT_EQ(TaskIds(task_infos), std::vector<int64>({0, 1}));
+}
+
+TEST(TaskOrderTest, PrefersLessLoadedWorkers) {
+  std::vector<TaskInfo> task_infos =
+      OrderTasks({MakeTask(0, "host_a:1", 2), MakeTask(1, "host_b:1", 1),
+                  MakeTask(2, "host_c:1", 1, /*elements_buffered=*/5)},
+                 /*consumer_host=*/"");
+  EXPECT_EQ(TaskIds(task_infos), std::vector<int64>({2, 1, 0}));
+}
+
+TEST(TaskOrderTest, StragglersComeLast) {
+  std::vector<TaskInfo> task_infos = OrderTasks(
+      {MakeTask(0, "host_a:1", 10), MakeTask(1, "host_b:1", 1),
+       MakeTask(2, "host_c:1", 2)},
+      "host_a");
+  EXPECT_EQ(TaskIds(task_infos), std::vector<int64>({1, 2, 0}));
+  EXPECT_FALSE(task_infos[0].straggler());
+  EXPECT_FALSE(task_infos[1].straggler());
+  EXPECT_TRUE(task_infos[2].straggler());
+}
+
+TEST(TaskOrderTest, NoStragglersBelowThreshold) {
+  std::vector<TaskInfo> task_infos =
+      OrderTasks({MakeTask(0, "host_a:1", kMinStragglerPendingRequests - 1),
+                  MakeTask(1, "host_b:1", 0)},
+                 /*consumer_host=*/"");
+  EXPECT_FALSE(task_infos[0].straggler());
+  EXPECT_FALSE(task_infos[1].straggler());
+}
+
+TEST(TaskOrderTest, PickTaskGoesRoundRobin) {
+  int64 next_index = 0;
+  EXPECT_EQ(PickTask({true, true, true}, &next_index), 0);
+  EXPECT_EQ(PickTask({true, true, true}, &next_index), 1);
+  EXPECT_EQ(PickTask({true, false, true}, &next_index), 2);
+  EXPECT_EQ(PickTask({true, false, true}, &next_index), 0);
+  EXPECT_EQ(PickTask({false, false, true}, &next_index), 2);
+  EXPECT_EQ(PickTask({false, false, false}, &next_index), -1);
+  EXPECT_EQ(PickTask({}, &next_index), -1);
+}
+
+TEST(TaskOrderTest, PickTaskAfterTasksWereRemoved) {
+  int64 next_index = 3;
+  EXPECT_EQ(PickTask({true, true}, &next_index), 0);
+  EXPECT_EQ(next_index, 1);
+}
+
+TEST(TaskOrderTest, OneOutstandingRequestReachesRemoteWorkers) {
+  // With max_outstanding_requests=1, a single request is in flight at a time,
+  // so every task can accept the next one. The local task comes first, but
+  // must not take all the requests.
+  std::vector<TaskInfo> task_infos = OrderTasks(
+      {MakeTask(0, "host_a:1", 0), MakeTask(1, "host_b:1", 0)}, "host_b");
+  ASSERT_EQ(TaskIds(task_infos), std::vector<int64>({1, 0}));
+  std::vector<int64> requested_task_ids;
+  int64 next_index = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int64 index = PickTask({true, true}, &next_index);
+    ASSERT_GE(index, 0);
+    requested_task_ids.push_back(task_infos[index].id());
+  }
+  EXPECT_EQ(requested_task_ids, std::vector<int64>({1, 0, 1, 0}));
+}
+
+TEST(TaskOrderTest, SingleWorkerIsNotAStraggler) {
+  std::vector<TaskInfo> task_infos =
+      OrderTasks({MakeTask(0, "host_a:1", 100)}, /*consumer_host=*/"");
+  ASSERT_EQ(task_infos.size(), 1);
+  EXPECT_FALSE(task_infos[0].straggler());
+  EXPECT_EQ(task_infos[0].worker_address(), "host_a:1");
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,171 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/task_runner.h"
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+constexpr int64 kDefaultPrefetchBufferSize = 16;
+}  // namespace
+
+TaskRunner::TaskRunner(std::unique_ptr<standalone::Dataset> dataset,
+                       std::unique_ptr<standalone::Iterator> iterator,
+                       const WorkerConfig& config)
+    : num_producer_threads_(config.num_producer_threads()),
+      prefetch_buffer_size_(config.prefetch_buffer_size() > 0
+                                ? config.prefetch_buffer_size()
+                                : kDefaultPrefetchBufferSize),
+      dataset_(std::move(dataset)),
+      iterator_(std::move(iterator)) {
+  for (int i = 0; i < num_producer_threads_; ++i) {
+    threads_.emplace_back(Env::Default()->StartThread(
+        {}, strings::StrCat("tf-data-service-task-producer-", i),
+        [this]() { ProducerThread(); }));
+  }
+}
+
+TaskRunner::~TaskRunner() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cv_.notify_all();
+  }
+  // Joins the producer threads.
+  threads_.clear();
+}
+
+void TaskRunner::ProducerThread() {
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && !end_of_sequence_ && status_.ok() &&
+             static_cast<int64>(buffer_.size()) + in_flight_ >=
+                 prefetch_buffer_size_) {
+        cv_.wait(l);
+      }
+      if (cancelled_ || end_of_sequence_ || !status_.ok()) {
+        return;
+      }
+      ++in_flight_;
+    }
+    std::vector<Tensor> element;
+    bool end_of_sequence = false;
+    const uint64 start_micros = Env::Default()->NowMicros();
+    Status s = iterator_->GetNext(&element, &end_of_sequence);
+    const int64 produce_time_micros =
+        Env::Default()->NowMicros() - start_micros;
+    mutex_lock l(mu_);
+    --in_flight_;
+    RecordElement(s, std::move(element), end_of_sequence, produce_time_micros);
+  }
+}
+
+void TaskRunner::RecordElement(const Status& status,
+                               std::vector<Tensor> element,
+                               bool end_of_sequence,
+                               int64 produce_time_micros) {
+  produce_time_micros_ += produce_time_micros;
+  if (!status.ok()) {
+    status_.Update(status);
+  } else if (end_of_sequence) {
+    end_of_sequence_ = true;
+  } else {
+    buffer_.push_back(std::move(element));
+  }
+  cv_.notify_all();
+}
+
+Status TaskRunner::WaitForElement(mutex_lock& l, bool* end_of_sequence) {
+  while (true) {
+    if (cancelled_) {
+      return errors::Cancelled("Task runner was cancelled");
+    }
+    if (!buffer_.empty()) {
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+    if (!status_.ok()) {
+      return status_;
+    }
+    if (end_of_sequence_) {
+      // Elements being produced by other threads may still be appended.
+      if (in_flight_ == 0) {
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+    } else if (num_producer_threads_ == 0) {
+      // Produce the element in this thread, under the lock so that elements
+      // are produced one at a time.
+      std::vector<Tensor> element;
+      bool element_end_of_sequence = false;
+      const uint64 start_micros = Env::Default()->NowMicros();
+      Status s = iterator_->GetNext(&element, &element_end_of_sequence);
+      RecordElement(s, std::move(element), element_end_of_sequence,
+                    Env::Default()->NowMicros() - start_micros);
+      continue;
+    }
+    cv_.wait(l);
+  }
+}
+
+Status TaskRunner::GetNext(std::vector<Tensor>* element,
+                           bool* end_of_sequence) {
+  mutex_lock l(mu_);
+  TF_RETURN_IF_ERROR(WaitForElement(l, end_of_sequence));
+  if (!*end_of_sequence) {
+    *element = std::move(buffer_.front());
+    buffer_.pop_front();
+    ++num_returned_;
+    cv_.notify_all();
+  }
+  return Status::OK();
+}
+
+bool TaskRunner::TryGetNext(std::vector<Tensor>* element,
+                            bool* end_of_sequence) {
+  mutex_lock l(mu_);
+  if (cancelled_ || !status_.ok()) {
+    return false;
+  }
+  if (!buffer_.empty()) {
+    *element = std::move(buffer_.front());
+    buffer_.pop_front();
+    ++num_returned_;
+    cv_.notify_all();
+    *end_of_sequence = false;
+    return true;
+  }
+  if (end_of_sequence_ && in_flight_ == 0) {
+    *end_of_sequence = true;
+    return true;
+  }
+  return false;
+}
+
+TaskRunner::Stats TaskRunner::GetStats() {
+  mutex_lock l(mu_);
+  Stats stats;
+  stats.elements_produced = NumProduced();
+  stats.elements_buffered = buffer_.size();
+  stats.produce_time_micros = produce_time_micros_;
+  return stats;
+}
+
+}  // namespace data
+}  // namespace tensorflow
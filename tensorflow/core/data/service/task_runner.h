@@ -0,0 +1,113 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/data/service/common.pb.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+
+// Produces the elements of a tf.data service task.
+//
+// If `config.num_producer_threads()` is positive, that many threads call the
+// task's iterator concurrently, producing up to `config.prefetch_buffer_size()`
+// elements ahead of the requests for them. The order of the elements then
+// depends on which thread finishes first. Otherwise, elements are produced one
+// at a time when they are requested.
+//
+// This class is thread-safe.
+class TaskRunner {
+ public:
+  // Statistics about the elements of the task.
+  struct Stats {
+    // Number of elements produced so far.
+    int64 elements_produced = 0;
+    // Number of produced elements which haven't been requested yet.
+    int64 elements_buffered = 0;
+    // Total time spent by the iterator producing elements, over all threads.
+    int64 produce_time_micros = 0;
+  };
+
+  TaskRunner(std::unique_ptr<standalone::Dataset> dataset,
+             std::unique_ptr<standalone::Iterator> iterator,
+             const WorkerConfig& config);
+  // Waits for the producer threads to finish producing their current element.
+  ~TaskRunner();
+
+  // Gets the next element not yet returned by `GetNext`. If no elements are
+  // left, sets `*end_of_sequence` to true.
+  Status GetNext(std::vector<Tensor>* element, bool* end_of_sequence);
+
+  // Like `GetNext`, but returns false instead of waiting if no element has
+  // been produced ahead of the request. Errors are left to `GetNext`.
+  bool TryGetNext(std::vector<Tensor>* element, bool* end_of_sequence);
+
+  Stats GetStats();
+
+ private:
+  // Produces elements until the task is finished or the runner is cancelled.
+  void ProducerThread();
+  // Records the result of a call to the iterator.
+  void RecordElement(const Status& status, std::vector<Tensor> element,
+                     bool end_of_sequence, int64 produce_time_micros)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Waits until an element has been buffered, or the end of the task has been
+  // reached.
+  Status WaitForElement(mutex_lock& l, bool* end_of_sequence)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Number of elements produced so far.
+  int64 NumProduced() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return num_returned_ + buffer_.size();
+  }
+
+  const int num_producer_threads_;
+  const int64 prefetch_buffer_size_;
+  // TODO(aaudibert): Have standalone::Iterator own a reference to
+  // standalone::Dataset so that we don't need to store the dataset here.
+  const std::unique_ptr<standalone::Dataset> dataset_;
+  const std::unique_ptr<standalone::Iterator> iterator_;
+
+  mutex mu_;
+  // Notified whenever an element is produced or requested.
+  condition_variable cv_;
+  // Produced elements which haven't been returned yet.
+  std::deque<std::vector<Tensor>> buffer_ TF_GUARDED_BY(mu_);
+  // Number of elements returned by `GetNext` so far.
+  int64 num_returned_ TF_GUARDED_BY(mu_) = 0;
+  // Number of calls to the iterator in progress.
+  int64 in_flight_ TF_GUARDED_BY(mu_) = 0;
+  int64 produce_time_micros_ TF_GUARDED_BY(mu_) = 0;
+  bool end_of_sequence_ TF_GUARDED_BY(mu_) = false;
+  Status status_ TF_GUARDED_BY(mu_);
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Thread>> threads_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(TaskRunner);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
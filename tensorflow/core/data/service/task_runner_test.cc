@@ -0,0 +1,150 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/task_runner.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/data/service/test_util.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+// The elements of `test_util::map_test_case`.
+const std::vector<int64> kElements = {0, 1, 4, 9, 16, 25, 36, 49, 64, 81};
+
+// Creates a runner for the dataset of `test_util::map_test_case`.
+Status MakeTaskRunner(const WorkerConfig& config,
+                      std::unique_ptr<TaskRunner>* runner) {
+  test_util::GraphDefTestCase test_case;
+  TF_RETURN_IF_ERROR(test_util::map_test_case(&test_case));
+  standalone::Dataset::Params params;
+  std::unique_ptr<standalone::Dataset> dataset;
+  TF_RETURN_IF_ERROR(
+      standalone::Dataset::FromGraph(params, test_case.graph_def, &dataset));
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+  *runner = absl::make_unique<TaskRunner>(std::move(dataset),
+                                          std::move(iterator), config);
+  return Status::OK();
+}
+
+// Gets elements with `GetNext` until the end of the task.
+Status GetAll(TaskRunner* runner, std::vector<int64>* elements) {
+  while (true) {
+    std::vector<Tensor> element;
+    bool end_of_sequence = false;
+    TF_RETURN_IF_ERROR(runner->GetNext(&element, &end_of_sequence));
+    if (end_of_sequence) {
+      return Status::OK();
+    }
+    elements->push_back(element[0].scalar<int64>()());
+  }
+}
+}  // namespace
+
+TEST(TaskRunnerTest, ProduceOnRequest) {
+  std::unique_ptr<TaskRunner> runner;
+  TF_ASSERT_OK(MakeTaskRunner(WorkerConfig(), &runner));
+  EXPECT_EQ(runner->GetStats().elements_produced, 0);
+  std::vector<int64> elements;
+  TF_ASSERT_OK(GetAll(runner.get(), &elements));
+  EXPECT_EQ(elements, kElements);
+  EXPECT_EQ(runner->GetStats().elements_produced, kElements.size());
+}
+
+TEST(TaskRunnerTest, ParallelProducers) {
+  WorkerConfig config;
+  config.set_num_producer_threads(4);
+  config.set_prefetch_buffer_size(2);
+  std::unique_ptr<TaskRunner> runner;
+  TF_ASSERT_OK(MakeTaskRunner(config, &runner));
+  std::vector<int64> elements;
+  TF_ASSERT_OK(GetAll(runner.get(), &elements));
+  // Elements are produced in the order in which the producers finish.
+  std::sort(elements.begin(), elements.end());
+  EXPECT_EQ(elements, kElements);
+}
+
+TEST(TaskRunnerTest, PrefetchBufferBoundsProduction) {
+  WorkerConfig config;
+  config.set_num_producer_threads(2);
+  config.set_prefetch_buffer_size(3);
+  std::unique_ptr<TaskRunner> runner;
+  TF_ASSERT_OK(MakeTaskRunner(config, &runner));
+  while (runner->GetStats().elements_produced < 3) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  // Give the producers a chance to go over the limit.
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  TaskRunner::Stats stats = runner->GetStats();
+  EXPECT_EQ(stats.elements_produced, 3);
+  EXPECT_EQ(stats.elements_buffered, 3);
+
+  std::vector<Tensor> element;
+  bool end_of_sequence = false;
+  TF_ASSERT_OK(runner->GetNext(&element, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  while (runner->GetStats().elements_produced < 4) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_EQ(runner->GetStats().elements_produced, 4);
+}
+
+TEST(TaskRunnerTest, TryGetNextDoesNotProduce) {
+  std::unique_ptr<TaskRunner> runner;
+  TF_ASSERT_OK(MakeTaskRunner(WorkerConfig(), &runner));
+  std::vector<Tensor> element;
+  bool end_of_sequence = false;
+  EXPECT_FALSE(runner->TryGetNext(&element, &end_of_sequence));
+  EXPECT_EQ(runner->GetStats().elements_produced, 0);
+}
+
+TEST(TaskRunnerTest, TryGetNextReturnsBufferedElements) {
+  WorkerConfig config;
+  config.set_num_producer_threads(2);
+  const int64 num_elements = kElements.size();
+  config.set_prefetch_buffer_size(num_elements + 1);
+  std::unique_ptr<TaskRunner> runner;
+  TF_ASSERT_OK(MakeTaskRunner(config, &runner));
+  // Wait for the producers to reach the end of the task.
+  std::vector<Tensor> element;
+  bool end_of_sequence = false;
+  while (runner->GetStats().elements_produced < num_elements) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  std::vector<int64> elements;
+  while (true) {
+    if (!runner->TryGetNext(&element, &end_of_sequence)) {
+      Env::Default()->SleepForMicroseconds(1000);
+      continue;
+    }
+    if (end_of_sequence) {
+      break;
+    }
+    elements.push_back(element[0].scalar<int64>()());
+  }
+  std::sort(elements.begin(), elements.end());
+  EXPECT_EQ(elements, kElements);
+}
+
+}  // namespace data
+}  // namespace tensorflow
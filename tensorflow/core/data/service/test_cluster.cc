@@ -37,7 +37,11 @@ Status AddressFromTarget(absl::string_view target, std::string* address) {
 }
 }  // namespace
 
-TestCluster::TestCluster(int num_workers) : num_workers_(num_workers) {}
+TestCluster::TestCluster(int num_workers)
+    : TestCluster(num_workers, WorkerConfig()) {}
+
+TestCluster::TestCluster(int num_workers, const WorkerConfig& worker_config)
+    : num_workers_(num_workers), worker_config_(worker_config) {}
 
 Status TestCluster::Initialize() {
   if (initialized_) {
@@ -56,10 +60,13 @@ Status TestCluster::Initialize() {
   return Status::OK();
 }
 
-Status TestCluster::AddWorker() {
+Status TestCluster::AddWorker() { return AddWorker(worker_config_); }
+
+Status TestCluster::AddWorker(const WorkerConfig& worker_config) {
   std::unique_ptr<WorkerGrpcDataServer> worker;
-  TF_RETURN_IF_ERROR(
-      NewWorkerServer(/*port=*/0, kProtocol, master_address_, &worker));
+  TF_RETURN_IF_ERROR(NewWorkerServer(/*port=*/0, kProtocol, master_address_,
+                                     /*worker_address=*/"", worker_config,
+                                     &worker));
   TF_RETURN_IF_ERROR(worker->Start());
   worker_addresses_.push_back(absl::StrCat("localhost:", worker->BoundPort()));
   workers_.push_back(std::move(worker));
@@ -70,7 +77,7 @@ std::string TestCluster::MasterAddress() { return master_address_; }
 
 std::string TestCluster::WorkerAddress(int index) {
   DCHECK_GE(index, 0);
-  DCHECK_LT(index, num_workers_);
+  DCHECK_LT(index, worker_addresses_.size());
   return worker_addresses_[index];
 }
 
@@ -26,22 +26,28 @@ class TestCluster {
  public:
   // Creates a new test cluster with a master and `num_workers` workers.
   explicit TestCluster(int num_workers);
+  // Creates a new test cluster whose workers are configured by
+  // `worker_config`.
+  TestCluster(int num_workers, const WorkerConfig& worker_config);
 
   // Initializes the test cluster. This must be called before interacting with
   // the cluster. Initialize should be called only once.
   Status Initialize();
   // Adds a new worker to the cluster.
   Status AddWorker();
+  // Adds a new worker configured by `worker_config` to the cluster.
+  Status AddWorker(const WorkerConfig& worker_config);
   // Returns the master address in the form "hostname:port".
   std::string MasterAddress();
   // Returns the address of the worker at the specified index, in the form
   // "hostname:port". The index must be non-negative and less than the number of
-  // workers in the cluster.
+  // workers in the cluster, including the workers added after initialization.
   std::string WorkerAddress(int index);
 
  private:
   bool initialized_ = false;
   int num_workers_;
+  const WorkerConfig worker_config_;
   std::unique_ptr<MasterGrpcDataServer> master_;
   std::string master_address_;
   std::vector<std::unique_ptr<WorkerGrpcDataServer>> workers_;
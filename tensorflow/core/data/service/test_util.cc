@@ -38,6 +38,11 @@ constexpr char kTestdataDir[] =
 // g.ParseFromString(ds._as_serialized_graph().numpy())
 // print(g)
 constexpr char kMapGraphDefFile[] = "map_graph_def.pbtxt";
+// The graph of kMapGraphDefFile, with the map function compressing its result
+// like `lambda x: compression_ops.compress(x*x)`, as datasets distributed by
+// the tf.data service do.
+constexpr char kCompressedMapGraphDefFile[] =
+    "compressed_map_graph_def.pbtxt";
 }  // namespace
 
 Status map_test_case(GraphDefTestCase* test_case) {
@@ -53,6 +58,13 @@ Status map_test_case(GraphDefTestCase* test_case) {
   return Status::OK();
 }
 
+Status compressed_map_test_case(GraphDefTestCase* test_case) {
+  TF_RETURN_IF_ERROR(map_test_case(test_case));
+  test_case->name = "CompressedMapGraph";
+  std::string filepath = io::JoinPath(kTestdataDir, kCompressedMapGraphDefFile);
+  return ReadTextProto(Env::Default(), filepath, &test_case->graph_def);
+}
+
 }  // namespace test_util
 }  // namespace data
 }  // namespace tensorflow
@@ -37,6 +37,11 @@ struct GraphDefTestCase {
 // dataset graph execution.
 Status map_test_case(GraphDefTestCase* test_case);
 
+// Like `map_test_case`, but the dataset produces each element as a single
+// CompressedElement variant, as the tf.data service workers expect. The
+// expected output holds the uncompressed elements.
+Status compressed_map_test_case(GraphDefTestCase* test_case);
+
 }  // namespace test_util
 }  // namespace data
 }  // namespace tensorflow
@@ -21,15 +21,20 @@ limitations under the License.
 #include "tensorflow/c/tf_status_helper.h"
 #include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/service/credentials_factory.h"
+#include "tensorflow/core/data/service/element_batch.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/master.grpc.pb.h"
 #include "tensorflow/core/data/service/master.pb.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -43,11 +48,83 @@ auto* tf_data_service_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/data/service/created",
                                     "Whether a tf.data service server "
                                     "has been created.");
+
+auto* tf_data_service_worker_elements = monitoring::Counter<1>::New(
+    "/tensorflow/data/service/worker/elements",
+    "The number of elements served by a tf.data service worker.",
+    "worker_address");
+
+auto* tf_data_service_worker_bytes = monitoring::Counter<1>::New(
+    "/tensorflow/data/service/worker/bytes",
+    "The number of compressed bytes served by a tf.data service worker.",
+    "worker_address");
+
+auto* tf_data_service_worker_get_element_latency =
+    monitoring::Sampler<1>::New(
+        {"/tensorflow/data/service/worker/get_element_latency",
+         "Microseconds spent by a tf.data service worker serving an element.",
+         "worker_address"},
+        // Power of 2 with bucket count 20 (> 1 second)
+        monitoring::Buckets::Exponential(1, 2, 20));
+
+// Moves the `CompressedElement` produced by a task's dataset into `out`.
+Status ExtractCompressedElement(std::vector<Tensor>* outputs,
+                                CompressedElement* out) {
+  if (outputs->size() != 1) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but the "
+        "dataset produced ",
+        outputs->size(), " outputs");
+  }
+  Tensor& output = (*outputs)[0];
+  if (output.dtype() != DT_VARIANT) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but "
+        "the dataset produced a tensor with type ",
+        DataTypeString(output.dtype()));
+  }
+  if (!TensorShapeUtils::IsScalar(output.shape())) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a single scalar variant tensor, but "
+        "the dataset produced a tensor with shape ",
+        output.shape());
+  }
+  Variant& variant = output.scalar<Variant>()();
+  CompressedElement* compressed = variant.get<CompressedElement>();
+  if (compressed == nullptr) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a CompressedElement variant tensor, but "
+        "it produced ",
+        variant.TypeName());
+  }
+  compressed->Swap(out);
+  return Status::OK();
+}
+
+// Adds an element produced by a task's dataset to `batch`. Datasets which
+// compress their elements one by one produce a single `CompressedElement`
+// variant, and others the components of the element.
+void AddToElementBatch(std::vector<Tensor>* outputs, ElementBatch* batch) {
+  if (outputs->size() == 1 && (*outputs)[0].dtype() == DT_VARIANT &&
+      TensorShapeUtils::IsScalar((*outputs)[0].shape())) {
+    CompressedElement* compressed =
+        (*outputs)[0].scalar<Variant>()().get<CompressedElement>();
+    if (compressed != nullptr) {
+      compressed->Swap(batch->add_elements());
+      return;
+    }
+  }
+  UncompressedElement* element = batch->add_uncompressed_elements();
+  for (const Tensor& component : *outputs) {
+    component.AsProtoTensorContent(element->add_components());
+  }
+}
 }  // namespace
 
 DataServiceWorkerImpl::DataServiceWorkerImpl(const std::string& master_address,
-                                             const std::string& protocol)
-    : master_address_(master_address), protocol_(protocol) {
+                                             const std::string& protocol,
+                                             const WorkerConfig& config)
+    : master_address_(master_address), protocol_(protocol), config_(config) {
   tf_data_service_created->GetCell()->Set(true);
 }
 
@@ -100,8 +177,8 @@ Status DataServiceWorkerImpl::ProcessTaskInternal(const TaskDef& task_def)
   }
   Task& task = tasks_[task_def.task_id()];
   task.id = task_def.task_id();
-  task.dataset = std::move(dataset);
-  task.iterator = std::move(iterator);
+  task.runner = std::make_shared<TaskRunner>(std::move(dataset),
+                                             std::move(iterator), config_);
   VLOG(3) << "Began processing for task " << task_def.task_id();
   return Status::OK();
 }
@@ -109,8 +186,9 @@ Status DataServiceWorkerImpl::ProcessTaskInternal(const TaskDef& task_def)
 Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
                                          GetElementResponse* response) {
   VLOG(3) << "Received GetElement request for task " << request->task_id();
-  bool end_of_sequence = false;
-  std::vector<tensorflow::Tensor> outputs;
+  const uint64 start_micros = Env::Default()->NowMicros();
+  std::shared_ptr<TaskRunner> runner;
+  std::string worker_address;
   {
     mutex_lock l(mu_);
     auto it = tasks_.find(request->task_id());
@@ -118,57 +196,91 @@ Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
       return errors::NotFound("DataServiceWorkerImpl::GetElement failed. ",
                               "Task id ", request->task_id(), " not found");
     }
-    std::unique_ptr<standalone::Iterator>& iter = it->second.iterator;
-    if (iter == nullptr) {
-      VLOG(3) << "Task " << request->task_id() << " is already finished";
-      response->set_end_of_sequence(true);
-      return Status::OK();
-    }
-    TF_RETURN_IF_ERROR(iter->GetNext(&outputs, &end_of_sequence));
-    if (end_of_sequence) {
-      VLOG(3) << "Reached end_of_sequence for task " << request->task_id();
-      // Release iterator memory and leave a null entry as a tombstone.
-      iter.reset();
-      pending_completed_tasks_.push_back(request->task_id());
-      heartbeat_cv_.notify_one();
+    runner = it->second.runner;
+    worker_address = worker_address_;
+    if (runner != nullptr) {
+      pending_requests_++;
     }
   }
-
-  if (!end_of_sequence) {
-    VLOG(3) << "Producing an element for task " << request->task_id();
-    if (outputs.size() != 1) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but the "
-          "dataset produced ",
-          outputs.size(), " outputs");
-    }
-    if (outputs[0].dtype() != DT_VARIANT) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but "
-          "the dataset produced a tensor with type ",
-          DataTypeString(outputs[0].dtype()));
+  if (runner == nullptr) {
+    VLOG(3) << "Task " << request->task_id() << " is already finished";
+    response->set_end_of_sequence(true);
+    return Status::OK();
+  }
+  auto cleanup = gtl::MakeCleanup([this]() {
+    mutex_lock l(mu_);
+    pending_requests_--;
+  });
+  // Wait for the elements without holding `mu_`, so that the tasks of the
+  // worker serve elements concurrently.
+  const bool batched = request->max_elements() > 0;
+  const int64 max_elements = batched ? request->max_elements() : 1;
+  ElementBatch batch;
+  bool end_of_sequence = false;
+  for (int64 i = 0; i < max_elements && !end_of_sequence; ++i) {
+    std::vector<tensorflow::Tensor> outputs;
+    if (i == 0) {
+      TF_RETURN_IF_ERROR(runner->GetNext(&outputs, &end_of_sequence));
+    } else if (!runner->TryGetNext(&outputs, &end_of_sequence)) {
+      // Send the elements at hand rather than wait for more.
+      break;
     }
-    if (!TensorShapeUtils::IsScalar(outputs[0].shape())) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a single scalar variant tensor, but "
-          "the dataset produced a tensor with shape ",
-          outputs[0].shape());
+    if (end_of_sequence) {
+      break;
     }
-    Variant& variant = outputs[0].scalar<Variant>()();
-    CompressedElement* compressed = variant.get<CompressedElement>();
-    if (compressed == nullptr) {
-      return errors::FailedPrecondition(
-          "Expected dataset to produce a CompressedElement variant tensor, but "
-          "it produced ",
-          variant.TypeName());
+    VLOG(3) << "Producing an element for task " << request->task_id();
+    if (batched) {
+      AddToElementBatch(&outputs, &batch);
+    } else {
+      TF_RETURN_IF_ERROR(ExtractCompressedElement(
+          &outputs, response->mutable_compressed_element()));
     }
-    compressed->Swap(response->mutable_compressed_element());
+  }
+  if (end_of_sequence) {
+    VLOG(3) << "Reached end_of_sequence for task " << request->task_id();
+    FinishTask(request->task_id());
+  }
+
+  int64 num_elements;
+  int64 num_bytes;
+  if (batched) {
+    TF_RETURN_IF_ERROR(CompressElementBatch(batch,
+                                            request->batch_compression(),
+                                            response->mutable_element_batch()));
+    num_elements = batch.elements_size() + batch.uncompressed_elements_size();
+    num_bytes = response->element_batch().size();
+  } else {
+    num_elements = end_of_sequence ? 0 : 1;
+    num_bytes = response->compressed_element().ByteSizeLong();
+  }
+  if (num_elements > 0) {
+    tf_data_service_worker_elements->GetCell(worker_address)
+        ->IncrementBy(num_elements);
+    tf_data_service_worker_bytes->GetCell(worker_address)
+        ->IncrementBy(num_bytes);
+    tf_data_service_worker_get_element_latency->GetCell(worker_address)
+        ->Add(Env::Default()->NowMicros() - start_micros);
   }
   response->set_end_of_sequence(end_of_sequence);
 
   return Status::OK();
 }
 
+void DataServiceWorkerImpl::FinishTask(int64 task_id) {
+  mutex_lock l(mu_);
+  auto it = tasks_.find(task_id);
+  if (it == tasks_.end() || it->second.finished) {
+    return;
+  }
+  Task& task = it->second;
+  task.finished = true;
+  // Release iterator memory and leave a null runner as a tombstone. GetElement
+  // calls still waiting for elements keep their own reference.
+  task.runner.reset();
+  pending_completed_tasks_.push_back(task_id);
+  heartbeat_cv_.notify_one();
+}
+
 Status DataServiceWorkerImpl::EnsureMasterStubInitialized()
     EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   if (!master_stub_) {
@@ -188,6 +300,8 @@ Status DataServiceWorkerImpl::Register() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   TF_RETURN_IF_ERROR(EnsureMasterStubInitialized());
   RegisterWorkerRequest req;
   req.set_worker_address(worker_address_);
+  req.set_worker_host(config_.worker_host().empty() ? port::Hostname()
+                                                    : config_.worker_host());
   RegisterWorkerResponse resp;
 
   grpc::ClientContext ctx;
@@ -203,38 +317,75 @@ Status DataServiceWorkerImpl::Register() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   return Status::OK();
 }
 
-Status DataServiceWorkerImpl::SendTaskUpdate() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  VLOG(3) << "Sending " << pending_completed_tasks_.size()
-          << " task updates to master";
-  TF_RETURN_IF_ERROR(EnsureMasterStubInitialized());
+Status DataServiceWorkerImpl::SendTaskUpdate() {
   WorkerUpdateRequest req;
-  req.set_worker_id(worker_id_);
-  for (int task_id : pending_completed_tasks_) {
-    TaskProgress* update = req.add_updates();
-    update->set_task_id(task_id);
-    update->set_completed(true);
+  MasterService::Stub* master_stub;
+  std::vector<std::shared_ptr<TaskRunner>> runners;
+  {
+    mutex_lock l(mu_);
+    VLOG(3) << "Sending " << pending_completed_tasks_.size()
+            << " task updates to master";
+    TF_RETURN_IF_ERROR(EnsureMasterStubInitialized());
+    // The stub is never reset once created.
+    master_stub = master_stub_.get();
+    req.set_worker_id(worker_id_);
+    for (int64 task_id : pending_completed_tasks_) {
+      TaskProgress* update = req.add_updates();
+      update->set_task_id(task_id);
+      update->set_completed(true);
+    }
+    req.mutable_load()->set_pending_requests(pending_requests_);
+    for (const auto& entry : tasks_) {
+      if (entry.second.runner != nullptr) {
+        runners.push_back(entry.second.runner);
+      }
+    }
+  }
+  WorkerLoad* load = req.mutable_load();
+  for (const std::shared_ptr<TaskRunner>& runner : runners) {
+    load->set_elements_buffered(load->elements_buffered() +
+                                runner->GetStats().elements_buffered);
   }
 
   WorkerUpdateResponse resp;
   grpc::ClientContext ctx;
-  grpc::Status s = master_stub_->WorkerUpdate(&ctx, req, &resp);
+  grpc::Status s = master_stub->WorkerUpdate(&ctx, req, &resp);
   if (!s.ok()) {
     return grpc_util::WrapError("Failed to send task updates", s);
   }
-  pending_completed_tasks_.clear();
+  {
+    mutex_lock l(mu_);
+    // Tasks finished during the update were appended after the ones sent.
+    pending_completed_tasks_.erase(
+        pending_completed_tasks_.begin(),
+        pending_completed_tasks_.begin() + req.updates_size());
+  }
   VLOG(3) << "Sent " << req.updates().size() << " task updates ";
   return Status::OK();
 }
 
 void DataServiceWorkerImpl::HeartbeatThread() {
+  const uint64 heartbeat_interval_micros =
+      config_.heartbeat_interval_ms() > 0
+          ? config_.heartbeat_interval_ms() * 1000
+          : kHeartbeatIntervalMicros;
   while (true) {
-    mutex_lock l(mu_);
-    while (!cancelled_ && pending_completed_tasks_.empty()) {
-      heartbeat_cv_.wait(l);
-    }
-    if (cancelled_) {
-      VLOG(3) << "Heartbeat thread shutting down";
-      return;
+    {
+      mutex_lock l(mu_);
+      // Completed tasks are reported right away, and the worker's load at
+      // least every `heartbeat_interval_micros`.
+      const uint64 next_heartbeat_micros =
+          Env::Default()->NowMicros() + heartbeat_interval_micros;
+      while (!cancelled_ && pending_completed_tasks_.empty() &&
+             Env::Default()->NowMicros() < next_heartbeat_micros) {
+        const uint64 remaining_micros =
+            next_heartbeat_micros - Env::Default()->NowMicros();
+        heartbeat_cv_.wait_for(l, std::chrono::microseconds(remaining_micros));
+      }
+      if (cancelled_) {
+        VLOG(3) << "Heartbeat thread shutting down";
+        return;
+      }
     }
     Status s = SendTaskUpdate();
     if (!s.ok()) {
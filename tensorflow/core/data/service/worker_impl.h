@@ -18,8 +18,8 @@ limitations under the License.
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/master.grpc.pb.h"
+#include "tensorflow/core/data/service/task_runner.h"
 #include "tensorflow/core/data/service/worker.pb.h"
-#include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/public/session.h"
 
@@ -29,8 +29,9 @@ namespace data {
 // A TensorFlow DataService serves dataset elements over RPC.
 class DataServiceWorkerImpl {
  public:
-  explicit DataServiceWorkerImpl(const std::string& master_address,
-                                 const std::string& protocol);
+  DataServiceWorkerImpl(const std::string& master_address,
+                        const std::string& protocol,
+                        const WorkerConfig& config = WorkerConfig());
   ~DataServiceWorkerImpl();
 
   // Starts the worker. The worker needs to know its own address so that it can
@@ -52,24 +53,31 @@ class DataServiceWorkerImpl {
   Status EnsureMasterStubInitialized();
   // Registers the worker with the master.
   Status Register();
-  // Sends task status to the master.
-  Status SendTaskUpdate();
+  // Sends task status and the worker's load to the master. `mu_` is only held
+  // to read the state to send, not while collecting task statistics or
+  // waiting for the master.
+  Status SendTaskUpdate() TF_LOCKS_EXCLUDED(mu_);
   // Creates an iterator to process a task.
   Status ProcessTaskInternal(const TaskDef& task);
   // A thread for updating the master with worker status.
-  void HeartbeatThread();
+  void HeartbeatThread() TF_LOCKS_EXCLUDED(mu_);
+
+  // Records that a task has produced all its elements, and releases its
+  // runner.
+  void FinishTask(int64 task_id) TF_LOCKS_EXCLUDED(mu_);
 
   typedef struct Task {
     int64 id;
-    // TODO(aaudibert): Have standalone::Iterator own a reference to
-    // standalone::Dataset so that we don't need to store the dataset here.
-    std::unique_ptr<standalone::Dataset> dataset;
-    std::unique_ptr<standalone::Iterator> iterator;
+    // Shared with the GetElement calls in progress, which don't hold `mu_`
+    // while waiting for elements. Null once the task is finished.
+    std::shared_ptr<TaskRunner> runner;
+    bool finished = false;
   } Task;
 
   const std::string master_address_;
   // Protocol for communicating with the master.
   const std::string protocol_;
+  const WorkerConfig config_;
   // The worker's own address.
   std::string worker_address_;
 
@@ -80,6 +88,8 @@ class DataServiceWorkerImpl {
   absl::flat_hash_map<int64, Task> tasks_ TF_GUARDED_BY(mu_);
   // List of completed tasks which haven't yet been communicated to the master.
   std::vector<int64> pending_completed_tasks_ TF_GUARDED_BY(mu_);
+  // Number of GetElement calls waiting for elements.
+  int64 pending_requests_ TF_GUARDED_BY(mu_) = 0;
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
   // Condition variable for notifying the heartbeat thread.
   condition_variable heartbeat_cv_ TF_GUARDED_BY(mu_);
@@ -351,5 +351,33 @@ TEST_F(DeviceResDistTest, Workers4Devices3) {
   ValidateCollectiveParams(num_workers, num_devices);
 }
 
+TEST_F(DeviceResDistTest, HierarchicalReduce) {
+  const int num_workers = 3;
+  const int num_devices = 2;
+  DefineWorkers(num_workers, num_devices, "CPU", false);
+  DefineCollectiveParams(num_workers, num_devices);
+  IssueRequests(num_workers, num_devices);
+  ValidateCollectiveParams(num_workers, num_devices);
+  for (const CollectiveParams& cp : cp_) {
+    EXPECT_EQ(cp.instance.impl_details.collective_name,
+              "HierarchicalRingReduce");
+  }
+}
+
+TEST_F(DeviceResDistTest, RingReduceHint) {
+  const int num_workers = 3;
+  const int num_devices = 2;
+  DefineWorkers(num_workers, num_devices, "CPU", false);
+  DefineCollectiveParams(num_workers, num_devices);
+  for (CollectiveParams& cp : cp_) {
+    cp.instance.impl_details.communication_hint = "ring";
+  }
+  IssueRequests(num_workers, num_devices);
+  ValidateCollectiveParams(num_workers, num_devices);
+  for (const CollectiveParams& cp : cp_) {
+    EXPECT_EQ(cp.instance.impl_details.collective_name, "RingReduce");
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
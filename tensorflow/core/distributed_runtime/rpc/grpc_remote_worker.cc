@@ -24,9 +24,12 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_state.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_logger.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/threadpool.h"
@@ -45,7 +48,8 @@ class GrpcRemoteWorker : public WorkerInterface {
   explicit GrpcRemoteWorker(SharedGrpcChannelPtr channel,
                             ::grpc::CompletionQueue* completion_queue,
                             thread::ThreadPool* callback_threadpool,
-                            WorkerCacheLogger* logger, const string& target)
+                            WorkerCacheLogger* logger, const string& target,
+                            SharedMemoryRingCache* shared_memory_rings)
       : channel_(std::move(channel)),
         stub_(channel_),
         cq_(completion_queue),
@@ -66,8 +70,10 @@ class GrpcRemoteWorker : public WorkerInterface {
         instancesource_(Method(GrpcWorkerMethod::kCompleteInstance)),
         getstepsequence_(Method(GrpcWorkerMethod::kGetStepSequence)),
         markrecvfinished_(Method(GrpcWorkerMethod::kMarkRecvFinished)),
+        recvtensorbatch_(Method(GrpcWorkerMethod::kRecvTensorBatch)),
         logger_(logger),
-        target_(target) {}
+        target_(target),
+        shared_memory_rings_(shared_memory_rings) {}
 
   ~GrpcRemoteWorker() override {}
 
@@ -201,8 +207,29 @@ class GrpcRemoteWorker : public WorkerInterface {
     // Type-specialized logging for this method.
     bool logging_active = logger_->LoggingActive() || VLOG_IS_ON(2);
 
-    auto callback = [this, request, response, done, start_usec,
-                     logging_active](Status s) {
+    // Ask for the payload through shared memory if the ring of target_ is
+    // open and the tensor is received into host memory.
+    std::shared_ptr<SharedMemoryRing> ring;
+    RecvTensorRequest shared_memory_request;
+    const RecvTensorRequest* issued_request = request;
+    if (shared_memory_rings_ != nullptr && response->device() != nullptr &&
+        response->device()->attributes().device_type() == DEVICE_CPU) {
+      ring = shared_memory_rings_->Find(target_);
+      if (ring != nullptr) {
+        SharedMemoryRingInfo ring_info;
+        ring_info.set_name(ring->name());
+        ring_info.set_token(ring->token());
+        shared_memory_request = *request;
+        shared_memory_request.mutable_transport_options()->PackFrom(ring_info);
+        issued_request = &shared_memory_request;
+      }
+    }
+
+    auto callback = [this, request, response, done, start_usec, logging_active,
+                     ring](Status s) {
+      if (s.ok() && shared_memory_rings_ != nullptr) {
+        s = MaybeReadFromSharedMemory(ring.get(), response);
+      }
       if (logging_active) {
         if (logger_->LoggingActive()) {
           int64 end_usec = Env::Default()->NowMicros();
@@ -238,6 +265,7 @@ class GrpcRemoteWorker : public WorkerInterface {
                                       key_parts[0],  // src_device
                                       key_parts[2],  // dst_device
                                       bytes);
+            logger_->RecordRecvTensorRpc(step_id, key_parts[2], 1);
           }
         }
         VLOG(2) << "done callback, req: " << request->DebugString()
@@ -252,7 +280,49 @@ class GrpcRemoteWorker : public WorkerInterface {
       done(s);
     };
 
-    IssueRequest(request, response, recvtensor_, callback, call_opts);
+    IssueRequest(issued_request, response, recvtensor_, callback, call_opts);
+  }
+
+  void RecvTensorBatchAsync(CallOptions* call_opts,
+                            const RecvTensorBatchRequest* request,
+                            RecvTensorBatchResponse* response,
+                            StatusCallback done) override {
+    VLOG(1) << "RecvTensorBatchAsync for " << request->requests_size()
+            << " tensors";
+    int64 start_usec = Env::Default()->NowMicros();
+    auto callback = [this, request, response, done,
+                     start_usec](const Status& s) {
+      if (s.ok() && logger_->LoggingActive()) {
+        int64 end_usec = Env::Default()->NowMicros();
+        string dst_device;
+        for (int i = 0; i < response->request_indices_size() &&
+                        i < response->responses_size();
+             ++i) {
+          const int index = response->request_indices(i);
+          if (index < 0 || index >= request->requests_size()) continue;
+          const RecvTensorRequest& tensor_request = request->requests(index);
+          const string& key = tensor_request.rendezvous_key();
+          std::vector<string> key_parts = str_util::Split(key, ';');
+          if (key_parts.size() != 5) {
+            LOG(WARNING) << "Bad key: " << key;
+            continue;
+          }
+          logger_->RecordRecvTensor(
+              tensor_request.step_id(), start_usec, end_usec,
+              key_parts[3],  // tensor name
+              key_parts[0],  // src_device
+              key_parts[2],  // dst_device
+              response->responses(i).tensor().ByteSizeLong());
+          dst_device = key_parts[2];
+        }
+        if (!dst_device.empty()) {
+          logger_->RecordRecvTensorRpc(request->requests(0).step_id(),
+                                       dst_device, response->responses_size());
+        }
+      }
+      done(s);
+    };
+    IssueRequest(request, response, recvtensorbatch_, callback, call_opts);
   }
 
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
@@ -296,6 +366,48 @@ class GrpcRemoteWorker : public WorkerInterface {
     IssueRequest(&request, response, markrecvfinished_, done);
   }
 
+  // Fills the contents of response->tensor() from `ring` if the response
+  // says they were passed through it, and opens the ring of target_ if the
+  // response advertises it.
+  Status MaybeReadFromSharedMemory(SharedMemoryRing* ring,
+                                   TensorResponse* response) {
+    const protobuf::Any& transport_options =
+        response->metadata().transport_options();
+    SharedMemoryTensorContent content;
+    if (transport_options.UnpackTo(&content)) {
+      if (ring == nullptr || ring->name() != content.ring_name()) {
+        return errors::Internal("RecvTensor response from ", target_,
+                                " refers to unknown shared memory ring ",
+                                content.ring_name());
+      }
+      SharedMemoryRing::Block block;
+      block.offset = content.offset();
+      block.size = content.size();
+      block.generation = content.generation();
+      const Tensor& tensor = response->tensor();
+      if (tensor.TotalBytes() != block.size) {
+        ring->Release(block).IgnoreError();
+        return errors::Internal("RecvTensor response from ", target_,
+                                " has ", block.size, " bytes in shared memory"
+                                " for a tensor of ", tensor.TotalBytes(),
+                                " bytes");
+      }
+      // The tensor was allocated by the parser, and is not shared yet.
+      Status s =
+          ring->Read(block, const_cast<char*>(tensor.tensor_data().data()));
+      if (errors::IsInvalidArgument(s)) {
+        ring->Release(block).IgnoreError();
+      }
+      return s;
+    }
+    SharedMemoryRingInfo ring_info;
+    if (transport_options.UnpackTo(&ring_info)) {
+      shared_memory_rings_->MaybeOpen(target_, ring_info.name(),
+                                      ring_info.token());
+    }
+    return Status::OK();
+  }
+
   // Helper function for initializing the RpcMethod objects below.
   const char* Method(GrpcWorkerMethod id) { return GrpcWorkerMethodName(id); }
 
@@ -320,21 +432,24 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::string instancesource_;
   const ::grpc::string getstepsequence_;
   const ::grpc::string markrecvfinished_;
+  const ::grpc::string recvtensorbatch_;
 
   // Support for logging.
   WorkerCacheLogger* logger_;
   const string target_;
 
+  SharedMemoryRingCache* const shared_memory_rings_;  // Not owned, may be null
+
   TF_DISALLOW_COPY_AND_ASSIGN(GrpcRemoteWorker);
 };
 
-WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
-                                     ::grpc::CompletionQueue* completion_queue,
-                                     thread::ThreadPool* callback_threadpool,
-                                     WorkerCacheLogger* logger,
-                                     const string& target) {
+WorkerInterface* NewGrpcRemoteWorker(
+    SharedGrpcChannelPtr channel, ::grpc::CompletionQueue* completion_queue,
+    thread::ThreadPool* callback_threadpool, WorkerCacheLogger* logger,
+    const string& target, SharedMemoryRingCache* shared_memory_rings) {
   return new GrpcRemoteWorker(std::move(channel), completion_queue,
-                              callback_threadpool, logger, target);
+                              callback_threadpool, logger, target,
+                              shared_memory_rings);
 }
 
 }  // namespace tensorflow
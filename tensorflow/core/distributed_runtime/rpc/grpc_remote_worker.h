@@ -23,14 +23,17 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 
 namespace tensorflow {
+class SharedMemoryRingCache;
 class WorkerCacheLogger;
 class WorkerInterface;
 
-WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
-                                     ::grpc::CompletionQueue* completion_queue,
-                                     thread::ThreadPool* callback_threadpool,
-                                     WorkerCacheLogger* logger,
-                                     const string& target);
+// If `shared_memory_rings` is not null, RecvTensor payloads are read from the
+// shared memory ring of `target` once it was opened, and the ring is opened
+// when `target` advertises it.
+WorkerInterface* NewGrpcRemoteWorker(
+    SharedGrpcChannelPtr channel, ::grpc::CompletionQueue* completion_queue,
+    thread::ThreadPool* callback_threadpool, WorkerCacheLogger* logger,
+    const string& target, SharedMemoryRingCache* shared_memory_rings = nullptr);
 
 }  // namespace tensorflow
 
@@ -83,8 +83,11 @@ class ReusePortOption : public ::grpc::ServerBuilderOption {
 };
 
 // static utility function
-RendezvousMgrInterface* NewRpcRendezvousMgr(const WorkerEnv* env) {
-  return new RpcRendezvousMgr(env);
+RendezvousMgrCreationFunction NewRpcRendezvousMgrFunc(
+    const RPCOptions& rpc_options) {
+  return [rpc_options](const WorkerEnv* env) {
+    return new RpcRendezvousMgr(env, rpc_options);
+  };
 }
 
 }  // namespace
@@ -197,7 +200,8 @@ Status GrpcServer::Init(const GrpcServerOptions& opts) {
   worker_env_.local_devices = worker_env_.device_mgr->ListDevices();
   master_env_.local_devices = worker_env_.device_mgr->ListDevices();
   worker_env_.rendezvous_mgr = opts.rendezvous_mgr_func == nullptr
-                                   ? new RpcRendezvousMgr(&worker_env_)
+                                   ? new RpcRendezvousMgr(&worker_env_,
+                                                          config.rpc_options())
                                    : opts.rendezvous_mgr_func(&worker_env_);
   string unused;
   string default_worker_name;
@@ -518,7 +522,8 @@ Status GrpcServer::Create(const ServerDef& server_def, Env* env,
   std::unique_ptr<GrpcServer> ret(
       new GrpcServer(server_def, env == nullptr ? Env::Default() : env));
   GrpcServerOptions options;
-  options.rendezvous_mgr_func = NewRpcRendezvousMgr;
+  options.rendezvous_mgr_func = NewRpcRendezvousMgrFunc(
+      server_def.default_session_config().rpc_options());
   options.local_device_mgr = local_device_mgr;
   Status s = ret->Init(options);
   if (!s.ok()) {
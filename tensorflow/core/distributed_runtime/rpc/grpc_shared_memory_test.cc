@@ -0,0 +1,173 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Tests passing RecvTensor payloads between two workers in this process
+// through shared memory, from GrpcWorker to GrpcRemoteWorker.
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/distributed_runtime/rpc/grpc_server_lib.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
+#include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+// Exposes the GrpcWorker of a server.
+class TestServer : public GrpcServer {
+ public:
+  static Status Create(const ServerDef& server_def,
+                       std::unique_ptr<TestServer>* server) {
+    server->reset(new TestServer(server_def));
+    GrpcServerOptions options;
+    const RPCOptions rpc_options =
+        server_def.default_session_config().rpc_options();
+    options.rendezvous_mgr_func = [rpc_options](const WorkerEnv* env) {
+      return new RpcRendezvousMgr(env, rpc_options);
+    };
+    return (*server)->Init(options);
+  }
+
+  using GrpcServer::worker_impl;
+
+ private:
+  explicit TestServer(const ServerDef& server_def)
+      : GrpcServer(server_def, Env::Default()) {}
+};
+
+class GrpcSharedMemoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ServerDef server_def;
+    server_def.set_protocol("grpc");
+    server_def.set_job_name("localhost");
+    JobDef* job_def = server_def.mutable_cluster()->add_job();
+    job_def->set_name("localhost");
+    for (int i = 0; i < 2; ++i) {
+      (*job_def->mutable_tasks())[i] =
+          strings::StrCat("localhost:", testing::PickUnusedPortOrDie());
+    }
+    ConfigProto* config = server_def.mutable_default_session_config();
+    (*config->mutable_device_count())["CPU"] = 1;
+    config->mutable_rpc_options()->set_shared_memory_transport_bytes(1 << 20);
+    for (int i = 0; i < 2; ++i) {
+      server_def.set_task_index(i);
+      TF_ASSERT_OK(TestServer::Create(server_def, &servers_[i]));
+      TF_ASSERT_OK(servers_[i]->Start());
+    }
+  }
+
+  void TearDown() override {
+    // Clean shutdown is not implemented for GrpcServer.
+    for (auto& server : servers_) server.release();
+  }
+
+  // Builds a graph passing `x` from task 0 to an Identity on task 1, and
+  // returns the name of the Identity.
+  static string BuildGraph(const Tensor& x, GraphDef* graph_def) {
+    Graph graph(OpRegistry::Global());
+    Node* source = test::graph::Constant(&graph, x);
+    source->set_requested_device("/job:localhost/replica:0/task:0/cpu:0");
+    Node* identity = test::graph::Identity(&graph, source);
+    identity->set_requested_device("/job:localhost/replica:0/task:1/cpu:0");
+    test::graph::ToGraphDef(&graph, graph_def);
+    return identity->name();
+  }
+
+  std::unique_ptr<Session> NewGrpcSession() {
+    SessionOptions options;
+    options.target = servers_[0]->target();
+    // Keep the constant from being folded into task 1.
+    options.config.mutable_graph_options()
+        ->mutable_optimizer_options()
+        ->set_opt_level(OptimizerOptions::L0);
+    options.config.mutable_graph_options()
+        ->mutable_rewrite_options()
+        ->set_disable_meta_optimizer(true);
+    return std::unique_ptr<Session>(NewSession(options));
+  }
+
+  std::unique_ptr<TestServer> servers_[2];
+};
+
+TEST_F(GrpcSharedMemoryTest, PassesTensorThroughRing) {
+  SharedMemoryRing* ring = servers_[0]->worker_impl()->shared_memory_ring();
+  ASSERT_NE(nullptr, ring);
+
+  Tensor x(DT_FLOAT, TensorShape({1024}));
+  for (int i = 0; i < 1024; ++i) x.flat<float>()(i) = i;
+  GraphDef graph_def;
+  const string fetch = BuildGraph(x, &graph_def);
+  std::unique_ptr<Session> session = NewGrpcSession();
+  ASSERT_NE(nullptr, session);
+  TF_ASSERT_OK(session->Create(graph_def));
+
+  // The first response advertises the ring, which later requests echo.
+  for (int step = 0; step < 3; ++step) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {strings::StrCat(fetch, ":0")}, {},
+                              &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(x, outputs[0]);
+  }
+  EXPECT_EQ(2 * x.TotalBytes(), ring->bytes_written());
+
+  // All payloads were read, so the whole ring is free again.
+  std::vector<char> payload(ring->capacity() / 2);
+  SharedMemoryRing::Block first, second;
+  TF_EXPECT_OK(ring->Write(payload.data(), payload.size(), &first));
+  EXPECT_TRUE(errors::IsResourceExhausted(
+      ring->Write(payload.data(), payload.size(), &second)));
+  TF_EXPECT_OK(ring->Release(first));
+  TF_EXPECT_OK(session->Close());
+}
+
+TEST_F(GrpcSharedMemoryTest, SmallTensorsStayOnGrpc) {
+  SharedMemoryRing* ring = servers_[0]->worker_impl()->shared_memory_ring();
+  ASSERT_NE(nullptr, ring);
+
+  Tensor x = test::AsTensor<float>({1, 2, 3});
+  GraphDef graph_def;
+  const string fetch = BuildGraph(x, &graph_def);
+  std::unique_ptr<Session> session = NewGrpcSession();
+  ASSERT_NE(nullptr, session);
+  TF_ASSERT_OK(session->Create(graph_def));
+  for (int step = 0; step < 3; ++step) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {strings::StrCat(fetch, ":0")}, {},
+                              &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(x, outputs[0]);
+  }
+  EXPECT_EQ(0, ring->bytes_written());
+  TF_EXPECT_OK(session->Close());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "grpcpp/support/slice.h"
 #include "absl/flags/flag.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -56,6 +57,7 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 //  encoding the code is generating).
 //
 // A:   <protocol buffer encoding of fields except R.tensor()>
+// P:   <RecvTensorResponse::padding, only for large tensors>
 // B1:  <tag encoding for RecvTensorResponse::tensor>
 // B2:  <varint32 length of R.tensor() sub message>
 // C:   <protocol buffer encoding of R.tensor() except for
@@ -73,6 +75,14 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 // copying the tensor data (and the grpc::Slice setup will be arrange so as
 // to dereference the underlying tensor data buffer when it is no longer
 // needed in the "*result" ByteBuffer).
+//
+// For large tensors, P pads A so that E starts at a multiple of
+// kTensorContentAlignment bytes from the beginning of the message. A receiver
+// holding the message in an aligned buffer can then use the tensor data in
+// place, see TensorResponse::Source::ShareBytes.
+static constexpr int kTensorContentAlignment =
+    Allocator::kAllocatorAlignment;
+
 static int VarLengthEncodingSize(uint32 tag, size_t bytes) {
   return core::VarintLength(tag << 3) + core::VarintLength(bytes) + bytes;
 }
@@ -137,14 +147,19 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
-void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
-                              ::grpc::ByteBuffer* result) {
+static void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                                     bool require_ack,
+                                     const protobuf::Any* transport_options,
+                                     ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
   RecvTensorResponse response;
   if (is_dead) {
     response.set_is_dead(is_dead);
   }
   response.set_require_ack(require_ack);
+  if (transport_options != nullptr) {
+    *response.mutable_transport_options() = *transport_options;
+  }
   response.set_send_start_micros(Env::Default()->NowMicros());
   if (!DataTypeCanUseMemcpy(val.dtype())) {
     // Straightforward but slow path for complicated kinds of tensor data
@@ -169,10 +184,6 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
     string header;  // All of RecvTensorResponse except the tensor() field
     response.AppendToString(&header);
 
-    size_t expected_size =
-        (header.size() +
-         VarLengthEncodingSize(RecvTensorResponse::kTensorFieldNumber,
-                               overall_tensor_proto_bytesize));
     // If "share_tensor_slice_memory == false", we copy the tensor data to
     // the end of the buffer we are preparing that holds the rest of the
     // RecvTensorResponse protocol buffer.
@@ -187,6 +198,29 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
 
     // (Omitted internal-only conditional)
 
+    // The tag and the length of P take one byte each, followed by
+    // "padding_bytes" bytes of padding.
+    size_t padding_size = 0;
+    int padding_bytes = 0;
+    if (share_tensor_slice_memory) {
+      const size_t unpadded_tdata_offset =
+          header.size() +
+          core::VarintLength(RecvTensorResponse::kTensorFieldNumber << 3) +
+          core::VarintLength(overall_tensor_proto_bytesize) +
+          e_skeleton.size() +
+          core::VarintLength(TensorProto::kTensorContentFieldNumber << 3) +
+          core::VarintLength(tdata.size());
+      padding_bytes = (kTensorContentAlignment -
+                       (unpadded_tdata_offset + 2) % kTensorContentAlignment) %
+                      kTensorContentAlignment;
+      padding_size = 2 + padding_bytes;
+    }
+
+    size_t expected_size =
+        (header.size() + padding_size +
+         VarLengthEncodingSize(RecvTensorResponse::kTensorFieldNumber,
+                               overall_tensor_proto_bytesize));
+
     size_t encoder_size = expected_size - tdata.size();
 
     // Encode all but the actual "tdata", but including the tag and
@@ -196,6 +230,14 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
     // (A)
     e.WriteRawBytes(header);
 
+    // (P)
+    if (padding_size > 0) {
+      static const char kZeros[kTensorContentAlignment] = {};
+      e.WriteVarlengthBeginning(RecvTensorResponse::kPaddingFieldNumber,
+                                padding_bytes);
+      e.WriteRawBytes(StringPiece(kZeros, padding_bytes));
+    }
+
     // (B1) & (B2)
     e.WriteVarlengthBeginning(RecvTensorResponse::kTensorFieldNumber,
                               overall_tensor_proto_bytesize);
@@ -245,5 +287,18 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
   }
 }
 
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
+                              ::grpc::ByteBuffer* result) {
+  EncodeTensorToByteBuffer(is_dead, val, require_ack,
+                           /*transport_options=*/nullptr, result);
+}
+
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
+                              const protobuf::Any& transport_options,
+                              ::grpc::ByteBuffer* result) {
+  EncodeTensorToByteBuffer(is_dead, val, require_ack, &transport_options,
+                           result);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 
+#include "google/protobuf/any.pb.h"
 #include "grpcpp/impl/codegen/byte_buffer.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
 class Tensor;
@@ -49,6 +51,12 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
                               ::grpc::ByteBuffer* result);
 
+// As above, also encoding "transport_options" as
+// "RecvTensorResponse::transport_options".
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
+                              const protobuf::Any& transport_options,
+                              ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
@@ -15,13 +15,25 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace tensorflow {
@@ -100,4 +112,129 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+class DummyDevice : public DeviceBase {
+ public:
+  explicit DummyDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("CPU");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
+
+TEST_F(GrpcTensorCodingTest, ParseSharesLargeTensors) {
+  DummyDevice cpu_device(Env::Default());
+  for (int64 num_elems : {16, 4096}) {
+    Tensor t(DT_FLOAT, TensorShape({num_elems}));
+    t.flat<float>().setRandom();
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorToByteBuffer(false, t, false, &buf);
+
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    ASSERT_TRUE(GrpcMaybeParseProto(&buf, &response));
+    test::ExpectTensorEqual<float>(response.tensor(), t);
+    // The contents of large tensors are sent in their own slice, which the
+    // received tensor aliases rather than copies.
+    EXPECT_EQ(response.tensor().tensor_data().data() == t.tensor_data().data(),
+              num_elems == 4096);
+
+    // The received tensor keeps the slice alive.
+    buf.Clear();
+    test::ExpectTensorEqual<float>(response.tensor(), t);
+  }
+}
+
+// Returns a copy of the bytes of `buf` in a buffer starting at an aligned
+// address, as a single slice if `max_slice_size` is 0, or otherwise split in
+// slices of up to `max_slice_size` bytes, as gRPC splits the messages it
+// receives over TCP in HTTP/2 frames.
+::grpc::ByteBuffer CopyToAlignedBuffer(const ::grpc::ByteBuffer& buf,
+                                       size_t max_slice_size) {
+  std::vector<::grpc::Slice> slices;
+  TF_CHECK_OK(FromGrpcStatus(buf.Dump(&slices)));
+  size_t size = 0;
+  for (const auto& slice : slices) size += slice.size();
+  char* data = static_cast<char*>(
+      port::AlignedMalloc(size, Allocator::kAllocatorAlignment));
+  size_t offset = 0;
+  for (const auto& slice : slices) {
+    memcpy(data + offset, slice.begin(), slice.size());
+    offset += slice.size();
+  }
+  ::grpc::Slice all(
+      data, size, [](void* data) { port::AlignedFree(data); }, data);
+  if (max_slice_size == 0) return ::grpc::ByteBuffer(&all, 1);
+  std::vector<::grpc::Slice> received;
+  for (size_t begin = 0; begin < size; begin += max_slice_size) {
+    received.push_back(all.sub(begin, std::min(size, begin + max_slice_size)));
+  }
+  return ::grpc::ByteBuffer(received.data(), received.size());
+}
+
+TEST_F(GrpcTensorCodingTest, ParseSharesAlignedReceivedContents) {
+  DummyDevice cpu_device(Env::Default());
+  Tensor t(DT_FLOAT, TensorShape({4096}));
+  t.flat<float>().setRandom();
+  ::grpc::ByteBuffer sent;
+  grpc::EncodeTensorToByteBuffer(false, t, false, &sent);
+
+  // The sender pads the message so that the contents are aligned in a buffer
+  // holding the whole message, which can then be shared.
+  ::grpc::ByteBuffer contiguous = CopyToAlignedBuffer(sent, 0);
+  std::vector<::grpc::Slice> slices;
+  TF_ASSERT_OK(FromGrpcStatus(contiguous.Dump(&slices)));
+  ASSERT_EQ(slices.size(), 1);
+  const char* begin = reinterpret_cast<const char*>(slices[0].begin());
+  const char* end = reinterpret_cast<const char*>(slices[0].end());
+  {
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    ASSERT_TRUE(GrpcMaybeParseProto(&contiguous, &response));
+    test::ExpectTensorEqual<float>(response.tensor(), t);
+    const char* data = response.tensor().tensor_data().data();
+    EXPECT_TRUE(data >= begin && data < end);
+    EXPECT_TRUE(response.tensor().IsAligned());
+  }
+
+  // Contents split across slices are copied.
+  ::grpc::ByteBuffer fragmented = CopyToAlignedBuffer(sent, 16384);
+  TF_ASSERT_OK(FromGrpcStatus(fragmented.Dump(&slices)));
+  ASSERT_GT(slices.size(), 1);
+  {
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    ASSERT_TRUE(GrpcMaybeParseProto(&fragmented, &response));
+    test::ExpectTensorEqual<float>(response.tensor(), t);
+    const char* data = response.tensor().tensor_data().data();
+    for (const auto& slice : slices) {
+      EXPECT_FALSE(data >= reinterpret_cast<const char*>(slice.begin()) &&
+                   data < reinterpret_cast<const char*>(slice.end()));
+    }
+  }
+}
+
+static void BM_TensorRoundTrip(int iters, int num_bytes) {
+  testing::StopTiming();
+  DummyDevice cpu_device(Env::Default());
+  Tensor t(DT_UINT8, TensorShape({num_bytes}));
+  t.flat<uint8>().setConstant(1);
+  testing::BytesProcessed(static_cast<int64>(iters) * num_bytes);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorToByteBuffer(false, t, false, &buf);
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    CHECK(GrpcMaybeParseProto(&buf, &response));
+  }
+}
+BENCHMARK(BM_TensorRoundTrip)->Range(1 << 10, 1 << 28);
+
 }  // namespace tensorflow
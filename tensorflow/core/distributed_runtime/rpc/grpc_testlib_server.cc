@@ -69,6 +69,9 @@ Status FillServerDef(const string& job_spec, const string& job_name,
   ConfigProto* config = options->mutable_default_session_config();
   (*config->mutable_device_count())["CPU"] = num_cpus;
   (*config->mutable_device_count())["GPU"] = num_gpus;
+  // Let collective ops span the tasks of this job.
+  config->mutable_experimental()->set_collective_group_leader(
+      strings::StrCat("/job:", job_name, "/replica:0/task:0"));
   return Status::OK();
 }
 
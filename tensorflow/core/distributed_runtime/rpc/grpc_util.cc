@@ -15,12 +15,41 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/lib/random/random.h"
 
 namespace tensorflow {
 
 namespace {
 
+// TensorBuffer holding a reference on a received ::grpc::Slice, so that a
+// Tensor can be backed by the slice without copying it.
+class GrpcSliceTensorBuffer : public TensorBuffer {
+ public:
+  GrpcSliceTensorBuffer(const ::grpc::Slice& slice, size_t offset, size_t size)
+      : TensorBuffer(const_cast<uint8_t*>(slice.begin()) + offset),
+        slice_(slice),
+        size_(size) {
+    // Copying an inlined slice would move its bytes.
+    DCHECK_EQ(slice.begin(), slice_.begin());
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("grpc");
+  }
+
+  // Prevents input forwarding from mutating the slice, which may be shared
+  // with other readers.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const ::grpc::Slice slice_;
+  const size_t size_;
+};
+
 double GenerateUniformRandomNumber() {
   return random::New64() * (1.0 / std::numeric_limits<uint64>::max());
 }
@@ -77,6 +106,24 @@ int64 ComputeBackoffMicroseconds(int current_retry_attempt, int64 min_delay,
                                   protobuf::Message>(src, dst, &own_buffer);
 }
 
+TensorBuffer* GrpcByteSource::ShareBytes(int64 offset, int64 num_bytes) {
+  // Inlined slices store their bytes in the slice object itself, so they
+  // cannot be shared.
+  if (num_bytes <= GRPC_SLICE_INLINED_SIZE) return nullptr;
+  std::vector<::grpc::Slice> slices;
+  if (!buffer_->Dump(&slices).ok()) return nullptr;
+  int64 slice_offset = 0;
+  for (const ::grpc::Slice& slice : slices) {
+    const int64 slice_size = slice.size();
+    if (offset < slice_offset + slice_size) {
+      if (offset + num_bytes > slice_offset + slice_size) return nullptr;
+      return new GrpcSliceTensorBuffer(slice, offset - slice_offset, num_bytes);
+    }
+    slice_offset += slice_size;
+  }
+  return nullptr;
+}
+
 // GrpcMaybeUnparseProto from a string simply copies the string to the
 // ByteBuffer.
 ::grpc::Status GrpcMaybeUnparseProto(const string& src, grpc::ByteBuffer* dst) {
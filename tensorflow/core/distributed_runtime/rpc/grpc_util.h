@@ -53,6 +53,10 @@ class GrpcByteSource : public TensorResponse::Source {
     return stream_;
   }
 
+  // Shares the bytes if they lie within a single slice of the buffer, by
+  // taking a reference on that slice.
+  TensorBuffer* ShareBytes(int64 offset, int64 num_bytes) override;
+
  private:
   void DeleteStream() {
     if (stream_) {
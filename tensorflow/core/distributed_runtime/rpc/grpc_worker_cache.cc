@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/eager/grpc_eager_client.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_remote_worker.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_logger.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_partial.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
@@ -61,7 +62,8 @@ class GrpcWorkerCache : public WorkerCachePartial {
       size_t index = AssignWorkerToThread(target);
       return NewGrpcRemoteWorker(
           channel, worker_env_->GetCompletionQueue(index),
-          worker_env_->GetThreadPool(), &logger_, target);
+          worker_env_->GetThreadPool(), &logger_, target,
+          &shared_memory_rings_);
     }
   }
 
@@ -109,6 +111,9 @@ class GrpcWorkerCache : public WorkerCachePartial {
   std::shared_ptr<GrpcChannelCache> channel_cache_;
   WorkerCacheLogger logger_;
   GrpcWorkerEnv* worker_env_;  // Not owned
+  // Rings of workers on this host, through which they pass RecvTensor
+  // payloads.
+  SharedMemoryRingCache shared_memory_rings_;
 
   mutex assignment_mu_;
   std::unordered_map<std::string, size_t> target_assignments_
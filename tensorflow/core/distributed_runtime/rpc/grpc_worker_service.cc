@@ -50,6 +50,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -147,6 +148,7 @@ class GrpcWorkerServiceThread {
     SETUP_FOR_REQUEST(RunGraph, 100, true);
     SETUP_FOR_REQUEST(CleanupGraph, 100, false);
     SETUP_FOR_REQUEST(MarkRecvFinished, 10, false);
+    SETUP_FOR_REQUEST(RecvTensorBatch, 100, true);
 
     // TODO(ncteisen): Determine a better policy for enqueuing the
     // appropriate number of each request type.
@@ -268,21 +270,46 @@ class GrpcWorkerServiceThread {
     Schedule([this, call]() {
       CallOptions* call_opts = new CallOptions;
       call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+      auto* undelivered = new std::function<void()>;
 
       worker_->GrpcRecvTensorAsync(
-          call_opts, &call->request, &call->response,
-          [call, call_opts](const Status& s) {
+          call_opts, &call->request, &call->response, undelivered,
+          [call, call_opts, undelivered](const Status& s) {
             call->ClearCancelCallback();
             delete call_opts;
             if (!s.ok()) {
               VLOG(1) << "Bad response from RecvTensor:" << s;
+            } else if (*undelivered) {
+              // Runs if the call does not complete, so that the client never
+              // reads the payload the response refers to.
+              call->SetCancelCallback(std::move(*undelivered));
             }
+            delete undelivered;
             call->SendResponse(ToGrpcStatus(s));
           });
     });
     EnqueueRecvTensorRequestRaw();
   }
 
+  void RecvTensorBatchHandler(
+      WorkerCall<RecvTensorBatchRequest, RecvTensorBatchResponse>* call) {
+    Schedule([this, call]() {
+      CallOptions* call_opts = new CallOptions;
+      call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+      worker_->RecvTensorBatchAsync(
+          call_opts, &call->request, &call->response,
+          [call, call_opts](const Status& s) {
+            call->ClearCancelCallback();
+            delete call_opts;
+            if (!s.ok()) {
+              VLOG(1) << "Bad response from RecvTensorBatch:" << s;
+            }
+            call->SendResponse(ToGrpcStatus(s));
+          });
+    });
+    ENQUEUE_REQUEST(RecvTensorBatch, true);
+  }
+
   void RecvBufHandler(WorkerCall<RecvBufRequest, RecvBufResponse>* call) {
     Schedule([this, call]() {
       CallOptions* call_opts = new CallOptions;
@@ -426,6 +453,19 @@ GrpcWorker::GrpcWorker(WorkerEnv* worker_env, const ConfigProto& config)
               : (config.experimental().recv_buf_max_chunk() < 0 ? 0 : 4096)) {
   if (config.rpc_options().cache_rpc_response()) {
     EnableResponseCache();
+  } else if (config.rpc_options().shared_memory_transport_bytes() > 0) {
+    // Cached responses may be sent again after their ring blocks were
+    // released, so shared memory is only used without the response cache.
+    std::unique_ptr<SharedMemoryRing> ring;
+    Status s = SharedMemoryRing::Create(
+        SharedMemoryRing::UniqueName(),
+        config.rpc_options().shared_memory_transport_bytes(), &ring);
+    if (s.ok()) {
+      shared_memory_ring_ = std::move(ring);
+    } else {
+      LOG(WARNING) << "Not passing RecvTensor payloads through shared memory: "
+                   << s;
+    }
   }
 }
 
@@ -440,6 +480,7 @@ void GrpcWorker::EnableResponseCache() {
 void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
                                      const RecvTensorRequest* request,
                                      ::grpc::ByteBuffer* response,
+                                     std::function<void()>* undelivered,
                                      StatusCallback done) {
   VLOG(1) << "GrpcRecvTensorAsync req: " << request->DebugString();
   const int64 request_id = request->request_id();
@@ -447,11 +488,12 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
+  auto do_response = [this, request, response, undelivered, done,
+                      cache_enabled](const Tensor& tensor, bool is_dead,
+                                     const Status& status) {
     if (status.ok()) {
-      grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
+      EncodeRecvTensorResponse(*request, tensor, is_dead, cache_enabled,
+                               response, undelivered);
     }
     done(status);
   };
@@ -476,18 +518,222 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
     }
   };
 
-  auto fail = [&rendezvous_done](const Status& status) {
-    rendezvous_done(Tensor(), false, status);
+  // Request the tensor associated with the rendezvous key.
+  // Note that we log the cancellation here but do not abort the current step.
+  // gRPC can generate cancellations in response to transient network failures,
+  // and aborting the step eliminates the opportunity for client side retries.
+  // Repeated client failures will eventually cause the step to be aborted by
+  // the client.
+  opts->SetCancelCallback(
+      [step_id]() { LOG(WARNING) << "RecvTensor cancelled for " << step_id; });
+  RecvLocalTensorAsync(*request, [opts, rendezvous_done](const Tensor& tensor,
+                                                         bool is_dead,
+                                                         const Status& status) {
+    opts->ClearCancelCallback();
+    rendezvous_done(tensor, is_dead, status);
+  });
+}
+
+namespace {
+// Tensors larger than this are held for a RecvTensor of their own rather than
+// copied into a RecvTensorBatch response, which would lose the zero-copy and
+// shared memory paths of RecvTensor.
+const int64 kMaxBatchedTensorBytes = 64 * 1024;
+// A RecvTensorBatch response is sent once its tensors take this many bytes.
+const int64 kMaxRecvTensorBatchBytes = 4 * 1024 * 1024;
+}  // namespace
+
+void GrpcWorker::RecvTensorBatchAsync(CallOptions* opts,
+                                      const RecvTensorBatchRequest* request,
+                                      RecvTensorBatchResponse* response,
+                                      StatusCallback done) {
+  const int num_requests = request->requests_size();
+  VLOG(1) << "RecvTensorBatchAsync for " << num_requests << " tensors";
+  if (num_requests == 0) {
+    done(Status::OK());
+    return;
+  }
+
+  // Shared by the callbacks of all requests.  The response is sent once all
+  // requests were issued and a tensor is ready, with the tensors ready by
+  // then, so that a tensor which is produced late (e.g. only after the
+  // receiver got another one) never holds back the others.
+  struct BatchState {
+    mutex mu;
+    bool issuing TF_GUARDED_BY(mu) = true;
+    bool responded TF_GUARDED_BY(mu) = false;
+    int num_ready TF_GUARDED_BY(mu) = 0;
+    Status status TF_GUARDED_BY(mu);
+    int64 response_bytes TF_GUARDED_BY(mu) = 0;
+    std::vector<bool> ready TF_GUARDED_BY(mu);
+  };
+  auto state = std::make_shared<BatchState>();
+  {
+    mutex_lock l(state->mu);
+    state->ready.resize(num_requests, false);
+  }
+  // Marks the batch as responded to, and unless it failed, holds the tensors
+  // which are not ready yet for the receiver to ask for them again.  Returns
+  // the status to respond with.  Requires state->mu.
+  auto respond = [this, request](BatchState* state) {
+    state->responded = true;
+    if (state->status.ok()) {
+      for (int i = 0; i < request->requests_size(); ++i) {
+        if (!state->ready[i]) ExpectHeldRecvTensor(request->requests(i));
+      }
+    }
+    return state->status;
   };
 
+  const int64 step_id = request->requests(0).step_id();
+  opts->SetCancelCallback([step_id]() {
+    LOG(WARNING) << "RecvTensorBatch cancelled for " << step_id;
+  });
+  for (int i = 0; i < num_requests; ++i) {
+    // A tensor may become ready after the response was sent, and `request`
+    // freed, so its callback keeps the fields that identify the tensor.
+    RecvTensorRequest tensor_request;
+    tensor_request.set_step_id(request->requests(i).step_id());
+    tensor_request.set_rendezvous_key(request->requests(i).rendezvous_key());
+    RecvLocalTensorAsync(
+        request->requests(i),
+        [this, opts, done, state, respond, response, i, tensor_request](
+            const Tensor& tensor, bool is_dead, const Status& status) {
+          bool responded;
+          Status batch_status;
+          {
+            mutex_lock l(state->mu);
+            responded = state->responded;
+            if (!responded) {
+              state->ready[i] = true;
+              ++state->num_ready;
+              // An error fails the whole batch on the receiver.
+              state->status.Update(status);
+              const int64 bytes = tensor.TotalBytes();
+              if (!status.ok()) {
+                // Nothing to return.
+              } else if (bytes > kMaxBatchedTensorBytes) {
+                HoldRecvTensor(tensor_request, tensor, is_dead, status,
+                               /*create=*/true);
+                response->add_unbatched_request_indices(i);
+              } else if (state->response_bytes + bytes >
+                             kMaxRecvTensorBatchBytes &&
+                         response->responses_size() > 0) {
+                // Left for the next batch.
+                HoldRecvTensor(tensor_request, tensor, is_dead, status,
+                               /*create=*/true);
+              } else {
+                RecvTensorResponse* tensor_response = response->add_responses();
+                response->add_request_indices(i);
+                tensor_response->set_is_dead(is_dead);
+                tensor_response->set_send_start_micros(
+                    Env::Default()->NowMicros());
+                tensor.AsProtoTensorContent(tensor_response->mutable_tensor());
+                state->response_bytes += bytes;
+              }
+              if (state->issuing) return;
+              batch_status = respond(state.get());
+            }
+          }
+          if (responded) {
+            // The response was sent without this tensor.
+            HoldRecvTensor(tensor_request, tensor, is_dead, status,
+                           /*create=*/false);
+            return;
+          }
+          opts->ClearCancelCallback();
+          done(batch_status);
+        });
+  }
+  Status batch_status;
+  {
+    mutex_lock l(state->mu);
+    state->issuing = false;
+    if (state->num_ready == 0) return;
+    batch_status = respond(state.get());
+  }
+  opts->ClearCancelCallback();
+  done(batch_status);
+}
+
+void GrpcWorker::ExpectHeldRecvTensor(const RecvTensorRequest& request) {
+  mutex_lock l(held_recv_tensors_mu_);
+  held_recv_tensors_[request.step_id()][request.rendezvous_key()];
+}
+
+void GrpcWorker::HoldRecvTensor(const RecvTensorRequest& request,
+                                const Tensor& tensor, bool is_dead,
+                                const Status& status, bool create) {
+  RecvLocalTensorCallback waiter;
+  {
+    mutex_lock l(held_recv_tensors_mu_);
+    auto step_it = held_recv_tensors_.find(request.step_id());
+    if (step_it == held_recv_tensors_.end()) {
+      if (!create) return;
+      step_it = held_recv_tensors_.emplace(request.step_id(),
+                                           std::unordered_map<string,
+                                                              HeldRecvTensor>())
+                    .first;
+    }
+    auto it = step_it->second.find(request.rendezvous_key());
+    if (it == step_it->second.end()) {
+      if (!create) return;
+      it = step_it->second.emplace(request.rendezvous_key(), HeldRecvTensor())
+               .first;
+    }
+    if (it->second.waiter) {
+      waiter = std::move(it->second.waiter);
+      step_it->second.erase(it);
+    } else {
+      it->second.ready = true;
+      it->second.tensor = tensor;
+      it->second.is_dead = is_dead;
+      it->second.status = status;
+    }
+  }
+  if (waiter) waiter(tensor, is_dead, status);
+}
+
+bool GrpcWorker::TakeHeldRecvTensor(const RecvTensorRequest& request,
+                                    const RecvLocalTensorCallback& done) {
+  HeldRecvTensor held;
+  {
+    mutex_lock l(held_recv_tensors_mu_);
+    auto step_it = held_recv_tensors_.find(request.step_id());
+    if (step_it == held_recv_tensors_.end()) return false;
+    auto it = step_it->second.find(request.rendezvous_key());
+    if (it == step_it->second.end()) return false;
+    if (!it->second.ready) {
+      if (!it->second.waiter) {
+        it->second.waiter = done;
+        return true;
+      }
+      held.status = errors::Internal("RecvTensor for ",
+                                     request.rendezvous_key(),
+                                     " is already waiting");
+    } else {
+      held = std::move(it->second);
+      step_it->second.erase(it);
+    }
+  }
+  done(held.tensor, held.is_dead, held.status);
+  return true;
+}
+
+void GrpcWorker::RecvLocalTensorAsync(const RecvTensorRequest& request,
+                                      RecvLocalTensorCallback done) {
+  // Held tensors were asked for before, so their requests are not unique.
+  if (TakeHeldRecvTensor(request, done)) return;
+  const int64 request_id = request.request_id();
+  const int64 step_id = request.step_id();
   Status s = recent_request_ids_.TrackUnique(
-      request_id, "RecvTensor (GrpcWorker)", *request);
+      request_id, "RecvTensor (GrpcWorker)", request);
   if (!s.ok()) {
-    fail(s);
+    done(Tensor(), false, s);
     return;
   }
 
-  const string& key = request->rendezvous_key();
+  const string& key = request.rendezvous_key();
   TRACEPRINTF("RecvTensor: %lld %s", step_id, key.c_str());
   Rendezvous::ParsedKey parsed;
   s = Rendezvous::ParseKey(key, &parsed);
@@ -496,25 +742,16 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
     s = PrepareRecvTensor(parsed, &src_dev);
   }
   if (!s.ok()) {
-    fail(s);
+    done(Tensor(), false, s);
     return;
   }
 
-  // Request the tensor associated with the rendezvous key.
-  // Note that we log the cancellation here but do not abort the current step.
-  // gRPC can generate cancellations in response to transient network failures,
-  // and aborting the step eliminates the opportunity for client side retries.
-  // Repeated client failures will eventually cause the step to be aborted by
-  // the client.
-  opts->SetCancelCallback(
-      [step_id]() { LOG(WARNING) << "RecvTensor cancelled for " << step_id; });
   env_->rendezvous_mgr->RecvLocalAsync(
       step_id, parsed,
-      [opts, rendezvous_done, src_dev, request](
-          const Status& status, const Rendezvous::Args& send_args,
-          const Rendezvous::Args& recv_args, const Tensor& val,
-          const bool is_dead) {
-        opts->ClearCancelCallback();
+      [done, src_dev, key](const Status& status,
+                           const Rendezvous::Args& send_args,
+                           const Rendezvous::Args& recv_args,
+                           const Tensor& val, const bool is_dead) {
         if (status.ok()) {
           // DMA can only be used for Tensors that do not fall into
           // the following three odd edge cases: 1) a zero-size
@@ -537,24 +774,75 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
                   << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
               // "val" is on an accelerator device. Uses the device_context to
               // fill the copy on host.
-              StatusCallback copy_ready = [rendezvous_done, copy,
+              StatusCallback copy_ready = [done, copy,
                                            is_dead](const Status& s) {
                 // The value is now ready to be returned on the wire.
-                rendezvous_done(*copy, is_dead, s);
+                done(*copy, is_dead, s);
                 delete copy;
               };
 
-              CopyDeviceToHost(&val, alloc, alloc, request->rendezvous_key(),
-                               src_dev, copy, send_dev_context, copy_ready);
+              CopyDeviceToHost(&val, alloc, alloc, key, src_dev, copy,
+                               send_dev_context, copy_ready);
               return;
             }
           }
         }
 
-        rendezvous_done(val, is_dead, status);
+        done(val, is_dead, status);
       });
 }
 
+void GrpcWorker::EncodeRecvTensorResponse(const RecvTensorRequest& request,
+                                          const Tensor& tensor, bool is_dead,
+                                          bool require_ack,
+                                          ::grpc::ByteBuffer* response,
+                                          std::function<void()>* undelivered) {
+  // Smaller payloads are not worth a round trip through the ring.
+  const int64 kMinSharedMemoryTensorBytes = 1024;
+  if (shared_memory_ring_ == nullptr) {
+    grpc::EncodeTensorToByteBuffer(is_dead, tensor, require_ack, response);
+    return;
+  }
+  SharedMemoryRingInfo ring_info;
+  if (!request.transport_options().UnpackTo(&ring_info) ||
+      ring_info.name() != shared_memory_ring_->name()) {
+    // Advertise the ring, which the receiver can open if it runs on this
+    // host.
+    ring_info.set_name(shared_memory_ring_->name());
+    ring_info.set_token(shared_memory_ring_->token());
+    protobuf::Any transport_options;
+    transport_options.PackFrom(ring_info);
+    grpc::EncodeTensorToByteBuffer(is_dead, tensor, require_ack,
+                                   transport_options, response);
+    return;
+  }
+  SharedMemoryRing::Block block;
+  if (is_dead || !DataTypeCanUseMemcpy(tensor.dtype()) ||
+      tensor.TotalBytes() < kMinSharedMemoryTensorBytes ||
+      !shared_memory_ring_
+           ->Write(tensor.tensor_data().data(), tensor.TotalBytes(), &block)
+           .ok()) {
+    grpc::EncodeTensorToByteBuffer(is_dead, tensor, require_ack, response);
+    return;
+  }
+  std::shared_ptr<SharedMemoryRing> ring = shared_memory_ring_;
+  *undelivered = [ring, block]() { ring->Release(block).IgnoreError(); };
+  // Send everything but the tensor contents, which the receiver reads from
+  // the ring.
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(tensor.dtype());
+  tensor.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_send_start_micros(Env::Default()->NowMicros());
+  proto.set_require_ack(require_ack);
+  SharedMemoryTensorContent content;
+  content.set_ring_name(shared_memory_ring_->name());
+  content.set_offset(block.offset);
+  content.set_size(block.size);
+  content.set_generation(block.generation);
+  proto.mutable_transport_options()->PackFrom(content);
+  grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+}
+
 namespace {
 // If RecvBufRespExtra.tensor_content is a single large string, then gRPC
 // can stall on the recv side when the string buffer needs to be enlarged,
@@ -734,6 +1022,22 @@ void GrpcWorker::CleanupGraphAsync(const CleanupGraphRequest* request,
     // a worker crashes before acking a request.
     response_cache_->CleanEntriesForStep(request->step_id());
   }
+  std::unordered_map<string, HeldRecvTensor> held;
+  {
+    mutex_lock l(held_recv_tensors_mu_);
+    auto it = held_recv_tensors_.find(request->step_id());
+    if (it != held_recv_tensors_.end()) {
+      held.swap(it->second);
+      held_recv_tensors_.erase(it);
+    }
+  }
+  for (auto& key_and_held : held) {
+    if (key_and_held.second.waiter) {
+      key_and_held.second.waiter(
+          Tensor(), false,
+          errors::Aborted("Step ", request->step_id(), " was cleaned up"));
+    }
+  }
   Worker::CleanupGraphAsync(request, response, done);
 }
 
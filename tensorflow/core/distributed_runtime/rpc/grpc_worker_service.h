@@ -20,8 +20,11 @@ limitations under the License.
 #include <unordered_map>
 #include "grpcpp/server_builder.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_response_cache.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace grpc {
@@ -40,12 +43,21 @@ class GrpcWorker : public Worker {
  public:
   GrpcWorker(WorkerEnv* env, const ConfigProto& config);
 
-  // Specialized version of RecvTensor for gRPC, which avoids a copy.
+  // Specialized version of RecvTensor for gRPC, which avoids a copy.  If
+  // `response` refers to a payload held for the receiver, `*undelivered` is
+  // set before `done` is called to a callback which releases it, and which
+  // the caller runs if the response cannot be delivered.
   virtual void GrpcRecvTensorAsync(CallOptions* opts,
                                    const RecvTensorRequest* request,
                                    ::grpc::ByteBuffer* response,
+                                   std::function<void()>* undelivered,
                                    StatusCallback done);
 
+  void RecvTensorBatchAsync(CallOptions* opts,
+                            const RecvTensorBatchRequest* request,
+                            RecvTensorBatchResponse* response,
+                            StatusCallback done) override;
+
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override;
 
@@ -62,9 +74,70 @@ class GrpcWorker : public Worker {
 
   void RemoveCacheEntryForId(int64 request_id);
 
+  // Returns the ring through which RecvTensor payloads are passed to workers
+  // on the same host, or nullptr if it is not enabled.
+  SharedMemoryRing* shared_memory_ring() const {
+    return shared_memory_ring_.get();
+  }
+
  private:
+  typedef std::function<void(const Tensor& tensor, bool is_dead,
+                             const Status& status)>
+      RecvLocalTensorCallback;
+
+  // Retrieves the tensor of `request` from the local rendezvous, copies it to
+  // host memory if it is on a GPU, and passes it to `done`.  Tensors held by
+  // HoldRecvTensor() are passed to the first request asking for them again.
+  void RecvLocalTensorAsync(const RecvTensorRequest& request,
+                            RecvLocalTensorCallback done);
+
+  // Tensors which a RecvTensorBatch request retrieved but did not return,
+  // until RecvLocalTensorAsync() is called for them again.
+  struct HeldRecvTensor {
+    bool ready = false;
+    Tensor tensor;
+    bool is_dead = false;
+    Status status;
+    // Set while a request waits for the tensor.
+    RecvLocalTensorCallback waiter;
+  };
+
+  // Makes the tensor of `request`, which is still being retrieved, wait for
+  // HoldRecvTensor().
+  void ExpectHeldRecvTensor(const RecvTensorRequest& request);
+
+  // Holds the tensor of `request`, or passes it to the request waiting for
+  // it.  Drops the tensor unless `create` or ExpectHeldRecvTensor() was
+  // called for the request.
+  void HoldRecvTensor(const RecvTensorRequest& request, const Tensor& tensor,
+                      bool is_dead, const Status& status, bool create);
+
+  // Returns false if no tensor is held for `request`, and otherwise passes
+  // it to `done` once it is ready.
+  bool TakeHeldRecvTensor(const RecvTensorRequest& request,
+                          const RecvLocalTensorCallback& done);
+
+  // Encodes the response to `request` for `tensor` into `response`, passing
+  // the tensor contents through shared_memory_ring_ if the receiver opened
+  // it, or else advertising the ring to the receiver.  Sets `*undelivered`
+  // as described for GrpcRecvTensorAsync.
+  void EncodeRecvTensorResponse(const RecvTensorRequest& request,
+                                const Tensor& tensor, bool is_dead,
+                                bool require_ack,
+                                ::grpc::ByteBuffer* response,
+                                std::function<void()>* undelivered);
+
   std::unique_ptr<GrpcResponseCache> response_cache_;
   const int32 recv_buf_max_chunk_;
+  // Ring through which RecvTensor payloads are passed to workers on the same
+  // host, if enabled by RPCOptions.shared_memory_transport_bytes.  Shared
+  // with the callbacks which release undelivered payloads.
+  std::shared_ptr<SharedMemoryRing> shared_memory_ring_;
+
+  mutex held_recv_tensors_mu_;
+  // By step id and rendezvous key.  Dropped by CleanupGraphAsync().
+  std::unordered_map<int64, std::unordered_map<string, HeldRecvTensor>>
+      held_recv_tensors_ TF_GUARDED_BY(held_recv_tensors_mu_);
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env,
@@ -0,0 +1,143 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/worker_env.h"
+#include "tensorflow/core/distributed_runtime/worker_session.h"
+#include "tensorflow/core/framework/rendezvous.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kWorkerName[] = "/job:worker/replica:0/task:0";
+constexpr char kDeviceName[] = "/job:worker/replica:0/task:0/device:CPU:0";
+
+class FakeDevice : public Device {
+ public:
+  explicit FakeDevice(const DeviceAttributes& attr) : Device(nullptr, attr) {}
+  Status Sync() override { return Status::OK(); }
+  Allocator* GetAllocator(AllocatorAttributes) override {
+    return cpu_allocator();
+  }
+};
+
+class GrpcWorkerTest : public ::testing::Test {
+ protected:
+  GrpcWorkerTest() {
+    DeviceAttributes attr;
+    attr.set_name(kDeviceName);
+    attr.set_device_type("CPU");
+    std::vector<std::unique_ptr<Device>> devices;
+    devices.emplace_back(new FakeDevice(attr));
+    device_mgr_.reset(new StaticDeviceMgr(std::move(devices)));
+    worker_session_ = WorkerSession::CreateWithBorrowedDeviceMgr(
+        "session", kWorkerName, std::unique_ptr<WorkerCacheInterface>(),
+        device_mgr_.get(), std::unique_ptr<GraphMgr>(),
+        std::unique_ptr<DynamicDeviceMgr>());
+    env_.env = Env::Default();
+    env_.device_mgr = device_mgr_.get();
+    rendezvous_mgr_.reset(new RpcRendezvousMgr(&env_));
+    env_.rendezvous_mgr = rendezvous_mgr_.get();
+    worker_.reset(new GrpcWorker(&env_, ConfigProto()));
+  }
+
+  static string Key(const string& name) {
+    return Rendezvous::CreateKey(kDeviceName, /*src_incarnation=*/0,
+                                 kDeviceName, name, FrameAndIter(0, 0));
+  }
+
+  // Sends `value` for the tensor `name` of `step_id`.
+  Status Send(int64 step_id, const string& name, const Tensor& value) {
+    Rendezvous::ParsedKey parsed;
+    TF_RETURN_IF_ERROR(Rendezvous::ParseKey(Key(name), &parsed));
+    RemoteRendezvous* rendezvous = rendezvous_mgr_->Find(step_id);
+    core::ScopedUnref unref(rendezvous);
+    TF_RETURN_IF_ERROR(rendezvous->Initialize(worker_session_.get()));
+    return rendezvous->Send(parsed, Rendezvous::Args(), value, false);
+  }
+
+  // Calls RecvTensorBatch for the tensors `names` of `step_id`, and waits for
+  // its response.
+  Status RecvTensorBatch(int64 step_id, const std::vector<string>& names,
+                         RecvTensorBatchResponse* response) {
+    // Freed once the response is sent, as the request of a gRPC call is.
+    std::unique_ptr<RecvTensorBatchRequest> request(
+        new RecvTensorBatchRequest);
+    for (const string& name : names) {
+      RecvTensorRequest* tensor_request = request->add_requests();
+      tensor_request->set_step_id(step_id);
+      tensor_request->set_rendezvous_key(Key(name));
+    }
+    CallOptions opts;
+    Notification n;
+    Status status;
+    worker_->RecvTensorBatchAsync(&opts, request.get(), response,
+                                  [&n, &status](const Status& s) {
+                                    status = s;
+                                    n.Notify();
+                                  });
+    n.WaitForNotification();
+    return status;
+  }
+
+  WorkerEnv env_;
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  std::shared_ptr<WorkerSession> worker_session_;
+  std::unique_ptr<RpcRendezvousMgr> rendezvous_mgr_;
+  std::unique_ptr<GrpcWorker> worker_;
+};
+
+TEST_F(GrpcWorkerTest, RecvTensorBatchHoldsTensorReadyAfterResponse) {
+  const int64 step_id = 123;
+  TF_ASSERT_OK(Send(step_id, "early", test::AsScalar<int32>(1)));
+
+  // Responds with the tensor ready by then, and holds the other one.
+  RecvTensorBatchResponse response;
+  TF_ASSERT_OK(RecvTensorBatch(step_id, {"early", "late"}, &response));
+  ASSERT_EQ(1, response.responses_size());
+  EXPECT_EQ(0, response.request_indices(0));
+  Tensor early;
+  ASSERT_TRUE(early.FromProto(response.responses(0).tensor()));
+  test::ExpectTensorEqual<int32>(test::AsScalar<int32>(1), early);
+
+  // Produced after the request of the first batch was freed.
+  TF_ASSERT_OK(Send(step_id, "late", test::AsScalar<int32>(2)));
+
+  RecvTensorBatchResponse late_response;
+  TF_ASSERT_OK(RecvTensorBatch(step_id, {"late"}, &late_response));
+  ASSERT_EQ(1, late_response.responses_size());
+  EXPECT_EQ(0, late_response.request_indices(0));
+  Tensor late;
+  ASSERT_TRUE(late.FromProto(late_response.responses(0).tensor()));
+  test::ExpectTensorEqual<int32>(test::AsScalar<int32>(2), late);
+
+  rendezvous_mgr_->Cleanup(step_id);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
@@ -29,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/notification.h"
@@ -38,10 +41,50 @@ namespace tensorflow {
 
 namespace {
 
+// Maximum number of tensors received by one RecvTensorBatch RPC.
+constexpr size_t kMaxRecvBatchSize = 256;
+
+// Checks that `resp` returns each of `num_requests` requests at most once,
+// and at least one of them, and sets `(*returned)[i]` if it returns request
+// `i`, as a tensor or as a request to use RecvTensor.
+Status CheckRecvTensorBatchResponse(const RecvTensorBatchResponse& resp,
+                                    int num_requests,
+                                    std::vector<bool>* returned) {
+  returned->assign(num_requests, false);
+  if (resp.request_indices_size() != resp.responses_size()) {
+    return errors::Internal("RecvTensorBatch response has ",
+                            resp.responses_size(), " tensors for ",
+                            resp.request_indices_size(), " requests");
+  }
+  auto add = [num_requests, returned](int index) {
+    if (index < 0 || index >= num_requests || (*returned)[index]) {
+      return errors::Internal("RecvTensorBatch response for ", num_requests,
+                              " requests has bad request index ", index);
+    }
+    (*returned)[index] = true;
+    return Status::OK();
+  };
+  for (int index : resp.request_indices()) {
+    TF_RETURN_IF_ERROR(add(index));
+  }
+  for (int index : resp.unbatched_request_indices()) {
+    TF_RETURN_IF_ERROR(add(index));
+  }
+  if (resp.request_indices_size() + resp.unbatched_request_indices_size() ==
+      0) {
+    return errors::Internal("RecvTensorBatch response returns no tensors");
+  }
+  return Status::OK();
+}
+
+class RpcRecvTensorCall;
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id,
+                      int64 batch_window_micros)
+      : BaseRemoteRendezvous(env, step_id),
+        batch_window_micros_(batch_window_micros) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -51,6 +94,37 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // RecvTensor calls from the same source worker to the same local device,
+  // which are sent in one RecvTensorBatch RPC.
+  struct RecvBatch {
+    int64 id;
+    string src_worker;
+    std::vector<std::pair<RpcRecvTensorCall*, std::function<void()>>> calls;
+    CallOptions opts;
+    RecvTensorBatchRequest req;
+    RecvTensorBatchResponse resp;
+  };
+
+  // Adds `call` to the pending batch of its source worker and destination
+  // device.  The batch is sent batch_window_micros_ after it was created, or
+  // as soon as it is full.
+  void AddToBatch(RpcRecvTensorCall* call, std::function<void()> recv_done);
+
+  // Sends the pending batch for `key` if it is the batch `id`.
+  void FlushBatch(const string& key, int64 id);
+
+  // Sends `batch`, which is deleted once its response was handled.  The
+  // calls whose tensors the response does not return are sent again in a
+  // new batch.
+  void StartBatch(RecvBatch* batch);
+
+  const int64 batch_window_micros_;
+
+  mutex batch_mu_;
+  int64 next_batch_id_ TF_GUARDED_BY(batch_mu_) = 0;
+  std::unordered_map<string, std::unique_ptr<RecvBatch>> pending_batches_
+      TF_GUARDED_BY(batch_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -127,6 +201,26 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   bool is_dead() const { return resp_.metadata().is_dead(); }
 
+  // Prepares this call to be received by a RecvTensorBatch RPC issued with
+  // `batch_opts`, which is cancelled if this call is aborted.
+  void StartBatched(CallOptions* batch_opts) {
+    resp_.InitAlloc(dst_device_, alloc_attrs_);
+    opts_.SetCancelCallback([batch_opts]() { batch_opts->StartCancel(); });
+  }
+
+  // Completes a call prepared by StartBatched(), given the status of the
+  // RecvTensorBatch RPC and, if it succeeded, the response for this call.
+  void FinishBatched(Status s, RecvTensorResponse* response) {
+    opts_.ClearCancelCallback();
+    if (s.ok()) {
+      s = resp_.InitFrom(response);
+    }
+    if (!s.ok()) {
+      mutex_lock l(mu_);
+      status_.Update(s);
+    }
+  }
+
   Device* dst_device() const { return dst_device_; }
   const Rendezvous::Args& recv_args() const { return recv_args_; }
   const Rendezvous::DoneCallback& done() const { return done_; }
@@ -288,7 +382,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
 
   // Start "call".
   Ref();
-  call->Start([this, call, worker_cache]() {
+  std::function<void()> recv_done = [this, call, worker_cache]() {
     // Removes "call" from active_. Prevent StartAbort().
     DeregisterCall(call);
     // If StartAbort was called prior to DeregisterCall, then the
@@ -301,17 +395,193 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
     get_call_freelist()->Release(call);
     Unref();
-  });
+  };
+  if (batch_window_micros_ > 0) {
+    AddToBatch(call, std::move(recv_done));
+  } else {
+    call->Start(std::move(recv_done));
+  }
+}
+
+void RpcRemoteRendezvous::AddToBatch(RpcRecvTensorCall* call,
+                                     std::function<void()> recv_done) {
+  const string key =
+      strings::StrCat(call->src_worker_, ";", call->dst_device()->name());
+  int64 new_batch_id = -1;
+  RecvBatch* full_batch = nullptr;
+  {
+    mutex_lock l(batch_mu_);
+    std::unique_ptr<RecvBatch>& batch = pending_batches_[key];
+    if (batch == nullptr) {
+      batch.reset(new RecvBatch);
+      batch->id = next_batch_id_++;
+      batch->src_worker = call->src_worker_;
+      new_batch_id = batch->id;
+    }
+    batch->calls.emplace_back(call, std::move(recv_done));
+    if (batch->calls.size() >= kMaxRecvBatchSize) {
+      full_batch = batch.release();
+      pending_batches_.erase(key);
+    }
+  }
+  if (new_batch_id >= 0) {
+    Ref();
+    env_->env->SchedClosureAfter(batch_window_micros_,
+                                 [this, key, new_batch_id]() {
+                                   FlushBatch(key, new_batch_id);
+                                   Unref();
+                                 });
+  }
+  if (full_batch != nullptr) {
+    StartBatch(full_batch);
+  }
+}
+
+void RpcRemoteRendezvous::FlushBatch(const string& key, int64 id) {
+  RecvBatch* batch;
+  {
+    mutex_lock l(batch_mu_);
+    auto it = pending_batches_.find(key);
+    if (it == pending_batches_.end() || it->second->id != id) {
+      return;  // The batch was sent when it became full.
+    }
+    batch = it->second.release();
+    pending_batches_.erase(it);
+  }
+  StartBatch(batch);
+}
+
+void RpcRemoteRendezvous::StartBatch(RecvBatch* batch) {
+  // The calls done below may release the last other references to this.
+  Ref();
+  core::ScopedUnref unref(this);
+
+  // Calls aborted while they were pending are done right away.
+  std::vector<std::pair<RpcRecvTensorCall*, std::function<void()>>> calls;
+  calls.reserve(batch->calls.size());
+  for (auto& call : batch->calls) {
+    if (call.first->status().ok()) {
+      calls.push_back(std::move(call));
+    } else {
+      // Calls sent again may still be cancelled through an earlier batch.
+      call.first->opts_.ClearCancelCallback();
+      call.second();
+    }
+  }
+  batch->calls.swap(calls);
+  if (batch->calls.size() <= 1) {
+    if (!batch->calls.empty()) {
+      batch->calls[0].first->opts_.ClearCancelCallback();
+      batch->calls[0].first->Start(std::move(batch->calls[0].second));
+    }
+    delete batch;
+    return;
+  }
+
+  std::shared_ptr<WorkerCacheInterface> worker_cache =
+      session()->GetSharedWorkerCache();
+  WorkerInterface* wi = worker_cache->GetOrCreateWorker(batch->src_worker);
+  if (wi == nullptr) {
+    for (auto& call : batch->calls) {
+      call.first->StartAbort(
+          errors::Internal("No worker known as ", batch->src_worker));
+      call.second();
+    }
+    delete batch;
+    return;
+  }
+  for (auto& call : batch->calls) {
+    call.first->StartBatched(&batch->opts);
+    *batch->req.add_requests() = call.first->req_;
+  }
+
+  auto abort_checked = std::make_shared<Notification>();
+  Ref();  // Released once the response was handled.
+  wi->RecvTensorBatchAsync(
+      &batch->opts, &batch->req, &batch->resp,
+      [this, batch, wi, worker_cache, abort_checked](const Status& s) {
+        // As in RpcRecvTensorCall::StartRTCall(), wait for the abort check
+        // before the calls, and with them the batch, may be destroyed.
+        abort_checked->WaitForNotification();
+        core::ScopedUnref unref(this);
+        worker_cache->ReleaseWorker(batch->src_worker, wi);
+        if (errors::IsUnimplemented(s)) {
+          // The source worker does not support RecvTensorBatch.
+          VLOG(1) << "Falling back to RecvTensor for " << batch->src_worker
+                  << ": " << s;
+          for (auto& call : batch->calls) {
+            call.first->opts_.ClearCancelCallback();
+            call.first->Start(std::move(call.second));
+          }
+          delete batch;
+          return;
+        }
+        const int num_calls = batch->calls.size();
+        std::vector<bool> returned;
+        Status status = s;
+        if (status.ok()) {
+          status = CheckRecvTensorBatchResponse(batch->resp, num_calls,
+                                                &returned);
+        }
+        if (!status.ok()) {
+          for (auto& call : batch->calls) {
+            call.first->FinishBatched(status, nullptr);
+            call.second();
+          }
+          delete batch;
+          return;
+        }
+        RecvTensorBatchResponse* resp = &batch->resp;
+        for (int i = 0; i < resp->request_indices_size(); ++i) {
+          auto& call = batch->calls[resp->request_indices(i)];
+          call.first->FinishBatched(status, resp->mutable_responses(i));
+          call.second();
+        }
+        for (int index : resp->unbatched_request_indices()) {
+          auto& call = batch->calls[index];
+          call.first->opts_.ClearCancelCallback();
+          call.first->Start(std::move(call.second));
+        }
+        // The tensors which were not ready yet are asked for again right
+        // away.
+        std::unique_ptr<RecvBatch> retry(new RecvBatch);
+        retry->id = -1;
+        retry->src_worker = batch->src_worker;
+        for (int i = 0; i < num_calls; ++i) {
+          if (!returned[i]) retry->calls.push_back(std::move(batch->calls[i]));
+        }
+        if (!retry->calls.empty()) {
+          StartBatch(retry.release());
+        }
+        delete batch;
+      });
+
+  // Cancel the RPC if any of its calls was aborted before their
+  // cancellation was redirected to it.
+  for (const auto& call : batch->calls) {
+    if (!call.first->status().ok()) {
+      batch->opts.StartCancel();
+      break;
+    }
+  }
+  abort_checked->Notify();
 }
 
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
-    : BaseRendezvousMgr(env) {}
+    : RpcRendezvousMgr(env, RPCOptions()) {}
+
+RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env,
+                                   const RPCOptions& rpc_options)
+    : BaseRendezvousMgr(env),
+      recv_tensor_batch_window_micros_(
+          rpc_options.recv_tensor_batch_window_micros()) {}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64 step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, step_id);
+  return new RpcRemoteRendezvous(worker_env, step_id,
+                                 recv_tensor_batch_window_micros_);
 }
 
 }  // end namespace tensorflow
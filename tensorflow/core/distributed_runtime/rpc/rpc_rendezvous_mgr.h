@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/base_rendezvous_mgr.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
 
@@ -46,10 +47,16 @@ class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
   explicit RpcRendezvousMgr(const WorkerEnv* env);
 
+  // Coalesces RecvTensor calls into RecvTensorBatch RPCs as configured by
+  // rpc_options.recv_tensor_batch_window_micros.
+  RpcRendezvousMgr(const WorkerEnv* env, const RPCOptions& rpc_options);
+
  protected:
   BaseRemoteRendezvous* Create(int64 step_id, const WorkerEnv* worker_env);
 
  private:
+  const int64 recv_tensor_batch_window_micros_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
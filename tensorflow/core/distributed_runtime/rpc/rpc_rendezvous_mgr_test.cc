@@ -15,13 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <atomic>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/test_utils.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/control_flow.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -57,6 +62,11 @@ class DummyWorker : public TestWorkerInterface {
  public:
   void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
                        TensorResponse* response, StatusCallback done) override {
+    num_recv_tensors_.fetch_add(1);
+    RecvTensorResponse proto;
+    Rendezvous::ParsedKey parsed = MakeKey(request->rendezvous_key());
+    V(string(parsed.edge_name)).AsProtoTensorContent(proto.mutable_tensor());
+    TF_CHECK_OK(response->InitFrom(&proto));
     SchedClosure([done = std::move(done)]() {
       // Simulate a random delay for RPC. This is needed to fill the entire
       // object buffer in `RpcRecvTensorFreeList` and trigger the destruction of
@@ -66,10 +76,45 @@ class DummyWorker : public TestWorkerInterface {
       done(Status::OK());
     });
   }
+
+  // Returns the edge name of each requested key as the tensor value.  If
+  // set_max_batched_tensors() was called, returns only that many tensors,
+  // and asks for the next one to be received with RecvTensor.
+  void RecvTensorBatchAsync(CallOptions* opts,
+                            const RecvTensorBatchRequest* request,
+                            RecvTensorBatchResponse* response,
+                            StatusCallback done) override {
+    num_batches_.fetch_add(1);
+    const int max_batched_tensors = max_batched_tensors_.load();
+    for (int i = 0; i < request->requests_size(); ++i) {
+      if (max_batched_tensors > 0 && i >= max_batched_tensors) {
+        if (i == max_batched_tensors) {
+          response->add_unbatched_request_indices(i);
+        }
+        continue;
+      }
+      Rendezvous::ParsedKey parsed =
+          MakeKey(request->requests(i).rendezvous_key());
+      V(string(parsed.edge_name))
+          .AsProtoTensorContent(response->add_responses()->mutable_tensor());
+      response->add_request_indices(i);
+    }
+    SchedClosure([done = std::move(done)]() { done(Status::OK()); });
+  }
+
+  void set_max_batched_tensors(int n) { max_batched_tensors_.store(n); }
+  int num_batches() const { return num_batches_.load(); }
+  int num_recv_tensors() const { return num_recv_tensors_.load(); }
+
+ private:
+  std::atomic<int> max_batched_tensors_{0};
+  std::atomic<int> num_batches_{0};
+  std::atomic<int> num_recv_tensors_{0};
 };
 
 // Fake cache implementation for WorkerEnv.
 class DummyWorkerCache : public WorkerCacheInterface {
+ public:
   void ListWorkers(std::vector<string>* workers) const override {}
   void ListWorkersInJob(const string& job_name,
                         std::vector<string>* workers) const override {}
@@ -80,6 +125,7 @@ class DummyWorkerCache : public WorkerCacheInterface {
     }
     return dummy_remote_worker_;
   }
+  DummyWorker* dummy_remote_worker() const { return dummy_remote_worker_; }
   Status GetEagerClientCache(
       std::unique_ptr<eager::EagerClientCache>* eager_client_cache) override {
     return errors::Unimplemented("Unimplemented.");
@@ -100,7 +146,9 @@ static Device* CreateDevice(const char* type, const char* name) {
    public:
     explicit FakeDevice(const DeviceAttributes& attr) : Device(nullptr, attr) {}
     Status Sync() override { return Status::OK(); }
-    Allocator* GetAllocator(AllocatorAttributes) override { return nullptr; }
+    Allocator* GetAllocator(AllocatorAttributes) override {
+      return cpu_allocator();
+    }
   };
   DeviceAttributes attr;
   attr.set_name(name);
@@ -342,4 +390,120 @@ TEST_F(RpcRendezvousMgrTest, RemoteRecvAsyncMany) {
   rmgr_.Cleanup(step_id);
 }
 
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatched) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_tensor_batch_window_micros(100 * 1000);
+  RpcRendezvousMgr rmgr(&env, rpc_options);
+  const int64 step_id = 123;
+  const int num_tensors = 300;
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+    Rendezvous::Args args;
+
+    mutex mu;
+    Status status;
+    std::vector<string> values(num_tensors);
+    BlockingCounter counter(num_tensors);
+    for (int i = 0; i < num_tensors; ++i) {
+      const Rendezvous::ParsedKey key = MakeKey(Rendezvous::CreateKey(
+          "/job:worker/replica:1/task:2/cpu:0", 7890,
+          "/job:mnist/replica:1/task:2/cpu:1", strings::StrCat("t", i),
+          FrameAndIter(0, 0)));
+      rendez->RecvAsync(
+          key, args,
+          [&mu, &status, &values, &counter, i](
+              const Status& s, const Rendezvous::Args&,
+              const Rendezvous::Args&, const Tensor& val, const bool) {
+            mutex_lock l(mu);
+            status.Update(s);
+            if (s.ok()) values[i] = V(val);
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+    TF_ASSERT_OK(status);
+    for (int i = 0; i < num_tensors; ++i) {
+      EXPECT_EQ(strings::StrCat("t", i), values[i]);
+    }
+    // One full batch, and one with the remaining tensors.
+    EXPECT_EQ(2, cache_->dummy_remote_worker()->num_batches());
+  }
+  rmgr.Cleanup(step_id);
+}
+
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatchedPartially) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_tensor_batch_window_micros(100 * 1000);
+  RpcRendezvousMgr rmgr(&env, rpc_options);
+  static_cast<DummyWorker*>(cache_->GetOrCreateWorker(""))
+      ->set_max_batched_tensors(4);
+  const int64 step_id = 123;
+  const int num_tensors = 20;
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+
+    mutex mu;
+    Status status;
+    std::vector<string> values(num_tensors);
+    BlockingCounter counter(num_tensors);
+    for (int i = 0; i < num_tensors; ++i) {
+      const Rendezvous::ParsedKey key = MakeKey(Rendezvous::CreateKey(
+          "/job:worker/replica:1/task:2/cpu:0", 7890,
+          "/job:mnist/replica:1/task:2/cpu:1", strings::StrCat("t", i),
+          FrameAndIter(0, 0)));
+      rendez->RecvAsync(
+          key, Rendezvous::Args(),
+          [&mu, &status, &values, &counter, i](
+              const Status& s, const Rendezvous::Args&,
+              const Rendezvous::Args&, const Tensor& val, const bool) {
+            mutex_lock l(mu);
+            status.Update(s);
+            if (s.ok()) values[i] = V(val);
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+    TF_ASSERT_OK(status);
+    for (int i = 0; i < num_tensors; ++i) {
+      EXPECT_EQ(strings::StrCat("t", i), values[i]);
+    }
+    // Each batch returns 4 tensors and leaves one to RecvTensor, and the
+    // remaining ones are asked for again: 20, 15, 10 and 5 tensors.
+    EXPECT_EQ(4, cache_->dummy_remote_worker()->num_batches());
+    EXPECT_EQ(4, cache_->dummy_remote_worker()->num_recv_tensors());
+  }
+  rmgr.Cleanup(step_id);
+}
+
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatchedAbort) {
+  RPCOptions rpc_options;
+  rpc_options.set_recv_tensor_batch_window_micros(100 * 1000);
+  RpcRendezvousMgr rmgr(&env, rpc_options);
+  const int64 step_id = 123;
+  const Rendezvous::ParsedKey key = MakeKey(Rendezvous::CreateKey(
+      "/job:worker/replica:1/task:2/cpu:0", 7890,
+      "/job:mnist/replica:1/task:2/cpu:1", "foo", FrameAndIter(0, 0)));
+  RemoteRendezvous* rendez = rmgr.Find(step_id);
+  core::ScopedUnref unref(rendez);
+  TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+  Notification n;
+  Status status;
+  rendez->RecvAsync(key, Rendezvous::Args(),
+                    [&n, &status](const Status& s, const Rendezvous::Args&,
+                                  const Rendezvous::Args&, const Tensor&,
+                                  const bool) {
+                      status = s;
+                      n.Notify();
+                    });
+  // Aborts the call while it waits for its batch to be sent.
+  rendez->StartAbort(errors::Aborted(""));
+  n.WaitForNotification();
+  EXPECT_TRUE(errors::IsAborted(status)) << status;
+  EXPECT_EQ(0, cache_->dummy_remote_worker()->num_batches());
+}
+
 }  // namespace tensorflow
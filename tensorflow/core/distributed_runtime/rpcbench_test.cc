@@ -13,18 +13,22 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <cstdio>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_testlib.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
@@ -33,6 +37,8 @@ limitations under the License.
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/protobuf/tensorflow_server.pb.h"
 #include "tensorflow/core/public/session.h"
 
@@ -237,6 +243,159 @@ static void BM_RPC(int iters, int width, int tensor_size) {
 }
 BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
 
+// Measures the throughput of RecvTensor for a tensor of `tensor_bytes` bytes,
+// read on the first worker from a variable on the second worker.
+static void BM_RecvTensor(int iters, int tensor_bytes) {
+  testing::StopTiming();
+  const Cluster* cluster = GetCluster();
+
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  const int64 num_elements = tensor_bytes / sizeof(float);
+  Scope s = Scope::NewRootScope();
+  Scope remote = s.WithDevice(cluster->devices[1].name());
+  Scope local = s.WithDevice(cluster->devices[0].name());
+  Output var = Variable(remote.WithOpName("var"), {num_elements}, DT_FLOAT);
+  Assign(remote.WithOpName("init"), var, Fill(remote, {num_elements}, 1.0f));
+  // Only the first element is fetched, so that the transfer to the client
+  // does not dominate.
+  Slice(local.WithOpName("y"), Identity(local, var), {0}, {1});
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+
+  // Keep the optimizers from folding the transfer away.
+  SessionOptions options = cluster->options;
+  GraphOptions* graph_options = options.config.mutable_graph_options();
+  graph_options->mutable_optimizer_options()->set_opt_level(
+      OptimizerOptions::L0);
+  graph_options->mutable_rewrite_options()->set_constant_folding(
+      RewriterConfig::OFF);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(def));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({}, {}, {"init"}, &outputs));
+  // Warm up, so that connections and partitions are set up.
+  TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+
+  testing::BytesProcessed(static_cast<int64>(iters) * tensor_bytes);
+  const uint64 start_micros = Env::Default()->NowMicros();
+  testing::StartTiming();
+  for (int i = 0; i < iters; i++) {
+    outputs.clear();
+    TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+  }
+  testing::StopTiming();
+  const uint64 elapsed_micros = Env::Default()->NowMicros() - start_micros;
+  testing::SetLabel(strings::Printf(
+      "%.3f GB/s", static_cast<double>(iters) * tensor_bytes /
+                       std::max<uint64>(elapsed_micros, 1) / 1e3));
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_RecvTensor)->Range(1 << 10, 1 << 28);
+
+// Unlike the in-process servers above, each task of this cluster runs in its
+// own process.
+static const int kAllToAllTasks = 8;
+
+static test::TestCluster* GetMultiProcessCluster() {
+  static test::TestCluster* result = [] {
+    SessionOptions options;
+    (*options.config.mutable_device_count())["CPU"] = 1;
+    std::unique_ptr<test::TestCluster> cluster;
+    TF_CHECK_OK(
+        test::TestCluster::MakeTestCluster(options, kAllToAllTasks, &cluster));
+    return cluster.release();
+  }();
+  return result;
+}
+
+// Measures a CollectiveAllToAll across `num_tasks` processes, each of which
+// sends `bytes_per_peer` bytes of 64-float embedding rows to every task.
+static void BM_AllToAll(int iters, int num_tasks, int bytes_per_peer) {
+  testing::StopTiming();
+  const test::TestCluster* cluster = GetMultiProcessCluster();
+  CHECK_LE(num_tasks, kAllToAllTasks);
+
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  const int kRowElements = 64;
+  const int rows_per_peer =
+      std::max<int>(1, bytes_per_peer / (kRowElements * sizeof(float)));
+  // Groups of different sizes must not share keys.
+  const int group_key = num_tasks;
+  static int next_instance_key = 1;
+  const int instance_key = next_instance_key++;
+
+  Scope s = Scope::NewRootScope();
+  std::vector<Operation> init_ops;
+  std::vector<Operation> all_to_all_ops;
+  for (int t = 0; t < num_tasks; ++t) {
+    const string device =
+        strings::StrCat("/job:localhost/replica:0/task:", t, "/device:CPU:0");
+    Scope task = s.WithDevice(device);
+    const int num_rows = num_tasks * rows_per_peer;
+    Output var = Variable(task.WithOpName(strings::StrCat("var", t)),
+                          {num_rows, kRowElements}, DT_FLOAT);
+    init_ops.push_back(
+        Assign(task, var, Fill(task, {num_rows, kRowElements}, 1.0f))
+            .operation);
+    Tensor splits(DT_INT32, TensorShape({num_tasks}));
+    splits.vec<int32>().setConstant(rows_per_peer);
+    Output split_sizes = Const(task, Input::Initializer(splits));
+    Output input = Identity(task, var);
+    Node* node;
+    TF_CHECK_OK(
+        NodeBuilder(strings::StrCat("all_to_all", t), "CollectiveAllToAll")
+            .Input(input.node(), input.index())
+            .Input(split_sizes.node(), split_sizes.index())
+            .Attr("T", DT_FLOAT)
+            .Attr("group_size", num_tasks)
+            .Attr("group_key", group_key)
+            .Attr("instance_key", instance_key)
+            .Device(device)
+            .Finalize(s.graph(), &node));
+    all_to_all_ops.push_back(Operation(node));
+  }
+  NoOp(s.WithOpName("init").WithControlDependencies(init_ops));
+  NoOp(s.WithOpName("all_to_all").WithControlDependencies(all_to_all_ops));
+  TF_CHECK_OK(s.status());
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+
+  SessionOptions options;
+  options.target = strings::StrCat("grpc://", cluster->targets()[0]);
+  GraphOptions* graph_options = options.config.mutable_graph_options();
+  graph_options->mutable_optimizer_options()->set_opt_level(
+      OptimizerOptions::L0);
+  graph_options->mutable_rewrite_options()->set_constant_folding(
+      RewriterConfig::OFF);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(def));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({}, {}, {"init"}, &outputs));
+  // Warm up, so that the group is resolved and connections are set up.
+  TF_CHECK_OK(session->Run({}, {}, {"all_to_all"}, &outputs));
+
+  // Bytes that cross process boundaries.
+  const int64 bytes_per_step = static_cast<int64>(num_tasks) *
+                               (num_tasks - 1) * rows_per_peer *
+                               kRowElements * sizeof(float);
+  testing::BytesProcessed(static_cast<int64>(iters) * bytes_per_step);
+  testing::StartTiming();
+  for (int i = 0; i < iters; i++) {
+    TF_CHECK_OK(session->Run({}, {}, {"all_to_all"}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_AllToAll)
+    ->ArgPair(2, 1 << 12)
+    ->ArgPair(2, 1 << 20)
+    ->ArgPair(4, 1 << 12)
+    ->ArgPair(4, 1 << 20)
+    ->ArgPair(8, 1 << 12)
+    ->ArgPair(8, 1 << 20);
+
 static void BM_SingleDevice(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/,
             false /*not multi-device*/);
@@ -0,0 +1,360 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <new>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/platform.h"
+
+#if !defined(PLATFORM_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(PLATFORM_WINDOWS)
+
+namespace tensorflow {
+namespace {
+
+constexpr uint64 kRingMagic = 0x5446534852494e47ULL;  // "TFSHRING"
+
+// Block headers and payloads are aligned to this many bytes, which satisfies
+// the alignment required of tensor buffers.
+constexpr int64 kAlignment = 64;
+
+// Set in the generation of a block while it is being read.  Generations are
+// counted from 1 and never reach this bit.
+constexpr uint64 kReadingBit = 1ULL << 63;
+
+// Blocks not released this long after they were written are reclaimed if the
+// ring runs out of space.
+constexpr uint64 kAbandonedBlockMicros = 10 * 60 * 1000 * 1000ULL;
+
+int64 RoundUp(int64 bytes) {
+  return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+}  // namespace
+
+struct SharedMemoryRing::RingHeader {
+  uint64 magic;
+  uint64 token;
+  int64 capacity;
+};
+
+// Precedes each payload.  `generation` holds the generation of the block
+// while it is live, with kReadingBit set while its reader copies it, and 0
+// once it was released.
+struct SharedMemoryRing::BlockHeader {
+  std::atomic<uint64> generation;
+  int64 size;
+};
+
+static_assert(sizeof(std::atomic<uint64>) == sizeof(uint64),
+              "Shared memory atomics must not need extra state");
+
+namespace {
+
+constexpr int64 kRingHeaderBytes = kAlignment;
+constexpr int64 kBlockHeaderBytes = kAlignment;
+
+// Bytes of the ring taken by a block with a payload of `size` bytes.
+int64 BlockBytes(int64 size) { return kBlockHeaderBytes + RoundUp(size); }
+
+}  // namespace
+
+SharedMemoryRing::SharedMemoryRing(const string& name, bool owner, char* base,
+                                   int64 mapped_bytes)
+    : name_(name), owner_(owner), base_(base), mapped_bytes_(mapped_bytes) {}
+
+uint64 SharedMemoryRing::token() const {
+  return reinterpret_cast<const RingHeader*>(base_)->token;
+}
+
+int64 SharedMemoryRing::capacity() const {
+  return reinterpret_cast<const RingHeader*>(base_)->capacity;
+}
+
+int64 SharedMemoryRing::bytes_written() {
+  mutex_lock l(mu_);
+  return bytes_written_;
+}
+
+string SharedMemoryRing::UniqueName() {
+  return strings::StrCat("/tf_shm_ring_", strings::Hex(random::New64()));
+}
+
+#if defined(PLATFORM_WINDOWS)
+
+SharedMemoryRing::~SharedMemoryRing() {}
+
+Status SharedMemoryRing::Create(const string& name, int64 capacity,
+                                std::unique_ptr<SharedMemoryRing>* ring) {
+  return errors::Unimplemented("Shared memory rings require POSIX");
+}
+
+Status SharedMemoryRing::Open(const string& name, uint64 token,
+                              std::unique_ptr<SharedMemoryRing>* ring) {
+  return errors::Unimplemented("Shared memory rings require POSIX");
+}
+
+#else
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(base_, mapped_bytes_);
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+Status SharedMemoryRing::Create(const string& name, int64 capacity,
+                                std::unique_ptr<SharedMemoryRing>* ring) {
+  capacity = capacity / kAlignment * kAlignment;
+  if (capacity < BlockBytes(1)) {
+    return errors::InvalidArgument("Shared memory ring capacity ", capacity,
+                                   " is too small");
+  }
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return errors::Unavailable("Cannot create shared memory ring ", name, ": ",
+                               strerror(errno));
+  }
+  const int64 mapped_bytes = kRingHeaderBytes + capacity;
+  void* base = MAP_FAILED;
+  if (ftruncate(fd, mapped_bytes) == 0) {
+    base = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  const int error = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return errors::Unavailable("Cannot map shared memory ring ", name, ": ",
+                               strerror(error));
+  }
+  RingHeader* header = static_cast<RingHeader*>(base);
+  header->magic = kRingMagic;
+  header->token = random::New64();
+  header->capacity = capacity;
+  ring->reset(new SharedMemoryRing(name, /*owner=*/true,
+                                   static_cast<char*>(base), mapped_bytes));
+  return Status::OK();
+}
+
+Status SharedMemoryRing::Open(const string& name, uint64 token,
+                              std::unique_ptr<SharedMemoryRing>* ring) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return errors::Unavailable("Cannot open shared memory ring ", name, ": ",
+                               strerror(errno));
+  }
+  struct stat st;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= kRingHeaderBytes) {
+    base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    return errors::Unavailable("Cannot map shared memory ring ", name);
+  }
+  const RingHeader* header = static_cast<const RingHeader*>(base);
+  if (header->magic != kRingMagic || header->token != token ||
+      kRingHeaderBytes + header->capacity > st.st_size) {
+    munmap(base, st.st_size);
+    return errors::InvalidArgument("Shared memory object ", name,
+                                   " is not the expected ring");
+  }
+  ring->reset(new SharedMemoryRing(name, /*owner=*/false,
+                                   static_cast<char*>(base), st.st_size));
+  return Status::OK();
+}
+
+#endif  // defined(PLATFORM_WINDOWS)
+
+SharedMemoryRing::BlockHeader* SharedMemoryRing::GetBlockHeader(
+    const Block& block) const {
+  if (block.offset < 0 || block.offset % kAlignment != 0 || block.size < 0 ||
+      block.offset + BlockBytes(block.size) > capacity()) {
+    return nullptr;
+  }
+  return reinterpret_cast<BlockHeader*>(base_ + kRingHeaderBytes +
+                                        block.offset);
+}
+
+void SharedMemoryRing::ReclaimReleased(bool reclaim_abandoned) {
+  const uint64 now_micros =
+      reclaim_abandoned ? Env::Default()->NowMicros() : 0;
+  while (!live_.empty()) {
+    const LiveBlock& front = live_.front();
+    std::atomic<uint64>* generation = &GetBlockHeader(front.block)->generation;
+    uint64 expected = front.block.generation;
+    if (generation->load(std::memory_order_acquire) == expected) {
+      // Once reclaimed, the reader can no longer start reading the block.
+      if (!reclaim_abandoned ||
+          now_micros < front.write_micros + kAbandonedBlockMicros ||
+          !generation->compare_exchange_strong(expected, 0,
+                                               std::memory_order_acq_rel)) {
+        break;
+      }
+      LOG(WARNING) << "Reclaiming block at " << front.block.offset
+                   << " of shared memory ring " << name_
+                   << ", which was not read";
+    } else if (generation->load(std::memory_order_acquire) != 0) {
+      break;  // Being read.
+    }
+    live_.pop_front();
+  }
+  if (live_.empty()) {
+    head_ = 0;
+  }
+}
+
+int64 SharedMemoryRing::FindRoom(int64 bytes) const {
+  // Live blocks span [tail, head_), wrapping around the end of the ring if
+  // head_ <= tail.
+  if (live_.empty()) {
+    return bytes <= capacity() ? 0 : -1;
+  }
+  const int64 tail = live_.front().block.offset;
+  if (head_ > tail) {
+    if (head_ + bytes <= capacity()) return head_;
+    if (bytes <= tail) return 0;
+  } else if (head_ + bytes <= tail) {
+    return head_;
+  }
+  return -1;
+}
+
+Status SharedMemoryRing::Write(const char* data, int64 size, Block* block) {
+  DCHECK(owner_);
+  const int64 bytes = BlockBytes(size);
+  BlockHeader* header;
+  {
+    mutex_lock l(mu_);
+    ReclaimReleased(/*reclaim_abandoned=*/false);
+    int64 offset = FindRoom(bytes);
+    if (offset < 0) {
+      // Only take space from readers which may merely be slow if there is
+      // no other way to make room.
+      ReclaimReleased(/*reclaim_abandoned=*/true);
+      offset = FindRoom(bytes);
+    }
+    if (offset < 0) {
+      return errors::ResourceExhausted("No room for ", size,
+                                       " bytes in shared memory ring ", name_);
+    }
+    block->offset = offset;
+    block->size = size;
+    block->generation = next_generation_++;
+    header = new (base_ + kRingHeaderBytes + offset) BlockHeader;
+    header->generation.store(block->generation, std::memory_order_relaxed);
+    header->size = size;
+    live_.push_back({*block, Env::Default()->NowMicros()});
+    head_ = offset + bytes;
+    bytes_written_ += size;
+  }
+  // The block cannot be reclaimed before its reader receives it, so the
+  // payload can be copied without holding mu_.
+  memcpy(reinterpret_cast<char*>(header) + kBlockHeaderBytes, data, size);
+  header->generation.store(block->generation, std::memory_order_release);
+  return Status::OK();
+}
+
+Status SharedMemoryRing::Read(const Block& block, char* dst) {
+  BlockHeader* header = GetBlockHeader(block);
+  if (header == nullptr) {
+    return errors::InvalidArgument("Block at ", block.offset, " of ",
+                                   block.size, " bytes is outside of ring ",
+                                   name_);
+  }
+  // Marking the block as being read keeps the writer from reclaiming it.
+  uint64 expected = block.generation;
+  if (!header->generation.compare_exchange_strong(
+          expected, block.generation | kReadingBit,
+          std::memory_order_acq_rel)) {
+    return errors::DataLoss("Block at ", block.offset, " of ring ", name_,
+                            " was released or overwritten");
+  }
+  if (header->size != block.size) {
+    // Leave the block live, so that it can still be read or released with
+    // its actual size, or else reclaimed by the writer.
+    const int64 size = header->size;
+    header->generation.store(block.generation, std::memory_order_release);
+    return errors::InvalidArgument("Block at ", block.offset, " of ring ",
+                                   name_, " has ", size, " bytes, not ",
+                                   block.size);
+  }
+  memcpy(dst, reinterpret_cast<const char*>(header) + kBlockHeaderBytes,
+         block.size);
+  header->generation.store(0, std::memory_order_release);
+  return Status::OK();
+}
+
+Status SharedMemoryRing::Release(const Block& block) {
+  BlockHeader* header = GetBlockHeader(block);
+  if (header == nullptr) {
+    return errors::InvalidArgument("Block at ", block.offset, " of ",
+                                   block.size, " bytes is outside of ring ",
+                                   name_);
+  }
+  uint64 expected = block.generation;
+  if (!header->generation.compare_exchange_strong(expected, 0,
+                                                  std::memory_order_acq_rel)) {
+    return errors::DataLoss("Block at ", block.offset, " of ring ", name_,
+                            " was released or overwritten");
+  }
+  return Status::OK();
+}
+
+std::shared_ptr<SharedMemoryRing> SharedMemoryRingCache::Find(
+    const string& target) {
+  mutex_lock l(mu_);
+  auto it = rings_.find(target);
+  return it == rings_.end() ? nullptr : it->second;
+}
+
+void SharedMemoryRingCache::MaybeOpen(const string& target, const string& name,
+                                      uint64 token) {
+  mutex_lock l(mu_);
+  auto it = rings_.find(target);
+  if ((it != rings_.end() && it->second->name() == name) ||
+      failed_names_.count(name) > 0) {
+    return;
+  }
+  std::unique_ptr<SharedMemoryRing> ring;
+  Status s = SharedMemoryRing::Open(name, token, &ring);
+  if (!s.ok()) {
+    // Most likely the target runs on another host.
+    VLOG(1) << "Not using shared memory ring of " << target << ": " << s;
+    failed_names_.insert(name);
+    return;
+  }
+  VLOG(1) << "Receiving tensors from " << target << " through shared memory "
+          << "ring " << name;
+  rings_[target] = std::move(ring);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,157 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A ring buffer in POSIX shared memory, through which one process (the
+// writer) passes byte payloads to other processes on the same host (the
+// readers).  Only the writer allocates space in the ring; the location of
+// each payload is sent to its reader over some other channel, e.g. an RPC
+// response, and the reader copies the payload out and releases its space.
+//
+// Space is reclaimed in the order it was allocated, so a payload that is not
+// read holds back the reuse of all space allocated after it.  A writer which
+// learns that a payload will not be read (e.g. because its RPC failed) should
+// release it; otherwise, the payload is reclaimed as abandoned only when the
+// ring runs out of space and ten minutes have passed since it was written.
+// When the ring is full, Write() fails and the caller is expected to fall
+// back to sending the payload over its regular channel.
+//
+// Shared memory is not supported on Windows, where Create() and Open()
+// return Unimplemented.
+class SharedMemoryRing {
+ public:
+  // Identifies a payload written to the ring.
+  struct Block {
+    int64 offset = 0;
+    int64 size = 0;
+    // Distinguishes this payload from others written at the same offset.
+    uint64 generation = 0;
+  };
+
+  ~SharedMemoryRing();
+
+  // Creates the ring `name`, with room for `capacity` bytes of payloads and
+  // their headers, for writing.  The shared memory object is removed when
+  // the returned ring is destroyed, although readers may keep using their
+  // mappings.
+  static Status Create(const string& name, int64 capacity,
+                       std::unique_ptr<SharedMemoryRing>* ring);
+
+  // Opens the existing ring `name` for reading.  Fails unless the ring was
+  // created with the given token, which guards against opening an unrelated
+  // object of the same name.
+  static Status Open(const string& name, uint64 token,
+                     std::unique_ptr<SharedMemoryRing>* ring);
+
+  // Returns a name for a new ring that is unique on this host.
+  static string UniqueName();
+
+  const string& name() const { return name_; }
+  uint64 token() const;
+  int64 capacity() const;
+
+  // Returns the number of payload bytes written to the ring so far.
+  int64 bytes_written();
+
+  // Copies `size` bytes from `data` into the ring.  Returns
+  // ResourceExhausted if there is not enough free space.  Writer only.
+  Status Write(const char* data, int64 size, Block* block);
+
+  // Copies the payload of `block` to `dst`, which must have room for
+  // block.size bytes, and releases its space.  Returns DataLoss if the
+  // payload was already released or overwritten, and InvalidArgument,
+  // leaving the payload in place, if its size is not block.size.  Reader
+  // only.
+  Status Read(const Block& block, char* dst);
+
+  // Releases the space of `block` without reading it.
+  Status Release(const Block& block);
+
+ private:
+  struct RingHeader;
+  struct BlockHeader;
+
+  SharedMemoryRing(const string& name, bool owner, char* base,
+                   int64 mapped_bytes);
+
+  // Returns the header of the block at `offset`, or nullptr if `block` does
+  // not lie within the ring.
+  BlockHeader* GetBlockHeader(const Block& block) const;
+
+  struct LiveBlock {
+    Block block;
+    uint64 write_micros;
+  };
+
+  // Drops blocks which readers released from the front of live_, and if
+  // `reclaim_abandoned`, also blocks left unread for too long.
+  void ReclaimReleased(bool reclaim_abandoned)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the offset at which a block taking `bytes` of the ring fits, or
+  // -1 if there is no room.
+  int64 FindRoom(int64 bytes) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const string name_;
+  const bool owner_;
+  char* const base_;
+  const int64 mapped_bytes_;
+
+  mutex mu_;
+  // Blocks written and not yet reclaimed, in the order they were written.
+  std::deque<LiveBlock> live_ TF_GUARDED_BY(mu_);
+  int64 head_ TF_GUARDED_BY(mu_) = 0;
+  uint64 next_generation_ TF_GUARDED_BY(mu_) = 1;
+  int64 bytes_written_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryRing);
+};
+
+// Rings opened for reading, by the target of the worker which writes them.
+// Thread-safe.
+class SharedMemoryRingCache {
+ public:
+  // Returns the ring opened for `target`, or nullptr.
+  std::shared_ptr<SharedMemoryRing> Find(const string& target);
+
+  // Opens the ring advertised by `target`, unless it is already open or
+  // failed to open before.
+  void MaybeOpen(const string& target, const string& name, uint64 token);
+
+ private:
+  mutex mu_;
+  std::unordered_map<string, std::shared_ptr<SharedMemoryRing>> rings_
+      TF_GUARDED_BY(mu_);
+  std::unordered_set<string> failed_names_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
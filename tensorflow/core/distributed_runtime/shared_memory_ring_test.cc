@@ -0,0 +1,162 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+std::vector<char> Payload(int64 size, char seed) {
+  std::vector<char> data(size);
+  for (int64 i = 0; i < size; ++i) data[i] = static_cast<char>(seed + i);
+  return data;
+}
+
+class SharedMemoryRingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TF_ASSERT_OK(SharedMemoryRing::Create(SharedMemoryRing::UniqueName(),
+                                          4096, &writer_));
+    TF_ASSERT_OK(
+        SharedMemoryRing::Open(writer_->name(), writer_->token(), &reader_));
+  }
+
+  std::unique_ptr<SharedMemoryRing> writer_;
+  std::unique_ptr<SharedMemoryRing> reader_;
+};
+
+TEST_F(SharedMemoryRingTest, WriteRead) {
+  const std::vector<char> data = Payload(1000, 7);
+  SharedMemoryRing::Block block;
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &block));
+  EXPECT_EQ(1000, block.size);
+  std::vector<char> read(block.size);
+  TF_ASSERT_OK(reader_->Read(block, read.data()));
+  EXPECT_EQ(data, read);
+}
+
+TEST_F(SharedMemoryRingTest, OpenWithWrongToken) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  Status s = SharedMemoryRing::Open(writer_->name(), writer_->token() + 1,
+                                    &ring);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  s = SharedMemoryRing::Open(SharedMemoryRing::UniqueName(), 0, &ring);
+  EXPECT_TRUE(errors::IsUnavailable(s)) << s;
+}
+
+TEST_F(SharedMemoryRingTest, ReadTwice) {
+  const std::vector<char> data = Payload(100, 1);
+  SharedMemoryRing::Block block;
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &block));
+  std::vector<char> read(block.size);
+  TF_ASSERT_OK(reader_->Read(block, read.data()));
+  EXPECT_TRUE(errors::IsDataLoss(reader_->Read(block, read.data())));
+  EXPECT_TRUE(errors::IsDataLoss(reader_->Release(block)));
+}
+
+TEST_F(SharedMemoryRingTest, ReadWithWrongSize) {
+  const std::vector<char> data = Payload(100, 2);
+  SharedMemoryRing::Block block;
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &block));
+  SharedMemoryRing::Block wrong_size = block;
+  wrong_size.size = 50;
+  std::vector<char> read(block.size);
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(reader_->Read(wrong_size, read.data())));
+  // The block is still live, and can be read.
+  TF_ASSERT_OK(reader_->Read(block, read.data()));
+  EXPECT_EQ(data, read);
+  EXPECT_EQ(100, writer_->bytes_written());
+}
+
+TEST_F(SharedMemoryRingTest, ReadOutsideRing) {
+  SharedMemoryRing::Block block;
+  block.offset = 4096;
+  block.size = 1;
+  char c;
+  EXPECT_TRUE(errors::IsInvalidArgument(reader_->Read(block, &c)));
+}
+
+TEST_F(SharedMemoryRingTest, FullUntilReleased) {
+  const std::vector<char> data = Payload(1500, 3);
+  SharedMemoryRing::Block first, second, third;
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &first));
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &second));
+  EXPECT_TRUE(
+      errors::IsResourceExhausted(writer_->Write(data.data(), 1500, &third)));
+
+  // Releasing the second block does not free space while the first, which
+  // was written before it, is live.
+  TF_ASSERT_OK(reader_->Release(second));
+  EXPECT_TRUE(
+      errors::IsResourceExhausted(writer_->Write(data.data(), 1500, &third)));
+
+  std::vector<char> read(first.size);
+  TF_ASSERT_OK(reader_->Read(first, read.data()));
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &third));
+  EXPECT_EQ(0, third.offset);
+  EXPECT_NE(first.generation, third.generation);
+  // The stale block no longer matches the payload at its offset.
+  EXPECT_TRUE(errors::IsDataLoss(reader_->Read(first, read.data())));
+  TF_ASSERT_OK(reader_->Read(third, read.data()));
+  EXPECT_EQ(data, read);
+}
+
+TEST_F(SharedMemoryRingTest, WrapsAround) {
+  SharedMemoryRing::Block block;
+  for (int i = 0; i < 20; ++i) {
+    const std::vector<char> data = Payload(700 + 37 * i, i);
+    TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &block));
+    std::vector<char> read(block.size);
+    TF_ASSERT_OK(reader_->Read(block, read.data()));
+    EXPECT_EQ(data, read);
+  }
+}
+
+TEST_F(SharedMemoryRingTest, TooLarge) {
+  const std::vector<char> data = Payload(4096, 0);
+  SharedMemoryRing::Block block;
+  EXPECT_TRUE(errors::IsResourceExhausted(
+      writer_->Write(data.data(), data.size(), &block)));
+}
+
+TEST_F(SharedMemoryRingTest, Cache) {
+  SharedMemoryRingCache cache;
+  EXPECT_EQ(nullptr, cache.Find("/job:a/task:0"));
+  cache.MaybeOpen("/job:a/task:0", "/tf_shm_ring_does_not_exist", 1);
+  EXPECT_EQ(nullptr, cache.Find("/job:a/task:0"));
+
+  cache.MaybeOpen("/job:a/task:0", writer_->name(), writer_->token());
+  std::shared_ptr<SharedMemoryRing> ring = cache.Find("/job:a/task:0");
+  ASSERT_NE(nullptr, ring);
+  EXPECT_EQ(writer_->name(), ring->name());
+  EXPECT_EQ(nullptr, cache.Find("/job:a/task:1"));
+
+  const std::vector<char> data = Payload(10, 5);
+  SharedMemoryRing::Block block;
+  TF_ASSERT_OK(writer_->Write(data.data(), data.size(), &block));
+  std::vector<char> read(block.size);
+  TF_ASSERT_OK(ring->Read(block, read.data()));
+  EXPECT_EQ(data, read);
+}
+
+}  // namespace
+}  // namespace tensorflow
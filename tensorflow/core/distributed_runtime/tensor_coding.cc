@@ -20,6 +20,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/refcount.h"
 
 namespace tensorflow {
 
@@ -130,6 +132,10 @@ bool ReadVarintSizeAsInt(protobuf::io::CodedInputStream* input, int* result) {
   }
 }
 
+// Tensor contents smaller than this are copied even if the Source could share
+// them, which avoids retaining a large received buffer for a small tensor.
+constexpr int kMinSharedTensorBytes = 1024;
+
 bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
                        protobuf::Message* value) {
   int length;
@@ -144,8 +150,30 @@ bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
 
 }  // namespace
 
+bool TensorResponse::ShareTensorContent(Source* source, DataType dtype,
+                                        const TensorShape& shape,
+                                        int num_bytes,
+                                        protobuf::io::CodedInputStream* input) {
+  // Small tensors are cheaper to copy than to share, and memory requested to
+  // be GPU or NIC compatible must come from allocator_.
+  if (num_bytes < kMinSharedTensorBytes || alloc_attrs_.gpu_compatible() ||
+      alloc_attrs_.nic_compatible()) {
+    return false;
+  }
+  TensorBuffer* buf = source->ShareBytes(input->CurrentPosition(), num_bytes);
+  if (buf == nullptr) return false;
+  core::ScopedUnref unref(buf);
+  if (reinterpret_cast<intptr_t>(buf->data()) % EIGEN_MAX_ALIGN_BYTES != 0) {
+    return false;
+  }
+  if (!input->Skip(num_bytes)) return false;
+  tensor_ = Tensor(dtype, shape, buf);
+  return true;
+}
+
 bool TensorResponse::ParseTensorSubmessage(
-    protobuf::io::CodedInputStream* input, TensorProto* tensor_meta) {
+    Source* source, protobuf::io::CodedInputStream* input,
+    TensorProto* tensor_meta) {
   bool seen_tensor_content = false;
   while (true) {
     auto p = input->ReadTagWithCutoff(127);
@@ -196,12 +224,16 @@ bool TensorResponse::ParseTensorSubmessage(
         if (!ReadVarintSizeAsInt(input, &num_bytes)) return false;
         seen_tensor_content = true;
         TensorShape shape(tensor_meta->tensor_shape());
+        if (static_cast<int64>(num_bytes) !=
+            shape.num_elements() * DataTypeSize(tensor_meta->dtype())) {
+          return false;
+        }
+        if (ShareTensorContent(source, tensor_meta->dtype(), shape, num_bytes,
+                               input)) {
+          break;
+        }
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
-        if (static_cast<size_t>(num_bytes) != buf.size()) return false;
-        // TODO(jeff,sanjay): Figure out a way to avoid this copy if
-        // the underlying ZeroCopyInputStream data is properly aligned
-        // and compatible with what allocator_ wants.
         if (!input->ReadRaw(const_cast<char*>(buf.data()), num_bytes))
           return false;
         tensor_ = std::move(t);
@@ -235,7 +267,7 @@ bool TensorResponse::ParseFast(Source* source) {
         std::pair<protobuf::io::CodedInputStream::Limit, int> p =
             input.IncrementRecursionDepthAndPushLimit(length);
         if (p.second < 0 ||
-            !ParseTensorSubmessage(&input, meta_.mutable_tensor())) {
+            !ParseTensorSubmessage(source, &input, meta_.mutable_tensor())) {
           return false;
         }
         if (!input.DecrementRecursionDepthAndPopLimit(p.first)) {
@@ -267,6 +299,13 @@ bool TensorResponse::ParseFast(Source* source) {
         meta_.set_require_ack(v != 0);
         break;
       }
+      case RecvTensorResponse::kPaddingFieldNumber: {
+        int length;
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadVarintSizeAsInt(&input, &length) || !input.Skip(length))
+          return false;
+        break;
+      }
       default: {
         // Unknown tag, so don't handle we can't handle on the fast path
         return false;
@@ -294,6 +333,7 @@ bool TensorResponse::ParseSlow(Source* source) {
     meta_.mutable_tensor()->Swap(&empty);
   }
   meta_.clear_tensor();
+  meta_.clear_padding();
 
   return true;
 }
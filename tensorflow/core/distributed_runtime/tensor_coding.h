@@ -64,6 +64,15 @@ class TensorResponse {
     // Ownership of the returned stream is retained by the Source and
     // should not be deleted by the caller.
     virtual ::tensorflow::protobuf::io::ZeroCopyInputStream* contents() = 0;
+
+    // If bytes [offset, offset + num_bytes) of the serialized
+    // RecvTensorResponse are contiguous in memory that may outlive the
+    // Source, returns a TensorBuffer sharing them, with one reference owned
+    // by the caller.  Otherwise returns nullptr, and ParseFrom copies the
+    // bytes out of contents() instead.
+    virtual TensorBuffer* ShareBytes(int64 offset, int64 num_bytes) {
+      return nullptr;
+    }
   };
 
   // Parse the RecvTensorResponse encoded in the data yielded by
@@ -92,8 +101,14 @@ class TensorResponse {
   DeviceBase* device() const { return device_; }
 
  private:
-  bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
+  bool ParseTensorSubmessage(Source* source,
+                             protobuf::io::CodedInputStream* input,
                              TensorProto* tensor_meta);
+  // Tries to initialize tensor_ with the next num_bytes of *input without
+  // copying them, by sharing the memory of *source.
+  bool ShareTensorContent(Source* source, DataType dtype,
+                          const TensorShape& shape, int num_bytes,
+                          protobuf::io::CodedInputStream* input);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
 
@@ -15,13 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -156,6 +159,108 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+// TensorBuffer owning a copy of some bytes, placed `misalignment` bytes past
+// an aligned address.
+class CopiedTensorBuffer : public TensorBuffer {
+ public:
+  CopiedTensorBuffer(const char* data, size_t size, size_t misalignment)
+      : TensorBuffer(Allocate(size, misalignment)),
+        misalignment_(misalignment),
+        size_(size) {
+    memcpy(this->data(), data, size);
+  }
+  ~CopiedTensorBuffer() override {
+    port::AlignedFree(static_cast<char*>(data()) - misalignment_);
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {}
+
+ private:
+  static char* Allocate(size_t size, size_t misalignment) {
+    return static_cast<char*>(port::AlignedMalloc(size + misalignment,
+                                                  EIGEN_MAX_ALIGN_BYTES)) +
+           misalignment;
+  }
+
+  const size_t misalignment_;
+  const size_t size_;
+};
+
+// StringSource that also shares the requested bytes, by handing out copies
+// of them which the parsed tensor is expected to alias.
+class SharingStringSource : public StringSource {
+ public:
+  SharingStringSource(const string* s, size_t misalignment)
+      : StringSource(s, 1024), s_(s), misalignment_(misalignment) {}
+  ~SharingStringSource() override {
+    if (shared_ != nullptr) shared_->Unref();
+  }
+
+  TensorBuffer* ShareBytes(int64 offset, int64 num_bytes) override {
+    if (shared_ != nullptr) shared_->Unref();
+    shared_ = new CopiedTensorBuffer(s_->data() + offset, num_bytes,
+                                     misalignment_);
+    shared_->Ref();
+    return shared_;
+  }
+
+  const TensorBuffer* shared() const { return shared_; }
+
+ private:
+  const string* s_;
+  const size_t misalignment_;
+  TensorBuffer* shared_ = nullptr;
+};
+
+TEST_F(TensorResponseTest, ShareTensorContent) {
+  for (int num_elems : {10, 1000}) {
+    for (size_t misalignment : {0, 4}) {
+      Tensor src(DT_FLOAT, TensorShape({num_elems}));
+      for (int i = 0; i < num_elems; ++i) {
+        src.flat<float>()(i) = i;
+      }
+      RecvTensorResponse proto;
+      src.AsProtoTensorContent(proto.mutable_tensor());
+      string encoded;
+      proto.AppendToString(&encoded);
+
+      SharingStringSource source(&encoded, misalignment);
+      TensorResponse response;
+      DummyDevice cpu_device(Env::Default());
+      response.InitAlloc(&cpu_device, AllocatorAttributes());
+      TF_ASSERT_OK(response.ParseFrom(&source));
+      test::ExpectTensorEqual<float>(response.tensor(), src);
+      // Only large tensor contents are shared, and only if aligned.
+      const bool shared = source.shared() != nullptr &&
+                          response.tensor().tensor_data().data() ==
+                              source.shared()->data();
+      EXPECT_EQ(shared, num_elems == 1000 && misalignment == 0)
+          << num_elems << " " << misalignment;
+    }
+  }
+}
+
+TEST_F(TensorResponseTest, ShareTensorContentNotForGpuCompatibleMemory) {
+  Tensor src(DT_FLOAT, TensorShape({1000}));
+  src.flat<float>().setConstant(1.0f);
+  RecvTensorResponse proto;
+  src.AsProtoTensorContent(proto.mutable_tensor());
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  SharingStringSource source(&encoded, 0);
+  TensorResponse response;
+  DummyDevice cpu_device(Env::Default());
+  AllocatorAttributes attr;
+  attr.set_gpu_compatible(true);
+  response.InitAlloc(&cpu_device, attr);
+  TF_ASSERT_OK(response.ParseFrom(&source));
+  test::ExpectTensorEqual<float>(response.tensor(), src);
+  EXPECT_EQ(source.shared(), nullptr);
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -60,6 +60,15 @@ bool WorkerCacheLogger::RetrieveLogs(int64 step_id, StepStats* ss) {
   mutex_lock l(mu_);
   LogMap::iterator iter = log_map_.find(step_id);
   if (iter != log_map_.end()) {
+    for (const auto& rpcs : iter->second.recv_tensor_rpcs) {
+      NodeExecStats* ns = new NodeExecStats;
+      ns->set_node_name("RecvTensorRpcs");
+      ns->set_timeline_label(strings::StrCat(rpcs.second.num_rpcs,
+                                             " RecvTensor RPCs for ",
+                                             rpcs.second.num_tensors,
+                                             " tensors to ", rpcs.first));
+      iter->second.collector->Save(rpcs.first, ns);
+    }
     iter->second.collector->FinalizeAndSwap(ss);
     delete iter->second.collector;
     log_map_.erase(iter);
@@ -68,20 +77,38 @@ bool WorkerCacheLogger::RetrieveLogs(int64 step_id, StepStats* ss) {
   return false;
 }
 
-void WorkerCacheLogger::Save(const string& device, int64 step_id,
-                             NodeExecStats* ns) {
-  mutex_lock l(mu_);
+WorkerCacheLogger::StepLog* WorkerCacheLogger::GetOrCreateStepLog(
+    int64 step_id) {
   StepLog* sl = &log_map_[step_id];
   if (!sl->collector) {
     sl->collector = new StepStatsCollector(&sl->step_stats);
   }
-  sl->collector->Save(device, ns);
+  return sl;
+}
+
+void WorkerCacheLogger::Save(const string& device, int64 step_id,
+                             NodeExecStats* ns) {
+  mutex_lock l(mu_);
+  GetOrCreateStepLog(step_id)->collector->Save(device, ns);
   if (log_map_.size() > kWorkerCacheLoggerLimit) {
     // Something's gone wrong.  Just empty the cache.
     ClearLogsWithLock();
   }
 }
 
+void WorkerCacheLogger::RecordRecvTensorRpc(int64 step_id,
+                                            const string& dst_device,
+                                            int64 num_tensors) {
+  mutex_lock l(mu_);
+  RpcCounts* counts =
+      &GetOrCreateStepLog(step_id)->recv_tensor_rpcs[dst_device];
+  ++counts->num_rpcs;
+  counts->num_tensors += num_tensors;
+  if (log_map_.size() > kWorkerCacheLoggerLimit) {
+    ClearLogsWithLock();
+  }
+}
+
 void WorkerCacheLogger::RecordRecvTensor(int64 step_id, int64 start_usecs,
                                          int64 end_usecs,
                                          const string& tensor_name,
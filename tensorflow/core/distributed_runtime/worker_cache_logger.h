@@ -68,13 +68,26 @@ class WorkerCacheLogger {
                           const string& details,
                           const string& transfer_method_name);
 
+  // Counts one RecvTensor or RecvTensorBatch RPC, which received
+  // `num_tensors` tensors for `dst_device` in step `step_id`.  RetrieveLogs()
+  // returns the counts of each device as a NodeExecStats named
+  // "RecvTensorRpcs".
+  void RecordRecvTensorRpc(int64 step_id, const string& dst_device,
+                           int64 num_tensors);
+
  private:
   mutex count_mu_;
   int32 want_logging_count_ TF_GUARDED_BY(count_mu_) = 0;
 
+  struct RpcCounts {
+    int64 num_rpcs = 0;
+    int64 num_tensors = 0;
+  };
   struct StepLog {
     StepStats step_stats;
     StepStatsCollector* collector;
+    // RecvTensor RPC counts by destination device.
+    std::unordered_map<string, RpcCounts> recv_tensor_rpcs;
   };
   typedef std::unordered_map<int64, StepLog> LogMap;
   mutex mu_;
@@ -83,6 +96,9 @@ class WorkerCacheLogger {
   // Records "ns" in log_map_ under the given device and step.
   void Save(const string& device, int64 step_id, NodeExecStats* ns);
 
+  // Returns the log of `step_id`, creating it if needed.
+  StepLog* GetOrCreateStepLog(int64 step_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   void ClearLogsWithLock() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 };
 }  // namespace tensorflow
@@ -43,6 +43,7 @@ enum CollectiveType {
   REDUCTION_COLLECTIVE = 0,
   BROADCAST_COLLECTIVE,
   GATHER_COLLECTIVE,
+  ALL_TO_ALL_COLLECTIVE,
   UNDEFINED_COLLECTIVE,
 };
 
@@ -86,6 +87,15 @@ struct CollImplDetails {
                               // e.g. ring or nccl
   float timeout_seconds;      // If non zero, set a completion timeout for the
                               // collective op to detect staleness.
+  // On-the-wire compression of the values exchanged by a ring reduction,
+  // e.g. "float16" or "topk".  Must be the same for all members.
+  string compression = "none";
+  float compression_topk_ratio = 0.01f;  // fraction of values sent by "topk"
+  // Reductions on the same device with the same group_key and bucket_key are
+  // fused into a single reduction once bucket_size of them have been
+  // launched.  A bucket_size of 1 disables fusion.
+  int32 bucket_key = 0;
+  int32 bucket_size = 1;
 };
 
 // Data common to all members of a collective instance.
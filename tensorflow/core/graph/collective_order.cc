@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/graph/collective_order.h"
 
+#include <algorithm>
+#include <tuple>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -63,13 +66,89 @@ Status DiscoverDataDependencies(
   return s;
 }
 
+// Reductions in the same bucket are fused when all of them have launched, so
+// they must not be ordered with respect to each other, and other collectives
+// must be ordered the same way with respect to all of them.  Computes in
+// `order_keys` the key by which each collective node is ordered: the smallest
+// instance key of its bucket, or its own instance key if it is not bucketed.
+// Rewrites `data_dependencies` in terms of order keys, so that depending on a
+// member of a bucket means depending on the whole bucket.
+Status MergeBuckets(
+    const std::vector<Node*>& collective_nodes,
+    const std::vector<int32>& instance_keys, std::vector<int32>* order_keys,
+    absl::flat_hash_map<Node*, absl::flat_hash_set<int32>>* data_dependencies) {
+  // (device, group key, bucket key) -> smallest instance key in the bucket.
+  absl::flat_hash_map<std::tuple<string, int32, int32>, int32> bucket_keys;
+  std::vector<std::tuple<string, int32, int32>> node_buckets(
+      collective_nodes.size());
+  std::vector<bool> bucketed(collective_nodes.size(), false);
+  for (int i = 0; i < collective_nodes.size(); ++i) {
+    const Node* node = collective_nodes[i];
+    int32 bucket_size = 1;
+    if (!TryGetNodeAttr(node->attrs(), "bucket_size", &bucket_size) ||
+        bucket_size <= 1) {
+      continue;
+    }
+    int32 group_key;
+    int32 bucket_key;
+    TF_RETURN_IF_ERROR(GetNodeAttr(node->attrs(), "group_key", &group_key));
+    TF_RETURN_IF_ERROR(GetNodeAttr(node->attrs(), "bucket_key", &bucket_key));
+    node_buckets[i] =
+        std::make_tuple(node->requested_device(), group_key, bucket_key);
+    bucketed[i] = true;
+    auto it = bucket_keys.emplace(node_buckets[i], instance_keys[i]).first;
+    it->second = std::min(it->second, instance_keys[i]);
+  }
+  order_keys->assign(instance_keys.begin(), instance_keys.end());
+  if (bucket_keys.empty()) return Status::OK();
+
+  absl::flat_hash_map<int32, int32> key_to_order_key;
+  for (int i = 0; i < collective_nodes.size(); ++i) {
+    if (bucketed[i]) {
+      (*order_keys)[i] = bucket_keys[node_buckets[i]];
+      key_to_order_key[instance_keys[i]] = (*order_keys)[i];
+    }
+  }
+  for (auto& node_deps : *data_dependencies) {
+    absl::flat_hash_set<int32> deps;
+    for (int32 key : node_deps.second) {
+      auto it = key_to_order_key.find(key);
+      deps.insert(it == key_to_order_key.end() ? key : it->second);
+    }
+    node_deps.second.swap(deps);
+  }
+  // Every member of a bucket depends on what any member depends on.
+  absl::flat_hash_map<std::tuple<string, int32, int32>,
+                      absl::flat_hash_set<int32>>
+      bucket_deps;
+  for (int i = 0; i < collective_nodes.size(); ++i) {
+    if (!bucketed[i]) continue;
+    const auto& deps = (*data_dependencies)[collective_nodes[i]];
+    if (deps.contains((*order_keys)[i])) {
+      return errors::InvalidArgument(
+          "Collective ", collective_nodes[i]->name(),
+          " depends on another member of its bucket ",
+          std::get<2>(node_buckets[i]), ", so the bucket can never be full");
+    }
+    bucket_deps[node_buckets[i]].insert(deps.begin(), deps.end());
+  }
+  for (int i = 0; i < collective_nodes.size(); ++i) {
+    if (!bucketed[i]) continue;
+    const auto& deps = bucket_deps[node_buckets[i]];
+    (*data_dependencies)[collective_nodes[i]].insert(deps.begin(), deps.end());
+  }
+  return Status::OK();
+}
+
 // Given a list of `collective_nodes` and `data_dependencies` between the
 // collective nodes, create control dependencies between concurrent collectives
-// and store in `dependency_edges`.
+// and store in `dependency_edges`.  Collectives are ordered by `order_keys`,
+// and collectives with the same order key are not ordered.
 // If there exists an edge a -> b then `dependency_edges[a]` contains `b`
 Status CreateControlDependencies(
     const std::vector<Node*>& collective_nodes,
     const std::vector<int32>& instance_keys,
+    const std::vector<int32>& order_keys,
     absl::flat_hash_map<Node*, absl::flat_hash_set<int32>>* data_dependencies,
     absl::flat_hash_map<Node*, absl::flat_hash_set<Node*>>* dependency_edges) {
   // If there exists some path a -> ... -> b then `all_paths[a]` contains `b`
@@ -92,11 +171,14 @@ Status CreateControlDependencies(
                                 " on 2 nodes with the same device ",
                                 collective_nodes[i]->requested_device());
       }
+      if (order_keys[i] == order_keys[j]) {
+        continue;
+      }
       const auto& deps_j = (*data_dependencies)[collective_nodes[j]];
-      if (deps_i.find(instance_keys[j]) == deps_i.end() &&
-          deps_j.find(instance_keys[i]) == deps_j.end()) {
-        int src_idx = instance_keys[i] > instance_keys[j] ? i : j;
-        int dst_idx = instance_keys[i] > instance_keys[j] ? j : i;
+      if (deps_i.find(order_keys[j]) == deps_i.end() &&
+          deps_j.find(order_keys[i]) == deps_j.end()) {
+        int src_idx = order_keys[i] > order_keys[j] ? i : j;
+        int dst_idx = order_keys[i] > order_keys[j] ? j : i;
         Node* src_node = collective_nodes[src_idx];
         Node* dst_node = collective_nodes[dst_idx];
         VLOG(1) << "Adding control dependency from node " << src_node->name()
@@ -192,12 +274,17 @@ Status OrderCollectives(Graph* graph, GraphCollectiveOrder order_type) {
 
   if (collective_nodes.empty()) return Status::OK();
 
+  std::vector<int32> order_keys;
+  TF_RETURN_IF_ERROR(MergeBuckets(collective_nodes, instance_keys, &order_keys,
+                                  &data_dependencies));
+
   absl::flat_hash_map<Node*, absl::flat_hash_set<Node*>> dependency_edges;
   // For all pairs of collective nodes n1 and n2 on the same device, if n1 does
   // not depend on n2 and n2 does not depend on n1, then they are potentially
   // concurrent.  Create an arbitrary, deterministic ordering between them.
-  TF_RETURN_IF_ERROR(CreateControlDependencies(
-      collective_nodes, instance_keys, &data_dependencies, &dependency_edges));
+  TF_RETURN_IF_ERROR(CreateControlDependencies(collective_nodes, instance_keys,
+                                               order_keys, &data_dependencies,
+                                               &dependency_edges));
 
   return InsertControlDependencies(graph, order_type, dependency_edges);
 }
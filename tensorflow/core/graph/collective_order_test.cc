@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/graph/collective_order.h"
 
 #include <gmock/gmock.h>
+#include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/graph_def_builder_util.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
@@ -78,7 +79,7 @@ void VerifyAttrs(
 
 Node* CollectiveReduceNode(GraphDefBuilder* builder, Node* input,
                            const string& name, const string& device,
-                           int instance_key) {
+                           int instance_key, int bucket_size = 1) {
   Node* collective_node =
       ops::UnaryOp("CollectiveReduce", input,
                    builder->opts()
@@ -90,7 +91,9 @@ Node* CollectiveReduceNode(GraphDefBuilder* builder, Node* input,
                        .WithAttr("instance_key", instance_key)
                        .WithAttr("merge_op", "Add")
                        .WithAttr("final_op", "Id")
-                       .WithAttr("subdiv_offsets", {1}));
+                       .WithAttr("subdiv_offsets", {1})
+                       .WithAttr("bucket_key", 1)
+                       .WithAttr("bucket_size", bucket_size));
   return collective_node;
 }
 
@@ -231,5 +234,67 @@ TEST(CollectiveOrderTest, Pruning) {
   VerifyAttrs(*graph, {{"c3", {4}}, {"c2", {3}}, {"c1", {2}}});
 }
 
+// Initialize the following graph:
+//
+//         x   y   z
+//         |   |   |
+//         b1  b2  c3
+//
+// Here b1 and b2 are collective nodes with `instance_key` 1 and 2 in the same
+// bucket, and c3 is a collective node with `instance_key` 3.  If
+// `c3_after_b1`, c3 takes the output of b1 as input instead of z.
+std::unique_ptr<Graph> InitGraphWithBucket(bool c3_after_b1) {
+  GraphDefBuilder builder(GraphDefBuilder::kFailImmediately);
+  const string dev0 = "/job:localhost/replica:0/task:0/device:CPU:0";
+  Node* x = ops::SourceOp("TestParams",
+                          builder.opts().WithName("x").WithDevice(dev0));
+  Node* y = ops::SourceOp("TestParams",
+                          builder.opts().WithName("y").WithDevice(dev0));
+  Node* z = ops::SourceOp("TestParams",
+                          builder.opts().WithName("z").WithDevice(dev0));
+  Node* b1 = CollectiveReduceNode(&builder, x, "b1", dev0, 1, 2);
+  CollectiveReduceNode(&builder, y, "b2", dev0, 2, 2);
+  CollectiveReduceNode(&builder, c3_after_b1 ? b1 : z, "c3", dev0, 3);
+
+  std::unique_ptr<Graph> graph = absl::make_unique<Graph>(OpRegistry::Global());
+  Status s = GraphDefBuilderToGraph(builder, graph.get());
+  if (!s.ok()) {
+    LOG(FATAL) << "Error building graph " << s;
+  }
+  return graph;
+}
+
+// Tests that the members of a bucket are not ordered with respect to each
+// other, and that c3 is ordered before both of them.
+TEST(CollectiveOrderTest, Bucket) {
+  std::unique_ptr<Graph> graph = InitGraphWithBucket(false);
+  TF_EXPECT_OK(OrderCollectives(graph.get(), GraphCollectiveOrder::kEdges));
+  VerifyGraph(*graph, {"b1", "b2", "c3"}, {{"c3", "b1"}, {"c3", "b2"}});
+}
+
+// Tests that c3, which depends on b1, is not ordered before b2, which would
+// prevent the bucket of b1 and b2 from ever being full.
+TEST(CollectiveOrderTest, BucketDataDependency) {
+  std::unique_ptr<Graph> graph = InitGraphWithBucket(true);
+  TF_EXPECT_OK(OrderCollectives(graph.get(), GraphCollectiveOrder::kEdges));
+  VerifyGraph(*graph, {"b1", "b2", "c3"}, {});
+}
+
+TEST(CollectiveOrderTest, BucketMemberDependsOnMember) {
+  GraphDefBuilder builder(GraphDefBuilder::kFailImmediately);
+  const string dev0 = "/job:localhost/replica:0/task:0/device:CPU:0";
+  Node* x = ops::SourceOp("TestParams",
+                          builder.opts().WithName("x").WithDevice(dev0));
+  Node* b1 = CollectiveReduceNode(&builder, x, "b1", dev0, 1, 2);
+  CollectiveReduceNode(&builder, b1, "b2", dev0, 2, 2);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(GraphDefBuilderToGraph(builder, &graph));
+  Status s = OrderCollectives(&graph, GraphCollectiveOrder::kEdges);
+  EXPECT_EQ(error::INVALID_ARGUMENT, s.code());
+  EXPECT_TRUE(absl::StrContains(s.error_message(),
+                                "depends on another member of its bucket"))
+      << s;
+}
+
 }  // namespace
 }  // namespace tensorflow
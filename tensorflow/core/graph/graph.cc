@@ -74,6 +74,7 @@ Node::NodeClass Node::GetNodeClassForOp(const string& ts) {
           {"CollectiveBcastSend", NC_COLLECTIVE},
           {"CollectiveBcastRecv", NC_COLLECTIVE},
           {"CollectiveGather", NC_COLLECTIVE},
+          {"CollectiveAllToAll", NC_COLLECTIVE},
           {"FakeParam", NC_FAKE_PARAM},
           {"PartitionedCall", NC_PARTITIONED_CALL},
           {"StatefulPartitionedCall", NC_PARTITIONED_CALL},
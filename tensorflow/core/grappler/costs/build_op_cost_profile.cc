@@ -0,0 +1,75 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Builds an op cost profile for Grappler from the RunMetadata of real runs.
+// The steps must run with RunOptions.trace_level = FULL_TRACE and
+// output_partition_graphs set, and the RunMetadata protos must be saved in
+// binary format. To use it, run something like this:
+//
+// bazel build tensorflow/core/grappler/costs:build_op_cost_profile
+// bazel-bin/tensorflow/core/grappler/costs/build_op_cost_profile \
+//   --run_metadata=step1.pb,step2.pb --profile=profile.pb
+//
+// Measurements are added to the profile if it already exists. The profile can
+// then be used for cost estimation by setting TF_GRAPPLER_OP_COST_PROFILE to
+// its path.
+
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+int ParseFlagsAndBuildProfile(int argc, char* argv[]) {
+  string run_metadata;
+  string profile;
+  std::vector<Flag> flag_list = {
+      Flag("run_metadata", &run_metadata,
+           "comma-separated RunMetadata files to read measurements from"),
+      Flag("profile", &profile, "op cost profile to create or update"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_result = Flags::Parse(&argc, argv, flag_list);
+  // We need to call this to set up global state for TensorFlow.
+  port::InitMain(argv[0], &argc, &argv);
+  if (!parse_result || argc > 1 || run_metadata.empty() || profile.empty()) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+
+  const std::vector<string> run_metadata_files =
+      absl::StrSplit(run_metadata, ',', absl::SkipEmpty());
+  Status s = UpdateOpCostProfile(Env::Default(), run_metadata_files, profile);
+  if (!s.ok()) {
+    LOG(ERROR) << "Building the op cost profile failed: " << s;
+    return -1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
+
+int main(int argc, char* argv[]) {
+  return tensorflow::grappler::ParseFlagsAndBuildProfile(argc, argv);
+}
@@ -2337,6 +2337,12 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
                                         bool aggressive_shape_inference,
                                         bool include_input_tensor_values,
                                         bool include_output_tensor_values) {
+  inferred_statically_ = true;
+  assume_valid_feeds_ = assume_valid_feeds;
+  aggressive_shape_inference_ = aggressive_shape_inference;
+  include_input_tensor_values_ = include_input_tensor_values;
+  include_output_tensor_values_ = include_output_tensor_values;
+
   FunctionLibraryDefinition function_library(OpRegistry::Global(),
                                              item_.graph.library());
   absl::flat_hash_map<string, absl::flat_hash_set<int>> fed_ports;
@@ -2572,6 +2578,298 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
   return Status::OK();
 }
 
+Status GraphProperties::UpdateStatically(
+    const absl::flat_hash_set<string>& mutated_nodes) {
+  if (!inferred_statically_) {
+    return errors::FailedPrecondition(
+        "UpdateStatically() requires a previous call to InferStatically()");
+  }
+
+  GraphView graph_view(&item_.graph);
+
+  // Collect the nodes to process again: the mutated nodes and their transitive
+  // fanout. The producers of their resource and variant inputs are processed
+  // again as well, since the shapes of the handles aren't part of the
+  // properties, and therefore can't be forwarded to the updated nodes.
+  absl::flat_hash_set<const NodeDef*> nodes_to_update;
+  std::vector<const NodeDef*> ready_nodes;
+  for (const string& node_name : mutated_nodes) {
+    const NodeDef* node = graph_view.GetNode(node_name);
+    if (node == nullptr) {
+      // The node was deleted or renamed.
+      input_properties_.erase(node_name);
+      output_properties_.erase(node_name);
+      incompatible_shape_nodes_.erase(node_name);
+    } else if (nodes_to_update.insert(node).second) {
+      ready_nodes.push_back(node);
+    }
+  }
+
+  const int max_nodes_to_update = item_.graph.node_size() / 2;
+  bool incremental = true;
+  while (!ready_nodes.empty() && incremental) {
+    const NodeDef* node = ready_nodes.back();
+    ready_nodes.pop_back();
+    // The shapes of the queues are propagated from the enqueue nodes to the
+    // dequeue nodes, which aren't connected by an edge.
+    if (IsQueue(*node) || IsEnqueue(*node) || IsDequeue(*node)) {
+      incremental = false;
+      break;
+    }
+    for (const auto& fanout :
+         graph_view.GetFanouts(*node, /*include_controlled_nodes=*/false)) {
+      if (nodes_to_update.insert(fanout.node).second) {
+        ready_nodes.push_back(fanout.node);
+      }
+    }
+    for (const auto& fanin :
+         graph_view.GetFanins(*node, /*include_controlling_nodes=*/false)) {
+      if (nodes_to_update.contains(fanin.node) ||
+          !HasRegularInputs(*fanin.node)) {
+        continue;
+      }
+      const auto it = output_properties_.find(fanin.node->name());
+      if (it == output_properties_.end() ||
+          fanin.port_id >= static_cast<int>(it->second.size())) {
+        // The properties of the input were cleared.
+        incremental = false;
+        break;
+      }
+      const DataType dtype = it->second[fanin.port_id].dtype();
+      if (dtype == DT_RESOURCE || dtype == DT_VARIANT) {
+        nodes_to_update.insert(fanin.node);
+        ready_nodes.push_back(fanin.node);
+      }
+    }
+    if (static_cast<int>(nodes_to_update.size()) > max_nodes_to_update) {
+      incremental = false;
+    }
+  }
+
+  num_updated_nodes_ = nodes_to_update.size();
+  if (nodes_to_update.empty()) {
+    return Status::OK();
+  }
+  if (incremental) {
+    VLOG(1) << "Updating the properties of " << nodes_to_update.size()
+            << " nodes out of " << item_.graph.node_size();
+    const Status status = InferSubgraphStatically(graph_view, nodes_to_update);
+    if (status.ok()) {
+      return status;
+    }
+    VLOG(1) << "Failed to update the properties incrementally: " << status;
+  }
+
+  num_updated_nodes_ = item_.graph.node_size();
+  input_properties_.clear();
+  output_properties_.clear();
+  incompatible_shape_nodes_.clear();
+  return InferStatically(assume_valid_feeds_, aggressive_shape_inference_,
+                         include_input_tensor_values_,
+                         include_output_tensor_values_);
+}
+
+Status GraphProperties::InferSubgraphStatically(
+    const GraphView& graph_view,
+    const absl::flat_hash_set<const NodeDef*>& nodes) {
+  GrapplerItem subgraph_item;
+  subgraph_item.id = item_.id;
+  GraphDef* subgraph = &subgraph_item.graph;
+  *subgraph->mutable_versions() = item_.graph.versions();
+  *subgraph->mutable_library() = item_.graph.library();
+
+  // Tensors produced by the rest of the graph, keyed by "node:port", and the
+  // output of the subgraph that replaces them.
+  struct SubgraphInput {
+    string node;
+    int port;
+    // The shape inferred previously, if any.
+    absl::optional<TensorShapeProto> shape;
+  };
+  absl::flat_hash_map<string, SubgraphInput> subgraph_inputs;
+  absl::flat_hash_set<string> subgraph_nodes;
+
+  const auto add_subgraph_input =
+      [&](const NodeDef& fanin_node, int port) -> Status {
+    const string key = strings::StrCat(fanin_node.name(), ":", port);
+    if (subgraph_inputs.contains(key)) {
+      return Status::OK();
+    }
+    SubgraphInput& input = subgraph_inputs[key];
+    const auto it = output_properties_.find(fanin_node.name());
+    if (it != output_properties_.end() &&
+        port < static_cast<int>(it->second.size())) {
+      input.shape = it->second[port].shape();
+    }
+
+    if (!HasRegularInputs(fanin_node)) {
+      // Sources (e.g. constants, placeholders or variables) are copied, which
+      // preserves their attributes and the shapes of their handles.
+      input.node = fanin_node.name();
+      input.port = port;
+      if (subgraph_nodes.insert(fanin_node.name()).second) {
+        NodeDef* source = subgraph->add_node();
+        *source = fanin_node;
+        source->clear_input();
+      }
+      return Status::OK();
+    }
+
+    if (it == output_properties_.end() ||
+        port >= static_cast<int>(it->second.size())) {
+      return errors::Unavailable("Missing properties for input ", key);
+    }
+    const OpInfo::TensorProperties& properties = it->second[port];
+    input.node =
+        strings::StrCat(fanin_node.name(), "/UpdateStatically-", port);
+    while (graph_view.GetNode(input.node) != nullptr) {
+      strings::StrAppend(&input.node, "_");
+    }
+    input.port = 0;
+    subgraph_nodes.insert(input.node);
+
+    NodeDef* input_node = subgraph->add_node();
+    input_node->set_name(input.node);
+    input_node->set_device(fanin_node.device());
+    auto* attr = input_node->mutable_attr();
+    (*attr)["dtype"].set_type(properties.dtype());
+    if (properties.has_value()) {
+      input_node->set_op("Const");
+      *(*attr)["value"].mutable_tensor() = properties.value();
+    } else {
+      input_node->set_op("Placeholder");
+      TensorShapeProto* shape = (*attr)["shape"].mutable_shape();
+      *shape = properties.shape();
+      for (auto& dim : *shape->mutable_dim()) {
+        dim.set_size(std::max<int64>(dim.size(), -1));
+      }
+    }
+    return Status::OK();
+  };
+
+  for (const NodeDef* node : nodes) {
+    subgraph_nodes.insert(node->name());
+    NodeDef* subgraph_node = subgraph->add_node();
+    *subgraph_node = *node;
+    subgraph_node->clear_input();
+    for (const string& input : node->input()) {
+      const TensorId tensor_id = ParseTensorName(input);
+      // Controlling fanins don't matter for shape inference.
+      if (tensor_id.index() < 0) break;
+      const NodeDef* fanin_node = graph_view.GetNode(tensor_id.node());
+      if (fanin_node == nullptr) {
+        return errors::InvalidArgument("Node ", node->name(),
+                                       " has an unknown input ", input);
+      }
+      if (nodes.contains(fanin_node)) {
+        subgraph_node->add_input(input);
+        continue;
+      }
+      TF_RETURN_IF_ERROR(add_subgraph_input(*fanin_node, tensor_id.index()));
+      const SubgraphInput& subgraph_input = subgraph_inputs[strings::StrCat(
+          tensor_id.node(), ":", tensor_id.index())];
+      subgraph_node->add_input(
+          strings::StrCat(subgraph_input.node, ":", subgraph_input.port));
+    }
+  }
+  for (const auto& feed : item_.feed) {
+    if (subgraph_nodes.contains(NodeName(feed.first))) {
+      subgraph_item.feed.push_back(feed);
+    }
+  }
+
+  GraphProperties subgraph_properties(subgraph_item);
+  TF_RETURN_IF_ERROR(subgraph_properties.InferStatically(
+      assume_valid_feeds_, aggressive_shape_inference_,
+      include_input_tensor_values_, include_output_tensor_values_));
+
+  // Symbolic dimensions of the subgraph known to be equal to a symbolic
+  // dimension of the rest of the graph. The other ones are renumbered below
+  // the symbolic dimensions used in the rest of the graph.
+  absl::flat_hash_map<int64, int64> symbolic_dims;
+  for (const auto& input : subgraph_inputs) {
+    const auto& properties =
+        subgraph_properties.GetOutputProperties(input.second.node);
+    if (!input.second.shape.has_value() ||
+        input.second.port >= static_cast<int>(properties.size())) {
+      continue;
+    }
+    const TensorShapeProto& shape = properties[input.second.port].shape();
+    const TensorShapeProto& previous_shape = *input.second.shape;
+    if (shape.dim_size() != previous_shape.dim_size()) continue;
+    for (int i = 0; i < shape.dim_size(); ++i) {
+      if (shape.dim(i).size() < -1 && previous_shape.dim(i).size() < -1) {
+        symbolic_dims.emplace(shape.dim(i).size(),
+                              previous_shape.dim(i).size());
+      }
+    }
+  }
+  int64 min_dim = -1;
+  const auto update_min_dim =
+      [&](const absl::flat_hash_map<string,
+                                    std::vector<OpInfo::TensorProperties>>&
+              node_properties) {
+        for (const auto& properties : node_properties) {
+          const NodeDef* node = graph_view.GetNode(properties.first);
+          if (node != nullptr && nodes.contains(node)) continue;
+          for (const auto& tensor_properties : properties.second) {
+            for (const auto& dim : tensor_properties.shape().dim()) {
+              min_dim = std::min<int64>(min_dim, dim.size());
+            }
+          }
+        }
+      };
+  update_min_dim(input_properties_);
+  update_min_dim(output_properties_);
+  const auto renumber_symbolic_dims =
+      [&](std::vector<OpInfo::TensorProperties>* properties) {
+        for (auto& tensor_properties : *properties) {
+          for (auto& dim : *tensor_properties.mutable_shape()->mutable_dim()) {
+            if (dim.size() >= -1) continue;
+            const auto it = symbolic_dims.find(dim.size());
+            dim.set_size(it != symbolic_dims.end() ? it->second
+                                                   : min_dim + dim.size() + 1);
+          }
+        }
+      };
+
+  for (const NodeDef* node : nodes) {
+    const string& node_name = node->name();
+    incompatible_shape_nodes_.erase(node_name);
+    if (subgraph_properties.CheckShapeIncompatible(node_name)) {
+      incompatible_shape_nodes_.insert(node_name);
+    }
+    if (!subgraph_properties.HasOutputProperties(node_name)) {
+      input_properties_.erase(node_name);
+      output_properties_.erase(node_name);
+      continue;
+    }
+
+    std::vector<OpInfo::TensorProperties> output_properties =
+        subgraph_properties.GetOutputProperties(node_name);
+    renumber_symbolic_dims(&output_properties);
+    output_properties_[node_name] = std::move(output_properties);
+
+    std::vector<OpInfo::TensorProperties> input_properties =
+        subgraph_properties.GetInputProperties(node_name);
+    renumber_symbolic_dims(&input_properties);
+    // Inputs produced by the rest of the graph keep their previous shapes.
+    const int num_inputs =
+        std::min<int>(input_properties.size(), node->input_size());
+    for (int i = 0; i < num_inputs; ++i) {
+      const TensorId tensor_id = ParseTensorName(node->input(i));
+      const auto it = subgraph_inputs.find(
+          strings::StrCat(tensor_id.node(), ":", tensor_id.index()));
+      if (it != subgraph_inputs.end() && it->second.shape.has_value()) {
+        *input_properties[i].mutable_shape() = *it->second.shape;
+      }
+    }
+    input_properties_[node_name] = std::move(input_properties);
+  }
+
+  return Status::OK();
+}
+
 Status GraphProperties::InferDynamically(Cluster* cluster) {
   TF_RETURN_IF_ERROR(cluster->Initialize(item_));
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
@@ -69,6 +70,7 @@ ABSL_CONST_INIT const char kOutputTypes[] = "_output_dtype_vector";
 // Outputs TensorShapeProto vector.
 ABSL_CONST_INIT const char kOutputShapes[] = "_output_shape_vector";
 
+class GraphView;
 class SymbolicShapeRefiner;
 class TopoQueue;
 
@@ -114,6 +116,25 @@ class GraphProperties {
                            /*aggressive_shape_inference=*/false,
                            /*include_tensor_values=*/true);
   }
+  // Update the properties inferred by the last call to InferStatically() after
+  // the nodes `mutated_nodes` were added to, deleted from or modified in the
+  // graph, e.g. the nodes rewritten by an optimizer. Only the mutated nodes
+  // and their transitive fanout are processed again, using the properties of
+  // their other inputs and the options of the last call to InferStatically().
+  // This is much cheaper than inferring the shapes of a large graph from
+  // scratch after each rewrite.
+  // The update falls back to inferring all the shapes again when it can't be
+  // done incrementally, e.g. when the mutated part of the graph uses queues,
+  // or is as large as the rest of the graph. Note that relations between the
+  // symbolic dimensions of the mutated part of the graph and the rest of the
+  // graph discovered by the update aren't propagated to the rest of the graph,
+  // so the result can be less precise (but never less conservative) than
+  // InferStatically().
+  Status UpdateStatically(const absl::flat_hash_set<string>& mutated_nodes);
+  // Returns the number of nodes whose properties were inferred again by the
+  // last call to UpdateStatically(). This is the number of nodes in the graph
+  // if the update fell back to InferStatically().
+  int num_updated_nodes() const { return num_updated_nodes_; }
   // Infer the shape by running the graph on the specified cluster and recording
   // the shapes of the processed tensors.
   Status InferDynamically(Cluster* cluster);
@@ -199,6 +220,15 @@ class GraphProperties {
           resource_handles,
       int num_loops) const;
 
+  // Infers again the properties of `nodes`, which must be closed under fanout,
+  // by running InferStatically() on a copy of these nodes, in which their
+  // inputs produced by the rest of the graph are replaced by nodes producing
+  // tensors with the properties inferred previously. The properties are only
+  // updated if the inference succeeds.
+  Status InferSubgraphStatically(
+      const GraphView& graph_view,
+      const absl::flat_hash_set<const NodeDef*>& nodes);
+
   // Data members
   const GrapplerItem& item_;
   absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>
@@ -210,6 +240,15 @@ class GraphProperties {
   // Nodes with output shape incompatible between shape inference and
   // annotation.
   std::unordered_set<string> incompatible_shape_nodes_;
+
+  // Options of the last call to InferStatically(), reused by
+  // UpdateStatically().
+  bool inferred_statically_ = false;
+  bool assume_valid_feeds_ = false;
+  bool aggressive_shape_inference_ = false;
+  bool include_input_tensor_values_ = false;
+  bool include_output_tensor_values_ = false;
+  int num_updated_nodes_ = 0;
 };
 
 // Helper function for GraphProperties.
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/clusters/single_machine.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
 #include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
 #include "tensorflow/core/grappler/inputs/utils.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -215,6 +216,91 @@ TEST_F(GraphPropertiesTest, ClearProperties) {
   }
 }
 
+TEST_F(GraphPropertiesTest, UpdateStatically) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(
+      s.WithOpName("x"), DT_FLOAT,
+      ops::Placeholder::Shape(PartialTensorShape({-1, 4})));
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {4, 2});
+  Output b = ops::Const(s.WithOpName("b"), 1.0f, {2, 3});
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), x, a);
+  Output relu = ops::Relu(s.WithOpName("relu"), matmul);
+  Output y = ops::Identity(s.WithOpName("y"), relu);
+  Output z = ops::Identity(s.WithOpName("z"), x);
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GraphProperties properties(item);
+  EXPECT_FALSE(properties.UpdateStatically({"y"}).ok());
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+  EXPECT_EQ("float: [-1,2]",
+            PropToString(properties.GetOutputProperties("y")[0]));
+  const int64 batch_dim =
+      properties.GetOutputProperties("relu")[0].shape().dim(0).size();
+  EXPECT_LT(batch_dim, -1);
+
+  // Insert a MatMul by `b` between `relu` and `y`.
+  MutableGraphView graph_view(&item.graph);
+  NodeDef matmul_b;
+  TF_ASSERT_OK(NodeDefBuilder("matmul_b", "MatMul")
+                   .Input("relu", 0, DT_FLOAT)
+                   .Input("b", 0, DT_FLOAT)
+                   .Finalize(&matmul_b));
+  graph_view.AddNode(std::move(matmul_b));
+  TF_ASSERT_OK(graph_view.UpdateFanouts("relu", "matmul_b"));
+  TF_ASSERT_OK(properties.UpdateStatically({"matmul_b", "y"}));
+  EXPECT_EQ(2, properties.num_updated_nodes());
+
+  const auto& matmul_b_inputs = properties.GetInputProperties("matmul_b");
+  ASSERT_EQ(2, matmul_b_inputs.size());
+  EXPECT_EQ("float: [-1,2]", PropToString(matmul_b_inputs[0]));
+  EXPECT_EQ("float: [2,3]", PropToString(matmul_b_inputs[1]));
+  const auto& y_outputs = properties.GetOutputProperties("y");
+  ASSERT_EQ(1, y_outputs.size());
+  EXPECT_EQ("float: [-1,3]", PropToString(y_outputs[0]));
+  // The symbolic batch dimension is still known to be the same as the one of
+  // the rest of the graph.
+  EXPECT_EQ(batch_dim, y_outputs[0].shape().dim(0).size());
+  // The properties of the rest of the graph are left untouched.
+  EXPECT_EQ("float: [-1,4]",
+            PropToString(properties.GetOutputProperties("z")[0]));
+
+  // Delete `y`.
+  TF_ASSERT_OK(graph_view.DeleteNodes({"y"}));
+  TF_ASSERT_OK(properties.UpdateStatically({"y"}));
+  EXPECT_EQ(0, properties.num_updated_nodes());
+  EXPECT_FALSE(properties.HasInputProperties("y"));
+  EXPECT_FALSE(properties.HasOutputProperties("y"));
+  EXPECT_TRUE(properties.HasOutputProperties("matmul_b"));
+}
+
+TEST_F(GraphPropertiesTest, UpdateStaticallyFallsBackToInferStatically) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Const(s.WithOpName("x"), 1.0f, {4, 2});
+  Output y = ops::Identity(s.WithOpName("y"), x);
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GraphProperties properties(item);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  // Most of the graph is mutated: it's processed again from scratch.
+  MutableGraphView graph_view(&item.graph);
+  NodeDef z;
+  TF_ASSERT_OK(NodeDefBuilder("z", "Neg").Input("y", 0, DT_FLOAT).Finalize(&z));
+  graph_view.AddNode(std::move(z));
+  AttrValue type;
+  type.set_type(DT_FLOAT);
+  TF_ASSERT_OK(graph_view.UpdateNode("y", "Identity", "", {{"T", type}}));
+  TF_ASSERT_OK(properties.UpdateStatically({"y", "z"}));
+  // All the nodes of the graph were processed, not only the mutated ones.
+  EXPECT_EQ(3, properties.num_updated_nodes());
+  EXPECT_EQ("float: [4,2]",
+            PropToString(properties.GetOutputProperties("z")[0]));
+  EXPECT_EQ("float: [4,2]",
+            PropToString(properties.GetOutputProperties("y")[0]));
+}
+
 TEST_F(GraphPropertiesTest, DynamicProperties) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false,
                                           cluster_->GetDeviceNames());
@@ -0,0 +1,334 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/robust_stats.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+bool IsFullyDefined(const OpInfo::TensorProperties& prop) {
+  if (prop.dtype() == DT_INVALID) return false;
+  return PartialTensorShape(prop.shape()).IsFullyDefined();
+}
+
+// Returns the measured execution time of the op itself, excluding the time
+// spent scheduling it and processing its outputs.
+int64 OpExecutionTimeNs(const NodeExecStats& stats) {
+  if (stats.op_end_rel_nanos() > 0) {
+    return stats.op_end_rel_nanos() - stats.op_start_rel_nanos();
+  }
+  return (stats.op_end_rel_micros() - stats.op_start_rel_micros()) * 1000;
+}
+
+}  // namespace
+
+constexpr int OpCostProfile::kMaxSamplesPerKey;
+
+string OpCostProfile::KeyForOpInfo(const OpInfo& op_info) {
+  string key = absl::StrCat(op_info.op(), "@", op_info.device().type());
+  // Only the attributes affecting the computation are part of the key:
+  // internal attributes (e.g. colocation constraints) and constant values are
+  // ignored. The attribute map is sorted to get a stable key.
+  std::map<string, const AttrValue*> sorted_attrs;
+  for (const auto& attr : op_info.attr()) {
+    if (absl::StartsWith(attr.first, "_")) continue;
+    if (attr.second.value_case() == AttrValue::kTensor) continue;
+    sorted_attrs[attr.first] = &attr.second;
+  }
+  for (const auto& attr : sorted_attrs) {
+    absl::StrAppend(&key, ";", attr.first, "=",
+                    SummarizeAttrValue(*attr.second));
+  }
+  for (const auto& input : op_info.inputs()) {
+    absl::StrAppend(&key, "|", DataTypeString(input.dtype()),
+                    PartialTensorShape::DebugString(input.shape()));
+  }
+  return key;
+}
+
+void OpCostProfile::AddSample(const OpInfo& op_info,
+                              Costs::Duration execution_time) {
+  AddSamples(op_info, static_cast<double>(execution_time.count()), 1);
+}
+
+void OpCostProfile::AddSamples(const OpInfo& op_info, double sample_ns,
+                               int64 count) {
+  Entry& entry = entries_[KeyForOpInfo(op_info)];
+  if (entry.samples_ns.empty()) {
+    entry.op_info = op_info;
+    // Constant values and the device description don't contribute to the key,
+    // so there is no point in storing them.
+    for (auto& input : *entry.op_info.mutable_inputs()) {
+      input.clear_value();
+    }
+    auto* attrs = entry.op_info.mutable_attr();
+    for (auto it = attrs->begin(); it != attrs->end();) {
+      if (it->second.value_case() == AttrValue::kTensor) {
+        it = attrs->erase(it);
+      } else {
+        ++it;
+      }
+    }
+    DeviceProperties device;
+    device.set_type(op_info.device().type());
+    *entry.op_info.mutable_device() = device;
+  }
+  // Older samples would all be replaced by the extra copies.
+  const int64 num_copies = std::min<int64>(count, kMaxSamplesPerKey);
+  for (int64 i = 0; i < num_copies; ++i) {
+    if (entry.samples_ns.size() < kMaxSamplesPerKey) {
+      entry.samples_ns.push_back(sample_ns);
+    } else {
+      entry.samples_ns[entry.next_sample] = sample_ns;
+      entry.next_sample = (entry.next_sample + 1) % kMaxSamplesPerKey;
+    }
+  }
+  entry.num_samples += count;
+  entry.estimate_ns = RobustStats(entry.samples_ns).mean();
+}
+
+Status OpCostProfile::AddStepStats(const GraphDef& graph,
+                                   const StepStats& step_stats,
+                                   const GraphProperties* properties) {
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  for (const auto& node : graph.node()) {
+    name_to_node[node.name()] = &node;
+  }
+
+  // Collect the shapes of the tensors produced during the step, so that the
+  // input properties of each measured node can be reconstructed.
+  std::unordered_map<string, const NodeExecStats*> name_to_stats;
+  for (const auto& dev_stats : step_stats.dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      name_to_stats[node_stats.node_name()] = &node_stats;
+    }
+  }
+
+  int num_skipped = 0;
+  for (const auto& dev_stats : step_stats.dev_stats()) {
+    const DeviceProperties device = GetDeviceInfo(dev_stats.device());
+    // Auxiliary streams (e.g. ".../stream:all") can't be parsed as device names
+    // and only duplicate the timings recorded for the main device.
+    if (device.type() == "UNKNOWN") continue;
+
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      auto node_it = name_to_node.find(node_stats.node_name());
+      if (node_it == name_to_node.end()) continue;
+      const NodeDef& node = *node_it->second;
+
+      std::vector<OpInfo::TensorProperties> static_inputs;
+      if (properties != nullptr &&
+          properties->HasInputProperties(node.name())) {
+        static_inputs = properties->GetInputProperties(node.name());
+      }
+
+      std::vector<OpInfo::TensorProperties> inputs;
+      bool inputs_known = true;
+      for (int i = 0; i < node.input_size(); ++i) {
+        const TensorId input = ParseTensorName(node.input(i));
+        if (input.index() < 0) continue;  // Control dependency.
+        OpInfo::TensorProperties prop;
+        auto stats_it = name_to_stats.find(string(input.node()));
+        if (stats_it != name_to_stats.end()) {
+          for (const auto& output : stats_it->second->output()) {
+            if (output.slot() == input.index()) {
+              prop.set_dtype(output.tensor_description().dtype());
+              *prop.mutable_shape() = output.tensor_description().shape();
+              break;
+            }
+          }
+        }
+        if (!IsFullyDefined(prop) && inputs.size() < static_inputs.size()) {
+          prop = static_inputs[inputs.size()];
+        }
+        inputs_known &= IsFullyDefined(prop);
+        inputs.push_back(std::move(prop));
+      }
+      if (!inputs_known) {
+        ++num_skipped;
+        continue;
+      }
+
+      OpInfo op_info = BuildOpInfoWithoutDevice(node, name_to_node, inputs);
+      *op_info.mutable_device() = device;
+      AddSample(op_info, Costs::Duration(OpExecutionTimeNs(node_stats)));
+    }
+  }
+  VLOG(1) << "Skipped " << num_skipped
+          << " measurements with unknown input shapes";
+  return Status::OK();
+}
+
+Status OpCostProfile::AddRunMetadata(const RunMetadata& run_metadata) {
+  if (run_metadata.partition_graphs().empty()) {
+    return errors::InvalidArgument(
+        "RunMetadata has no partition graphs, the step must run with "
+        "RunOptions.output_partition_graphs set");
+  }
+  // The StepStats name the nodes of the partition graphs, which have distinct
+  // names across partitions.
+  GraphDef graph;
+  for (const GraphDef& partition_graph : run_metadata.partition_graphs()) {
+    graph.mutable_node()->MergeFrom(partition_graph.node());
+  }
+  return AddStepStats(graph, run_metadata.step_stats());
+}
+
+bool OpCostProfile::Lookup(const OpInfo& op_info,
+                           Costs::Duration* execution_time) const {
+  auto it = entries_.find(KeyForOpInfo(op_info));
+  if (it == entries_.end()) return false;
+  *execution_time = Costs::Duration(it->second.estimate_ns);
+  return true;
+}
+
+int64 OpCostProfile::NumSamples(const OpInfo& op_info) const {
+  auto it = entries_.find(KeyForOpInfo(op_info));
+  return it == entries_.end() ? 0 : it->second.num_samples;
+}
+
+OpPerformanceList OpCostProfile::ToOpPerformanceList() const {
+  // Sort by key so that the serialized profile is deterministic.
+  std::map<string, const Entry*> sorted_entries;
+  for (const auto& entry : entries_) {
+    sorted_entries[entry.first] = &entry.second;
+  }
+  OpPerformanceList ret;
+  for (const auto& entry : sorted_entries) {
+    OpPerformance* perf = ret.add_op_performance();
+    *perf->mutable_op() = entry.second->op_info;
+    perf->set_compute_cost(static_cast<int64>(entry.second->estimate_ns));
+    perf->set_num_samples(entry.second->num_samples);
+  }
+  return ret;
+}
+
+void OpCostProfile::AddOpPerformanceList(
+    const OpPerformanceList& op_performance_list) {
+  for (const auto& perf : op_performance_list.op_performance()) {
+    AddSamples(perf.op(), static_cast<double>(perf.compute_cost()),
+               std::max<int64>(perf.num_samples(), 1));
+  }
+}
+
+Status OpCostProfile::Save(Env* env, const string& filename) const {
+  return WriteBinaryProto(env, filename, ToOpPerformanceList());
+}
+
+Status OpCostProfile::Load(Env* env, const string& filename) {
+  OpPerformanceList op_performance_list;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env, filename, &op_performance_list));
+  AddOpPerformanceList(op_performance_list);
+  return Status::OK();
+}
+
+ProfiledOpLevelCostEstimator::ProfiledOpLevelCostEstimator(
+    std::shared_ptr<const OpCostProfile> profile)
+    : profile_(std::move(profile)) {}
+
+Costs ProfiledOpLevelCostEstimator::PredictCosts(
+    const OpContext& op_context) const {
+  Costs costs = OpLevelCostEstimator::PredictCosts(op_context);
+  Costs::Duration measured;
+  if (profile_ == nullptr || !profile_->Lookup(op_context.op_info, &measured)) {
+    return costs;
+  }
+  // The measurement already accounts for both compute and memory accesses, so
+  // attribute all of it to compute. Memory usage estimates are kept as is.
+  costs.execution_time = measured;
+  costs.compute_time = measured;
+  costs.memory_time = Costs::Duration::zero();
+  costs.intermediate_memory_time = Costs::Duration::zero();
+  costs.intermediate_memory_read_time = Costs::Duration::zero();
+  costs.intermediate_memory_write_time = Costs::Duration::zero();
+  costs.inaccurate = false;
+  costs.num_ops_with_unknown_shapes = 0;
+  return costs;
+}
+
+std::unique_ptr<OpLevelCostEstimator> CreateDefaultOpLevelCostEstimator() {
+  string filename;
+  Status s = ReadStringFromEnvVar(kOpCostProfileEnvVar, "", &filename);
+  if (!s.ok() || filename.empty()) {
+    return absl::make_unique<OpLevelCostEstimator>();
+  }
+
+  // The profile is immutable once loaded, so it is shared by all the
+  // estimators created for the same file instead of being re-read each time.
+  static mutex* mu = new mutex;
+  static auto* profiles =
+      new std::unordered_map<string, std::shared_ptr<const OpCostProfile>>;
+  std::shared_ptr<const OpCostProfile> profile;
+  {
+    mutex_lock l(*mu);
+    auto it = profiles->find(filename);
+    if (it != profiles->end()) {
+      profile = it->second;
+    } else {
+      auto loaded = std::make_shared<OpCostProfile>();
+      s = loaded->Load(Env::Default(), filename);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to load the op cost profile " << filename
+                     << ", falling back to analytical cost estimates: " << s;
+        return absl::make_unique<OpLevelCostEstimator>();
+      }
+      profile = std::move(loaded);
+      (*profiles)[filename] = profile;
+    }
+  }
+  return absl::make_unique<ProfiledOpLevelCostEstimator>(std::move(profile));
+}
+
+Status UpdateOpCostProfile(Env* env,
+                           const std::vector<string>& run_metadata_files,
+                           const string& profile_file) {
+  OpCostProfile profile;
+  if (env->FileExists(profile_file).ok()) {
+    TF_RETURN_IF_ERROR(profile.Load(env, profile_file));
+  }
+  for (const string& filename : run_metadata_files) {
+    RunMetadata run_metadata;
+    TF_RETURN_IF_ERROR(ReadBinaryProto(env, filename, &run_metadata));
+    Status s = profile.AddRunMetadata(run_metadata);
+    if (!s.ok()) {
+      return errors::InvalidArgument("Invalid RunMetadata in ", filename, ": ",
+                                     s.error_message());
+    }
+  }
+  return profile.Save(env, profile_file);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
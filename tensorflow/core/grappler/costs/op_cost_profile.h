@@ -0,0 +1,144 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace grappler {
+
+class GraphProperties;
+
+// A table of measured op execution times, keyed by op type, attributes, input
+// dtypes and shapes, and device type. The profile is filled from the StepStats
+// of real runs and can be persisted as an OpPerformanceList so that it can be
+// reused across processes.
+class OpCostProfile {
+ public:
+  // Maximum number of samples kept for each key. Older samples are replaced
+  // once this limit is reached.
+  static constexpr int kMaxSamplesPerKey = 64;
+
+  OpCostProfile() {}
+
+  // Records the op execution times found in 'step_stats', which must have been
+  // collected while running 'graph'. Input shapes are taken from the outputs
+  // recorded for the producing nodes; when these are missing and 'properties'
+  // is not null, the statically inferred input properties are used instead.
+  // Nodes whose input shapes can't be determined are skipped.
+  Status AddStepStats(const GraphDef& graph, const StepStats& step_stats,
+                      const GraphProperties* properties = nullptr);
+
+  // Records the op execution times of a step run with
+  // RunOptions.trace_level = FULL_TRACE and output_partition_graphs set, which
+  // provide the StepStats and the graphs they were collected for.
+  Status AddRunMetadata(const RunMetadata& run_metadata);
+
+  // Records a single measurement for the op described by 'op_info'.
+  void AddSample(const OpInfo& op_info, Costs::Duration execution_time);
+
+  // Returns true and sets 'execution_time' if a measurement exists for an op
+  // matching 'op_info'.
+  bool Lookup(const OpInfo& op_info, Costs::Duration* execution_time) const;
+
+  // Returns the number of measurements recorded for ops matching 'op_info',
+  // including the ones aggregated in loaded profiles.
+  int64 NumSamples(const OpInfo& op_info) const;
+
+  // Serialization to and from the OpPerformanceList proto. Each key is stored
+  // as a single OpPerformance entry whose compute_cost is the robust mean of
+  // its samples and whose num_samples is their count. Loading an entry weighs
+  // its compute_cost by its num_samples (up to kMaxSamplesPerKey) against the
+  // samples recorded afterwards.
+  OpPerformanceList ToOpPerformanceList() const;
+  void AddOpPerformanceList(const OpPerformanceList& op_performance_list);
+
+  Status Save(Env* env, const string& filename) const;
+  Status Load(Env* env, const string& filename);
+
+  int size() const { return entries_.size(); }
+
+  // Returns the key under which the measurements for 'op_info' are stored.
+  static string KeyForOpInfo(const OpInfo& op_info);
+
+ private:
+  struct Entry {
+    OpInfo op_info;
+    // The most recent samples, up to kMaxSamplesPerKey of them.
+    std::vector<double> samples_ns;
+    int next_sample = 0;
+    int64 num_samples = 0;
+    double estimate_ns = 0.0;
+  };
+
+  // Records 'count' measurements of 'sample_ns' for the op described by
+  // 'op_info'.
+  void AddSamples(const OpInfo& op_info, double sample_ns, int64 count);
+
+  absl::flat_hash_map<string, Entry> entries_;
+};
+
+// An OpLevelCostEstimator that returns the measured execution time of an op
+// when it is available in the profile, and falls back to the analytical model
+// otherwise. It can be passed to AnalyticalCostEstimator (and hence to the
+// VirtualScheduler) in place of the default OpLevelCostEstimator.
+class ProfiledOpLevelCostEstimator : public OpLevelCostEstimator {
+ public:
+  explicit ProfiledOpLevelCostEstimator(
+      std::shared_ptr<const OpCostProfile> profile);
+  ~ProfiledOpLevelCostEstimator() override {}
+
+  Costs PredictCosts(const OpContext& op_context) const override;
+
+ private:
+  std::shared_ptr<const OpCostProfile> profile_;
+};
+
+// Name of the environment variable holding the path of a saved OpCostProfile
+// to be used by default for cost estimation.
+constexpr char kOpCostProfileEnvVar[] = "TF_GRAPPLER_OP_COST_PROFILE";
+
+// Returns the OpLevelCostEstimator to use by default. When the
+// TF_GRAPPLER_OP_COST_PROFILE environment variable names a saved profile, this
+// is a ProfiledOpLevelCostEstimator backed by that profile. Otherwise, or if
+// the profile can't be loaded, this is a plain OpLevelCostEstimator.
+std::unique_ptr<OpLevelCostEstimator> CreateDefaultOpLevelCostEstimator();
+
+// Adds the measurements of the RunMetadata protos saved in binary format in
+// 'run_metadata_files' to the profile saved in 'profile_file', creating the
+// profile if the file doesn't exist yet.
+Status UpdateOpCostProfile(Env* env,
+                           const std::vector<string>& run_metadata_files,
+                           const string& profile_file);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
@@ -0,0 +1,250 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
+
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kDevice[] = "/job:localhost/replica:0/task:0/device:CPU:0";
+
+void AddOutput(int slot, DataType dtype, const TensorShape& shape,
+               NodeExecStats* stats) {
+  NodeOutput* output = stats->add_output();
+  output->set_slot(slot);
+  output->mutable_tensor_description()->set_dtype(dtype);
+  shape.AsProto(output->mutable_tensor_description()->mutable_shape());
+}
+
+NodeExecStats* AddNodeStats(const string& name, int64 start_micros,
+                            int64 end_micros, DeviceStepStats* dev_stats) {
+  NodeExecStats* stats = dev_stats->add_node_stats();
+  stats->set_node_name(name);
+  stats->set_op_start_rel_micros(start_micros);
+  stats->set_op_end_rel_micros(end_micros);
+  return stats;
+}
+
+class OpCostProfileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TF_CHECK_OK(NodeDefBuilder("a", "Placeholder")
+                    .Attr("dtype", DT_FLOAT)
+                    .Finalize(graph_.add_node()));
+    TF_CHECK_OK(NodeDefBuilder("b", "Placeholder")
+                    .Attr("dtype", DT_FLOAT)
+                    .Finalize(graph_.add_node()));
+    TF_CHECK_OK(NodeDefBuilder("matmul", "MatMul")
+                    .Input("a", 0, DT_FLOAT)
+                    .Input("b", 0, DT_FLOAT)
+                    .Attr("transpose_a", false)
+                    .Attr("transpose_b", false)
+                    .Finalize(graph_.add_node()));
+
+    DeviceStepStats* dev_stats = step_stats_.add_dev_stats();
+    dev_stats->set_device(kDevice);
+    AddOutput(0, DT_FLOAT, TensorShape({32, 64}),
+              AddNodeStats("a", 0, 1, dev_stats));
+    AddOutput(0, DT_FLOAT, TensorShape({64, 16}),
+              AddNodeStats("b", 0, 1, dev_stats));
+    AddOutput(0, DT_FLOAT, TensorShape({32, 16}),
+              AddNodeStats("matmul", 10, 35, dev_stats));
+  }
+
+  // Builds the context of a MatMul node the same way the profile builds the
+  // keys of its measurements.
+  OpContext MatMulContext(int m, int k, int n) {
+    NodeDef node;
+    TF_CHECK_OK(NodeDefBuilder("matmul", "MatMul")
+                    .Input("a", 0, DT_FLOAT)
+                    .Input("b", 0, DT_FLOAT)
+                    .Attr("transpose_a", false)
+                    .Attr("transpose_b", false)
+                    .Finalize(&node));
+    std::vector<OpInfo::TensorProperties> inputs(2);
+    inputs[0].set_dtype(DT_FLOAT);
+    TensorShape({m, k}).AsProto(inputs[0].mutable_shape());
+    inputs[1].set_dtype(DT_FLOAT);
+    TensorShape({k, n}).AsProto(inputs[1].mutable_shape());
+
+    OpContext op_context;
+    op_context.name = node.name();
+    op_context.op_info = BuildOpInfoWithoutDevice(node, {}, inputs);
+    op_context.op_info.mutable_device()->set_type("CPU");
+    return op_context;
+  }
+
+  GraphDef graph_;
+  StepStats step_stats_;
+};
+
+TEST_F(OpCostProfileTest, AddStepStats) {
+  OpCostProfile profile;
+  TF_ASSERT_OK(profile.AddStepStats(graph_, step_stats_));
+  // Placeholders have no inputs, so they are recorded as well.
+  EXPECT_EQ(2, profile.size());
+
+  Costs::Duration execution_time;
+  EXPECT_TRUE(
+      profile.Lookup(MatMulContext(32, 64, 16).op_info, &execution_time));
+  EXPECT_EQ(Costs::Duration(25000), execution_time);
+  EXPECT_FALSE(
+      profile.Lookup(MatMulContext(32, 64, 8).op_info, &execution_time));
+}
+
+TEST_F(OpCostProfileTest, RobustMeanOfSamples) {
+  OpCostProfile profile;
+  const OpInfo op_info = MatMulContext(32, 64, 16).op_info;
+  for (int i = 0; i < 10; ++i) {
+    profile.AddSample(op_info, Costs::Duration(100));
+  }
+  // A single outlier doesn't move the estimate.
+  profile.AddSample(op_info, Costs::Duration(100000));
+  Costs::Duration execution_time;
+  EXPECT_TRUE(profile.Lookup(op_info, &execution_time));
+  EXPECT_EQ(Costs::Duration(100), execution_time);
+}
+
+TEST_F(OpCostProfileTest, SaveAndLoad) {
+  OpCostProfile profile;
+  TF_ASSERT_OK(profile.AddStepStats(graph_, step_stats_));
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile_test.pb");
+  TF_ASSERT_OK(profile.Save(Env::Default(), filename));
+
+  OpCostProfile loaded;
+  TF_ASSERT_OK(loaded.Load(Env::Default(), filename));
+  EXPECT_EQ(profile.size(), loaded.size());
+  Costs::Duration execution_time;
+  EXPECT_TRUE(
+      loaded.Lookup(MatMulContext(32, 64, 16).op_info, &execution_time));
+  EXPECT_EQ(Costs::Duration(25000), execution_time);
+}
+
+TEST_F(OpCostProfileTest, SaveAndLoadKeepsSampleCounts) {
+  OpCostProfile profile;
+  const OpInfo op_info = MatMulContext(32, 64, 16).op_info;
+  for (int i = 0; i < 10; ++i) {
+    profile.AddSample(op_info, Costs::Duration(100));
+  }
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile_counts_test.pb");
+  TF_ASSERT_OK(profile.Save(Env::Default(), filename));
+
+  OpCostProfile loaded;
+  TF_ASSERT_OK(loaded.Load(Env::Default(), filename));
+  EXPECT_EQ(10, loaded.NumSamples(op_info));
+  // The loaded estimate still stands for 10 samples, so a single outlier
+  // doesn't move it.
+  loaded.AddSample(op_info, Costs::Duration(100000));
+  EXPECT_EQ(11, loaded.NumSamples(op_info));
+  Costs::Duration execution_time;
+  EXPECT_TRUE(loaded.Lookup(op_info, &execution_time));
+  EXPECT_EQ(Costs::Duration(100), execution_time);
+}
+
+TEST_F(OpCostProfileTest, UpdateOpCostProfileFromRunMetadata) {
+  RunMetadata run_metadata;
+  *run_metadata.mutable_step_stats() = step_stats_;
+  *run_metadata.add_partition_graphs() = graph_;
+  const string run_metadata_file =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile_run_metadata.pb");
+  TF_ASSERT_OK(
+      WriteBinaryProto(Env::Default(), run_metadata_file, run_metadata));
+  const string profile_file =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile_from_run_metadata.pb");
+  Env::Default()->DeleteFile(profile_file).IgnoreError();
+
+  // Creates the profile, then adds to it.
+  TF_ASSERT_OK(UpdateOpCostProfile(Env::Default(), {run_metadata_file},
+                                   profile_file));
+  TF_ASSERT_OK(UpdateOpCostProfile(
+      Env::Default(), {run_metadata_file, run_metadata_file}, profile_file));
+
+  OpCostProfile profile;
+  TF_ASSERT_OK(profile.Load(Env::Default(), profile_file));
+  const OpInfo op_info = MatMulContext(32, 64, 16).op_info;
+  EXPECT_EQ(3, profile.NumSamples(op_info));
+  Costs::Duration execution_time;
+  EXPECT_TRUE(profile.Lookup(op_info, &execution_time));
+  EXPECT_EQ(Costs::Duration(25000), execution_time);
+}
+
+TEST_F(OpCostProfileTest, AddRunMetadataRequiresPartitionGraphs) {
+  RunMetadata run_metadata;
+  *run_metadata.mutable_step_stats() = step_stats_;
+  OpCostProfile profile;
+  EXPECT_TRUE(errors::IsInvalidArgument(profile.AddRunMetadata(run_metadata)));
+}
+
+TEST_F(OpCostProfileTest, ProfiledOpLevelCostEstimator) {
+  auto profile = std::make_shared<OpCostProfile>();
+  TF_ASSERT_OK(profile->AddStepStats(graph_, step_stats_));
+  ProfiledOpLevelCostEstimator estimator(profile);
+  OpLevelCostEstimator analytical_estimator;
+
+  // Measured op.
+  Costs costs = estimator.PredictCosts(MatMulContext(32, 64, 16));
+  EXPECT_EQ(Costs::Duration(25000), costs.execution_time);
+  EXPECT_EQ(Costs::Duration(25000), costs.compute_time);
+  EXPECT_FALSE(costs.inaccurate);
+
+  // Unmeasured shape falls back to the analytical model.
+  const OpContext unmeasured = MatMulContext(128, 64, 16);
+  EXPECT_EQ(analytical_estimator.PredictCosts(unmeasured).execution_time,
+            estimator.PredictCosts(unmeasured).execution_time);
+}
+
+TEST_F(OpCostProfileTest, DefaultEstimatorUsesProfileFromEnv) {
+  OpCostProfile profile;
+  TF_ASSERT_OK(profile.AddStepStats(graph_, step_stats_));
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile_env_test.pb");
+  TF_ASSERT_OK(profile.Save(Env::Default(), filename));
+
+  unsetenv(kOpCostProfileEnvVar);
+  const OpContext measured = MatMulContext(32, 64, 16);
+  OpLevelCostEstimator analytical_estimator;
+  EXPECT_EQ(analytical_estimator.PredictCosts(measured).execution_time,
+            CreateDefaultOpLevelCostEstimator()
+                ->PredictCosts(measured)
+                .execution_time);
+
+  setenv(kOpCostProfileEnvVar, filename.c_str(), 1);
+  EXPECT_EQ(Costs::Duration(25000), CreateDefaultOpLevelCostEstimator()
+                                        ->PredictCosts(measured)
+                                        .execution_time);
+
+  // A missing profile falls back to the analytical model.
+  setenv(kOpCostProfileEnvVar, "/nonexistent/op_cost_profile.pb", 1);
+  EXPECT_EQ(analytical_estimator.PredictCosts(measured).execution_time,
+            CreateDefaultOpLevelCostEstimator()
+                ->PredictCosts(measured)
+                .execution_time);
+  unsetenv(kOpCostProfileEnvVar);
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,150 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Returns true if `tensor` is known to be a scalar, i.e. it is produced by a
+// scalar constant.
+bool IsScalarConst(const NodeBuilder::NodeOut& tensor) {
+  if (tensor.node == nullptr || !tensor.node->IsConstant()) return false;
+  const TensorProto* value;
+  if (!GetNodeAttr(tensor.node->attrs(), "value", &value).ok()) return false;
+  return value->tensor_shape().dim_size() == 0 &&
+         !value->tensor_shape().unknown_rank();
+}
+
+// Vectorizer for string ops that act independently on each string of their
+// first input, and whose remaining inputs (e.g. the pattern of `RegexReplace`
+// or the `pos` and `len` of `Substr`) are parameters of the transformation.
+// When the parameters don't vary between slices, applying the op to the
+// stacked input is the vectorized version of the op. Ops that append
+// dimensions to their output (e.g. `DecodeRaw`) vectorize the same way, since
+// the stacked dimension stays in front.
+//
+// If `scalar_params` is true, the parameters are broadcast against the input,
+// so the op is only vectorized when they are known to be scalars: otherwise
+// they would be broadcast against the stacked dimension as well.
+class ElementwiseStringOpVectorizer : public Vectorizer {
+ public:
+  ElementwiseStringOpVectorizer(int num_inputs, bool scalar_params)
+      : num_inputs_(num_inputs), scalar_params_(scalar_params) {}
+
+  Status Vectorize(const Node& node, Graph* outer_scope,
+                   VectorizerInput&& inputs,
+                   VectorizerOutput* outputs) override {
+    if (inputs.size() != num_inputs_) {
+      return errors::Internal("Failed to vectorize ", node.type_string(),
+                              ". The op should have ", num_inputs_,
+                              " inputs, but has ", inputs.size());
+    }
+
+    NodeBuilder::NodeOut input;
+    TF_RETURN_IF_ERROR(inputs.stacked(0, &input));
+
+    std::vector<NodeBuilder::NodeOut> params;
+    params.resize(inputs.size() - 1);
+    for (size_t i = 1; i < inputs.size(); ++i) {
+      TF_RETURN_IF_ERROR(inputs.unstacked(i, &params[i - 1]));
+      if (scalar_params_ && !IsScalarConst(params[i - 1])) {
+        return errors::InvalidArgument(
+            "Expecting input ", i, " of ", node.type_string(),
+            " to be a scalar constant.");
+      }
+    }
+
+    Node* new_node;
+    auto node_builder = NodeBuilder(strings::StrCat("vectorized/", node.name()),
+                                    node.type_string())
+                            .Input(input);
+    for (const auto& param : params) {
+      node_builder = node_builder.Input(param);
+    }
+    for (const auto& attr : node.attrs()) {
+      node_builder = node_builder.Attr(attr.first, attr.second);
+    }
+    TF_RETURN_IF_ERROR(node_builder.Finalize(outer_scope, &new_node));
+
+    // Add output mappings
+    outputs->push_back({new_node, 0, true});
+    return Status::OK();
+  }
+
+ private:
+  const int num_inputs_;
+  const bool scalar_params_;
+};
+
+class UnaryStringOpVectorizer : public ElementwiseStringOpVectorizer {
+ public:
+  UnaryStringOpVectorizer()
+      : ElementwiseStringOpVectorizer(1, /*scalar_params=*/false) {}
+};
+
+// The kernels of `RegexFullMatch` and `RegexReplace` require scalar patterns,
+// so there is no need to check them here.
+class RegexFullMatchVectorizer : public ElementwiseStringOpVectorizer {
+ public:
+  RegexFullMatchVectorizer()
+      : ElementwiseStringOpVectorizer(2, /*scalar_params=*/false) {}
+};
+
+class RegexReplaceVectorizer : public ElementwiseStringOpVectorizer {
+ public:
+  RegexReplaceVectorizer()
+      : ElementwiseStringOpVectorizer(3, /*scalar_params=*/false) {}
+};
+
+// `pos` and `len` of `Substr` are broadcast against `input`.
+class SubstrVectorizer : public ElementwiseStringOpVectorizer {
+ public:
+  SubstrVectorizer()
+      : ElementwiseStringOpVectorizer(3, /*scalar_params=*/true) {}
+};
+
+// Hashing
+REGISTER_VECTORIZER("StringToHashBucket", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringToHashBucketFast", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringToHashBucketStrong", UnaryStringOpVectorizer);
+
+// Conversion
+REGISTER_VECTORIZER("AsString", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("DecodeBase64", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("DecodeRaw", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("EncodeBase64", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringToNumber", UnaryStringOpVectorizer);
+
+// Manipulation
+REGISTER_VECTORIZER("StaticRegexFullMatch", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StaticRegexReplace", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringLength", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringLower", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringStrip", UnaryStringOpVectorizer);
+REGISTER_VECTORIZER("StringUpper", UnaryStringOpVectorizer);
+
+// Manipulation with unstacked parameters
+REGISTER_VECTORIZER("RegexFullMatch", RegexFullMatchVectorizer);
+REGISTER_VECTORIZER("RegexReplace", RegexReplaceVectorizer);
+REGISTER_VECTORIZER("Substr", SubstrVectorizer);
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -1380,6 +1380,102 @@ TEST(VectorizerTest, VectorizeIdentity) {
   EXPECT_EQ(vectorized->node_def_size(), 1);
 }
 
+TEST(VectorizerTest, VectorizeStringToHashBucketFast) {
+  FunctionDef inner = FunctionDefHelper::Create(
+      /*function_name=*/"inner_function",
+      /*in_def=*/{"arg0: string"},
+      /*out_def=*/{"ret0: int64"},
+      /*attr_def=*/{},
+      /*node_def=*/
+      {{{"Hash"}, "StringToHashBucketFast", {"arg0"}, {{"num_buckets", 10}}}},
+      /*ret_def=*/{{"ret0", "Hash:output:0"}});
+
+  FunctionDefLibrary lib;
+  FunctionDef* vectorized;
+  TF_ASSERT_OK(WrapAndVectorize(inner, &lib, &vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+  ASSERT_TRUE(function_utils::ContainsFunctionNodeWithOp(
+      "StringToHashBucketFast", *vectorized));
+  const NodeDef& hash_node = vectorized->node_def(
+      function_utils::FindFunctionNodeWithOp("StringToHashBucketFast",
+                                             *vectorized));
+  EXPECT_EQ(hash_node.input(0), vectorized->signature().input_arg(0).name());
+  EXPECT_EQ(GetRetval(*vectorized, 0),
+            strings::StrCat(hash_node.name(), ":output:0"));
+}
+
+TEST(VectorizerTest, VectorizeRegexReplace) {
+  FunctionDef inner = FunctionDefHelper::Create(
+      /*function_name=*/"inner_function",
+      /*in_def=*/{"arg0: string"},
+      /*out_def=*/{"ret0: string"},
+      /*attr_def=*/{},
+      /*node_def=*/
+      {FunctionDefHelper::Const("Pattern", tstring("[0-9]")),
+       FunctionDefHelper::Const("Rewrite", tstring("#")),
+       {{"RegexReplace"},
+        "RegexReplace",
+        {"arg0", "Pattern:output:0", "Rewrite:output:0"},
+        {{"replace_global", true}}}},
+      /*ret_def=*/{{"ret0", "RegexReplace:output:0"}});
+
+  FunctionDefLibrary lib;
+  FunctionDef* vectorized;
+  TF_ASSERT_OK(WrapAndVectorize(inner, &lib, &vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("RegexReplace", *vectorized));
+}
+
+TEST(VectorizerTest, VectorizeSubstr) {
+  FunctionDef inner = FunctionDefHelper::Create(
+      /*function_name=*/"inner_function",
+      /*in_def=*/{"arg0: string"},
+      /*out_def=*/{"ret0: string"},
+      /*attr_def=*/{},
+      /*node_def=*/
+      {FunctionDefHelper::Const("Pos", 1), FunctionDefHelper::Const("Len", 3),
+       {{"Substr"},
+        "Substr",
+        {"arg0", "Pos:output:0", "Len:output:0"},
+        {{"T", DT_INT32}}}},
+      /*ret_def=*/{{"ret0", "Substr:output:0"}});
+
+  FunctionDefLibrary lib;
+  FunctionDef* vectorized;
+  TF_ASSERT_OK(WrapAndVectorize(inner, &lib, &vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("Substr", *vectorized));
+}
+
+TEST(VectorizerTest, VectorizeSubstrWithVectorPos) {
+  // Non-scalar `pos` and `len` would be broadcast against the stacked
+  // dimension, so the node should not be vectorized.
+  FunctionDef inner = FunctionDefHelper::Create(
+      /*function_name=*/"inner_function",
+      /*in_def=*/{"arg0: string"},
+      /*out_def=*/{"ret0: string"},
+      /*attr_def=*/{},
+      /*node_def=*/
+      {FunctionDefHelper::Const("Pos", gtl::ArraySlice<int>({0, 1})),
+       FunctionDefHelper::Const("Len", gtl::ArraySlice<int>({2, 2})),
+       {{"Substr"},
+        "Substr",
+        {"arg0", "Pos:output:0", "Len:output:0"},
+        {{"T", DT_INT32}}}},
+      /*ret_def=*/{{"ret0", "Substr:output:0"}});
+
+  FunctionDefLibrary lib;
+  FunctionDef* vectorized;
+  TF_ASSERT_OK(WrapAndVectorize(inner, &lib, &vectorized));
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+}
+
 }  // namespace
 }  // namespace vectorization_utils
 }  // namespace grappler
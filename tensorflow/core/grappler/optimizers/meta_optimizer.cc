@@ -39,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
@@ -599,6 +600,20 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
   optimization_results_.clear();
 
+  // Reuse the result of a previous optimization of the same item, if any.
+  std::unique_ptr<MetaOptimizerCache> cache;
+  string cache_key;
+  if (!cfg_.meta_optimizer_cache_dir().empty()) {
+    cache = MakeUnique<MetaOptimizerCache>(Env::Default(),
+                                           cfg_.meta_optimizer_cache_dir());
+    cache_key = MetaOptimizerCache::Key(item, cluster, config_proto_);
+    if (cache->Lookup(cache_key, optimized_graph)) {
+      VLOG(1) << "Found optimized graph for grappler item " << item.id
+              << " in the cache (key = " << cache_key << ")";
+      return Status::OK();
+    }
+  }
+
   // Constructs a FunctionLibraryDefinition with functions that are reachable
   // from the nodes of the graph.
   const auto minimized_flib =
@@ -625,6 +640,7 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   bool optimize_function_library =
       item.optimization_options().optimize_function_library;
   const auto producer = item.graph.versions().producer();
+  const string item_id = item.id;
 
   // 1. Optimize main graph
   TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(item), optimized_graph));
@@ -802,6 +818,25 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
                         reinterpret_cast<uintptr_t>(optimized_graph)),
         *optimized_graph);
   }
+  // Only fully optimized graphs are cached: a graph on which some pass failed
+  // or ran out of time would otherwise be served instead of reoptimizing it.
+  bool all_passes_succeeded = true;
+  for (const GraphOptimizationResult& graph_result : optimization_results_) {
+    for (const OptimizerResult& result : graph_result.results) {
+      all_passes_succeeded &= result.status.ok();
+    }
+  }
+  if (cache != nullptr && !all_passes_succeeded) {
+    VLOG(1) << "Not caching the optimized graph for grappler item " << item_id
+            << ": some optimizers failed";
+  }
+  if (cache != nullptr && all_passes_succeeded) {
+    const Status s = cache->Insert(cache_key, *optimized_graph);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to cache the optimized graph for grappler item "
+                   << item_id << ": " << s;
+    }
+  }
   return Status::OK();
 }
 
@@ -0,0 +1,169 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+string FingerprintToHex(const Fprint128& fp) {
+  return strings::Printf("%016llx%016llx",
+                         static_cast<unsigned long long>(fp.high64),
+                         static_cast<unsigned long long>(fp.low64));
+}
+
+// Appends a fingerprint of the deterministic serialization of `proto`.
+void AppendProtoFingerprint(const protobuf::MessageLite& proto, string* key) {
+  string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  absl::StrAppend(key, FingerprintToHex(Fingerprint128(serialized)), ";");
+}
+
+void AppendStrings(const string& name, const std::vector<string>& values,
+                   string* key) {
+  absl::StrAppend(key, name, "=");
+  for (const string& value : values) {
+    absl::StrAppend(key, value.size(), ":", value, ",");
+  }
+  absl::StrAppend(key, ";");
+}
+
+}  // namespace
+
+MetaOptimizerCache::MetaOptimizerCache(Env* env, const string& cache_dir)
+    : env_(env), cache_dir_(cache_dir) {}
+
+string MetaOptimizerCache::Key(const GrapplerItem& item,
+                               const Cluster* cluster,
+                               const ConfigProto& cfg) {
+  // Optimizers differ between versions of TensorFlow.
+  string key = absl::StrCat("version=", tf_git_version(), ",",
+                            TF_GRAPH_DEF_VERSION, ";");
+
+  absl::StrAppend(&key, "graph=");
+  AppendProtoFingerprint(item.graph, &key);
+
+  absl::StrAppend(&key, "feed=");
+  for (const auto& feed : item.feed) {
+    absl::StrAppend(&key, feed.first.size(), ":", feed.first, "/",
+                    DataTypeString(feed.second.dtype()),
+                    feed.second.shape().DebugString(), ",");
+  }
+  absl::StrAppend(&key, ";");
+  AppendStrings("fetch", item.fetch, &key);
+  AppendStrings("init_ops", item.init_ops, &key);
+  AppendStrings("keep_ops", item.keep_ops, &key);
+  AppendStrings("save_restore",
+                {item.save_op, item.restore_op, item.save_restore_loc_tensor},
+                &key);
+  absl::StrAppend(&key, "queue_runners=");
+  for (const QueueRunnerDef& queue_runner : item.queue_runners) {
+    AppendProtoFingerprint(queue_runner, &key);
+  }
+  absl::StrAppend(&key, ";");
+
+  std::vector<string> devices(item.devices().begin(), item.devices().end());
+  std::sort(devices.begin(), devices.end());
+  AppendStrings("devices", devices, &key);
+
+  const GrapplerItem::OptimizationOptions& options =
+      item.optimization_options();
+  absl::StrAppend(&key, "options=",
+                  options.allow_non_differentiable_rewrites, ",",
+                  options.allow_pruning_stateful_and_dataset_ops, ",",
+                  options.optimize_function_library, ",",
+                  options.is_eager_mode, ";");
+
+  // Cost-based optimizers depend on the properties of the cluster devices.
+  absl::StrAppend(&key, "cluster=");
+  if (cluster != nullptr) {
+    const std::map<string, DeviceProperties> sorted_devices(
+        cluster->GetDevices().begin(), cluster->GetDevices().end());
+    for (const auto& device : sorted_devices) {
+      absl::StrAppend(&key, device.first, "/");
+      AppendProtoFingerprint(device.second, &key);
+    }
+  }
+  absl::StrAppend(&key, ";");
+
+  // The cache directory doesn't change the optimized graph, so it is cleared
+  // to avoid cache misses. The timeout is kept: it bounds the optimization
+  // passes that get to run.
+  RewriterConfig rewriter_config = cfg.graph_options().rewrite_options();
+  rewriter_config.clear_meta_optimizer_cache_dir();
+  absl::StrAppend(&key, "rewriter_config=");
+  AppendProtoFingerprint(rewriter_config, &key);
+  absl::StrAppend(&key, "global_jit_level=",
+                  cfg.graph_options().optimizer_options().global_jit_level(),
+                  ";executor_type=", cfg.experimental().executor_type(), ";");
+
+  return FingerprintToHex(Fingerprint128(key));
+}
+
+string MetaOptimizerCache::EntryPath(const string& key) const {
+  return io::JoinPath(cache_dir_, absl::StrCat(key, ".pb"));
+}
+
+bool MetaOptimizerCache::Lookup(const string& key,
+                                GraphDef* optimized_graph) const {
+  const string path = EntryPath(key);
+  if (!env_->FileExists(path).ok()) return false;
+  Status s = ReadBinaryProto(env_, path, optimized_graph);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to read the optimized graph cached in " << path
+                 << ": " << s;
+    optimized_graph->Clear();
+    return false;
+  }
+  return true;
+}
+
+Status MetaOptimizerCache::Insert(const string& key,
+                                  const GraphDef& optimized_graph) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(cache_dir_));
+  // Write to a temporary file first, so that concurrent readers never see a
+  // partially written entry.
+  const string path = EntryPath(key);
+  const string tmp_path =
+      strings::Printf("%s.tmp.%016llx", path.c_str(),
+                      static_cast<unsigned long long>(random::New64()));
+  Status s = WriteBinaryProto(env_, tmp_path, optimized_graph);
+  if (s.ok()) {
+    s = env_->RenameFile(tmp_path, path);
+  }
+  if (!s.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return s;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
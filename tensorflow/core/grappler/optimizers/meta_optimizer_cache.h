@@ -0,0 +1,68 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A content-addressed cache of graphs optimized by the MetaOptimizer, stored
+// as one binary GraphDef per entry in a local directory.
+//
+// Entries are keyed by a fingerprint of everything that determines the result
+// of the optimization: the GrapplerItem (graph, feeds, fetches, nodes to
+// preserve, devices and optimization options), the devices of the cluster, the
+// optimizer configuration (including the timeout) and the version of
+// TensorFlow. This allows identical
+// model loads (e.g. on several replicas of the same model, or after a restart)
+// to skip Grappler altogether.
+//
+// Entries are written atomically, so the same directory can be shared by
+// several processes.
+class MetaOptimizerCache {
+ public:
+  MetaOptimizerCache(Env* env, const string& cache_dir);
+
+  // Returns the cache key for optimizing `item` on `cluster` (which may be
+  // null) with the configuration `cfg`.
+  static string Key(const GrapplerItem& item, const Cluster* cluster,
+                    const ConfigProto& cfg);
+
+  // Looks up the optimized graph for `key`. Returns false if there is no such
+  // entry, or if it can't be read.
+  bool Lookup(const string& key, GraphDef* optimized_graph) const;
+
+  // Stores `optimized_graph` as the entry for `key`.
+  Status Insert(const string& key, const GraphDef& optimized_graph) const;
+
+ private:
+  string EntryPath(const string& key) const;
+
+  Env* const env_;
+  const string cache_dir_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
@@ -0,0 +1,116 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class MetaOptimizerCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+    ASSERT_TRUE(fake_input.NextItem(&item_));
+    config_.mutable_graph_options()
+        ->mutable_rewrite_options()
+        ->set_constant_folding(RewriterConfig::OFF);
+  }
+
+  GrapplerItem item_;
+  ConfigProto config_;
+};
+
+TEST_F(MetaOptimizerCacheTest, KeyIsDeterministic) {
+  GrapplerItem copy = item_;
+  EXPECT_EQ(MetaOptimizerCache::Key(item_, nullptr, config_),
+            MetaOptimizerCache::Key(copy, nullptr, config_));
+}
+
+TEST_F(MetaOptimizerCacheTest, KeyDependsOnInputs) {
+  const string key = MetaOptimizerCache::Key(item_, nullptr, config_);
+
+  GrapplerItem other_graph = item_;
+  other_graph.graph.mutable_node(0)->set_device("/device:CPU:1");
+  EXPECT_NE(key, MetaOptimizerCache::Key(other_graph, nullptr, config_));
+
+  GrapplerItem other_fetch = item_;
+  other_fetch.fetch.push_back(item_.graph.node(0).name());
+  EXPECT_NE(key, MetaOptimizerCache::Key(other_fetch, nullptr, config_));
+
+  GrapplerItem other_options = item_;
+  other_options.optimization_options().allow_non_differentiable_rewrites =
+      false;
+  EXPECT_NE(key, MetaOptimizerCache::Key(other_options, nullptr, config_));
+
+  ConfigProto other_config = config_;
+  other_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_constant_folding(RewriterConfig::ON);
+  EXPECT_NE(key, MetaOptimizerCache::Key(item_, nullptr, other_config));
+}
+
+TEST_F(MetaOptimizerCacheTest, KeyIgnoresCacheDir) {
+  ConfigProto other_config = config_;
+  other_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_meta_optimizer_cache_dir("/some/dir");
+  EXPECT_EQ(MetaOptimizerCache::Key(item_, nullptr, config_),
+            MetaOptimizerCache::Key(item_, nullptr, other_config));
+}
+
+TEST_F(MetaOptimizerCacheTest, KeyDependsOnTimeout) {
+  ConfigProto other_config = config_;
+  other_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_meta_optimizer_timeout_ms(1000);
+  EXPECT_NE(MetaOptimizerCache::Key(item_, nullptr, config_),
+            MetaOptimizerCache::Key(item_, nullptr, other_config));
+}
+
+TEST_F(MetaOptimizerCacheTest, InsertAndLookup) {
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "meta_optimizer_cache_test");
+  int64 undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  MetaOptimizerCache cache(Env::Default(), cache_dir);
+  const string key = MetaOptimizerCache::Key(item_, nullptr, config_);
+
+  GraphDef optimized_graph;
+  EXPECT_FALSE(cache.Lookup(key, &optimized_graph));
+
+  TF_ASSERT_OK(cache.Insert(key, item_.graph));
+  // Another instance sharing the directory sees the entry.
+  MetaOptimizerCache other_cache(Env::Default(), cache_dir);
+  ASSERT_TRUE(other_cache.Lookup(key, &optimized_graph));
+  EXPECT_EQ(item_.graph.DebugString(), optimized_graph.DebugString());
+
+  // Entries are replaced when inserted again.
+  GraphDef empty_graph;
+  TF_ASSERT_OK(cache.Insert(key, empty_graph));
+  ASSERT_TRUE(cache.Lookup(key, &optimized_graph));
+  EXPECT_EQ(0, optimized_graph.node_size());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
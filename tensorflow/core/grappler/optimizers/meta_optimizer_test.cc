@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -234,6 +235,115 @@ TEST_F(MetaOptimizerTest, RunToggleOptimizersAndCustomGraphOptimizerTwice) {
   EXPECT_TRUE(TestGraphOptimizer::IsOptimized());
 }
 
+TEST_F(MetaOptimizerTest, ReusesCachedResult) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("TestOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "meta_optimizer_test_cache");
+  int64 undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  rewriter_config.set_meta_optimizer_cache_dir(cache_dir);
+
+  TestOptimizer::SetOptimized(false);
+  GraphDef output;
+  {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  }
+  EXPECT_TRUE(TestOptimizer::IsOptimized());
+
+  // A new optimizer with the same configuration doesn't run any pass.
+  TestOptimizer::SetOptimized(false);
+  GraphDef cached_output;
+  {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &cached_output));
+  }
+  EXPECT_FALSE(TestOptimizer::IsOptimized());
+  CompareGraphs(output, cached_output);
+
+  // A different graph is optimized again.
+  item.graph.mutable_node(0)->set_device("/device:CPU:1");
+  {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &cached_output));
+  }
+  EXPECT_TRUE(TestOptimizer::IsOptimized());
+}
+
+class FailingOptimizer : public CustomGraphOptimizer {
+ public:
+  static void ResetNumRuns() { num_runs_ = 0; }
+  static int NumRuns() { return num_runs_; }
+
+  FailingOptimizer() {}
+  string name() const override { return "failing_optimizer"; }
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(const tensorflow::RewriterConfig_CustomGraphOptimizer* config =
+                  nullptr) override {
+    return Status::OK();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override {
+    ++num_runs_;
+    return errors::Internal("FailingOptimizer failed");
+  }
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  static int num_runs_;
+};
+
+int FailingOptimizer::num_runs_;
+
+REGISTER_GRAPH_OPTIMIZER(FailingOptimizer);
+
+TEST_F(MetaOptimizerTest, DoesNotCacheResultOfFailedOptimizers) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("FailingOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::ONE);
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "meta_optimizer_test_failed_cache");
+  int64 undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  rewriter_config.set_meta_optimizer_cache_dir(cache_dir);
+
+  FailingOptimizer::ResetNumRuns();
+  GraphDef output;
+  for (int i = 0; i < 2; ++i) {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  }
+  // The failed optimization isn't served from the cache the second time.
+  EXPECT_EQ(2, FailingOptimizer::NumRuns());
+  std::vector<string> entries;
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(cache_dir));
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &entries));
+  EXPECT_TRUE(entries.empty());
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   using test::function::NDef;
 
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
@@ -65,14 +66,17 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
     return errors::Aborted("Nothing to do.");
   }
 
-  *optimized_graph = item.graph;
-  GraphProperties properties(item);
+  // The properties are inferred on the graph being optimized, so that they can
+  // be updated after the first rewrite.
+  GrapplerItem optimized_item = item.WithGraph(GraphDef(item.graph));
+  GraphProperties properties(optimized_item);
   bool inferred_properties = false;
+  absl::flat_hash_set<string> rewritten_nodes;
   {
-    MutableGraphView graph(optimized_graph);
+    MutableGraphView graph(&optimized_item.graph);
     // The product of all the dimensions in a tensor shape can be expressed more
     // simply as the size of the tensor.
-    for (auto& node : *optimized_graph->mutable_node()) {
+    for (auto& node : *optimized_item.graph.mutable_node()) {
       if (!IsShape(node)) {
         continue;
       }
@@ -134,13 +138,20 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
           }
 
           fanout.node->Swap(&size_node);
+          rewritten_nodes.insert(fanout.node->name());
         }
       }
     }
   }
+  if (inferred_properties && !rewritten_nodes.empty()) {
+    // The Size nodes have different inputs than the Prod nodes they replace:
+    // update their properties, and the ones of their fanout, before using them
+    // below.
+    TF_RETURN_IF_ERROR(properties.UpdateStatically(rewritten_nodes));
+  }
   {
-    MutableGraphView graph(optimized_graph);
-    for (auto& node : *optimized_graph->mutable_node()) {
+    MutableGraphView graph(&optimized_item.graph);
+    for (auto& node : *optimized_item.graph.mutable_node()) {
       // Try to convert the ratio of 2 symbolic tensor sizes into a constant.
       // This is possible whenever the symbolic dimensions in the numerator and
       // denominator cancel each other.
@@ -189,6 +200,7 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       }
     }
   }
+  *optimized_graph = std::move(optimized_item.graph);
   return Status::OK();
 }
 
@@ -161,6 +161,46 @@ TEST_F(ShapeOptimizerTest, OptimizeShapeRatio) {
               tensors_actual[0].scalar<int>()(), 0);
 }
 
+TEST_F(ShapeOptimizerTest, OptimizeShapeRatioOfShapeProduct) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output a = ops::Const(s.WithOpName("a"), 3.14f, {32, 32});
+  Output b = ops::Const(s.WithOpName("b"), 3.14f, {32, 16});
+  Output c = ops::Shape(s.WithOpName("c"), a);
+  Output d = ops::Const(s.WithOpName("d"), 0, {1});
+  ops::ReduceProd::Attrs attrs;
+  Output e = ops::ReduceProd(s.WithOpName("e"), c, d, attrs.KeepDims(false));
+  Output f = ops::Size(s.WithOpName("f"), b);
+  Output g = ops::Div(s.WithOpName("g"), e, f);
+
+  GrapplerItem item;
+  item.fetch = {"g"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+
+  GraphDef output;
+  ShapeOptimizer optimizer;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The properties of the Size node replacing the Prod are updated, which
+  // allows folding the ratio.
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "e") {
+      found++;
+      EXPECT_EQ("Size", node.op());
+    } else if (node.name() == "g") {
+      found++;
+      EXPECT_EQ("Const", node.op());
+    }
+  }
+  EXPECT_EQ(2, found);
+
+  auto tensors_actual = EvaluateNodes(output, item.fetch);
+  EXPECT_NEAR(tensors_expected[0].scalar<int>()(),
+              tensors_actual[0].scalar<int>()(), 0);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -145,6 +145,78 @@ REGISTER_KERNEL_BUILDER(Name("CollectiveGather").Device(DEVICE_CPU),
 REGISTER_KERNEL_BUILDER(Name("CollectiveGather").Device(DEVICE_GPU),
                         CollectiveGatherOpKernel);
 
+class CollectiveAllToAllOpKernel : public CollectiveOpKernel {
+ public:
+  explicit CollectiveAllToAllOpKernel(OpKernelConstruction* c)
+      : CollectiveOpKernel(c) {
+    col_params_.instance.type = ALL_TO_ALL_COLLECTIVE;
+    OP_REQUIRES_OK(c, c->GetAttr("group_size", &col_params_.group.group_size));
+    OP_REQUIRES(
+        c, col_params_.group.group_size > 0,
+        errors::InvalidArgument("group_size must be positive integer but got ",
+                                col_params_.group.group_size));
+    OP_REQUIRES_OK(c, c->GetAttr("group_key", &col_params_.group.group_key));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("instance_key", &col_params_.instance.instance_key));
+    OP_REQUIRES_OK(c, c->GetAttr("T", &col_params_.instance.data_type));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("communication_hint",
+                      &col_params_.instance.impl_details.communication_hint));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("timeout_seconds",
+                      &col_params_.instance.impl_details.timeout_seconds));
+    const NodeDef& real_node = c->def();
+    col_params_.name = strings::StrCat(real_node.name(), ": AllToAll");
+    col_params_.group.device_type = c->device_type();
+  }
+
+  void ComputeAsync(OpKernelContext* c, DoneCallback done) override {
+    CollectiveExecutor* col_exec = c->collective_executor();
+    OP_REQUIRES_ASYNC(
+        c, col_exec,
+        errors::Internal(
+            "Failed to get CollectiveExecutor from OpKernelContext for Op ",
+            col_params_.name),
+        done);
+    OP_REQUIRES_ASYNC(
+        c, c->input(0).dims() >= 1,
+        errors::InvalidArgument("input of ", col_params_.name,
+                                " must have at least one dimension"),
+        done);
+
+    // The number of rows each member sends differs, so the shape which must
+    // agree across the group is that of a single row.  The outputs are
+    // allocated by the implementation once it has received the split sizes
+    // of all members; this is safe as the op only runs on CPU.
+    TensorShape row_shape = c->input(0).shape();
+    row_shape.RemoveDim(0);
+    col_params_.instance.shape = row_shape;
+    if (!CanProceedWithCompute(c, col_exec, done)) return;
+
+    auto actual_done = [c, group_key = col_params_.group.group_key,
+                        instance_key = col_params_.instance.instance_key,
+                        done](const Status& s) {
+      VLOG(1) << "CollectiveAllToAllOpKernel ExecuteAsync done for collective "
+              << c->op_kernel().name() << " device " << c->device()->name()
+              << " group " << group_key << " instance " << instance_key
+              << " status " << s;
+      OP_REQUIRES_OK_ASYNC(c, s, done);
+      done();
+    };
+    VLOG(1) << "CollectiveAllToAllOpKernel ExecuteAsync start for collective "
+            << col_params_.name << " device " << c->device()->name()
+            << " group " << col_params_.group.group_key << " instance "
+            << col_params_.instance.instance_key;
+    col_exec->ExecuteAsync(c, col_params_, GetCollectiveKey(c), actual_done);
+  }
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(CollectiveAllToAllOpKernel);
+};
+
+REGISTER_KERNEL_BUILDER(Name("CollectiveAllToAll").Device(DEVICE_CPU),
+                        CollectiveAllToAllOpKernel);
+
 class CollectiveReduceOpKernel : public CollectiveOpKernel {
  public:
   explicit CollectiveReduceOpKernel(OpKernelConstruction* c)
@@ -182,11 +254,39 @@ class CollectiveReduceOpKernel : public CollectiveOpKernel {
     OP_REQUIRES_OK(
         c, c->GetAttr("timeout_seconds",
                       &col_params_.instance.impl_details.timeout_seconds));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("compression",
+                      &col_params_.instance.impl_details.compression));
+    OP_REQUIRES_OK(
+        c, c->GetAttr(
+               "compression_topk_ratio",
+               &col_params_.instance.impl_details.compression_topk_ratio));
+    OP_REQUIRES_OK(c, c->GetAttr("bucket_key",
+                                 &col_params_.instance.impl_details.bucket_key));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("bucket_size",
+                      &col_params_.instance.impl_details.bucket_size));
+    OP_REQUIRES(c, col_params_.instance.impl_details.bucket_size > 0,
+                errors::InvalidArgument(
+                    "bucket_size must be positive integer but got ",
+                    col_params_.instance.impl_details.bucket_size));
+    // The inputs of a bucket are fused by the executor outside of the
+    // executor thread, which is only safe for CPU memory.
+    OP_REQUIRES(c,
+                col_params_.instance.impl_details.bucket_size == 1 ||
+                    c->device_type() == DEVICE_CPU,
+                errors::Unimplemented(
+                    "bucket_size > 1 is only implemented for CPU devices, got ",
+                    c->device_type().type_string()));
     VLOG(2) << "CollectiveReduce instance " << col_params_.instance.instance_key
             << " merge_op " << merge_op_name << " final_op " << final_op_name
             << " communication_hint "
             << col_params_.instance.impl_details.communication_hint
-            << " timeout " << col_params_.instance.impl_details.timeout_seconds;
+            << " timeout " << col_params_.instance.impl_details.timeout_seconds
+            << " compression "
+            << col_params_.instance.impl_details.compression << " bucket "
+            << col_params_.instance.impl_details.bucket_key << " of size "
+            << col_params_.instance.impl_details.bucket_size;
 
     const NodeDef& real_node = c->def();
     col_params_.name = strings::StrCat(real_node.name(), ": Reduce(",
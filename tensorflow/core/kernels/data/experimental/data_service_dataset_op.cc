@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/experimental/data_service_dataset_op.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <queue>
@@ -23,6 +24,8 @@ limitations under the License.
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/service/data_service.h"
+#include "tensorflow/core/data/service/element_batch.h"
+#include "tensorflow/core/data/service/task_order.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
@@ -35,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
@@ -53,6 +57,12 @@ namespace data {
     DataServiceDatasetOp::kMaxOutstandingRequests;
 /* static */ constexpr const char* const
     DataServiceDatasetOp::kIterationCounter;
+/* static */ constexpr const char* const
+    DataServiceDatasetOp::kElementsPerRequest;
+/* static */ constexpr const char* const
+    DataServiceDatasetOp::kRequestsPerTask;
+/* static */ constexpr const char* const
+    DataServiceDatasetOp::kBatchCompression;
 /* static */ constexpr const char* const DataServiceDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const DataServiceDatasetOp::kOutputShapes;
 
@@ -70,13 +80,16 @@ const int64 kDefaultTaskRefreshIntervalMs = 1000;  // 1 second.
 //
 // This dataset interleaves dataset elements produced by multiple tf.data
 // workers. We periodically query the tf.data master to determine which workers
-// to read from (in case workers are added or removed).
+// to read from (in case workers are added or removed), and in which order to
+// prefer them.
 class DataServiceDatasetOp::Dataset : public DatasetBase {
  public:
   Dataset(OpKernelContext* ctx, int64 dataset_id,
           ProcessingMode processing_mode, const std::string& address,
           const std::string& protocol, const std::string& job_name,
           int64 max_outstanding_requests, int64 task_refresh_interval_ms,
+          int64 elements_per_request, int64 requests_per_task,
+          BatchCompression batch_compression,
           IterationCounter* iteration_counter, bool owns_resource,
           ResourceHandle iteration_counter_handle,
           const DataTypeVector& output_types,
@@ -89,6 +102,9 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         job_name_(job_name),
         max_outstanding_requests_(max_outstanding_requests),
         task_refresh_interval_ms_(task_refresh_interval_ms),
+        elements_per_request_(elements_per_request),
+        requests_per_task_(requests_per_task),
+        batch_compression_(batch_compression),
         iteration_counter_(iteration_counter),
         owns_resource_(owns_resource),
         iteration_counter_handle_(iteration_counter_handle),
@@ -164,13 +180,24 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
     AttrValue task_refresh_interval_hint_ms;
     b->BuildAttrValue(task_refresh_interval_ms_,
                       &task_refresh_interval_hint_ms);
+    AttrValue elements_per_request;
+    b->BuildAttrValue(elements_per_request_, &elements_per_request);
+    AttrValue requests_per_task;
+    b->BuildAttrValue(requests_per_task_, &requests_per_task);
+    AttrValue batch_compression;
+    b->BuildAttrValue(BatchCompressionToString(batch_compression_),
+                      &batch_compression);
 
     TF_RETURN_IF_ERROR(
         b->AddDataset(this,
                       {dataset_id, processing_mode, address, protocol, job_name,
                        max_outstanding_requests, iteration_counter_handle},
                       {std::make_pair(kTaskRefreshIntervalHintMs,
-                                      task_refresh_interval_hint_ms)},
+                                      task_refresh_interval_hint_ms),
+                       std::make_pair(kElementsPerRequest,
+                                      elements_per_request),
+                       std::make_pair(kRequestsPerTask, requests_per_task),
+                       std::make_pair(kBatchCompression, batch_compression)},
                       output));
     return Status::OK();
   }
@@ -181,6 +208,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
     explicit Iterator(const Params& params, int64 iterator_index)
         : DatasetIterator<Dataset>(params),
           iterator_index_(iterator_index),
+          consumer_host_(port::Hostname()),
           max_outstanding_requests_(params.dataset->max_outstanding_requests_) {
     }
 
@@ -275,8 +303,11 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       const std::string address;
       // Client for fetching task elements from the tf.data service worker.
       const std::unique_ptr<DataServiceWorkerClient> worker;
-      // Indicates whether a worker thread is currently processing the task.
-      bool in_use TF_GUARDED_BY(&Iterator::mu_) = false;
+      // Number of worker threads currently requesting elements for the task.
+      int64 outstanding_requests TF_GUARDED_BY(&Iterator::mu_) = 0;
+      // Indicates whether the master reported the task's worker as a
+      // straggler.
+      bool straggler TF_GUARDED_BY(&Iterator::mu_) = false;
       // Indicates whether the worker has returned end_of_sequence for the task.
       bool end_of_sequence TF_GUARDED_BY(&Iterator::mu_) = false;
     };
@@ -316,15 +347,19 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       VLOG(3) << "Updating tasks";
       std::vector<TaskInfo> tasks;
       bool job_finished;
-      Status s = master->GetTasks(job_id_, &tasks, &job_finished);
+      Status s =
+          master->GetTasks(job_id_, consumer_host_, &tasks, &job_finished);
       if (!s.ok()) {
         LOG(WARNING) << "Failed to get task info for job id " << job_id_ << ": "
                      << s;
         return;
       }
       absl::flat_hash_map<int64, TaskInfo> task_id_to_task;
-      for (auto& task : tasks) {
-        task_id_to_task[task.id()] = task;
+      // Positions of the tasks in the master's order of preference.
+      absl::flat_hash_map<int64, int64> task_order;
+      for (int i = 0; i < tasks.size(); ++i) {
+        task_id_to_task[tasks[i].id()] = tasks[i];
+        task_order[tasks[i].id()] = i;
       }
       mutex_lock l(mu_);
       job_finished_ = job_finished;
@@ -360,9 +395,21 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         tasks_.push_back(std::make_shared<Task>(
             task_info.id(), task_info.worker_address(), std::move(worker)));
       }
+      // Keep `tasks_` in the master's order of preference, which favors
+      // workers on this host and less loaded workers within each round of
+      // requests.
+      for (std::shared_ptr<Task>& task : tasks_) {
+        task->straggler = tasks[task_order[task->task_id]].straggler();
+      }
+      std::sort(tasks_.begin(), tasks_.end(),
+                [&task_order](const std::shared_ptr<Task>& lhs,
+                              const std::shared_ptr<Task>& rhs) {
+                  return task_order[lhs->task_id] < task_order[rhs->task_id];
+                });
       if (dataset()->max_outstanding_requests_ == model::kAutotune) {
         // Adjust max_outstanding_requests to account for newly added tasks.
-        max_outstanding_requests_ = tasks_.size();
+        max_outstanding_requests_ =
+            tasks_.size() * dataset()->requests_per_task_;
       }
     }
 
@@ -392,7 +439,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         {
           mutex_lock l(mu_);
           if (task_to_process) {
-            task_to_process->in_use = false;
+            task_to_process->outstanding_requests--;
             task_to_process = nullptr;
             worker_thread_cv_.notify_one();
           }
@@ -412,19 +459,16 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
             return;
           }
           outstanding_requests_++;
-          // Search for a task to update.
-          int num_tasks = tasks_.size();
-          for (int i = 0; i < num_tasks; ++i) {
-            int index = (next_task_index_ + i) % num_tasks;
-            std::shared_ptr<Task>& task = tasks_[index];
-            if (!task->in_use && !task->end_of_sequence) {
-              task->in_use = true;
-              task_to_process = task;
-              next_task_index_ = (index + 1) % num_tasks;
-              break;
-            }
+          // Go round robin over the tasks which can take a request, so that
+          // remote tasks are read from even when few requests are allowed.
+          std::vector<bool> can_request(tasks_.size());
+          for (int i = 0; i < tasks_.size(); ++i) {
+            can_request[i] = CanRequest(*tasks_[i]);
           }
-          DCHECK(task_to_process != nullptr);
+          const int64 index = PickTask(can_request, &next_task_index_);
+          DCHECK_GE(index, 0);
+          task_to_process = tasks_[index];
+          task_to_process->outstanding_requests++;
           VLOG(3) << "Processing task " << task_to_process->task_id;
         }
         int64 deadline_micros =
@@ -439,21 +483,21 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       }
     }
 
-    // Gets an element from a task and adds the element to `results_`.
+    // Gets up to `elements_per_request` elements from a task and adds the
+    // elements to `results_`.
     //
     // If the task reaches end_of_sequence or is cancelled (e.g. due to a
     // worker dying), GetElement returns Status::OK() without adding to
-    // `results_`.
+    // `results_` the elements it didn't receive.
     Status GetElement(Task* task, int64 deadline_micros)
         TF_LOCKS_EXCLUDED(mu_) {
       VLOG(3) << "Getting an element for task id " << task->task_id;
       tensorflow::profiler::TraceMe activity(
           "GetDataServiceElement", tensorflow::profiler::TraceMeLevel::kInfo);
-      CompressedElement compressed;
+      std::vector<std::vector<Tensor>> elements;
       bool end_of_sequence;
       for (int num_retries = 0;; ++num_retries) {
-        Status s = task->worker->GetElement(task->task_id, &compressed,
-                                            &end_of_sequence);
+        Status s = FetchElements(task, &elements, &end_of_sequence);
         if (s.ok()) {
           break;
         }
@@ -461,8 +505,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
           // This indicates that the worker was restarted. The restarted worker
           // will get a new task, and the old task is lost.
           mutex_lock l(mu_);
-          finished_tasks_++;
-          task->end_of_sequence = true;
+          FinishTask(task);
           return Status::OK();
         }
         // Retry all errors that could indicate preemption.
@@ -494,34 +537,81 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         Env::Default()->SleepForMicroseconds(backoff_until - now_micros);
       }
 
-      std::vector<Tensor> element;
-      if (!end_of_sequence) {
+      mutex_lock l(mu_);
+      for (std::vector<Tensor>& element : elements) {
+        results_.push(std::move(element));
+      }
+      if (!elements.empty()) {
+        get_next_cv_.notify_all();
+        VLOG(3) << "Got " << elements.size()
+                << " elements for task id " << task->task_id;
+      }
+      if (end_of_sequence) {
+        FinishTask(task);
+      }
+      return Status::OK();
+    }
+
+    // Requests elements from the worker of `task`, fetching a batch of
+    // elements if `elements_per_request` is greater than 1.
+    Status FetchElements(Task* task,
+                         std::vector<std::vector<Tensor>>* elements,
+                         bool* end_of_sequence) TF_LOCKS_EXCLUDED(mu_) {
+      if (dataset()->elements_per_request_ > 1) {
+        return task->worker->GetElements(
+            task->task_id, dataset()->elements_per_request_,
+            dataset()->batch_compression_, elements, end_of_sequence);
+      }
+      elements->clear();
+      CompressedElement compressed;
+      TF_RETURN_IF_ERROR(
+          task->worker->GetElement(task->task_id, &compressed, end_of_sequence));
+      if (!*end_of_sequence) {
         Tensor tensor(DT_VARIANT, TensorShape{});
         tensor.scalar<Variant>()() = std::move(compressed);
-        element.push_back(tensor);
+        elements->push_back({std::move(tensor)});
       }
-      mutex_lock l(mu_);
-      if (end_of_sequence) {
+      return Status::OK();
+    }
+
+    // Marks `task` as finished. Several outstanding requests for the task may
+    // find that it is finished.
+    void FinishTask(Task* task) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!task->end_of_sequence) {
         task->end_of_sequence = true;
         finished_tasks_++;
-        return Status::OK();
       }
-      results_.push(std::move(element));
-      get_next_cv_.notify_all();
-      VLOG(3) << "Got an element for task id " << task->task_id;
-      return Status::OK();
     }
 
     bool SpaceInBuffer() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-      return results_.size() + outstanding_requests_ <
-             max_outstanding_requests_;
+      // Leaves room for all the elements of a new request.
+      const int64 elements_per_request = dataset()->elements_per_request_;
+      return results_.size() +
+                 (outstanding_requests_ + 1) * elements_per_request <=
+             max_outstanding_requests_ * elements_per_request;
     }
 
     bool TaskAvailable() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-      return finished_tasks_ + outstanding_requests_ < tasks_.size();
+      for (const std::shared_ptr<Task>& task : tasks_) {
+        if (CanRequest(*task)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Returns whether a new request may be sent for `task`. Requests to
+    // straggler workers aren't pipelined, so that the other workers serve the
+    // additional requests.
+    bool CanRequest(const Task& task) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 max_requests =
+          task.straggler ? 1 : dataset()->requests_per_task_;
+      return !task.end_of_sequence && task.outstanding_requests < max_requests;
     }
 
     const int64 iterator_index_;
+    // Host of this consumer, used by the master to prefer local workers.
+    const std::string consumer_host_;
 
     mutex mu_;
     condition_variable get_next_cv_ TF_GUARDED_BY(mu_);
@@ -531,21 +621,21 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
 
     int64 outstanding_requests_ TF_GUARDED_BY(mu_) = 0;
     // max_outstanding_requests controls how many elements may be held in memory
-    // at the same time. This count includes both in-progress requests for
-    // elements as well as completed requests which haven't yet been produced.
+    // at the same time, in units of `elements_per_request` elements. This count
+    // includes both in-progress requests for elements as well as completed
+    // requests which haven't yet been produced.
     int64 max_outstanding_requests_ TF_GUARDED_BY(mu_);
 
     // The number of threads in `worker_threads_` which are still running.
     int64 num_running_worker_threads_ TF_GUARDED_BY(mu_) = 0;
 
-    // The index of the next task in `tasks_` to read from.
-    int64 next_task_index_ TF_GUARDED_BY(mu_) = 0;
-
     // The number tasks in the `tasks_` list that have reached end_of_sequence.
     int64 finished_tasks_ TF_GUARDED_BY(mu_) = 0;
 
-    // List of tasks to read from.
+    // List of tasks to read from, in order of preference.
     std::vector<std::shared_ptr<Task>> tasks_ TF_GUARDED_BY(mu_);
+    // Index in `tasks_` of the next task to consider for a request.
+    int64 next_task_index_ TF_GUARDED_BY(mu_) = 0;
 
     // A status to be returned from the next call to `GetNext`. This is set by
     // asynchronous threads when they encounter errors.
@@ -571,6 +661,9 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
   const tstring job_name_;
   const int64 max_outstanding_requests_;
   const int64 task_refresh_interval_ms_;
+  const int64 elements_per_request_;
+  const int64 requests_per_task_;
+  const BatchCompression batch_compression_;
   IterationCounter* const iteration_counter_;  // Owned
   const bool owns_resource_;
   const ResourceHandle iteration_counter_handle_;
@@ -586,6 +679,21 @@ DataServiceDatasetOp::DataServiceDatasetOp(OpKernelConstruction* ctx)
   if (task_refresh_interval_hint_ms_ == model::kAutotune) {
     task_refresh_interval_hint_ms_ = kDefaultTaskRefreshIntervalMs;
   }
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr(kElementsPerRequest, &elements_per_request_));
+  OP_REQUIRES(ctx, elements_per_request_ > 0,
+              errors::InvalidArgument(kElementsPerRequest,
+                                      " must be positive, got ",
+                                      elements_per_request_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kRequestsPerTask, &requests_per_task_));
+  OP_REQUIRES(ctx, requests_per_task_ > 0,
+              errors::InvalidArgument(kRequestsPerTask,
+                                      " must be positive, got ",
+                                      requests_per_task_));
+  std::string batch_compression;
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kBatchCompression, &batch_compression));
+  OP_REQUIRES_OK(ctx,
+                 ParseBatchCompression(batch_compression, &batch_compression_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
 }
@@ -657,6 +765,7 @@ void DataServiceDatasetOp::MakeDataset(OpKernelContext* ctx,
   *output =
       new Dataset(ctx, dataset_id, processing_mode, address, protocol, job_name,
                   max_outstanding_requests, task_refresh_interval_hint_ms_,
+                  elements_per_request_, requests_per_task_, batch_compression_,
                   iteration_counter, owns_resource, iteration_counter_handle,
                   output_types_, output_shapes_);
 }
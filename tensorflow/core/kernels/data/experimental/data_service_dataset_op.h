@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_DATA_SERVICE_DATASET_OP_H_
 
 #include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 
@@ -57,6 +58,10 @@ class DataServiceDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kTaskRefreshIntervalHintMs =
       "task_refresh_interval_hint_ms";
   static constexpr const char* const kIterationCounter = "iteration_counter";
+  static constexpr const char* const kElementsPerRequest =
+      "elements_per_request";
+  static constexpr const char* const kRequestsPerTask = "requests_per_task";
+  static constexpr const char* const kBatchCompression = "batch_compression";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
 
@@ -69,6 +74,9 @@ class DataServiceDatasetOp : public DatasetOpKernel {
   class Dataset;
 
   int64 task_refresh_interval_hint_ms_;
+  int64 elements_per_request_;
+  int64 requests_per_task_;
+  BatchCompression batch_compression_;
   DataTypeVector output_types_;
   std::vector<PartialTensorShape> output_shapes_;
 };
@@ -32,6 +32,10 @@ REGISTER_OP("CollectiveReduce")
     .Attr("wait_for: list(int) = []")
     .Attr("communication_hint: string = 'auto'")
     .Attr("timeout_seconds: float = 0")
+    .Attr("compression: {'none', 'float16', 'bfloat16', 'topk'} = 'none'")
+    .Attr("compression_topk_ratio: float = 0.01")
+    .Attr("bucket_key: int = 0")
+    .Attr("bucket_size: int = 1")
     .SetIsStateful()
     .SetShapeFn(shape_inference::UnchangedShape);
 
@@ -79,6 +83,42 @@ REGISTER_OP("CollectiveGather")
       return Status::OK();
     });
 
+REGISTER_OP("CollectiveAllToAll")
+    .Input("input: T")
+    .Input("split_sizes: int32")
+    .Output("data: T")
+    .Output("recv_split_sizes: int32")
+    .Attr("T: {float, float16, float64, int32, int64}")
+    .Attr("group_size: int")
+    .Attr("group_key: int")
+    .Attr("instance_key: int")
+    .Attr("communication_hint: string = 'auto'")
+    .Attr("timeout_seconds: float = 0")
+    .SetIsStateful()
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      // Scalar input is not supported.
+      shape_inference::ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &unused));
+      int group_size;
+      TF_RETURN_IF_ERROR(c->GetAttr("group_size", &group_size));
+      shape_inference::ShapeHandle split_sizes;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &split_sizes));
+      shape_inference::DimensionHandle unused_dim;
+      TF_RETURN_IF_ERROR(
+          c->WithValue(c->Dim(split_sizes, 0), group_size, &unused_dim));
+
+      // The number of rows received is only known at run time.
+      shape_inference::ShapeHandle in_subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(c->input(0), 1, &in_subshape));
+      shape_inference::ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(shape_inference::InferenceContext::kUnknownDim),
+          in_subshape, &out));
+      c->set_output(0, out);
+      c->set_output(1, c->Vector(group_size));
+      return Status::OK();
+    });
+
 REGISTER_OP("CollectiveBcastSend")
     .Input("input: T")
     .Output("data: T")
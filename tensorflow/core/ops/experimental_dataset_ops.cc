@@ -1114,6 +1114,9 @@ REGISTER_OP("DataServiceDataset")
     .Input("iteration_counter: resource")
     .Output("handle: variant")
     .Attr("task_refresh_interval_hint_ms: int = -1")
+    .Attr("elements_per_request: int = 1")
+    .Attr("requests_per_task: int = 1")
+    .Attr("batch_compression: string = ''")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .SetIsStateful()
@@ -31,14 +31,17 @@ constexpr int32_t kNodeNotAssigned = std::numeric_limits<int32_t>::max();
 ArenaPlanner::ArenaPlanner(TfLiteContext* context,
                            std::unique_ptr<GraphInfo> graph_info,
                            bool preserve_inputs, bool preserve_intermediates,
-                           int tensor_alignment)
+                           int tensor_alignment, int plan_cache_size,
+                           ArenaPlanningStrategy strategy)
     : context_(context),
       graph_info_(std::move(graph_info)),
       arena_(kDefaultArenaAlignment),
       persistent_arena_(kDefaultArenaAlignment),
       preserve_inputs_(preserve_inputs),
       preserve_intermediates_(preserve_intermediates),
-      tensor_alignment_(tensor_alignment) {}
+      tensor_alignment_(tensor_alignment),
+      plan_cache_size_(plan_cache_size),
+      strategy_(strategy) {}
 
 ArenaPlanner::~ArenaPlanner() {}
 
@@ -62,7 +65,7 @@ TfLiteStatus ArenaPlanner::ResetAllocations() {
 
 TfLiteStatus ArenaPlanner::ResetAllocationsAfter(int node) {
   for (int i = 0; i < static_cast<int>(allocs_.size()); ++i) {
-    if (allocs_[i].first_node > node && allocs_[i].size > 0) {
+    if (alloc_node_[i] > node && allocs_[i].size > 0) {
       TfLiteTensor& tensor = *graph_info_->tensor(i);
       if (tensor.allocation_type == kTfLiteArenaRw) {
         TF_LITE_ENSURE_STATUS(arena_.Deallocate(context_, allocs_[i]));
@@ -78,6 +81,7 @@ TfLiteStatus ArenaPlanner::ResetAllocationsAfter(int node) {
 TfLiteStatus ArenaPlanner::PlanAllocations() {
   // Invalidate any existing data.
   TF_LITE_ENSURE_STATUS(ResetAllocations());
+  plan_cache_.clear();
   // Maybe other verb instead of 'Assigned'
   alloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
   dealloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
@@ -208,8 +212,18 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
       dealloc_node_[tensor_index] = i;
     }
   }
-
-  TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  CalculateLastUseSteps();
+
+  if (plan_cache_size_ > 0 && first_node == 0 &&
+      static_cast<size_t>(last_node) + 1 >= graph_info_->num_nodes()) {
+    std::vector<size_t> key = PlanCacheKey();
+    if (!RestoreCachedPlan(key)) {
+      TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+      CachePlan(std::move(key));
+    }
+  } else {
+    TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  }
   TF_LITE_ENSURE_STATUS(Commit());
 
   for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
@@ -253,15 +267,43 @@ bool ArenaPlanner::HasNonPersistentMemory() {
   return arena_.GetBufferSize() != 0;
 }
 
+size_t ArenaPlanner::RequiredBytes(TfLiteAllocationType type) {
+  if (type == kTfLiteArenaRw) {
+    return arena_.GetHighWaterMark();
+  }
+  if (type == kTfLiteArenaRwPersistent) {
+    return persistent_arena_.GetHighWaterMark();
+  }
+  return 0;
+}
+
 TfLiteStatus ArenaPlanner::Commit() {
   TF_LITE_ENSURE_STATUS(arena_.Commit(context_));
   TF_LITE_ENSURE_STATUS(persistent_arena_.Commit(context_));
   return kTfLiteOk;
 }
 
-std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(int first_node,
-                                                                int last_node) {
-  auto tensor_compare = [this](int idx1, int idx2) {
+std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(
+    int first_node, int last_node, ArenaPlanningStrategy strategy) {
+  std::vector<int32_t> tensor_order;
+  for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
+    if (alloc_node_[i] >= first_node && alloc_node_[i] <= last_node) {
+      tensor_order.push_back(i);
+    }
+  }
+
+  // The widest step of each tensor, indexed by tensor.
+  std::vector<std::pair<size_t, int32_t>> widest_steps;
+  if (strategy == ArenaPlanningStrategy::kGreedyByBreadth) {
+    const std::vector<std::pair<size_t, int32_t>> tensor_widest_steps =
+        WidestSteps(tensor_order);
+    widest_steps.resize(graph_info_->num_tensors());
+    for (size_t i = 0; i < tensor_order.size(); ++i) {
+      widest_steps[tensor_order[i]] = tensor_widest_steps[i];
+    }
+  }
+
+  auto tensor_compare = [this, &widest_steps](int idx1, int idx2) {
     // Tensors that have lifespan through the whole model inference time are
     // allocated at the beginning of memory slice. Their respective order
     // doesn't matter in fact, so here they are sorted by index.
@@ -278,6 +320,19 @@ std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(int first_node,
       return false;
     }
 
+    // With kGreedyByBreadth, tensors allocated at the widest steps go first,
+    // and tensors of the same step are sorted by size.
+    if (!widest_steps.empty()) {
+      const auto& step1 = widest_steps[idx1];
+      const auto& step2 = widest_steps[idx2];
+      if (step1.first != step2.first) {
+        return step1.first > step2.first;
+      }
+      if (step1.second != step2.second) {
+        return step1.second < step2.second;
+      }
+    }
+
     // All other tensors are sorted in non-increasing order of their size.
     auto size1 = this->graph_info_->tensor(idx1)->bytes;
     auto size2 = this->graph_info_->tensor(idx2)->bytes;
@@ -288,22 +343,101 @@ std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(int first_node,
     return this->alloc_node_[idx1] < this->alloc_node_[idx2];
   };
 
-  std::vector<int32_t> tensor_order;
-  for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
-    if (alloc_node_[i] >= first_node && alloc_node_[i] <= last_node) {
-      tensor_order.push_back(i);
-    }
-  }
   // Indices of tensors in order their allocation offsets will be calculated.
   std::sort(tensor_order.begin(), tensor_order.end(), tensor_compare);
 
   return tensor_order;
 }
 
+std::vector<std::pair<size_t, int32_t>> ArenaPlanner::WidestSteps(
+    const std::vector<int32_t>& tensors) const {
+  int32_t last_step = 0;
+  for (int i = 0; i < static_cast<int>(graph_info_->num_nodes()); ++i) {
+    last_step = std::max(last_step, ExecutionStep(i));
+  }
+  // The steps at which each tensor is allocated. Tensors that are never
+  // deallocated are allocated until the last step.
+  std::vector<std::pair<int32_t, int32_t>> intervals;
+  intervals.reserve(tensors.size());
+  for (int32_t tensor_index : tensors) {
+    const int32_t first_step =
+        std::min(ExecutionStep(alloc_node_[tensor_index]), last_step);
+    intervals.emplace_back(
+        first_step,
+        std::max(first_step,
+                 std::min(LastAllocatedStep(tensor_index), last_step)));
+  }
+
+  // Breadth of each step, computed from the variations between steps.
+  std::vector<int64_t> breadth_delta(last_step + 2, 0);
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const TfLiteTensor& tensor = *graph_info_->tensor(tensors[i]);
+    if (tensor.allocation_type != kTfLiteArenaRw) continue;
+    breadth_delta[intervals[i].first] += tensor.bytes;
+    breadth_delta[intervals[i].second + 1] -= tensor.bytes;
+  }
+  std::vector<size_t> breadth(last_step + 1);
+  int64_t current_breadth = 0;
+  for (int32_t step = 0; step <= last_step; ++step) {
+    current_breadth += breadth_delta[step];
+    breadth[step] = current_breadth;
+  }
+
+  std::vector<std::pair<size_t, int32_t>> widest_steps;
+  widest_steps.reserve(tensors.size());
+  for (const auto& interval : intervals) {
+    int32_t widest_step = interval.first;
+    for (int32_t step = interval.first + 1; step <= interval.second; ++step) {
+      if (breadth[step] > breadth[widest_step]) {
+        widest_step = step;
+      }
+    }
+    widest_steps.emplace_back(breadth[widest_step], widest_step);
+  }
+  return widest_steps;
+}
+
 TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
+  if (strategy_ != ArenaPlanningStrategy::kSmallest) {
+    return CalculateAllocations(first_node, last_node, strategy_);
+  }
+
+  // Calculate the allocations with both strategies from the same state, and
+  // keep those requiring the least memory.
+  const std::vector<ArenaAllocWithUsageInterval> initial_allocs = allocs_;
+  const SimpleMemoryArena::Plan initial_arena_plan = arena_.GetPlan();
+  const SimpleMemoryArena::Plan initial_persistent_arena_plan =
+      persistent_arena_.GetPlan();
+  TF_LITE_ENSURE_STATUS(CalculateAllocations(
+      first_node, last_node, ArenaPlanningStrategy::kGreedyBySize));
+  const size_t by_size_bytes =
+      arena_.GetHighWaterMark() + persistent_arena_.GetHighWaterMark();
+  std::vector<ArenaAllocWithUsageInterval> by_size_allocs = allocs_;
+  const SimpleMemoryArena::Plan by_size_arena_plan = arena_.GetPlan();
+  const SimpleMemoryArena::Plan by_size_persistent_arena_plan =
+      persistent_arena_.GetPlan();
+
+  allocs_ = initial_allocs;
+  TF_LITE_ENSURE_STATUS(arena_.RestorePlan(initial_arena_plan));
+  TF_LITE_ENSURE_STATUS(
+      persistent_arena_.RestorePlan(initial_persistent_arena_plan));
+  TF_LITE_ENSURE_STATUS(CalculateAllocations(
+      first_node, last_node, ArenaPlanningStrategy::kGreedyByBreadth));
+  if (arena_.GetHighWaterMark() + persistent_arena_.GetHighWaterMark() >
+      by_size_bytes) {
+    allocs_ = std::move(by_size_allocs);
+    TF_LITE_ENSURE_STATUS(arena_.RestorePlan(by_size_arena_plan));
+    TF_LITE_ENSURE_STATUS(
+        persistent_arena_.RestorePlan(by_size_persistent_arena_plan));
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus ArenaPlanner::CalculateAllocations(
+    int first_node, int last_node, ArenaPlanningStrategy strategy) {
   // Indices of tensors in order their allocation offsets will be calculated.
   const std::vector<int32_t> tensor_order =
-      CreateTensorAllocationVector(first_node, last_node);
+      CreateTensorAllocationVector(first_node, last_node, strategy);
 
   // Deallocate if the tensor was already allocated.
   for (const auto& tensor_index : tensor_order) {
@@ -317,16 +451,18 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
   // Vector of ids of already allocated tensors, ordered by offset.
   for (const auto& tensor_index : tensor_order) {
     TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
+    // The arenas only compare usage intervals, so these are expressed in
+    // execution steps rather than nodes.
+    const int32_t first_step = ExecutionStep(alloc_node_[tensor_index]);
     if (tensor.allocation_type == kTfLiteArenaRw) {
-      TF_LITE_ENSURE_STATUS(
-          arena_.Allocate(context_, tensor_alignment_, tensor.bytes,
-                          tensor_index, alloc_node_[tensor_index],
-                          dealloc_node_[tensor_index], &allocs_[tensor_index]));
+      TF_LITE_ENSURE_STATUS(arena_.Allocate(
+          context_, tensor_alignment_, tensor.bytes, tensor_index, first_step,
+          LastAllocatedStep(tensor_index), &allocs_[tensor_index]));
     }
     if (tensor.allocation_type == kTfLiteArenaRwPersistent) {
       TF_LITE_ENSURE_STATUS(persistent_arena_.Allocate(
           context_, tensor_alignment_, tensor.bytes, tensor_index,
-          /*first_node=*/alloc_node_[tensor_index],
+          /*first_node=*/first_step,
           /*last_node=*/std::numeric_limits<int32_t>::max(),
           &allocs_[tensor_index]));
     }
@@ -334,6 +470,83 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
   return kTfLiteOk;
 }
 
+int32_t ArenaPlanner::ExecutionStep(int32_t node) const {
+  if (node < 0 || node >= static_cast<int32_t>(graph_info_->num_nodes())) {
+    return node;
+  }
+  return graph_info_->node_execution_step(node);
+}
+
+void ArenaPlanner::CalculateLastUseSteps() {
+  last_use_step_.assign(graph_info_->num_tensors(), 0);
+  auto use = [this](int32_t step, const TfLiteIntArray* tensors) {
+    for (int j = 0; j < tensors->size; ++j) {
+      const int tensor_index = tensors->data[j];
+      if (tensor_index != kTfLiteOptionalTensor) {
+        last_use_step_[tensor_index] =
+            std::max(last_use_step_[tensor_index], step);
+      }
+    }
+  };
+  for (size_t i = 0; i < graph_info_->num_nodes(); ++i) {
+    const TfLiteNode& node = graph_info_->node(i);
+    const int32_t step = ExecutionStep(i);
+    use(step, node.inputs);
+    use(step, node.outputs);
+    use(step, node.temporaries);
+  }
+}
+
+int32_t ArenaPlanner::LastAllocatedStep(int tensor_index) const {
+  if (dealloc_node_[tensor_index] == kNodeNotAssigned) {
+    return kNodeNotAssigned;
+  }
+  return last_use_step_[tensor_index];
+}
+
+std::vector<size_t> ArenaPlanner::PlanCacheKey() const {
+  std::vector<size_t> key = {graph_info_->num_tensors()};
+  for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
+    const TfLiteTensor& tensor = *graph_info_->tensor(i);
+    if (alloc_node_[i] == kNodeNotAssigned ||
+        (tensor.allocation_type != kTfLiteArenaRw &&
+         tensor.allocation_type != kTfLiteArenaRwPersistent)) {
+      continue;
+    }
+    key.insert(key.end(),
+               {static_cast<size_t>(i),
+                static_cast<size_t>(tensor.allocation_type), tensor.bytes,
+                static_cast<size_t>(ExecutionStep(alloc_node_[i])),
+                static_cast<size_t>(LastAllocatedStep(i))});
+  }
+  return key;
+}
+
+bool ArenaPlanner::RestoreCachedPlan(const std::vector<size_t>& key) {
+  for (auto it = plan_cache_.begin(); it != plan_cache_.end(); ++it) {
+    if (it->key != key) continue;
+    plan_cache_.splice(plan_cache_.begin(), plan_cache_, it);
+    const CachedPlan& plan = plan_cache_.front();
+    allocs_ = plan.allocs;
+    arena_.RestorePlan(plan.arena_plan);
+    persistent_arena_.RestorePlan(plan.persistent_arena_plan);
+    return true;
+  }
+  return false;
+}
+
+void ArenaPlanner::CachePlan(std::vector<size_t> key) {
+  CachedPlan plan;
+  plan.key = std::move(key);
+  plan.allocs = allocs_;
+  plan.arena_plan = arena_.GetPlan();
+  plan.persistent_arena_plan = persistent_arena_.GetPlan();
+  plan_cache_.push_front(std::move(plan));
+  while (plan_cache_.size() > static_cast<size_t>(plan_cache_size_)) {
+    plan_cache_.pop_back();
+  }
+}
+
 TfLiteStatus ArenaPlanner::ResolveTensorAllocation(int tensor_index) {
   TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
   if (tensor.allocation_type == kTfLiteArenaRw) {
@@ -16,7 +16,9 @@ limitations under the License.
 #define TENSORFLOW_LITE_ARENA_PLANNER_H_
 
 #include <cstdint>
+#include <list>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/c/common.h"
@@ -30,6 +32,37 @@ namespace tflite {
 constexpr const int kDefaultArenaAlignment = 64;
 constexpr const int kDefaultTensorAlignment = 64;
 
+// Strategies to assign memory to the tensors allocated in the arenas. Both
+// place each tensor in the smallest gap that fits it among the tensors already
+// placed, and only differ by the order in which tensors are placed.
+enum class ArenaPlanningStrategy {
+  // Tensors are placed in non-increasing order of their size.
+  kGreedyBySize,
+  // Nodes are visited in non-increasing order of their breadth, i.e. the
+  // total size of the tensors allocated while they run, and the tensors
+  // allocated while a node runs are placed in non-increasing order of their
+  // size. This tends to pack the tensors around the widest nodes, which
+  // determine the size of the arena, more tightly.
+  kGreedyByBreadth,
+  // Tensors are placed with both strategies above, keeping the allocations
+  // which require the least memory. Neither is better for all graphs, so
+  // this trades twice the planning time for smaller arenas.
+  kSmallest,
+};
+
+// The default strategy can be selected at build time with
+// --define=tflite_arena_planning=greedy_by_breadth (or smallest).
+#if defined(TFLITE_ARENA_PLANNING_GREEDY_BY_BREADTH)
+constexpr ArenaPlanningStrategy kDefaultArenaPlanningStrategy =
+    ArenaPlanningStrategy::kGreedyByBreadth;
+#elif defined(TFLITE_ARENA_PLANNING_SMALLEST)
+constexpr ArenaPlanningStrategy kDefaultArenaPlanningStrategy =
+    ArenaPlanningStrategy::kSmallest;
+#else
+constexpr ArenaPlanningStrategy kDefaultArenaPlanningStrategy =
+    ArenaPlanningStrategy::kGreedyBySize;
+#endif
+
 struct AllocationInfo;
 
 // A memory planner that makes all the allocations using arenas.
@@ -45,15 +78,29 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// If the graph reports that several nodes are executed at the same step (see
+// GraphInfo::node_execution_step()), the lifetimes of tensors are measured in
+// steps rather than nodes, so that tensors used by nodes running concurrently
+// never share memory.
+//
+// Allocations for the whole graph can be cached, so that they don't need to be
+// calculated again when the sizes of the tensors go back to ones seen before,
+// e.g. when the inputs are resized back and forth.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
   // ArenaPlanner is destroyed. If 'preserve_inputs' is true the inputs to the
   // graph will not share memory with any other tensor, effectively preserving
-  // them until the end of inference.
-  ArenaPlanner(TfLiteContext* context, std::unique_ptr<GraphInfo> graph_info,
-               bool preserve_inputs, bool preserve_intermediates,
-               int tensor_alignment = kDefaultTensorAlignment);
+  // them until the end of inference. If 'plan_cache_size' is positive, the
+  // allocations for up to that many different sets of tensor sizes are
+  // cached, evicting the least recently used ones. 'strategy' determines the
+  // order in which tensors are placed in the arenas.
+  ArenaPlanner(
+      TfLiteContext* context, std::unique_ptr<GraphInfo> graph_info,
+      bool preserve_inputs, bool preserve_intermediates,
+      int tensor_alignment = kDefaultTensorAlignment, int plan_cache_size = 0,
+      ArenaPlanningStrategy strategy = kDefaultArenaPlanningStrategy);
   ~ArenaPlanner() override;
   ArenaPlanner(const ArenaPlanner&) = delete;
   ArenaPlanner& operator=(const ArenaPlanner&) = delete;
@@ -65,6 +112,7 @@ class ArenaPlanner : public MemoryPlanner {
   TfLiteStatus ReleaseNonPersistentMemory() override;
   TfLiteStatus AcquireNonPersistentMemory() override;
   bool HasNonPersistentMemory() override;
+  size_t RequiredBytes(TfLiteAllocationType type) override;
 
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
@@ -78,16 +126,31 @@ class ArenaPlanner : public MemoryPlanner {
   // Comparator to sort tensors for the allocation algorithm:
   // - Tensors that have lifespan through the whole model inference time go
   // first;
-  // - Other tensors (e.g. intermediate and temporary ones) are sorted in
-  // non-increasing order of their size. If sizes of two tensors are equal, the
-  // one that needs to be allocated earlier goes first.
-  std::vector<int32_t> CreateTensorAllocationVector(int first_node,
-                                                    int last_node);
+  // - With kGreedyByBreadth, other tensors are sorted by the widest step at
+  // which they are allocated (see WidestSteps()), the wider first;
+  // - Remaining ties (e.g. intermediate and temporary tensors with
+  // kGreedyBySize) are sorted in non-increasing order of their size. If sizes
+  // of two tensors are equal, the one that needs to be allocated earlier goes
+  // first.
+  std::vector<int32_t> CreateTensorAllocationVector(
+      int first_node, int last_node, ArenaPlanningStrategy strategy);
+
+  // Returns, for each of 'tensors', the execution step at which the total
+  // size of the arena tensors among 'tensors' that are allocated is the
+  // largest, over the steps at which the tensor is allocated, and that total
+  // size (the breadth of the step).
+  std::vector<std::pair<size_t, int32_t>> WidestSteps(
+      const std::vector<int32_t>& tensors) const;
 
   // Traverse the allocation queue and reserve space in the appropriate arena
   // for all tensors affected by ops in the interval [first_node, last_node].
   TfLiteStatus CalculateAllocations(int first_node, int last_node);
 
+  // Same as above, placing tensors following 'strategy', which must not be
+  // kSmallest.
+  TfLiteStatus CalculateAllocations(int first_node, int last_node,
+                                    ArenaPlanningStrategy strategy);
+
   // Assign absolute memory location to a tensor, based on its relative
   // position inside the corresponding arena buffer.
   TfLiteStatus ResolveTensorAllocation(int tensor_index);
@@ -100,6 +163,27 @@ class ArenaPlanner : public MemoryPlanner {
   // 'node_index'.
   TfLiteStatus CalculateDeallocationOfInternalTensors(int node_index);
 
+  // Returns the execution step of the node at 'node', or 'node' itself if it
+  // is not a valid node (e.g. kNodeNotAssigned).
+  int32_t ExecutionStep(int32_t node) const;
+
+  // Computes 'last_use_step_' for all tensors.
+  void CalculateLastUseSteps();
+
+  // Returns the last execution step at which the tensor is allocated.
+  int32_t LastAllocatedStep(int tensor_index) const;
+
+  // Returns the key of the allocations for the whole graph in 'plan_cache_'.
+  // Allocations only depend on which tensors are allocated in arenas, and on
+  // their sizes and lifetimes.
+  std::vector<size_t> PlanCacheKey() const;
+
+  // Restores the allocations cached for 'key', if any. Returns true if found.
+  bool RestoreCachedPlan(const std::vector<size_t>& key);
+
+  // Caches the current allocations for 'key'.
+  void CachePlan(std::vector<size_t> key);
+
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
 
@@ -114,6 +198,11 @@ class ArenaPlanner : public MemoryPlanner {
   // the node's operation.
   std::vector<int32_t> dealloc_node_;
 
+  // Last execution step at which a node uses the tensor. This is the step of
+  // 'dealloc_node_', unless nodes run concurrently, in which case a node
+  // that comes earlier in the execution plan may still use the tensor later.
+  std::vector<int32_t> last_use_step_;
+
   // Raw memory buffer that is allocated for all temporary and graph outputs
   // that are declared kTfLiteArenaRw.
   SimpleMemoryArena arena_;
@@ -133,6 +222,21 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Number of bytes that tensor buffers should be aligned to.
   int tensor_alignment_;
+
+  // Allocations for the whole graph, most recently used first.
+  struct CachedPlan {
+    std::vector<size_t> key;
+    std::vector<ArenaAllocWithUsageInterval> allocs;
+    SimpleMemoryArena::Plan arena_plan;
+    SimpleMemoryArena::Plan persistent_arena_plan;
+  };
+  std::list<CachedPlan> plan_cache_;
+
+  // Maximum number of entries in 'plan_cache_'.
+  int plan_cache_size_;
+
+  // The order in which tensors are placed in the arenas.
+  ArenaPlanningStrategy strategy_;
 };
 
 }  // namespace tflite
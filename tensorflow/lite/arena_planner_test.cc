@@ -109,12 +109,19 @@ class TestGraph {
     variables_ = variables;
   }
 
+  const std::vector<size_t>& execution_steps() { return execution_steps_; }
+
+  void SetExecutionSteps(const std::vector<size_t>& execution_steps) {
+    execution_steps_ = execution_steps;
+  }
+
   void Swap(TestGraph* other) {
     std::swap(nodes_, other->nodes_);
     std::swap(tensors_, other->tensors_);
     std::swap(inputs_, other->inputs_);
     std::swap(outputs_, other->outputs_);
     std::swap(variables_, other->variables_);
+    std::swap(execution_steps_, other->execution_steps_);
   }
 
  private:
@@ -123,6 +130,7 @@ class TestGraph {
   std::vector<int> inputs_;
   std::vector<int> outputs_;
   std::vector<int> variables_;
+  std::vector<size_t> execution_steps_;
 };
 
 // The GraphInfo for a TestGraph.
@@ -139,6 +147,10 @@ class TestGraphInfo : public GraphInfo {
     return graph_->nodes()[index];
   }
   size_t node_index(size_t index) const override { return index; }
+  size_t node_execution_step(size_t index) const override {
+    if (graph_->execution_steps().empty()) return index;
+    return graph_->execution_steps()[index];
+  }
   const std::vector<int>& inputs() const override { return graph_->inputs(); }
   const std::vector<int>& outputs() const override { return graph_->outputs(); }
   const std::vector<int>& variables() const override {
@@ -163,12 +175,16 @@ void ReportError(TfLiteContext* context, const char* format, ...) {
 
 class ArenaPlannerTest : public ::testing::Test {
  protected:
-  void SetGraph(TestGraph* graph, bool preserve_inputs = false) {
+  void SetGraph(TestGraph* graph, bool preserve_inputs = false,
+                int plan_cache_size = 0,
+                ArenaPlanningStrategy strategy =
+                    ArenaPlanningStrategy::kGreedyBySize) {
     graph_ = graph;
     context_.ReportError = ReportError;
     planner_.reset(new ArenaPlanner(
         &context_, std::unique_ptr<GraphInfo>(new TestGraphInfo(graph)),
-        preserve_inputs, /*preserve intermediates*/ false, kTensorAlignment));
+        preserve_inputs, /*preserve intermediates*/ false, kTensorAlignment,
+        plan_cache_size, strategy));
     CHECK(planner_->ResetAllocations() == kTfLiteOk);
     CHECK(planner_->PlanAllocations() == kTfLiteOk);
   }
@@ -190,6 +206,8 @@ class ArenaPlannerTest : public ::testing::Test {
     CHECK(planner_->AcquireNonPersistentMemory() == kTfLiteOk);
   }
 
+  void ResetAllocations() { CHECK(planner_->ResetAllocations() == kTfLiteOk); }
+
   void ResetAllocationsAfter(int node) {
     CHECK(planner_->ResetAllocationsAfter(node) == kTfLiteOk);
   }
@@ -324,6 +342,117 @@ TEST_F(ArenaPlannerTest, SimpleGraphWithTemporary) {
   EXPECT_EQ(GetOffset(1), 0);
 }
 
+TEST_F(ArenaPlannerTest, ConcurrentNodesDontShareMemory) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {}},    // First op
+                      {{1}, {2}, {5}},   // Second op
+                      {{0}, {3}, {6}},   // Third op
+                      {{2, 3}, {4}, {}}  // Fourth op
+                  },
+                  {4});
+  const std::vector<size_t> bytes = {4, 32, 4, 32, 4, 8, 8};
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    (*graph.tensors())[i].bytes = bytes[i];
+  }
+  SetGraph(&graph);
+  Execute(0, 10);
+
+  // When executed in order, the output of the third op reuses the memory of
+  // the output of the first op, and the temporaries of the second and third
+  // ops share memory.
+  EXPECT_EQ(GetOffset(3), GetOffset(1));
+  EXPECT_EQ(GetOffset(6), GetOffset(5));
+
+  // The second and third ops don't depend on each other, so they can run at
+  // the same step, in which case none of their tensors can share memory.
+  graph.SetExecutionSteps({0, 1, 1, 2});
+  SetGraph(&graph);
+  Execute(0, 10);
+  EXPECT_EQ(GetOffset(1), 0);
+  EXPECT_EQ(GetOffset(3), GetOffsetAfter(1));
+  EXPECT_EQ(GetOffset(5), GetOffsetAfter(3));
+  EXPECT_EQ(GetOffset(6), GetOffsetAfter(5));
+}
+
+TEST_F(ArenaPlannerTest, CachedPlans) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},     // First op
+                      {{2, 0}, {4, 5}, {}},  // Second op
+                      {{4, 5}, {3}, {}}      // Third op
+                  },
+                  {3});
+  SetGraph(&graph, /*preserve_inputs=*/false, /*plan_cache_size=*/2);
+  auto offsets = [this]() {
+    std::vector<std::ptrdiff_t> result;
+    for (int i = 0; i <= 5; ++i) result.push_back(GetOffset(i));
+    return result;
+  };
+  Execute(0, 10);
+  const std::vector<std::ptrdiff_t> small_offsets = offsets();
+
+  // Make the output of the first op larger than the others.
+  (*graph.tensors())[2].bytes = 100;
+  ResetAllocations();
+  Execute(0, 10);
+  const std::vector<std::ptrdiff_t> large_offsets = offsets();
+  EXPECT_NE(small_offsets, large_offsets);
+  EXPECT_EQ(GetOffset(2), 0);
+
+  // Going back and forth between sizes gives the same allocations, whether
+  // they are cached or not.
+  for (int i = 0; i < 2; ++i) {
+    (*graph.tensors())[2].bytes = 9;
+    ResetAllocations();
+    Execute(0, 10);
+    EXPECT_EQ(offsets(), small_offsets);
+
+    (*graph.tensors())[2].bytes = 100;
+    ResetAllocations();
+    Execute(0, 10);
+    EXPECT_EQ(offsets(), large_offsets);
+  }
+}
+
+TEST_F(ArenaPlannerTest, PlanningStrategies) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {}},     // First op
+                      {{1}, {2}, {}},     // Second op
+                      {{1}, {3}, {}},     // Third op
+                      {{2, 3}, {4}, {}},  // Fourth op
+                      {{1}, {5}, {}}      // Fifth op
+                  },
+                  {5});
+  const std::vector<size_t> sizes = {192, 384, 256, 320, 192, 448};
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    (*graph.tensors())[i].bytes = sizes[i];
+  }
+  auto arena_size = [this, &graph](ArenaPlanningStrategy strategy) {
+    SetGraph(&graph, /*preserve_inputs=*/false, /*plan_cache_size=*/0,
+             strategy);
+    Execute(0, 10);
+    return planner_->RequiredBytes(kTfLiteArenaRw);
+  };
+
+  // Placing the largest tensor first puts tensor 5 at the bottom of the arena,
+  // leaving gaps too small for the tensors used by the fourth op, which is
+  // the widest one. Placing the tensors of the fourth op first packs them
+  // tightly.
+  EXPECT_EQ(arena_size(ArenaPlanningStrategy::kGreedyBySize), 1280);
+  EXPECT_EQ(GetOffset(5), 0);
+  EXPECT_EQ(GetOffset(4), 1088);
+  EXPECT_EQ(arena_size(ArenaPlanningStrategy::kGreedyByBreadth), 1152);
+  EXPECT_EQ(GetOffset(1), 0);
+  EXPECT_EQ(GetOffset(4), 960);
+  EXPECT_EQ(arena_size(ArenaPlanningStrategy::kSmallest), 1152);
+  EXPECT_EQ(planner_->RequiredBytes(kTfLiteArenaRwPersistent), 0);
+}
+
 TEST_F(ArenaPlannerTest, SimpleGraphWithResetAllocationsAfter) {
   TestGraph graph({0, 1},
                   {
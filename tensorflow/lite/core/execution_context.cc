@@ -0,0 +1,294 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/execution_context.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "tensorflow/lite/arena_planner.h"
+#include "tensorflow/lite/context_util.h"
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/core/api/tensor_utils.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace impl {
+
+namespace {
+
+// Returns the first multiple of `alignment` which is >= `offset`.
+size_t AlignTo(size_t alignment, size_t offset) {
+  return offset % alignment == 0 ? offset
+                                 : offset + (alignment - offset % alignment);
+}
+
+// Returns true if kernels write to `tensor` during inference, in which case
+// every context needs its own copy of the data.
+bool IsWrittenDuringInference(const TfLiteTensor& tensor) {
+  return tensor.allocation_type == kTfLiteArenaRw ||
+         (tensor.allocation_type == kTfLiteArenaRwPersistent &&
+          tensor.is_variable);
+}
+
+const char* GetOpName(const TfLiteRegistration& registration) {
+  return registration.custom_name
+             ? registration.custom_name
+             : EnumNameBuiltinOperator(
+                   static_cast<BuiltinOperator>(registration.builtin_code));
+}
+
+}  // namespace
+
+ExecutionContext::ExecutionContext(Subgraph* subgraph)
+    : subgraph_(subgraph),
+      allocation_generation_(subgraph->allocation_generation_) {
+  const TfLiteContext& subgraph_context = subgraph_->context_;
+  context_.impl_ = static_cast<void*>(this);
+  context_.ResizeTensor = ResizeTensor;
+  context_.ReportError = ReportError;
+  context_.AddTensors = AddTensors;
+  context_.GetNodeAndRegistration = GetNodeAndRegistration;
+  context_.GetExecutionPlan = GetExecutionPlan;
+  context_.GetExternalContext = GetExternalContext;
+  context_.SetExternalContext = SetExternalContext;
+  context_.allow_fp32_relax_to_fp16 =
+      subgraph_context.allow_fp32_relax_to_fp16;
+  context_.recommended_num_threads = subgraph_context.recommended_num_threads;
+  context_.profiler = nullptr;
+}
+
+ExecutionContext::~ExecutionContext() {
+  for (TfLiteTensor& tensor : tensors_) {
+    TfLiteIntArrayFree(tensor.dims);
+  }
+}
+
+TfLiteStatus ExecutionContext::Create(
+    Subgraph* subgraph, std::unique_ptr<ExecutionContext>* context) {
+  if (subgraph->state_ == Subgraph::kStateUninvokable ||
+      !subgraph->invoked_since_allocation_) {
+    subgraph->ReportError(
+        "Execution contexts can only be created once the subgraph was "
+        "invoked after AllocateTensors().");
+    return kTfLiteError;
+  }
+  if (subgraph->HasDynamicTensors()) {
+    subgraph->ReportError(
+        "Execution contexts don't support subgraphs with dynamic tensors.");
+    return kTfLiteError;
+  }
+  for (int node_index : subgraph->execution_plan_) {
+    const TfLiteNode& node =
+        subgraph->nodes_and_registration_[node_index].first;
+    const TfLiteRegistration& registration =
+        subgraph->nodes_and_registration_[node_index].second;
+    // Delegate kernels keep their buffers for themselves, and control flow
+    // ops invoke other subgraphs with the tensors of those subgraphs.
+    if (node.delegate != nullptr ||
+        registration.builtin_code == BuiltinOperator_IF ||
+        registration.builtin_code == BuiltinOperator_WHILE) {
+      subgraph->ReportError(
+          "Execution contexts don't support delegate kernels or control "
+          "flow ops (node number %d).",
+          node_index);
+      return kTfLiteError;
+    }
+  }
+
+  std::unique_ptr<ExecutionContext> new_context(new ExecutionContext(subgraph));
+  TF_LITE_ENSURE_STATUS(new_context->CopyTensors());
+  TF_LITE_ENSURE_STATUS(new_context->ResetVariableTensors());
+  *context = std::move(new_context);
+  return kTfLiteOk;
+}
+
+TfLiteStatus ExecutionContext::CopyTensors() {
+  const std::vector<TfLiteTensor>& subgraph_tensors = subgraph_->tensors_;
+  tensors_ = subgraph_tensors;
+  for (TfLiteTensor& tensor : tensors_) {
+    tensor.dims = TfLiteIntArrayCopy(tensor.dims);
+  }
+
+  // The arena tensors keep the offsets planned by the subgraph, relative to
+  // the lowest address of the arena in use.
+  const char* arena_begin = nullptr;
+  const char* arena_end = nullptr;
+  for (const TfLiteTensor& tensor : subgraph_tensors) {
+    if (tensor.allocation_type != kTfLiteArenaRw ||
+        tensor.data.raw == nullptr) {
+      continue;
+    }
+    if (arena_begin == nullptr || tensor.data.raw < arena_begin) {
+      arena_begin = tensor.data.raw;
+    }
+    arena_end =
+        std::max<const char*>(arena_end, tensor.data.raw + tensor.bytes);
+  }
+  const size_t arena_size = arena_end - arena_begin;
+
+  // Variable tensors follow the arena.
+  std::vector<size_t> variable_offsets(subgraph_tensors.size());
+  size_t buffer_size = arena_size;
+  for (size_t i = 0; i < subgraph_tensors.size(); ++i) {
+    const TfLiteTensor& tensor = subgraph_tensors[i];
+    if (tensor.allocation_type == kTfLiteArenaRwPersistent &&
+        tensor.is_variable) {
+      variable_offsets[i] = AlignTo(kDefaultTensorAlignment, buffer_size);
+      buffer_size = variable_offsets[i] + tensor.bytes;
+    }
+  }
+
+  // Kernels may rely on the alignment of the data, so the arena is placed at
+  // the same address modulo kDefaultTensorAlignment.
+  buffer_.reset(new char[buffer_size + kDefaultTensorAlignment]);
+  const size_t misalignment =
+      (reinterpret_cast<uintptr_t>(arena_begin) + kDefaultTensorAlignment -
+       reinterpret_cast<uintptr_t>(buffer_.get()) % kDefaultTensorAlignment) %
+      kDefaultTensorAlignment;
+  char* buffer_begin = buffer_.get() + misalignment;
+
+  for (size_t i = 0; i < tensors_.size(); ++i) {
+    TfLiteTensor& tensor = tensors_[i];
+    if (!IsWrittenDuringInference(tensor) || tensor.data.raw == nullptr) {
+      continue;
+    }
+    if (tensor.allocation_type == kTfLiteArenaRw) {
+      tensor.data.raw = buffer_begin + (tensor.data.raw - arena_begin);
+    } else {
+      tensor.data.raw = buffer_begin + variable_offsets[i];
+    }
+  }
+
+  context_.tensors = tensors_.data();
+  context_.tensors_size = tensors_.size();
+  return kTfLiteOk;
+}
+
+const std::vector<int>& ExecutionContext::inputs() const {
+  return subgraph_->inputs();
+}
+
+const std::vector<int>& ExecutionContext::outputs() const {
+  return subgraph_->outputs();
+}
+
+TfLiteStatus ExecutionContext::Invoke() {
+  if (subgraph_->state_ == Subgraph::kStateUninvokable ||
+      subgraph_->allocation_generation_ != allocation_generation_) {
+    subgraph_->ReportError(
+        "Invoke called on an execution context created before the tensors "
+        "of the subgraph were last allocated.");
+    return kTfLiteError;
+  }
+
+  for (int node_index : subgraph_->execution_plan_) {
+    auto& node_and_registration =
+        subgraph_->nodes_and_registration_[node_index];
+    TfLiteNode& node = node_and_registration.first;
+    const TfLiteRegistration& registration = node_and_registration.second;
+    const char* op_name = profiler_ ? GetOpName(registration) : nullptr;
+    TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(profiler_, op_name, node_index);
+    if (registration.invoke == nullptr ||
+        registration.invoke(&context_, &node) != kTfLiteOk) {
+      ReportError(&context_, "Node number %d (%s) failed to invoke.\n",
+                  node_index, GetOpName(registration));
+      return kTfLiteError;
+    }
+  }
+  return kTfLiteOk;
+}
+
+void ExecutionContext::SetProfiler(Profiler* profiler) {
+  profiler_ = profiler;
+  context_.profiler = profiler;
+}
+
+TfLiteStatus ExecutionContext::ResetVariableTensors() {
+  for (TfLiteTensor& tensor : tensors_) {
+    if (tensor.is_variable) {
+      TF_LITE_ENSURE(&context_, tensor.data.raw != nullptr);
+      tflite::ResetVariableTensor(&tensor);
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus ExecutionContext::ResizeTensor(TfLiteContext* context,
+                                            TfLiteTensor* tensor,
+                                            TfLiteIntArray* new_size) {
+  // Kernels commonly "resize" their outputs to the sizes they already have,
+  // which is fine, but the memory of a context can't be planned again.
+  if (tensor->data.raw != nullptr &&
+      EqualArrayAndTfLiteIntArray(tensor->dims, new_size->size,
+                                  new_size->data)) {
+    TfLiteIntArrayFree(tensor->dims);
+    tensor->dims = new_size;
+    return kTfLiteOk;
+  }
+  TfLiteIntArrayFree(new_size);
+  ReportError(context, "Tensors can't be resized in an execution context.");
+  return kTfLiteError;
+}
+
+void ExecutionContext::ReportError(TfLiteContext* context, const char* format,
+                                   ...) {
+  va_list args;
+  va_start(args, format);
+  static_cast<ExecutionContext*>(context->impl_)
+      ->subgraph_->ReportErrorImpl(format, args);
+  va_end(args);
+}
+
+TfLiteStatus ExecutionContext::AddTensors(TfLiteContext* context,
+                                          int tensors_to_add,
+                                          int* first_new_tensor_index) {
+  ReportError(context, "Tensors can't be added in an execution context.");
+  return kTfLiteError;
+}
+
+TfLiteStatus ExecutionContext::GetNodeAndRegistration(
+    TfLiteContext* context, int node_index, TfLiteNode** node,
+    TfLiteRegistration** registration) {
+  return static_cast<ExecutionContext*>(context->impl_)
+      ->subgraph_->GetNodeAndRegistration(node_index, node, registration);
+}
+
+TfLiteStatus ExecutionContext::GetExecutionPlan(
+    TfLiteContext* context, TfLiteIntArray** execution_plan) {
+  ReportError(context,
+              "The execution plan can't be queried in an execution context.");
+  return kTfLiteError;
+}
+
+TfLiteExternalContext* ExecutionContext::GetExternalContext(
+    TfLiteContext* context, TfLiteExternalContextType type) {
+  auto* execution_context = static_cast<ExecutionContext*>(context->impl_);
+  if (type == kTfLiteCpuBackendContext) {
+    return &execution_context->cpu_backend_context_;
+  }
+  return execution_context->subgraph_->GetExternalContext(type);
+}
+
+void ExecutionContext::SetExternalContext(TfLiteContext* context,
+                                          TfLiteExternalContextType type,
+                                          TfLiteExternalContext* ctx) {
+  ReportError(context,
+              "External contexts can't be set in an execution context.");
+}
+
+}  // namespace impl
+}  // namespace tflite
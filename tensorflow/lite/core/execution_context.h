@@ -0,0 +1,170 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_CORE_EXECUTION_CONTEXT_H_
+#define TENSORFLOW_LITE_CORE_EXECUTION_CONTEXT_H_
+
+#include <cstdarg>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
+#include "tensorflow/lite/type_to_tflitetype.h"
+
+namespace tflite {
+namespace impl {
+
+class Subgraph;
+
+// A lightweight context to invoke a subgraph with its own activations.
+//
+// Execution contexts share everything the subgraph set up in
+// AllocateTensors(): the weights, the nodes and the state their kernels
+// prepared. Each context only owns copies of the tensors written during
+// inference, i.e. those allocated in the activation arena and the variable
+// tensors, so that a single interpreter can serve several requests
+// concurrently, e.g. with one context per request thread.
+//
+// A context must only be used by one thread at a time, but different
+// contexts of a subgraph can be invoked concurrently, and concurrently with
+// the subgraph itself. The tensors of a context keep the sizes they had when
+// it was created: once the subgraph reallocates its tensors, its contexts
+// can't be invoked anymore and must be created again. Contexts must not
+// outlive their subgraph.
+//
+// WARNING: This is an experimental API and subject to change.
+class ExecutionContext {
+ public:
+  ~ExecutionContext();
+
+  // Creates a context to invoke `subgraph`. This requires that the subgraph
+  // was invoked since its tensors were last allocated, so that kernels had a
+  // chance to initialize their state, and that it has no dynamic tensors, no
+  // delegate kernels and no control flow ops.
+  static TfLiteStatus Create(Subgraph* subgraph,
+                             std::unique_ptr<ExecutionContext>* context);
+
+  // Read only access to list of inputs and outputs, which are those of the
+  // subgraph.
+  const std::vector<int>& inputs() const;
+  const std::vector<int>& outputs() const;
+
+  // Returns the tensor of this context at `tensor_index`, or null if the
+  // index is out of range.
+  TfLiteTensor* tensor(int tensor_index) {
+    if (tensor_index < 0 ||
+        static_cast<size_t>(tensor_index) >= tensors_.size()) {
+      return nullptr;
+    }
+    return &tensors_[tensor_index];
+  }
+
+  // Perform a checked cast to the appropriate tensor type.
+  template <class T>
+  T* typed_tensor(int tensor_index) {
+    if (TfLiteTensor* tensor_ptr = tensor(tensor_index)) {
+      if (tensor_ptr->type == typeToTfLiteType<T>()) {
+        return reinterpret_cast<T*>(tensor_ptr->data.raw);
+      }
+    }
+    return nullptr;
+  }
+
+  // Return a mutable pointer into the data of a given input tensor. The given
+  // index must be between 0 and inputs().size().
+  template <class T>
+  T* typed_input_tensor(int index) {
+    return typed_tensor<T>(inputs()[index]);
+  }
+
+  // Return a mutable pointer into the data of a given output tensor. The
+  // given index must be between 0 and outputs().size().
+  template <class T>
+  T* typed_output_tensor(int index) {
+    return typed_tensor<T>(outputs()[index]);
+  }
+
+  // Invoke the subgraph with the tensors of this context.
+  TfLiteStatus Invoke();
+
+  // Sets the profiler of the ops invoked in this context, which isn't owned
+  // and must outlive it. As a context, a profiler must only be used by one
+  // thread at a time, so contexts invoked concurrently need their own. Passing
+  // null disables profiling.
+  void SetProfiler(Profiler* profiler);
+
+  // Reset the variable tensors of this context to their default value. This
+  // is done when the context is created.
+  TfLiteStatus ResetVariableTensors();
+
+ private:
+  explicit ExecutionContext(Subgraph* subgraph);
+
+  // Copies the tensors of the subgraph, and gives the tensors allocated in
+  // the activation arena and the variable tensors their own memory.
+  TfLiteStatus CopyTensors();
+
+  // Functions of `context_`. Those which modify the subgraph, or are only
+  // meant to be called by delegates, fail.
+  static TfLiteStatus ResizeTensor(TfLiteContext* context,
+                                   TfLiteTensor* tensor,
+                                   TfLiteIntArray* new_size);
+  static void ReportError(TfLiteContext* context, const char* format, ...);
+  static TfLiteStatus AddTensors(TfLiteContext* context, int tensors_to_add,
+                                 int* first_new_tensor_index);
+  static TfLiteStatus GetNodeAndRegistration(TfLiteContext* context,
+                                             int node_index,
+                                             TfLiteNode** node,
+                                             TfLiteRegistration** registration);
+  static TfLiteStatus GetExecutionPlan(TfLiteContext* context,
+                                       TfLiteIntArray** execution_plan);
+  static TfLiteExternalContext* GetExternalContext(
+      TfLiteContext* context, TfLiteExternalContextType type);
+  static void SetExternalContext(TfLiteContext* context,
+                                 TfLiteExternalContextType type,
+                                 TfLiteExternalContext* ctx);
+
+  Subgraph* const subgraph_;
+
+  // The allocation of the subgraph's tensors this context was created for.
+  // See Subgraph::allocation_generation_.
+  int allocation_generation_;
+
+  // The context passed to kernels, which points to `tensors_`.
+  TfLiteContext context_ = {};
+
+  // Copies of the subgraph's tensors. The dimensions are owned by this
+  // context, and the data too for the tensors allocated in `buffer_`.
+  std::vector<TfLiteTensor> tensors_;
+
+  // The activation arena, followed by the variable tensors.
+  std::unique_ptr<char[]> buffer_;
+
+  // Not owned, may be null.
+  Profiler* profiler_ = nullptr;
+
+  // Kernels running in different contexts can't share the CPU backend
+  // context, whose thread pool and caches aren't thread-safe.
+  ExternalCpuBackendContext cpu_backend_context_;
+};
+
+}  // namespace impl
+
+using ExecutionContext = impl::ExecutionContext;
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_CORE_EXECUTION_CONTEXT_H_
@@ -16,6 +16,8 @@ limitations under the License.
 #include "tensorflow/lite/core/subgraph.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 
 #include "tensorflow/lite/arena_planner.h"
 #include "tensorflow/lite/c/common.h"
@@ -140,6 +142,26 @@ const char* GetTFLiteOpName(const TfLiteRegistration& op_reg) {
   return tflite::EnumNamesBuiltinOperator()[op_reg.builtin_code];
 }
 
+// Returns true if the node must not run concurrently with any other node.
+// Delegate kernels may use threads of their own, and custom ops and control
+// flow ops (which invoke other subgraphs) may not be safe to run concurrently.
+bool RunsExclusively(const TfLiteNode& node,
+                     const TfLiteRegistration& registration) {
+  return node.delegate != nullptr || registration.custom_name != nullptr ||
+         registration.builtin_code == tflite::BuiltinOperator_IF ||
+         registration.builtin_code == tflite::BuiltinOperator_WHILE;
+}
+
+// A task of the inter-op thread pool.
+class InterOpTask : public ruy::Task {
+ public:
+  explicit InterOpTask(std::function<void()> fn) : fn_(std::move(fn)) {}
+  void Run() override { fn_(); }
+
+ private:
+  std::function<void()> fn_;
+};
+
 }  // namespace
 
 // A trivial implementation of GraphInfo around the Interpreter.
@@ -165,6 +187,9 @@ class InterpreterInfo : public GraphInfo {
   size_t node_index(size_t index) const override {
     return subgraph_->execution_plan()[index];
   }
+  size_t node_execution_step(size_t index) const override {
+    return subgraph_->execution_step(index);
+  }
   const std::vector<int>& inputs() const override {
     return subgraph_->inputs();
   }
@@ -420,6 +445,18 @@ TfLiteExternalContext* Subgraph::GetExternalContext(
   return static_cast<Subgraph*>(context->impl_)->GetExternalContext(type);
 }
 
+TfLiteExternalContext* Subgraph::GetInterOpExternalContext(
+    struct TfLiteContext* context, TfLiteExternalContextType type) {
+  Subgraph* subgraph = static_cast<Subgraph*>(context->impl_);
+  if (type == kTfLiteCpuBackendContext) {
+    // Nodes running concurrently can't share the CPU backend context, whose
+    // thread pool and caches aren't thread-safe.
+    const size_t index = context - subgraph->inter_op_contexts_.data();
+    return subgraph->inter_op_cpu_backend_contexts_[index].get();
+  }
+  return subgraph->GetExternalContext(type);
+}
+
 void Subgraph::SetExternalContext(TfLiteExternalContextType type,
                                   TfLiteExternalContext* ctx) {
   if (static_cast<int>(type) >= 0 && type < kTfLiteMaxExternalContexts) {
@@ -538,6 +575,253 @@ bool Subgraph::IsCancelled() {
          (*check_cancelled_func_)(cancellation_data_);
 }
 
+TfLiteStatus Subgraph::SetNumInterOpThreads(int num_threads) {
+  if (num_threads < 1) {
+    ReportError("num_threads should be >= 1.");
+    return kTfLiteError;
+  }
+  if (num_threads == num_inter_op_threads_) {
+    return kTfLiteOk;
+  }
+  if (state_ == kStateInvokableAndImmutable) {
+    ReportError(
+        "SetNumInterOpThreads is disallowed when graph is immutable.");
+    return kTfLiteError;
+  }
+  num_inter_op_threads_ = num_threads;
+  if (num_inter_op_threads_ == 1) {
+    inter_op_thread_pool_.reset();
+    inter_op_contexts_.clear();
+    inter_op_cpu_backend_contexts_.clear();
+  }
+  // The nodes need to be scheduled, and the tensors allocated, again.
+  state_ = kStateUninvokable;
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::SetAllocationPlanCacheSize(int num_plans) {
+  if (num_plans < 0) {
+    ReportError("num_plans should be >= 0.");
+    return kTfLiteError;
+  }
+  if (memory_planner_) {
+    ReportError(
+        "SetAllocationPlanCacheSize must be called before AllocateTensors.");
+    return kTfLiteError;
+  }
+  allocation_plan_cache_size_ = num_plans;
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::SetArenaPlanningStrategy(
+    ArenaPlanningStrategy strategy) {
+  if (memory_planner_) {
+    ReportError(
+        "SetArenaPlanningStrategy must be called before AllocateTensors.");
+    return kTfLiteError;
+  }
+  arena_planning_strategy_ = strategy;
+  return kTfLiteOk;
+}
+
+void Subgraph::ScheduleInterOpSteps() {
+  execution_plan_steps_.clear();
+  inter_op_steps_.clear();
+  inter_op_steps_invoked_ = false;
+  if (num_inter_op_threads_ <= 1 || has_dynamic_tensors_) {
+    return;
+  }
+
+  // The step at which each tensor was last written, and the last step at
+  // which it was read.
+  std::vector<int> last_write(tensors_.size(), -1);
+  std::vector<int> last_read(tensors_.size(), -1);
+  // Nodes can't run before `first_step`, which follows the last node that
+  // runs exclusively.
+  int first_step = 0;
+  int num_steps = 0;
+  execution_plan_steps_.resize(execution_plan_.size());
+  for (size_t i = 0; i < execution_plan_.size(); ++i) {
+    const auto& node_and_reg = nodes_and_registration_[execution_plan_[i]];
+    const TfLiteNode& node = node_and_reg.first;
+    const bool exclusive = RunsExclusively(node, node_and_reg.second);
+
+    // A node runs after the nodes writing its inputs, and after the nodes
+    // reading or writing the tensors it writes, which include its variable
+    // inputs.
+    int step = exclusive ? num_steps : first_step;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      step = std::max(step, last_write[tensor_index] + 1);
+      if (tensors_[tensor_index].is_variable) {
+        step = std::max(step, last_read[tensor_index] + 1);
+      }
+    }
+    for (const TfLiteIntArray* written : {node.outputs, node.intermediates}) {
+      for (int tensor_index : TfLiteIntArrayView(written)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        step = std::max({step, last_write[tensor_index] + 1,
+                         last_read[tensor_index] + 1});
+      }
+    }
+
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      last_read[tensor_index] = std::max(last_read[tensor_index], step);
+      if (tensors_[tensor_index].is_variable) {
+        last_write[tensor_index] = step;
+      }
+    }
+    for (const TfLiteIntArray* written : {node.outputs, node.intermediates}) {
+      for (int tensor_index : TfLiteIntArrayView(written)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        last_write[tensor_index] = step;
+      }
+    }
+
+    execution_plan_steps_[i] = step;
+    num_steps = std::max(num_steps, step + 1);
+    if (exclusive) {
+      first_step = step + 1;
+    }
+  }
+
+  // Nothing can run concurrently.
+  if (num_steps == static_cast<int>(execution_plan_.size())) {
+    execution_plan_steps_.clear();
+    return;
+  }
+
+  inter_op_steps_.resize(num_steps);
+  size_t max_step_size = 0;
+  for (size_t i = 0; i < execution_plan_.size(); ++i) {
+    std::vector<int>& step = inter_op_steps_[execution_plan_steps_[i]];
+    step.push_back(i);
+    max_step_size = std::max(max_step_size, step.size());
+  }
+
+  // The calling thread runs one of the nodes of each step.
+  const size_t num_extra_threads =
+      std::min<size_t>(num_inter_op_threads_, max_step_size) - 1;
+  if (!inter_op_thread_pool_) {
+    inter_op_thread_pool_.reset(new ruy::ThreadPool);
+  }
+  inter_op_contexts_.resize(num_extra_threads);
+  while (inter_op_cpu_backend_contexts_.size() < num_extra_threads) {
+    inter_op_cpu_backend_contexts_.emplace_back(new ExternalCpuBackendContext);
+  }
+  RefreshInterOpCpuBackendContexts();
+}
+
+TfLiteStatus Subgraph::InvokeInterOpSteps() {
+  // Nodes run one at a time on the first invocation, so that kernels can
+  // initialize their state lazily, and when profiling.
+  const bool concurrent = inter_op_steps_invoked_ && !profiler_;
+  inter_op_steps_invoked_ = true;
+
+  for (const std::vector<int>& step : inter_op_steps_) {
+    for (int execution_plan_index : step) {
+      const TfLiteNode& node =
+          nodes_and_registration_[execution_plan_[execution_plan_index]].first;
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        if (tensor_index == kTfLiteOptionalTensor) {
+          continue;
+        }
+        TfLiteTensor* tensor = &tensors_[tensor_index];
+        if (tensor->delegate && tensor->delegate != node.delegate &&
+            tensor->data_is_stale) {
+          TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
+        }
+      }
+    }
+
+    if (IsCancelled()) {
+      ReportError("Client requested cancel during Invoke()");
+      return kTfLiteError;
+    }
+
+    EnsureTensorsVectorCapacity();
+    if (concurrent && step.size() > 1) {
+      TF_LITE_ENSURE_STATUS(InvokeConcurrently(step));
+      continue;
+    }
+    for (int execution_plan_index : step) {
+      int node_index = execution_plan_[execution_plan_index];
+      TfLiteNode& node = nodes_and_registration_[node_index].first;
+      const TfLiteRegistration& registration =
+          nodes_and_registration_[node_index].second;
+
+      const char* op_name = nullptr;
+      if (profiler_) op_name = GetTFLiteOpName(registration);
+      TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(profiler_.get(), op_name,
+                                            node_index);
+
+      if (OpInvoke(registration, &node) != kTfLiteOk) {
+        return ReportOpError(&context_, node, registration, node_index,
+                             "failed to invoke");
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::InvokeConcurrently(const std::vector<int>& step) {
+  const int num_tasks =
+      std::min<int>(step.size(), inter_op_contexts_.size() + 1);
+
+  // Each task runs nodes until there are none left, or one of them failed.
+  std::atomic<int> next_node(0);
+  std::atomic<int> failed_node_index(-1);
+  auto run_nodes = [this, &step, &next_node,
+                    &failed_node_index](TfLiteContext* context) {
+    for (int i = next_node++;
+         i < static_cast<int>(step.size()) && failed_node_index < 0;
+         i = next_node++) {
+      int node_index = execution_plan_[step[i]];
+      TfLiteNode& node = nodes_and_registration_[node_index].first;
+      const TfLiteRegistration& registration =
+          nodes_and_registration_[node_index].second;
+      if (registration.invoke == nullptr ||
+          registration.invoke(context, &node) != kTfLiteOk) {
+        int no_failure = -1;
+        failed_node_index.compare_exchange_strong(no_failure, node_index);
+      }
+    }
+  };
+
+  // The first task runs on the calling thread, with the subgraph's context.
+  std::vector<InterOpTask> tasks;
+  tasks.reserve(num_tasks);
+  tasks.emplace_back([this, &run_nodes]() { run_nodes(&context_); });
+  for (int i = 1; i < num_tasks; ++i) {
+    TfLiteContext* context = &inter_op_contexts_[i - 1];
+    *context = context_;
+    context->GetExternalContext = GetInterOpExternalContext;
+    tasks.emplace_back([context, &run_nodes]() { run_nodes(context); });
+  }
+  inter_op_thread_pool_->Execute(num_tasks, tasks.data());
+
+  if (failed_node_index >= 0) {
+    const int node_index = failed_node_index;
+    return ReportOpError(&context_, nodes_and_registration_[node_index].first,
+                         nodes_and_registration_[node_index].second,
+                         node_index, "failed to invoke");
+  }
+  return kTfLiteOk;
+}
+
+void Subgraph::RefreshInterOpCpuBackendContexts() {
+  if (context_.recommended_num_threads == -1) {
+    return;
+  }
+  for (auto& cpu_backend_context : inter_op_cpu_backend_contexts_) {
+    if (cpu_backend_context->internal_backend_context()) {
+      cpu_backend_context->internal_backend_context()->SetMaxNumThreads(
+          context_.recommended_num_threads);
+    }
+  }
+}
+
 void Subgraph::ReserveNodes(int count) {
   nodes_and_registration_.reserve(count);
 }
@@ -641,6 +925,8 @@ TfLiteStatus Subgraph::AllocateTensors() {
   TF_LITE_ENSURE_STATUS(PrepareOpsAndTensors());
 
   state_ = kStateInvokable;
+  ++allocation_generation_;
+  invoked_since_allocation_ = false;
 
   // Reset the variable tensors to zero after (re)allocating the tensors.
   // Developers shouldn't rely on the side effect of this function to reset
@@ -859,7 +1145,9 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
   if (!memory_planner_) {
     memory_planner_.reset(new ArenaPlanner(
         &context_, std::unique_ptr<GraphInfo>(new InterpreterInfo(this)),
-        /*preserve_inputs=*/true, /*preserve_intermediates*/ false));
+        /*preserve_inputs=*/true, /*preserve_intermediates*/ false,
+        kDefaultTensorAlignment, allocation_plan_cache_size_,
+        arena_planning_strategy_));
     memory_planner_->PlanAllocations();
   }
 
@@ -869,6 +1157,13 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
       next_execution_plan_index_to_prepare_, &last_exec_plan_index_prepared));
   next_execution_plan_index_to_prepare_ = last_exec_plan_index_prepared + 1;
 
+  // When planning from scratch, schedule the nodes before the tensors are
+  // allocated, since the arena planner needs to know which nodes run
+  // concurrently.
+  if (next_execution_plan_index_to_plan_allocation_ == 0) {
+    ScheduleInterOpSteps();
+  }
+
   TF_LITE_ENSURE_STATUS(memory_planner_->ExecuteAllocations(
       next_execution_plan_index_to_plan_allocation_,
       last_exec_plan_index_prepared));
@@ -900,6 +1195,12 @@ TfLiteStatus Subgraph::Invoke() {
     applied_nnapi_delegate_ = true;
   }
 
+  if (!inter_op_steps_.empty()) {
+    TF_LITE_ENSURE_STATUS(InvokeInterOpSteps());
+    invoked_since_allocation_ = true;
+    return kTfLiteOk;
+  }
+
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
@@ -970,6 +1271,7 @@ TfLiteStatus Subgraph::Invoke() {
     }
   }
 
+  invoked_since_allocation_ = true;
   return status;
 }
 
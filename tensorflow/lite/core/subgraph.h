@@ -22,11 +22,14 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/arena_planner.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/macros.h"
+#include "ruy/thread_pool.h"  // from @ruy
 #include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/memory_planner.h"
 #include "tensorflow/lite/util.h"
 
@@ -40,10 +43,12 @@ namespace impl {
 
 // Forward declare since NNAPIDelegate uses Interpreter.
 class NNAPIDelegate;
+class ExecutionContext;
 
 class Subgraph {
  public:
   friend class Interpreter;
+  friend class ExecutionContext;
 
   Subgraph(ErrorReporter* error_reporter,
            TfLiteExternalContext** external_contexts,
@@ -276,6 +281,63 @@ class Subgraph {
   // WARNING: This is an experimental API and subject to change.
   void SetCancellationFunction(void* data, bool (*check_cancelled_func)(void*));
 
+  // Sets the number of threads used to run independent nodes concurrently.
+  // By default (1), nodes run one at a time, in the order of the execution
+  // plan.
+  //
+  // Otherwise, nodes are grouped into steps according to the tensors they
+  // read and write: the nodes of a step run concurrently, each with its own
+  // CPU backend context, and a step only starts once the previous one is done.
+  // Tensors used during the same step never share memory, so the arena may
+  // grow. Delegate kernels, custom ops and control flow ops always run on
+  // their own, and subgraphs with dynamic tensors, or with a profiler, run
+  // one node at a time. Since kernels may initialize their state lazily, the
+  // first invocation after AllocateTensors() also runs one node at a time.
+  //
+  // Note that each concurrent node may in turn use up to
+  // `context()->recommended_num_threads` threads.
+  //
+  // Takes effect on the next call to AllocateTensors().
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetNumInterOpThreads(int num_threads);
+
+  // Sets the number of memory allocation plans cached for different tensor
+  // sizes. When the inputs are resized back to sizes seen before,
+  // AllocateTensors() reuses the allocations planned for them rather than
+  // planning them again. Ops are still prepared, since they may depend on
+  // the sizes of their tensors. Defaults to 0, which disables caching.
+  //
+  // Must be called before the first call to AllocateTensors().
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetAllocationPlanCacheSize(int num_plans);
+
+  // Sets the strategy used to assign memory to the tensors allocated in the
+  // arenas. Defaults to kDefaultArenaPlanningStrategy, which can be selected
+  // at build time.
+  //
+  // Must be called before the first call to AllocateTensors().
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetArenaPlanningStrategy(ArenaPlanningStrategy strategy);
+
+  // Returns the number of bytes used in the arena of the given allocation
+  // type (kTfLiteArenaRw or kTfLiteArenaRwPersistent), or 0 before the first
+  // call to AllocateTensors().
+  // WARNING: This is an experimental API and subject to change.
+  size_t GetArenaSize(TfLiteAllocationType type) const {
+    return memory_planner_ ? memory_planner_->RequiredBytes(type) : 0;
+  }
+
+  // Returns the step at which the node at `execution_plan_index` runs. See
+  // SetNumInterOpThreads().
+  // WARNING: This is an experimental API and subject to change.
+  int execution_step(int execution_plan_index) const {
+    if (static_cast<size_t>(execution_plan_index) <
+        execution_plan_steps_.size()) {
+      return execution_plan_steps_[execution_plan_index];
+    }
+    return execution_plan_index;
+  }
+
   // Ensure the data in `tensor.data` is readable. In case delegate is used,
   // it might require to copy the data from delegate buffer to raw memory.
   // WARNING: This is an experimental API and subject to change.
@@ -521,6 +583,11 @@ class Subgraph {
   static TfLiteExternalContext* GetExternalContext(
       struct TfLiteContext* context, TfLiteExternalContextType type);
 
+  // Retrieve an external context by type, for a node running concurrently
+  // with the context `context`, which is one of `inter_op_contexts_`.
+  static TfLiteExternalContext* GetInterOpExternalContext(
+      struct TfLiteContext* context, TfLiteExternalContextType type);
+
   // Set the value of an external context.
   static void SetExternalContext(struct TfLiteContext* context,
                                  TfLiteExternalContextType type,
@@ -575,6 +642,22 @@ class Subgraph {
   // Returns true if cancellation function returns true.
   bool IsCancelled();
 
+  // Groups the nodes of the execution plan into steps, so that independent
+  // nodes run concurrently. Does nothing unless more than one inter-op thread
+  // is used and all the tensors have static sizes.
+  void ScheduleInterOpSteps();
+
+  // Invokes the subgraph step by step, following `inter_op_steps_`.
+  TfLiteStatus InvokeInterOpSteps();
+
+  // Runs the nodes of `step`, given by their execution plan indices,
+  // concurrently.
+  TfLiteStatus InvokeConcurrently(const std::vector<int>& step);
+
+  // Updates the number of threads of the CPU backend contexts used by nodes
+  // running concurrently.
+  void RefreshInterOpCpuBackendContexts();
+
   // The state of the Interpreter.
   enum State {
     // The interpreter isn't ready to be invoked.
@@ -702,6 +785,43 @@ class Subgraph {
 
   // A map of resources. Owned by interpreter and shared by multiple subgraphs.
   resource::ResourceMap* resources_ = nullptr;
+
+  // Incremented whenever the tensors are (re)allocated, so that execution
+  // contexts created for an earlier allocation can tell they are outdated.
+  int allocation_generation_ = 0;
+
+  // Whether the subgraph was invoked since its tensors were last allocated.
+  bool invoked_since_allocation_ = false;
+
+  // Number of memory allocation plans cached by the memory planner.
+  int allocation_plan_cache_size_ = 0;
+
+  // The strategy used by the memory planner.
+  ArenaPlanningStrategy arena_planning_strategy_ =
+      kDefaultArenaPlanningStrategy;
+
+  // Number of threads used to run independent nodes concurrently.
+  int num_inter_op_threads_ = 1;
+
+  // The step at which each node of the execution plan runs, and the execution
+  // plan indices of the nodes of each step. Both are empty if nodes run one at
+  // a time.
+  std::vector<int> execution_plan_steps_;
+  std::vector<std::vector<int>> inter_op_steps_;
+
+  // Whether the subgraph was invoked since the steps were scheduled.
+  bool inter_op_steps_invoked_ = false;
+
+  // The thread pool on which nodes run concurrently. This is not the thread
+  // pool of the CPU backend context, since kernels use that one themselves.
+  std::unique_ptr<ruy::ThreadPool> inter_op_thread_pool_;
+
+  // Copies of `context_` for the nodes that run concurrently on the threads
+  // of `inter_op_thread_pool_`, which only differ by their CPU backend
+  // context.
+  std::vector<TfLiteContext> inter_op_contexts_;
+  std::vector<std::unique_ptr<ExternalCpuBackendContext>>
+      inter_op_cpu_backend_contexts_;
 };
 
 }  // namespace impl
@@ -0,0 +1,406 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/serialization.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/minimal_logging.h"
+
+namespace tflite {
+namespace delegates {
+namespace {
+
+constexpr char kEntryMagic[8] = {'T', 'F', 'L', 'D', 'S', 'E', 'R', '1'};
+
+// Header in front of the data of every cache file.
+struct EntryHeader {
+  char magic[8];
+  uint64_t fingerprint;
+  uint64_t data_size;
+  uint64_t data_hash;
+};
+
+// 64-bit FNV-1a hash. Unlike std::hash, the result is stable across builds and
+// platforms, which matters for files that outlive the process.
+class FingerprintBuilder {
+ public:
+  FingerprintBuilder& Add(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash_ ^= bytes[i];
+      hash_ *= 0x100000001B3ULL;
+    }
+    return *this;
+  }
+
+  FingerprintBuilder& Add(int64_t value) { return Add(&value, sizeof(value)); }
+
+  FingerprintBuilder& AddFloat(float value) {
+    return Add(&value, sizeof(value));
+  }
+
+  FingerprintBuilder& Add(const std::string& value) {
+    Add(static_cast<int64_t>(value.size()));
+    return Add(value.data(), value.size());
+  }
+
+  FingerprintBuilder& Add(const TfLiteIntArray* array) {
+    if (array == nullptr) {
+      return Add(int64_t{-1});
+    }
+    Add(static_cast<int64_t>(array->size));
+    return Add(array->data, array->size * sizeof(int));
+  }
+
+  FingerprintBuilder& Add(const TfLiteFloatArray* array) {
+    if (array == nullptr) {
+      return Add(int64_t{-1});
+    }
+    Add(static_cast<int64_t>(array->size));
+    return Add(array->data, array->size * sizeof(float));
+  }
+
+  uint64_t hash() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 0xCBF29CE484222325ULL;
+};
+
+uint64_t HashData(const char* data, size_t size) {
+  return FingerprintBuilder().Add(data, size).hash();
+}
+
+void AddTensor(TfLiteContext* context, int tensor_index,
+               FingerprintBuilder* builder) {
+  builder->Add(static_cast<int64_t>(tensor_index));
+  if (tensor_index < 0 ||
+      static_cast<size_t>(tensor_index) >= context->tensors_size) {
+    return;
+  }
+  const TfLiteTensor& tensor = context->tensors[tensor_index];
+  builder->Add(static_cast<int64_t>(tensor.type));
+  builder->Add(static_cast<int64_t>(tensor.allocation_type));
+  builder->Add(tensor.dims);
+
+  builder->AddFloat(tensor.params.scale);
+  builder->Add(static_cast<int64_t>(tensor.params.zero_point));
+  builder->Add(static_cast<int64_t>(tensor.quantization.type));
+  if (tensor.quantization.type == kTfLiteAffineQuantization &&
+      tensor.quantization.params != nullptr) {
+    const auto* quantization = static_cast<const TfLiteAffineQuantization*>(
+        tensor.quantization.params);
+    builder->Add(quantization->scale);
+    builder->Add(quantization->zero_point);
+    builder->Add(static_cast<int64_t>(quantization->quantized_dimension));
+  }
+}
+
+// Adds the parameters of the builtin operators that delegates commonly
+// support. Parameter structs are hashed field by field, as their padding is
+// not initialized. Parameters of other operators are not part of the
+// fingerprint, and are covered only by the model token.
+void AddBuiltinData(int builtin_code, const void* builtin_data,
+                    FingerprintBuilder* builder) {
+  if (builtin_data == nullptr) {
+    builder->Add(int64_t{-1});
+    return;
+  }
+  switch (builtin_code) {
+    case kTfLiteBuiltinAdd:
+      builder->Add(static_cast<int64_t>(
+          static_cast<const TfLiteAddParams*>(builtin_data)->activation));
+      break;
+    case kTfLiteBuiltinSub:
+      builder->Add(static_cast<int64_t>(
+          static_cast<const TfLiteSubParams*>(builtin_data)->activation));
+      break;
+    case kTfLiteBuiltinMul:
+      builder->Add(static_cast<int64_t>(
+          static_cast<const TfLiteMulParams*>(builtin_data)->activation));
+      break;
+    case kTfLiteBuiltinDiv:
+      builder->Add(static_cast<int64_t>(
+          static_cast<const TfLiteDivParams*>(builtin_data)->activation));
+      break;
+    case kTfLiteBuiltinAveragePool2d:
+    case kTfLiteBuiltinL2Pool2d:
+    case kTfLiteBuiltinMaxPool2d: {
+      const auto* params = static_cast<const TfLitePoolParams*>(builtin_data);
+      builder->Add(static_cast<int64_t>(params->padding));
+      builder->Add(static_cast<int64_t>(params->stride_width));
+      builder->Add(static_cast<int64_t>(params->stride_height));
+      builder->Add(static_cast<int64_t>(params->filter_width));
+      builder->Add(static_cast<int64_t>(params->filter_height));
+      builder->Add(static_cast<int64_t>(params->activation));
+      break;
+    }
+    case kTfLiteBuiltinConv2d: {
+      const auto* params = static_cast<const TfLiteConvParams*>(builtin_data);
+      builder->Add(static_cast<int64_t>(params->padding));
+      builder->Add(static_cast<int64_t>(params->stride_width));
+      builder->Add(static_cast<int64_t>(params->stride_height));
+      builder->Add(static_cast<int64_t>(params->activation));
+      builder->Add(static_cast<int64_t>(params->dilation_width_factor));
+      builder->Add(static_cast<int64_t>(params->dilation_height_factor));
+      break;
+    }
+    case kTfLiteBuiltinDepthwiseConv2d: {
+      const auto* params =
+          static_cast<const TfLiteDepthwiseConvParams*>(builtin_data);
+      builder->Add(static_cast<int64_t>(params->padding));
+      builder->Add(static_cast<int64_t>(params->stride_width));
+      builder->Add(static_cast<int64_t>(params->stride_height));
+      builder->Add(static_cast<int64_t>(params->depth_multiplier));
+      builder->Add(static_cast<int64_t>(params->activation));
+      builder->Add(static_cast<int64_t>(params->dilation_width_factor));
+      builder->Add(static_cast<int64_t>(params->dilation_height_factor));
+      break;
+    }
+    case kTfLiteBuiltinFullyConnected: {
+      const auto* params =
+          static_cast<const TfLiteFullyConnectedParams*>(builtin_data);
+      builder->Add(static_cast<int64_t>(params->activation));
+      builder->Add(static_cast<int64_t>(params->weights_format));
+      builder->Add(static_cast<int64_t>(params->keep_num_dims));
+      builder->Add(static_cast<int64_t>(params->asymmetric_quantize_inputs));
+      break;
+    }
+    case kTfLiteBuiltinConcatenation: {
+      const auto* params =
+          static_cast<const TfLiteConcatenationParams*>(builtin_data);
+      builder->Add(static_cast<int64_t>(params->axis));
+      builder->Add(static_cast<int64_t>(params->activation));
+      break;
+    }
+    case kTfLiteBuiltinLeakyRelu:
+      builder->AddFloat(
+          static_cast<const TfLiteLeakyReluParams*>(builtin_data)->alpha);
+      break;
+    case kTfLiteBuiltinMean:
+      builder->Add(static_cast<int64_t>(
+          static_cast<const TfLiteReducerParams*>(builtin_data)->keep_dims));
+      break;
+    case kTfLiteBuiltinSoftmax:
+      builder->AddFloat(
+          static_cast<const TfLiteSoftmaxParams*>(builtin_data)->beta);
+      break;
+    default:
+      break;
+  }
+}
+
+TfLiteStatus AddNode(TfLiteContext* context, int node_index,
+                     FingerprintBuilder* builder) {
+  TfLiteNode* node = nullptr;
+  TfLiteRegistration* registration = nullptr;
+  TF_LITE_ENSURE_STATUS(context->GetNodeAndRegistration(
+      context, node_index, &node, &registration));
+  builder->Add(static_cast<int64_t>(node_index));
+  builder->Add(static_cast<int64_t>(registration->builtin_code));
+  builder->Add(static_cast<int64_t>(registration->version));
+  builder->Add(std::string(registration->custom_name != nullptr
+                               ? registration->custom_name
+                               : ""));
+  AddBuiltinData(registration->builtin_code, node->builtin_data, builder);
+  builder->Add(static_cast<int64_t>(node->custom_initial_data_size));
+  if (node->custom_initial_data != nullptr) {
+    builder->Add(node->custom_initial_data, node->custom_initial_data_size);
+  }
+  builder->Add(node->inputs);
+  builder->Add(node->outputs);
+  for (int i = 0; i < node->inputs->size; i++) {
+    AddTensor(context, node->inputs->data[i], builder);
+  }
+  for (int i = 0; i < node->outputs->size; i++) {
+    AddTensor(context, node->outputs->data[i], builder);
+  }
+  return kTfLiteOk;
+}
+
+// Returns a suffix for temporary files which differs between threads and
+// processes writing the same entry concurrently.
+std::string TemporarySuffix() {
+  const uint64_t unique =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+      static_cast<uint64_t>(
+          std::chrono::steady_clock::now().time_since_epoch().count());
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%016llx.tmp",
+           static_cast<unsigned long long>(unique));
+  return suffix;
+}
+
+}  // namespace
+
+TfLiteStatus SerializationEntry::GetData(TfLiteContext* context,
+                                         std::string* data) const {
+  FILE* file = fopen(path_.c_str(), "rb");
+  if (file == nullptr) {
+    // Cache miss: nothing was saved for this fingerprint yet.
+    return kTfLiteError;
+  }
+
+  EntryHeader header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) == 0 &&
+               header.fingerprint == fingerprint_;
+  // The file must end right after the data. This is checked before reading
+  // the data, so that a corrupted size isn't used to size the buffer.
+  const long data_offset = valid ? ftell(file) : -1;  // NOLINT(runtime/int)
+  valid = valid && data_offset >= 0 && fseek(file, 0, SEEK_END) == 0 &&
+          static_cast<uint64_t>(ftell(file) - data_offset) ==
+              header.data_size &&
+          fseek(file, data_offset, SEEK_SET) == 0;
+  if (valid) {
+    data->resize(header.data_size);
+    valid = header.data_size == 0 ||
+            fread(&(*data)[0], header.data_size, 1, file) == 1;
+  }
+  fclose(file);
+
+  if (!valid || HashData(data->data(), data->size()) != header.data_hash) {
+    TFLITE_LOG(TFLITE_LOG_WARNING, "Ignoring invalid delegate cache file %s",
+               path_.c_str());
+    data->clear();
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus SerializationEntry::SetData(TfLiteContext* context,
+                                         const char* data, size_t size) const {
+  EntryHeader header;
+  memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+  header.fingerprint = fingerprint_;
+  header.data_size = size;
+  header.data_hash = HashData(data, size);
+
+  const std::string temporary_path = path_ + TemporarySuffix();
+  FILE* file = fopen(temporary_path.c_str(), "wb");
+  if (file == nullptr) {
+    TFLITE_LOG(TFLITE_LOG_WARNING, "Unable to create delegate cache file %s",
+               temporary_path.c_str());
+    return kTfLiteError;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 (size == 0 || fwrite(data, size, 1, file) == 1);
+  written = (fclose(file) == 0) && written;
+
+  if (written && rename(temporary_path.c_str(), path_.c_str()) != 0) {
+    // rename() does not replace existing files on some platforms.
+    remove(path_.c_str());
+    written = rename(temporary_path.c_str(), path_.c_str()) == 0;
+  }
+  if (!written) {
+    TFLITE_LOG(TFLITE_LOG_WARNING, "Unable to write delegate cache file %s",
+               path_.c_str());
+    remove(temporary_path.c_str());
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+SerializationEntry Serialization::GetEntryForDelegate(
+    const std::string& custom_key, TfLiteContext* context) {
+  FingerprintBuilder builder;
+  builder.Add(model_token_).Add(custom_key);
+  builder.Add(static_cast<int64_t>(context->tensors_size));
+
+  TfLiteIntArray* execution_plan = nullptr;
+  if (context->GetExecutionPlan(context, &execution_plan) != kTfLiteOk) {
+    // Key the entry by the parameters alone; lookups then fail validation of
+    // the node indices in GetDelegatedNodes.
+    builder.Add(std::string("invalid execution plan"));
+    return CreateEntry(builder.hash());
+  }
+  builder.Add(execution_plan);
+  for (int i = 0; i < execution_plan->size; i++) {
+    if (AddNode(context, execution_plan->data[i], &builder) != kTfLiteOk) {
+      builder.Add(std::string("invalid node"));
+    }
+  }
+  return CreateEntry(builder.hash());
+}
+
+SerializationEntry Serialization::CreateEntry(uint64_t fingerprint) const {
+  char file_name[32];
+  snprintf(file_name, sizeof(file_name), "_%016llx.bin",
+           static_cast<unsigned long long>(fingerprint));
+  std::string path = cache_dir_;
+  if (!path.empty() && path.back() != '/') {
+    path.push_back('/');
+  }
+  return SerializationEntry(path + model_token_ + file_name, fingerprint);
+}
+
+TfLiteStatus SaveDelegatedNodes(TfLiteContext* context,
+                                Serialization* serialization,
+                                const std::string& delegate_id,
+                                const TfLiteIntArray* node_ids) {
+  if (serialization == nullptr || node_ids == nullptr) {
+    return kTfLiteError;
+  }
+  const SerializationEntry entry =
+      serialization->GetEntryForDelegate(delegate_id, context);
+  return entry.SetData(context, reinterpret_cast<const char*>(node_ids->data),
+                       node_ids->size * sizeof(int));
+}
+
+TfLiteStatus GetDelegatedNodes(TfLiteContext* context,
+                               Serialization* serialization,
+                               const std::string& delegate_id,
+                               TfLiteIntArray** node_ids) {
+  if (serialization == nullptr || node_ids == nullptr) {
+    return kTfLiteError;
+  }
+  const SerializationEntry entry =
+      serialization->GetEntryForDelegate(delegate_id, context);
+  std::string data;
+  TF_LITE_ENSURE_STATUS(entry.GetData(context, &data));
+  if (data.size() % sizeof(int) != 0) {
+    return kTfLiteError;
+  }
+
+  // The fingerprint covers the execution plan, but check the node indices
+  // anyway, as the delegate trusts them without further validation.
+  TfLiteIntArray* execution_plan = nullptr;
+  TF_LITE_ENSURE_STATUS(context->GetExecutionPlan(context, &execution_plan));
+  const std::unordered_set<int> plan_nodes(
+      &execution_plan->data[0], &execution_plan->data[execution_plan->size]);
+
+  const int num_nodes = data.size() / sizeof(int);
+  TfLiteIntArray* result = TfLiteIntArrayCreate(num_nodes);
+  memcpy(result->data, data.data(), data.size());
+  for (int i = 0; i < num_nodes; i++) {
+    if (plan_nodes.count(result->data[i]) == 0) {
+      TfLiteIntArrayFree(result);
+      return kTfLiteError;
+    }
+  }
+  *node_ids = result;
+  return kTfLiteOk;
+}
+
+}  // namespace delegates
+}  // namespace tflite
@@ -0,0 +1,118 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_DELEGATES_SERIALIZATION_H_
+#define TENSORFLOW_LITE_DELEGATES_SERIALIZATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/lite/c/common.h"
+
+// Utilities for delegates to cache the partitioning of the graph across
+// interpreter instances, in files next to the model. Each cache entry is
+// identified by a fingerprint of the model token, a delegate-specific key, and
+// the structure of the graph, i.e. the operators with their parameters and the
+// types, shapes and quantization of their tensors. Entries written for a
+// different model, delegate configuration, or TensorFlow Lite graph are thus
+// never reused.
+//
+// Typical usage in TfLiteDelegate::Prepare:
+//
+//   TfLiteIntArray* nodes_to_delegate = nullptr;
+//   if (GetDelegatedNodes(context, serialization, "my_delegate_v1",
+//                         &nodes_to_delegate) != kTfLiteOk) {
+//     nodes_to_delegate = ComputeNodesToDelegate(context);
+//     SaveDelegatedNodes(context, serialization, "my_delegate_v1",
+//                        nodes_to_delegate);
+//   }
+//
+// WARNING: This is an experimental API and subject to change.
+namespace tflite {
+namespace delegates {
+
+struct SerializationParams {
+  // Token that uniquely identifies the model, e.g. a hash of the model file.
+  // Static tensor data is not part of the fingerprint, so the token must
+  // change whenever the weights of the model change. Used as a prefix of the
+  // cache file names, and thus must be a valid file name.
+  std::string model_token;
+  // Existing directory, writable by the application, to store cache files in.
+  std::string cache_dir;
+};
+
+// A single cache entry, i.e. one file in the cache directory.
+class SerializationEntry {
+ public:
+  // Reads the data of the entry. Returns kTfLiteError if the entry does not
+  // exist, or if it is corrupted or was written for a different fingerprint.
+  TfLiteStatus GetData(TfLiteContext* context, std::string* data) const;
+
+  // Overwrites the data of the entry. The file is written under a temporary
+  // name and then renamed, so concurrent readers never see partial data.
+  TfLiteStatus SetData(TfLiteContext* context, const char* data,
+                       size_t size) const;
+
+  uint64_t fingerprint() const { return fingerprint_; }
+  const std::string& path() const { return path_; }
+
+ private:
+  friend class Serialization;
+
+  SerializationEntry(const std::string& path, uint64_t fingerprint)
+      : path_(path), fingerprint_(fingerprint) {}
+
+  std::string path_;
+  uint64_t fingerprint_;
+};
+
+class Serialization {
+ public:
+  explicit Serialization(const SerializationParams& params)
+      : model_token_(params.model_token), cache_dir_(params.cache_dir) {}
+
+  // Returns the entry for data that depends on the whole graph, e.g. the set
+  // of nodes claimed by the delegate. Must be called from
+  // TfLiteDelegate::Prepare, before the graph is partitioned.
+  SerializationEntry GetEntryForDelegate(const std::string& custom_key,
+                                         TfLiteContext* context);
+
+ private:
+  SerializationEntry CreateEntry(uint64_t fingerprint) const;
+
+  std::string model_token_;
+  std::string cache_dir_;
+};
+
+// Saves the indices of the nodes claimed by the delegate identified by
+// `delegate_id`, which must also identify all delegate options that affect
+// the partitioning.
+TfLiteStatus SaveDelegatedNodes(TfLiteContext* context,
+                                Serialization* serialization,
+                                const std::string& delegate_id,
+                                const TfLiteIntArray* node_ids);
+
+// Restores the indices of the nodes saved with SaveDelegatedNodes for the same
+// delegate and graph. On success, the caller owns `*node_ids` and must release
+// it with TfLiteIntArrayFree. Returns kTfLiteError on a cache miss.
+TfLiteStatus GetDelegatedNodes(TfLiteContext* context,
+                               Serialization* serialization,
+                               const std::string& delegate_id,
+                               TfLiteIntArray** node_ids);
+
+}  // namespace delegates
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_SERIALIZATION_H_
@@ -0,0 +1,338 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/serialization.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace delegates {
+namespace {
+
+// Registration of an ADD op, which ignores its fused activation.
+TfLiteRegistration AddOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.builtin_code = kTfLiteBuiltinAdd;
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input = GetInput(context, node, 0);
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input1 = GetInput(context, node, 0);
+    const TfLiteTensor* input2 = GetInput(context, node, 1);
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    for (int i = 0; i < NumElements(output); i++) {
+      output->data.f[i] = input1->data.f[i] + input2->data.f[i];
+    }
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+// Builds a graph of three ADD ops. `activation` is the fused activation of
+// the last op, and `scale` the quantization scale of its output.
+std::unique_ptr<Interpreter> BuildInterpreter(
+    int size, TfLiteFusedActivation activation = kTfLiteActNone,
+    float scale = 0.0f) {
+  std::unique_ptr<Interpreter> interpreter(new Interpreter);
+  interpreter->AddTensors(5);
+  interpreter->SetInputs({0, 1});
+  interpreter->SetOutputs({3, 4});
+  TfLiteQuantizationParams quant;
+  for (int t = 0; t < 4; t++) {
+    interpreter->SetTensorParametersReadWrite(t, kTfLiteFloat32, "", {size},
+                                              quant);
+  }
+  quant.scale = scale;
+  interpreter->SetTensorParametersReadWrite(4, kTfLiteFloat32, "", {size},
+                                            quant);
+  TfLiteRegistration reg = AddOpRegistration();
+  const TfLiteFusedActivation activations[] = {kTfLiteActNone, kTfLiteActNone,
+                                               activation};
+  const std::vector<std::vector<int>> inputs = {{0, 0}, {1, 1}, {2, 1}};
+  for (int node = 0; node < 3; node++) {
+    // The interpreter takes ownership of the parameters.
+    auto* params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    params->activation = activations[node];
+    interpreter->AddNodeWithParameters(inputs[node], {node + 2}, nullptr, 0,
+                                       params, &reg);
+  }
+  return interpreter;
+}
+
+// Delegate which claims a fixed set of nodes unless a cached set exists.
+class CachingDelegate {
+ public:
+  CachingDelegate(Serialization* serialization, const std::string& delegate_id,
+                  const std::vector<int>& nodes)
+      : serialization_(serialization),
+        delegate_id_(delegate_id),
+        nodes_(nodes) {
+    delegate_.data_ = this;
+    delegate_.Prepare = Prepare;
+  }
+
+  TfLiteDelegate* get() { return &delegate_; }
+  bool nodes_cache_hit() const { return nodes_cache_hit_; }
+  const std::vector<int>& delegated_nodes() const { return delegated_nodes_; }
+
+ private:
+  static TfLiteStatus Prepare(TfLiteContext* context,
+                              TfLiteDelegate* delegate) {
+    auto* self = static_cast<CachingDelegate*>(delegate->data_);
+    TfLiteIntArray* nodes = nullptr;
+    self->nodes_cache_hit_ =
+        GetDelegatedNodes(context, self->serialization_, self->delegate_id_,
+                          &nodes) == kTfLiteOk;
+    if (!self->nodes_cache_hit_) {
+      nodes = ConvertVectorToTfLiteIntArray(self->nodes_);
+      TF_LITE_ENSURE_STATUS(SaveDelegatedNodes(context, self->serialization_,
+                                               self->delegate_id_, nodes));
+    }
+    self->delegated_nodes_.assign(&nodes->data[0], &nodes->data[nodes->size]);
+
+    TfLiteRegistration registration = {nullptr, nullptr, nullptr, nullptr};
+    registration.custom_name = "caching_delegate_kernel";
+    const TfLiteStatus status = context->ReplaceNodeSubsetsWithDelegateKernels(
+        context, registration, nodes, delegate);
+    TfLiteIntArrayFree(nodes);
+    return status;
+  }
+
+  TfLiteDelegate delegate_ = TfLiteDelegateCreate();
+  Serialization* serialization_;
+  std::string delegate_id_;
+  std::vector<int> nodes_;
+  std::vector<int> delegated_nodes_;
+  bool nodes_cache_hit_ = false;
+};
+
+// Returns the path of the entry of `serialization` for the node list of
+// delegate "delegate" and the graph of BuildInterpreter(3).
+std::string GetDelegateEntryPath(Serialization* serialization) {
+  auto interpreter = BuildInterpreter(3);
+  std::pair<Serialization*, std::string> lookup(serialization, "");
+  TfLiteDelegate delegate = TfLiteDelegateCreate();
+  delegate.data_ = &lookup;
+  delegate.Prepare = [](TfLiteContext* context,
+                        TfLiteDelegate* delegate) -> TfLiteStatus {
+    auto* lookup =
+        static_cast<std::pair<Serialization*, std::string>*>(delegate->data_);
+    lookup->second =
+        lookup->first->GetEntryForDelegate("delegate", context).path();
+    return kTfLiteOk;
+  };
+  EXPECT_EQ(interpreter->ModifyGraphWithDelegate(&delegate), kTfLiteOk);
+  return lookup.second;
+}
+
+class SerializationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Use a fresh model token, so that files left in the temporary directory
+    // by previous runs are never hit.
+    std::random_device random_device;
+    model_token_ =
+        std::string(
+            ::testing::UnitTest::GetInstance()->current_test_info()->name()) +
+        "_" + std::to_string(random_device());
+  }
+
+  SerializationParams Params() const {
+    SerializationParams params;
+    params.model_token = model_token_;
+    params.cache_dir = ::testing::TempDir();
+    return params;
+  }
+
+ private:
+  std::string model_token_;
+};
+
+TEST_F(SerializationTest, RestoresDelegatedNodes) {
+  Serialization serialization(Params());
+  {
+    auto interpreter = BuildInterpreter(3);
+    CachingDelegate delegate(&serialization, "delegate", {0, 1});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+    EXPECT_FALSE(delegate.nodes_cache_hit());
+  }
+  {
+    auto interpreter = BuildInterpreter(3);
+    // The delegate would claim node 2 on a cache miss.
+    CachingDelegate delegate(&serialization, "delegate", {2});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+    EXPECT_TRUE(delegate.nodes_cache_hit());
+    EXPECT_THAT(delegate.delegated_nodes(), ::testing::ElementsAre(0, 1));
+    ASSERT_EQ(interpreter->execution_plan().size(), 2);
+  }
+}
+
+TEST_F(SerializationTest, DifferentModelTokenMisses) {
+  Serialization serialization(Params());
+  SerializationParams other_params = Params();
+  other_params.model_token += "_other";
+  Serialization other_serialization(other_params);
+
+  auto interpreter = BuildInterpreter(3);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  auto other_interpreter = BuildInterpreter(3);
+  CachingDelegate other_delegate(&other_serialization, "delegate", {0, 1});
+  ASSERT_EQ(other_interpreter->ModifyGraphWithDelegate(other_delegate.get()),
+            kTfLiteOk);
+  EXPECT_FALSE(other_delegate.nodes_cache_hit());
+}
+
+TEST_F(SerializationTest, DifferentDelegateIdMisses) {
+  Serialization serialization(Params());
+
+  auto interpreter = BuildInterpreter(3);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  auto other_interpreter = BuildInterpreter(3);
+  CachingDelegate other_delegate(&serialization, "delegate_v2", {0, 1});
+  ASSERT_EQ(other_interpreter->ModifyGraphWithDelegate(other_delegate.get()),
+            kTfLiteOk);
+  EXPECT_FALSE(other_delegate.nodes_cache_hit());
+}
+
+TEST_F(SerializationTest, DifferentGraphMisses) {
+  Serialization serialization(Params());
+
+  auto interpreter = BuildInterpreter(3);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  auto other_interpreter = BuildInterpreter(4);
+  CachingDelegate other_delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(other_interpreter->ModifyGraphWithDelegate(other_delegate.get()),
+            kTfLiteOk);
+  EXPECT_FALSE(other_delegate.nodes_cache_hit());
+}
+
+TEST_F(SerializationTest, DifferentOpParamsMiss) {
+  Serialization serialization(Params());
+
+  auto interpreter = BuildInterpreter(3);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  auto other_interpreter = BuildInterpreter(3, kTfLiteActRelu);
+  CachingDelegate other_delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(other_interpreter->ModifyGraphWithDelegate(other_delegate.get()),
+            kTfLiteOk);
+  EXPECT_FALSE(other_delegate.nodes_cache_hit());
+}
+
+TEST_F(SerializationTest, DifferentQuantizationMisses) {
+  Serialization serialization(Params());
+
+  auto interpreter = BuildInterpreter(3, kTfLiteActNone, /*scale=*/0.5f);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  auto other_interpreter = BuildInterpreter(3, kTfLiteActNone, /*scale=*/0.25f);
+  CachingDelegate other_delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(other_interpreter->ModifyGraphWithDelegate(other_delegate.get()),
+            kTfLiteOk);
+  EXPECT_FALSE(other_delegate.nodes_cache_hit());
+}
+
+TEST_F(SerializationTest, CorruptedEntryIsIgnored) {
+  Serialization serialization(Params());
+  {
+    auto interpreter = BuildInterpreter(3);
+    CachingDelegate delegate(&serialization, "delegate", {0, 1});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  }
+
+  // Corrupt the saved node list, as a partially written file would.
+  const std::string entry_path = GetDelegateEntryPath(&serialization);
+  ASSERT_FALSE(entry_path.empty());
+  {
+    FILE* file = fopen(entry_path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(fseek(file, -1, SEEK_END), 0);
+    ASSERT_EQ(fputc(0x7F, file), 0x7F);
+    fclose(file);
+  }
+
+  {
+    auto interpreter = BuildInterpreter(3);
+    CachingDelegate delegate(&serialization, "delegate", {0, 1});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+    EXPECT_FALSE(delegate.nodes_cache_hit());
+  }
+  // The invalid entry is replaced on a miss.
+  {
+    auto interpreter = BuildInterpreter(3);
+    CachingDelegate delegate(&serialization, "delegate", {0, 1});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+    EXPECT_TRUE(delegate.nodes_cache_hit());
+  }
+}
+
+TEST_F(SerializationTest, EntryWithOversizedDataIsIgnored) {
+  Serialization serialization(Params());
+  {
+    auto interpreter = BuildInterpreter(3);
+    CachingDelegate delegate(&serialization, "delegate", {0, 1});
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  }
+
+  // Claim more data than the file holds, in the size field which follows the
+  // 8-byte magic and the 8-byte fingerprint of the header. The entry must be
+  // rejected before the size is used to allocate its buffer.
+  const std::string entry_path = GetDelegateEntryPath(&serialization);
+  ASSERT_FALSE(entry_path.empty());
+  {
+    FILE* file = fopen(entry_path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    const uint64_t data_size = uint64_t{1} << 62;
+    ASSERT_EQ(fseek(file, 16, SEEK_SET), 0);
+    ASSERT_EQ(fwrite(&data_size, sizeof(data_size), 1, file), 1);
+    fclose(file);
+  }
+
+  auto interpreter = BuildInterpreter(3);
+  CachingDelegate delegate(&serialization, "delegate", {0, 1});
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  EXPECT_FALSE(delegate.nodes_cache_hit());
+}
+
+}  // namespace
+}  // namespace delegates
+}  // namespace tflite
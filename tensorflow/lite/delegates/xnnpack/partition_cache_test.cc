@@ -0,0 +1,203 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/serialization.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace xnnpack {
+namespace {
+
+// Must match the key used by the delegate for its partitioning cache.
+constexpr char kPartitionCacheKey[] = "xnnpack_partition_v1";
+
+// Builds a graph computing (input1 + input2) + input2 with two ADD nodes,
+// both of which XNNPACK supports.
+std::unique_ptr<Interpreter> BuildInterpreter() {
+  std::unique_ptr<Interpreter> interpreter(new Interpreter);
+  interpreter->AddTensors(4);
+  interpreter->SetInputs({0, 1});
+  interpreter->SetOutputs({3});
+  TfLiteQuantizationParams quant;
+  for (int t = 0; t < 4; t++) {
+    interpreter->SetTensorParametersReadWrite(t, kTfLiteFloat32, "", {1, 2},
+                                              quant);
+  }
+  TfLiteRegistration registration = *ops::builtin::Register_ADD();
+  registration.builtin_code = kTfLiteBuiltinAdd;
+  registration.version = 1;
+  for (const std::vector<int>& inputs :
+       std::vector<std::vector<int>>{{0, 1}, {2, 1}}) {
+    auto* params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    params->activation = kTfLiteActNone;
+    interpreter->AddNodeWithParameters(inputs, {inputs[0] + 2}, nullptr, 0,
+                                       params, &registration);
+  }
+  return interpreter;
+}
+
+// Delegate which runs `callback` on the graph without claiming any node.
+class InspectingDelegate {
+ public:
+  explicit InspectingDelegate(
+      std::function<TfLiteStatus(TfLiteContext*)> callback)
+      : callback_(std::move(callback)) {
+    delegate_.data_ = this;
+    delegate_.Prepare = [](TfLiteContext* context,
+                           TfLiteDelegate* delegate) -> TfLiteStatus {
+      return static_cast<InspectingDelegate*>(delegate->data_)
+          ->callback_(context);
+    };
+  }
+
+  TfLiteDelegate* get() { return &delegate_; }
+
+ private:
+  TfLiteDelegate delegate_ = TfLiteDelegateCreate();
+  std::function<TfLiteStatus(TfLiteContext*)> callback_;
+};
+
+class PartitionCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Use a fresh model token, so that files left in the temporary directory
+    // by previous runs are never hit.
+    std::random_device random_device;
+    model_token_ =
+        std::string(
+            ::testing::UnitTest::GetInstance()->current_test_info()->name()) +
+        "_" + std::to_string(random_device());
+    cache_dir_ = ::testing::TempDir();
+  }
+
+  std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> CreateDelegate()
+      const {
+    TfLiteXNNPackDelegateOptions options =
+        TfLiteXNNPackDelegateOptionsDefault();
+    options.cache_dir = cache_dir_.c_str();
+    options.model_token = model_token_.c_str();
+    return std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)>(
+        TfLiteXNNPackDelegateCreate(&options), TfLiteXNNPackDelegateDelete);
+  }
+
+  delegates::Serialization CreateSerialization() const {
+    delegates::SerializationParams params;
+    params.cache_dir = cache_dir_;
+    params.model_token = model_token_;
+    return delegates::Serialization(params);
+  }
+
+  // Returns the nodes cached for the graph of BuildInterpreter, or an empty
+  // vector on a cache miss.
+  std::vector<int> GetCachedNodes() const {
+    delegates::Serialization serialization = CreateSerialization();
+    std::vector<int> cached_nodes;
+    InspectingDelegate delegate([&](TfLiteContext* context) {
+      TfLiteIntArray* nodes = nullptr;
+      if (delegates::GetDelegatedNodes(context, &serialization,
+                                       kPartitionCacheKey,
+                                       &nodes) == kTfLiteOk) {
+        cached_nodes.assign(&nodes->data[0], &nodes->data[nodes->size]);
+        TfLiteIntArrayFree(nodes);
+      }
+      return kTfLiteOk;
+    });
+    auto interpreter = BuildInterpreter();
+    EXPECT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+    return cached_nodes;
+  }
+
+  // Replaces the nodes cached for the graph of BuildInterpreter.
+  void SetCachedNodes(const std::vector<int>& cached_nodes) const {
+    delegates::Serialization serialization = CreateSerialization();
+    InspectingDelegate delegate([&](TfLiteContext* context) {
+      TfLiteIntArray* nodes = ConvertVectorToTfLiteIntArray(cached_nodes);
+      const TfLiteStatus status = delegates::SaveDelegatedNodes(
+          context, &serialization, kPartitionCacheKey, nodes);
+      TfLiteIntArrayFree(nodes);
+      return status;
+    });
+    auto interpreter = BuildInterpreter();
+    ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  }
+
+  static void ExpectOutput(Interpreter* interpreter) {
+    ASSERT_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+    interpreter->typed_tensor<float>(0)[0] = 1.0f;
+    interpreter->typed_tensor<float>(0)[1] = 2.0f;
+    interpreter->typed_tensor<float>(1)[0] = 10.0f;
+    interpreter->typed_tensor<float>(1)[1] = 20.0f;
+    ASSERT_EQ(interpreter->Invoke(), kTfLiteOk);
+    EXPECT_EQ(interpreter->typed_tensor<float>(3)[0], 21.0f);
+    EXPECT_EQ(interpreter->typed_tensor<float>(3)[1], 42.0f);
+  }
+
+  static int GetBuiltinCode(const Interpreter& interpreter, int plan_index) {
+    return interpreter
+        .node_and_registration(interpreter.execution_plan()[plan_index])
+        ->second.builtin_code;
+  }
+
+ private:
+  std::string model_token_;
+  std::string cache_dir_;
+};
+
+TEST_F(PartitionCacheTest, SavesPartitioningOnMiss) {
+  auto delegate = CreateDelegate();
+  auto interpreter = BuildInterpreter();
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  ASSERT_EQ(interpreter->execution_plan().size(), 1);
+  EXPECT_EQ(GetBuiltinCode(*interpreter, 0), kTfLiteBuiltinDelegate);
+  ExpectOutput(interpreter.get());
+
+  EXPECT_EQ(GetCachedNodes(), std::vector<int>({0, 1}));
+}
+
+TEST_F(PartitionCacheTest, DelegatesCachedNodesOnHit) {
+  // A cached partitioning claiming a subset of the supported nodes is used
+  // as is, which shows that the nodes were not checked again.
+  SetCachedNodes({0});
+  auto delegate = CreateDelegate();
+  auto interpreter = BuildInterpreter();
+  ASSERT_EQ(interpreter->ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+  ASSERT_EQ(interpreter->execution_plan().size(), 2);
+  EXPECT_EQ(GetBuiltinCode(*interpreter, 0), kTfLiteBuiltinDelegate);
+  EXPECT_EQ(GetBuiltinCode(*interpreter, 1), kTfLiteBuiltinAdd);
+  ExpectOutput(interpreter.get());
+
+  // The cache is left as is on a hit.
+  EXPECT_EQ(GetCachedNodes(), std::vector<int>({0}));
+}
+
+}  // namespace
+}  // namespace xnnpack
+}  // namespace tflite
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/lite/builtin_ops.h"
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/serialization.h"
 #include "tensorflow/lite/minimal_logging.h"
 #include "tensorflow/lite/tools/optimize/sparsity/format_converter.h"
 
@@ -42,6 +43,10 @@ namespace {
 // Forward declaration.
 TfLiteStatus DelegatePrepare(TfLiteContext* context, TfLiteDelegate* delegate);
 
+// Identifies the rules for selecting nodes in the partitioning cache. Must be
+// updated whenever the set of nodes supported by the delegate changes.
+constexpr char kPartitionCacheKey[] = "xnnpack_partition_v1";
+
 class Delegate {
   friend class Subgraph;
 
@@ -53,6 +58,13 @@ class Delegate {
           pthreadpool_create(static_cast<size_t>(options->num_threads)));
     }
 #endif
+    if (options != nullptr && options->cache_dir != nullptr &&
+        options->model_token != nullptr) {
+      delegates::SerializationParams serialization_params;
+      serialization_params.cache_dir = options->cache_dir;
+      serialization_params.model_token = options->model_token;
+      serialization_.reset(new delegates::Serialization(serialization_params));
+    }
     TFLITE_LOG_PROD_ONCE(tflite::TFLITE_LOG_INFO,
                          "Created TensorFlow Lite XNNPACK delegate for CPU.");
   }
@@ -89,6 +101,8 @@ class Delegate {
   // ignored in the delegate implementation, because their outputs are
   // pre-unpacked in DelegatePrepare.
   std::unordered_set<int> static_unpack_nodes_;
+  // Cache of the nodes claimed by the delegate, if enabled in the options.
+  std::unique_ptr<delegates::Serialization> serialization_;
 #if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
   // Thread pool with smart-pointer for lifetime management.
   std::unique_ptr<pthreadpool, decltype(&pthreadpool_destroy)> threadpool_{
@@ -1168,7 +1182,7 @@ class Subgraph {
 
     const TfLiteTensor& bias_tensor = tensors[node->inputs->data[2]];
     TF_LITE_ENSURE_STATUS(CheckTensorFloatType(
-        logging_context, filter_tensor, node->inputs->data[2], node_index));
+        logging_context, bias_tensor, node->inputs->data[2], node_index));
     TF_LITE_ENSURE_STATUS(CheckTensorShape(logging_context, bias_tensor, 1,
                                            node->inputs->data[2]));
     if (quasi_static_tensors.count(node->inputs->data[2]) == 0) {
@@ -1256,7 +1270,7 @@ class Subgraph {
 
     const TfLiteTensor& bias_tensor = tensors[node->inputs->data[2]];
     TF_LITE_ENSURE_STATUS(CheckTensorFloatType(
-        logging_context, filter_tensor, node->inputs->data[2], node_index));
+        logging_context, bias_tensor, node->inputs->data[2], node_index));
     TF_LITE_ENSURE_STATUS(CheckTensorShape(logging_context, bias_tensor, 1,
                                            node->inputs->data[2]));
     if (quasi_static_tensors.count(node->inputs->data[2]) == 0) {
@@ -1401,7 +1415,7 @@ class Subgraph {
 
     const TfLiteTensor& bias_tensor = tensors[node->inputs->data[2]];
     TF_LITE_ENSURE_STATUS(CheckTensorFloatType(
-        logging_context, filter_tensor, node->inputs->data[2], node_index));
+        logging_context, bias_tensor, node->inputs->data[2], node_index));
     TF_LITE_ENSURE_STATUS(CheckTensorShape(logging_context, bias_tensor, 1,
                                            node->inputs->data[2]));
     if (quasi_static_tensors.count(node->inputs->data[2]) == 0) {
@@ -1857,7 +1871,7 @@ class Subgraph {
 
     const TfLiteTensor& bias_tensor = tensors[node->inputs->data[2]];
     TF_LITE_ENSURE_STATUS(CheckTensorFloatType(
-        logging_context, filter_tensor, node->inputs->data[2], node_index));
+        logging_context, bias_tensor, node->inputs->data[2], node_index));
     TF_LITE_ENSURE_STATUS(CheckTensorShape(logging_context, bias_tensor, 1,
                                            node->inputs->data[2]));
     if (quasi_static_tensors.count(node->inputs->data[2]) == 0) {
@@ -2564,6 +2578,21 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     return nullptr;
   }
 
+  // Nodes claimed by the delegate for the same model and graph in an earlier
+  // run. When available, these are delegated without checking them again.
+  std::unordered_set<int> cached_nodes;
+  bool use_cached_nodes = false;
+  if (serialization_ != nullptr) {
+    TfLiteIntArray* nodes = nullptr;
+    if (delegates::GetDelegatedNodes(context, serialization_.get(),
+                                     kPartitionCacheKey,
+                                     &nodes) == kTfLiteOk) {
+      cached_nodes.insert(&nodes->data[0], &nodes->data[nodes->size]);
+      TfLiteIntArrayFree(nodes);
+      use_cached_nodes = true;
+    }
+  }
+
   // Mapping for quasi-static (unpacked from static) tensor index to the node
   // index that produced it.
   std::unordered_map<int, int> quasi_static_tensors_producers;
@@ -2634,9 +2663,13 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
       }
     }
 
-    if (Subgraph::VisitNode(/*subgraph=*/nullptr, context, registration, node,
-                            node_index, quasi_static_tensors,
-                            std::vector<uint32_t>()) != kTfLiteOk) {
+    const bool is_supported =
+        use_cached_nodes
+            ? cached_nodes.count(node_index) != 0
+            : Subgraph::VisitNode(/*subgraph=*/nullptr, context, registration,
+                                  node, node_index, quasi_static_tensors,
+                                  std::vector<uint32_t>()) == kTfLiteOk;
+    if (!is_supported) {
       // If a non-delegated node consumes output of a node that unpacks static
       // data, that node shouldn't be delegated.
       for (int j = 0; j < node->inputs->size; j++) {
@@ -2799,6 +2832,12 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
   std::sort(&nodes_to_delegate->data[0],
             &nodes_to_delegate->data[nodes_to_delegate->size]);
 
+  if (serialization_ != nullptr && !use_cached_nodes) {
+    // Failing to write the cache only costs the next run some time.
+    delegates::SaveDelegatedNodes(context, serialization_.get(),
+                                  kPartitionCacheKey, nodes_to_delegate);
+  }
+
 #ifdef XNNPACK_DELEGATE_TEST_MODE
   // In the test mode build (used by unit tests), XNNPACK delegate claims to
   // support all operators in the execution plan to disable fallback to the
@@ -26,6 +26,14 @@ typedef struct {
   // Number of threads to use in the thread pool.
   // 0 or negative value means no thread pool used.
   int32_t num_threads;
+  // Existing directory to cache the partitioning of the model in, so that
+  // later interpreters for the same model skip checking which operators the
+  // delegate supports. Caching is disabled when `cache_dir` or `model_token`
+  // is null. Experimental, see tensorflow/lite/delegates/serialization.h.
+  const char* cache_dir;
+  // Token that uniquely identifies the model and its weights, e.g. a hash of
+  // the model file. Used as the prefix of the names of the cache files.
+  const char* model_token;
 } TfLiteXNNPackDelegateOptions;
 
 // Returns a structure with the default XNNPack delegate options.
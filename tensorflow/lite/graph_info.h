@@ -45,6 +45,12 @@ class GraphInfo {
   // index.
   virtual size_t node_index(size_t index) const = 0;
 
+  // Returns the step at which the node at `index` is executed. Nodes that are
+  // executed at the same step may run concurrently, and nodes at later steps
+  // only start once all nodes at earlier steps are done. By default, nodes
+  // are executed one at a time in order.
+  virtual size_t node_execution_step(size_t index) const { return index; }
+
   // Returns the indices of the input tensors.
   virtual const std::vector<int>& inputs() const = 0;
 
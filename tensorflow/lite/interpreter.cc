@@ -249,6 +249,11 @@ TfLiteStatus Interpreter::Invoke() {
   return kTfLiteOk;
 }
 
+TfLiteStatus Interpreter::CreateExecutionContext(
+    std::unique_ptr<ExecutionContext>* execution_context) {
+  return ExecutionContext::Create(&primary_subgraph(), execution_context);
+}
+
 TfLiteStatus Interpreter::AddTensors(int tensors_to_add,
                                      int* first_new_tensor_index) {
   return primary_subgraph().AddTensors(tensors_to_add, first_new_tensor_index);
@@ -312,6 +317,7 @@ void Interpreter::SetNumThreads(int num_threads) {
 
   for (auto& subgraph : subgraphs_) {
     subgraph->context()->recommended_num_threads = num_threads;
+    subgraph->RefreshInterOpCpuBackendContexts();
   }
 
   for (int i = 0; i < kTfLiteMaxExternalContexts; ++i) {
@@ -322,6 +328,36 @@ void Interpreter::SetNumThreads(int num_threads) {
   }
 }
 
+TfLiteStatus Interpreter::SetNumInterOpThreads(int num_threads) {
+  for (auto& subgraph : subgraphs_) {
+    TF_LITE_ENSURE_STATUS(subgraph->SetNumInterOpThreads(num_threads));
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Interpreter::SetAllocationPlanCacheSize(int num_plans) {
+  for (auto& subgraph : subgraphs_) {
+    TF_LITE_ENSURE_STATUS(subgraph->SetAllocationPlanCacheSize(num_plans));
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Interpreter::SetArenaPlanningStrategy(
+    ArenaPlanningStrategy strategy) {
+  for (auto& subgraph : subgraphs_) {
+    TF_LITE_ENSURE_STATUS(subgraph->SetArenaPlanningStrategy(strategy));
+  }
+  return kTfLiteOk;
+}
+
+size_t Interpreter::GetArenaSize(TfLiteAllocationType type) const {
+  size_t size = 0;
+  for (const auto& subgraph : subgraphs_) {
+    size += subgraph->GetArenaSize(type);
+  }
+  return size;
+}
+
 void Interpreter::SetAllowFp16PrecisionForFp32(bool allow) {
   for (auto& subgraph : subgraphs_) {
     subgraph->context()->allow_fp32_relax_to_fp16 = allow;
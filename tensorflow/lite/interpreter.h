@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/lite/c/common.h"  // IWYU pragma: export
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/core/execution_context.h"
 #include "tensorflow/lite/core/subgraph.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
 #include "tensorflow/lite/external_cpu_backend_context.h"
@@ -363,6 +364,17 @@ class Interpreter {
   /// Returns status of success or failure.
   TfLiteStatus Invoke();
 
+  /// Create a context that invokes the graph with its own activation memory,
+  /// while sharing the weights and the prepared ops of this interpreter.
+  /// Different contexts may be invoked concurrently, e.g. one per request
+  /// thread. Contexts must be created after Invoke() has been called at least
+  /// once since AllocateTensors(), and again after each AllocateTensors().
+  /// Models with dynamic tensors, delegates or control flow ops aren't
+  /// supported. See ExecutionContext for details.
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus CreateExecutionContext(
+      std::unique_ptr<ExecutionContext>* execution_context);
+
   /// Enable or disable the NN API (true to enable)
   void UseNNAPI(bool enable);
 
@@ -373,6 +385,32 @@ class Interpreter {
   /// available to itself.
   void SetNumThreads(int num_threads);
 
+  /// Set the number of threads used to run independent nodes of the graph
+  /// concurrently. By default (1), nodes run one at a time. Each of these
+  /// threads may in turn use up to the number of threads set with
+  /// SetNumThreads(). Takes effect on the next AllocateTensors().
+  /// See Subgraph::SetNumInterOpThreads() for details.
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetNumInterOpThreads(int num_threads);
+
+  /// Set the number of memory allocation plans cached for different input
+  /// sizes, so that AllocateTensors() after resizing the inputs back to sizes
+  /// seen before doesn't need to plan the allocations again. Must be called
+  /// before AllocateTensors(). See Subgraph::SetAllocationPlanCacheSize().
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetAllocationPlanCacheSize(int num_plans);
+
+  /// Set the strategy used to assign arena memory to tensors. Must be called
+  /// before AllocateTensors(). The default strategy can be selected at build
+  /// time, see ArenaPlanningStrategy.
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetArenaPlanningStrategy(ArenaPlanningStrategy strategy);
+
+  /// Return the number of bytes used in the arenas of the given allocation
+  /// type (kTfLiteArenaRw or kTfLiteArenaRwPersistent) by all subgraphs.
+  /// WARNING: This is an experimental API and subject to change.
+  size_t GetArenaSize(TfLiteAllocationType type) const;
+
   /// Allow float16 precision for FP32 calculation when possible.
   /// default: not allow.
   /// WARNING: This is an experimental API and subject to change.
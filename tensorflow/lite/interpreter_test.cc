@@ -17,12 +17,16 @@ limitations under the License.
 
 #include <stdint.h>
 
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "third_party/eigen3/Eigen/Core"
 #include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
@@ -738,6 +742,203 @@ TEST(BasicInterpreter, ReleaseNonPersistentMemory) {
   ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
 }
 
+TEST(BasicInterpreter, AllocationPlanCache) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(2), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({1}), kTfLiteOk);
+
+  TfLiteQuantizationParams quantized;
+  ASSERT_EQ(interpreter.SetTensorParametersReadWrite(0, kTfLiteFloat32, "in1",
+                                                     {3}, quantized),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.SetTensorParametersReadWrite(1, kTfLiteFloat32, "out0",
+                                                     {3}, quantized),
+            kTfLiteOk);
+
+  TfLiteRegistration reg = GetPassthroughOpRegistration();
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+
+  ASSERT_EQ(interpreter.SetAllocationPlanCacheSize(-1), kTfLiteError);
+  ASSERT_EQ(interpreter.SetAllocationPlanCacheSize(2), kTfLiteOk);
+
+  // Resize the input back and forth, so that cached plans get reused.
+  for (int size : {3, 5, 3, 5, 7, 3}) {
+    ASSERT_EQ(interpreter.ResizeInputTensor(0, {size}), kTfLiteOk);
+    ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+    float* input = interpreter.typed_tensor<float>(0);
+    for (int i = 0; i < size; ++i) {
+      input[i] = i;
+    }
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    ASSERT_EQ(interpreter.tensor(1)->dims->data[0], size);
+    const float* output = interpreter.typed_tensor<float>(1);
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(output[i], i);
+    }
+  }
+
+  // The cache can't be resized once tensors are allocated.
+  ASSERT_EQ(interpreter.SetAllocationPlanCacheSize(4), kTfLiteError);
+}
+
+TEST(BasicInterpreter, ArenaPlanningStrategy) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(2), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({1}), kTfLiteOk);
+
+  TfLiteQuantizationParams quantized;
+  ASSERT_EQ(interpreter.SetTensorParametersReadWrite(0, kTfLiteFloat32, "in1",
+                                                     {3}, quantized),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.SetTensorParametersReadWrite(1, kTfLiteFloat32, "out0",
+                                                     {3}, quantized),
+            kTfLiteOk);
+
+  TfLiteRegistration reg = GetPassthroughOpRegistration();
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+
+  ASSERT_EQ(interpreter.GetArenaSize(kTfLiteArenaRw), 0u);
+  ASSERT_EQ(
+      interpreter.SetArenaPlanningStrategy(ArenaPlanningStrategy::kSmallest),
+      kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  // The input, the output and the two temporaries of the op all overlap.
+  EXPECT_GE(interpreter.GetArenaSize(kTfLiteArenaRw), 4 * 3 * sizeof(float));
+  EXPECT_EQ(interpreter.GetArenaSize(kTfLiteArenaRwPersistent), 0u);
+
+  // The strategy can't be changed once tensors are allocated.
+  ASSERT_EQ(interpreter.SetArenaPlanningStrategy(
+                ArenaPlanningStrategy::kGreedyBySize),
+            kTfLiteError);
+}
+
+TEST(BasicInterpreter, ExecutionContexts) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(3), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({2}), kTfLiteOk);
+
+  TfLiteQuantizationParams quantized;
+  for (int tensor_index = 0; tensor_index < 3; tensor_index++) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(
+                  tensor_index, kTfLiteFloat32, "", {3}, quantized),
+              kTfLiteOk);
+  }
+
+  TfLiteRegistration reg = GetPassthroughOpRegistration();
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({1}, {2}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  // Kernels must have been invoked once before contexts are created.
+  std::unique_ptr<ExecutionContext> contexts[4];
+  ASSERT_EQ(interpreter.CreateExecutionContext(&contexts[0]), kTfLiteError);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+  for (auto& context : contexts) {
+    ASSERT_EQ(interpreter.CreateExecutionContext(&context), kTfLiteOk);
+    ASSERT_EQ(context->inputs(), interpreter.inputs());
+    ASSERT_EQ(context->outputs(), interpreter.outputs());
+    ASSERT_NE(context->typed_input_tensor<float>(0),
+              interpreter.typed_input_tensor<float>(0));
+    ASSERT_EQ(context->typed_input_tensor<int32_t>(0), nullptr);
+  }
+
+  // Contexts can be invoked concurrently, each with its own inputs.
+  interpreter.typed_input_tensor<float>(0)[0] = -1.0f;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&contexts, i]() {
+      ExecutionContext* context = contexts[i].get();
+      for (int j = 0; j < 100; ++j) {
+        float* input = context->typed_input_tensor<float>(0);
+        for (int k = 0; k < 3; ++k) {
+          input[k] = i * 1000 + j * 10 + k;
+        }
+        ASSERT_EQ(context->Invoke(), kTfLiteOk);
+        const float* output = context->typed_output_tensor<float>(0);
+        for (int k = 0; k < 3; ++k) {
+          ASSERT_EQ(output[k], i * 1000 + j * 10 + k);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(interpreter.typed_input_tensor<float>(0)[0], -1.0f);
+
+  // Contexts can't be invoked once the tensors of the interpreter are
+  // allocated again.
+  ASSERT_EQ(interpreter.ResizeInputTensor(0, {5}), kTfLiteOk);
+  ASSERT_EQ(contexts[0]->Invoke(), kTfLiteError);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(contexts[0]->Invoke(), kTfLiteError);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter.CreateExecutionContext(&contexts[0]), kTfLiteOk);
+  ASSERT_EQ(contexts[0]->tensor(2)->dims->data[0], 5);
+  ASSERT_EQ(contexts[0]->Invoke(), kTfLiteOk);
+}
+
+// Counts the ops it profiles.
+class OpCountingProfiler : public Profiler {
+ public:
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override {
+    if (event_type == EventType::OPERATOR_INVOKE_EVENT) ++num_ops;
+    return 0;
+  }
+  void EndEvent(uint32_t event_handle) override {}
+
+  int num_ops = 0;
+};
+
+TEST(BasicInterpreter, ExecutionContextProfiler) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(3), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({2}), kTfLiteOk);
+
+  TfLiteQuantizationParams quantized;
+  for (int tensor_index = 0; tensor_index < 3; tensor_index++) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(
+                  tensor_index, kTfLiteFloat32, "", {3}, quantized),
+              kTfLiteOk);
+  }
+
+  TfLiteRegistration reg = GetPassthroughOpRegistration();
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({1}, {2}, nullptr, 0, nullptr, &reg),
+      kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  std::unique_ptr<ExecutionContext> context;
+  ASSERT_EQ(interpreter.CreateExecutionContext(&context), kTfLiteOk);
+  OpCountingProfiler profiler;
+  context->SetProfiler(&profiler);
+  ASSERT_EQ(context->Invoke(), kTfLiteOk);
+  ASSERT_EQ(context->Invoke(), kTfLiteOk);
+  EXPECT_EQ(profiler.num_ops, 4);
+
+  context->SetProfiler(nullptr);
+  ASSERT_EQ(context->Invoke(), kTfLiteOk);
+  EXPECT_EQ(profiler.num_ops, 4);
+}
+
 // Forcefully divides tensor allocation in three steps: one before invocation
 // and two more at invocation time. This happens because we use string tensors
 // and their sizes can't be determined until invocation time.
@@ -1480,6 +1681,140 @@ TEST_F(CancellationTest, CancelDuringInvoke) {
   ASSERT_EQ(invoke_error_code, kTfLiteError);
 }
 
+// Test fixture to test running independent nodes concurrently.
+class InterOpThreadsTest : public ::testing::Test {
+ protected:
+  // Data of the nodes built by AddOpRegistration().
+  struct OpData {
+    InterOpThreadsTest* test;
+    float addend;
+    // Whether the node waits for another one to run concurrently.
+    bool wait;
+  };
+
+  // Builds the kernel registration for an op that adds up its inputs, and
+  // `OpData::addend`.
+  static TfLiteRegistration AddOpRegistration() {
+    TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+    reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+      const TfLiteTensor* input = GetInput(context, node, 0);
+      TfLiteTensor* output = GetOutput(context, node, 0);
+      return context->ResizeTensor(context, output,
+                                   TfLiteIntArrayCopy(input->dims));
+    };
+    reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+      auto* op_data = static_cast<OpData*>(node->builtin_data);
+      op_data->test->Run(op_data->wait);
+      TfLiteTensor* output = GetOutput(context, node, 0);
+      for (int i = 0; i < NumElements(output); ++i) {
+        output->data.f[i] = op_data->addend;
+        for (int j = 0; j < NumInputs(node); ++j) {
+          output->data.f[i] += GetInput(context, node, j)->data.f[i];
+        }
+      }
+      return kTfLiteOk;
+    };
+    return reg;
+  }
+
+  void AddNode(std::vector<int> inputs, int output, float addend, bool wait) {
+    TfLiteRegistration reg = AddOpRegistration();
+    // Ownership of op_data is taken by the interpreter, which frees it.
+    auto* op_data = static_cast<OpData*>(malloc(sizeof(OpData)));
+    *op_data = {this, addend, wait};
+    ASSERT_EQ(interpreter_.AddNodeWithParameters(
+                  inputs, {output}, nullptr, 0, op_data, &reg),
+              kTfLiteOk);
+  }
+
+  // Records that a node runs. When `wait` is set and `wait_for_concurrent_`
+  // is true, waits for another node to run concurrently, up to a few seconds.
+  void Run(bool wait) {
+    const int running = ++num_running_;
+    int max_running = max_running_;
+    while (running > max_running &&
+           !max_running_.compare_exchange_weak(max_running, running)) {
+    }
+    if (wait && wait_for_concurrent_) {
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (max_running_ < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+    }
+    --num_running_;
+  }
+
+  void SetUp() final {
+    // tensor[1] = tensor[0] + 1 and tensor[2] = tensor[0] + 2 don't depend on
+    // each other, and tensor[3] = tensor[1] + tensor[2] depends on both.
+    ASSERT_EQ(interpreter_.AddTensors(4), kTfLiteOk);
+    ASSERT_EQ(interpreter_.SetInputs({0}), kTfLiteOk);
+    ASSERT_EQ(interpreter_.SetOutputs({3}), kTfLiteOk);
+    TfLiteQuantizationParams quantized;
+    for (int tensor_index = 0; tensor_index < 4; tensor_index++) {
+      ASSERT_EQ(interpreter_.SetTensorParametersReadWrite(
+                    tensor_index, kTfLiteFloat32, "", {3}, quantized),
+                kTfLiteOk);
+    }
+    AddNode({0}, 1, 1.0f, /*wait=*/true);
+    AddNode({0}, 2, 2.0f, /*wait=*/true);
+    AddNode({1, 2}, 3, 0.0f, /*wait=*/false);
+  }
+
+  void CheckOutput() {
+    float* input = interpreter_.typed_tensor<float>(0);
+    input[0] = 1.0f;
+    input[1] = 2.0f;
+    input[2] = 3.0f;
+    ASSERT_EQ(interpreter_.Invoke(), kTfLiteOk);
+    const float* output = interpreter_.typed_tensor<float>(3);
+    EXPECT_EQ(output[0], 5.0f);
+    EXPECT_EQ(output[1], 7.0f);
+    EXPECT_EQ(output[2], 9.0f);
+  }
+
+  Interpreter interpreter_;
+  std::atomic<int> num_running_{0};
+  std::atomic<int> max_running_{0};
+  bool wait_for_concurrent_ = false;
+};
+
+TEST_F(InterOpThreadsTest, NodesRunOneAtATimeByDefault) {
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+  CheckOutput();
+  CheckOutput();
+  EXPECT_EQ(max_running_.load(), 1);
+}
+
+TEST_F(InterOpThreadsTest, IndependentNodesRunConcurrently) {
+  ASSERT_EQ(interpreter_.SetNumInterOpThreads(2), kTfLiteOk);
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+  // The independent nodes run at the same step, so their outputs don't share
+  // memory.
+  EXPECT_NE(interpreter_.tensor(1)->data.raw, interpreter_.tensor(2)->data.raw);
+
+  // The first invocation runs one node at a time.
+  CheckOutput();
+  EXPECT_EQ(max_running_.load(), 1);
+
+  wait_for_concurrent_ = true;
+  CheckOutput();
+  EXPECT_EQ(max_running_.load(), 2);
+}
+
+TEST_F(InterOpThreadsTest, SettingThreadsRequiresAllocation) {
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter_.SetNumInterOpThreads(2), kTfLiteOk);
+  EXPECT_EQ(interpreter_.Invoke(), kTfLiteError);
+  ASSERT_EQ(interpreter_.AllocateTensors(), kTfLiteOk);
+  CheckOutput();
+}
+
+TEST_F(InterOpThreadsTest, InvalidNumThreads) {
+  EXPECT_EQ(interpreter_.SetNumInterOpThreads(0), kTfLiteError);
+}
+
 }  // namespace
 }  // namespace tflite
 
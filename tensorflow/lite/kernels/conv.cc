@@ -17,11 +17,15 @@ limitations under the License.
 #include <stddef.h>
 
 #include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm_params.h"
 #include "tensorflow/lite/kernels/eigen_support.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/internal/types.h"
@@ -103,6 +107,10 @@ struct OpData {
   bool supports_multithreaded_kernel = false;
   bool is_hybrid_per_channel = false;
   bool compute_hybrid_row_sums = true;
+
+  // Keeps the constant filter prepacked for the matrix*vector products of the
+  // optimized kernels, see cpu_backend_gemm::PrepackLhs.
+  std::unique_ptr<PrepackedWeightsCache::Reference> prepacked_filter;
 };
 
 inline PaddingType RuntimePaddingType(TfLitePadding padding) {
@@ -296,6 +304,58 @@ static TfLiteStatus AllocateTemporaryTensorsIfRequired(TfLiteContext* context,
   return kTfLiteOk;
 }
 
+template <typename T>
+std::unique_ptr<PrepackedWeightsCache::Reference> PrepackFilter(
+    TfLiteContext* context, const TfLiteTensor* filter, T zero_point) {
+  cpu_backend_gemm::MatrixParams<T> lhs_params;
+  lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
+  lhs_params.rows = SizeOfDimension(filter, 0);
+  lhs_params.cols = NumElements(filter) / lhs_params.rows;
+  lhs_params.zero_point = zero_point;
+  return cpu_backend_gemm::PrepackLhs(
+      lhs_params, GetTensorData<T>(filter),
+      CpuBackendContext::GetFromContext(context));
+}
+
+// Prepacks the filter when it is constant, if the CPU backend caches prepacked
+// weights, for the matrix*vector products of the optimized kernels. These
+// happen when the output has a single pixel.
+void PrepackFilterIfConstant(TfLiteContext* context, TfLiteNode* node) {
+  OpData* data = reinterpret_cast<OpData*>(node->user_data);
+  const TfLiteTensor* input = GetInput(context, node, 0);
+  const TfLiteTensor* filter = GetInput(context, node, 1);
+  const TfLiteTensor* output = GetOutput(context, node, 0);
+
+  // The previous prepacked filter is only released after acquiring the new
+  // one, so that it isn't prepacked again if it is the same.
+  std::unique_ptr<PrepackedWeightsCache::Reference> prepacked_filter;
+  const int output_pixels = NumElements(output) / SizeOfDimension(output, 3);
+  if (IsConstantTensor(filter) && output_pixels == 1 &&
+      input->type == filter->type) {
+    switch (filter->type) {
+      case kTfLiteFloat32:
+        prepacked_filter = PrepackFilter<float>(context, filter, 0.0f);
+        break;
+      case kTfLiteUInt8:
+        prepacked_filter = PrepackFilter<uint8_t>(context, filter,
+                                                  filter->params.zero_point);
+        break;
+      case kTfLiteInt8:
+        // The filter is symmetric-quantized.
+        prepacked_filter = PrepackFilter<int8_t>(context, filter, 0);
+        break;
+      default:
+        break;
+    }
+  }
+  data->prepacked_filter = std::move(prepacked_filter);
+}
+
+// Returns the filter prepacked by PrepackFilterIfConstant, if any.
+const void* PrepackedFilterData(const OpData* data) {
+  return data->prepacked_filter ? data->prepacked_filter->data() : nullptr;
+}
+
 TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
                      TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
@@ -563,6 +623,10 @@ TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
       }
     }
   }
+
+  if (kernel_type != kReference) {
+    PrepackFilterIfConstant(context, node);
+  }
   return kTfLiteOk;
 }
 
@@ -608,6 +672,7 @@ void EvalQuantized(TfLiteContext* context, TfLiteNode* node,
   op_params.output_shift = -data->output_shift;
   op_params.quantized_activation_min = data->output_activation_min;
   op_params.quantized_activation_max = data->output_activation_max;
+  op_params.lhs_prepacked_data = PrepackedFilterData(data);
   switch (effective_kernel_type) {
     case kReference: {
       reference_ops::Conv(
@@ -653,6 +718,7 @@ void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
   op_params.padding_values.width = data->padding.width;
   op_params.quantized_activation_min = data->output_activation_min;
   op_params.quantized_activation_max = data->output_activation_max;
+  op_params.lhs_prepacked_data = PrepackedFilterData(data);
 
   switch (kernel_type) {
     case kReference: {
@@ -743,6 +809,7 @@ void EvalFloat(TfLiteContext* context, TfLiteNode* node,
   op_params.dilation_height_factor = params->dilation_height_factor;
   op_params.float_activation_min = output_activation_min;
   op_params.float_activation_max = output_activation_max;
+  op_params.lhs_prepacked_data = PrepackedFilterData(data);
   switch (effective_kernel_type) {
     case kReference: {
       reference_ops::Conv(op_params, GetTensorShape(input),
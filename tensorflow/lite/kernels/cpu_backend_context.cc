@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 
 #include "public/gemmlowp.h"
 #include "ruy/context.h"  // from @ruy
@@ -30,6 +33,53 @@ const int kDefaultNumThreadpoolThreads = 1;
 
 namespace tflite {
 
+PrepackedWeightsCache::Reference::~Reference() { cache_->Release(key_); }
+
+std::shared_ptr<PrepackedWeightsCache> PrepackedWeightsCache::GetDefault() {
+  // Leaked on purpose, so that it outlives the CpuBackendContext's of static
+  // interpreters.
+  static auto* default_cache = new std::shared_ptr<PrepackedWeightsCache>(
+      std::make_shared<PrepackedWeightsCache>());
+  return *default_cache;
+}
+
+std::unique_ptr<PrepackedWeightsCache::Reference>
+PrepackedWeightsCache::Acquire(
+    const std::shared_ptr<PrepackedWeightsCache>& cache, const Key& key,
+    std::size_t size, const std::function<void(void*)>& pack) {
+  Entry* entry;
+  {
+    std::lock_guard<std::mutex> lock(cache->mutex_);
+    std::unique_ptr<Entry>& slot = cache->entries_[key];
+    if (!slot) {
+      slot.reset(new Entry);
+    }
+    entry = slot.get();
+    // Taken before packing, so that the entry outlives it.
+    ++entry->num_references;
+  }
+  std::call_once(entry->packed, [entry, size, &pack]() {
+    entry->data.resize(size);
+    pack(entry->data.data());
+  });
+  return std::unique_ptr<Reference>(
+      new Reference(cache, key, entry->data.data()));
+}
+
+int PrepackedWeightsCache::num_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void PrepackedWeightsCache::Release(const Key& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  TF_LITE_ASSERT(it != entries_.end());
+  if (--it->second->num_references == 0) {
+    entries_.erase(it);
+  }
+}
+
 CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
   auto* external_context = static_cast<ExternalCpuBackendContext*>(
       context->GetExternalContext(context, kTfLiteCpuBackendContext));
@@ -57,7 +107,8 @@ CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
 CpuBackendContext::CpuBackendContext()
     : TfLiteInternalBackendContext(),
       ruy_context_(new ruy::Context),
-      gemmlowp_context_(new gemmlowp::GemmContext) {
+      gemmlowp_context_(new gemmlowp::GemmContext),
+      prepacked_weights_cache_(PrepackedWeightsCache::GetDefault()) {
   SetMaxNumThreads(kDefaultNumThreadpoolThreads);
 // TODO(b/148289189) Remove when clients have transitioned to runtime flag.
 #ifdef TFLITE_WITH_RUY_GEMV
@@ -79,4 +130,9 @@ void CpuBackendContext::SetMaxNumThreads(int max_num_threads) {
 
 void CpuBackendContext::SetUseCaching(bool flag) { use_caching_ = flag; }
 
+void CpuBackendContext::SetPrepackedWeightsCache(
+    std::shared_ptr<PrepackedWeightsCache> cache) {
+  prepacked_weights_cache_ = std::move(cache);
+}
+
 }  // namespace tflite
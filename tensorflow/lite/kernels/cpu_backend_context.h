@@ -16,7 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_KERNELS_CPU_BACKEND_CONTEXT_H_
 #define TENSORFLOW_LITE_KERNELS_CPU_BACKEND_CONTEXT_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "public/gemmlowp.h"
 #include "ruy/context.h"  // from @ruy
@@ -25,6 +33,79 @@ limitations under the License.
 
 namespace tflite {
 
+// A cache of constant matrices (i.e. weights) rearranged ahead of time into
+// the layout that some kernels read, so that this rearranging isn't done again
+// on each inference. Entries are shared by everything acquiring the same key,
+// e.g. the ops of several interpreters running the same model buffer, and are
+// freed when the last reference to them is destroyed.
+//
+// This class is thread-safe.
+class PrepackedWeightsCache {
+ public:
+  // Identifies a prepacked matrix. `data` is the pointer to the constant
+  // data it was prepacked from, which is assumed to be unchanging as long as
+  // any reference to the entry exists.
+  struct Key {
+    const void* data;
+    int rows;
+    int cols;
+    int scalar_size;
+    std::int32_t zero_point;
+
+    bool operator<(const Key& other) const {
+      return std::tie(data, rows, cols, scalar_size, zero_point) <
+             std::tie(other.data, other.rows, other.cols, other.scalar_size,
+                      other.zero_point);
+    }
+  };
+
+  // Keeps an entry of the cache alive.
+  class Reference {
+   public:
+    ~Reference();
+
+    const void* data() const { return data_; }
+
+   private:
+    friend class PrepackedWeightsCache;
+    Reference(std::shared_ptr<PrepackedWeightsCache> cache, const Key& key,
+              const void* data)
+        : cache_(std::move(cache)), key_(key), data_(data) {}
+
+    std::shared_ptr<PrepackedWeightsCache> cache_;
+    Key key_;
+    const void* data_;
+  };
+
+  // Returns the cache shared by all the CpuBackendContext's of the process,
+  // unless they were given another one.
+  static std::shared_ptr<PrepackedWeightsCache> GetDefault();
+
+  // Returns a reference to the entry for `key`. If there is none yet, creates
+  // it with a buffer of `size` bytes, which `pack` fills. The packing runs
+  // without holding the lock of the cache, so that it only blocks the callers
+  // acquiring the same entry.
+  static std::unique_ptr<Reference> Acquire(
+      const std::shared_ptr<PrepackedWeightsCache>& cache, const Key& key,
+      std::size_t size, const std::function<void(void*)>& pack);
+
+  int num_entries() const;
+
+ private:
+  struct Entry {
+    std::once_flag packed;
+    std::vector<char> data;
+    int num_references = 0;
+  };
+
+  void Release(const Key& key);
+
+  mutable std::mutex mutex_;
+  // Entries are allocated separately, so that they stay at the same address
+  // while they are packed outside of the lock.
+  std::map<Key, std::unique_ptr<Entry>> entries_;
+};
+
 class CpuBackendContext final : public TfLiteInternalBackendContext {
  public:
   static CpuBackendContext* GetFromContext(TfLiteContext* context);
@@ -48,6 +129,22 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
 
   bool use_caching() const { return use_caching_; }
 
+  // The cache of prepacked weights of the custom GEMV kernels of
+  // cpu_backend_gemm, which are used instead of ruy for matrix*vector products
+  // with prepacked weights when use_caching() is true.
+  // See cpu_backend_gemm::PrepackLhs.
+  const std::shared_ptr<PrepackedWeightsCache>& prepacked_weights_cache()
+      const {
+    return prepacked_weights_cache_;
+  }
+
+  // Replaces the process-wide default cache of prepacked weights, e.g. to
+  // keep the weights of some interpreters apart. Weights already prepacked
+  // stay in the previous cache as long as they are referenced.
+  void SetPrepackedWeightsCache(std::shared_ptr<PrepackedWeightsCache> cache);
+
+  // Entries of the prepacked weights cache belong to the ops referencing
+  // them, and are freed along with those ops rather than here.
   void ClearCaches() override { ruy_context_->ClearPrepackedCache(); }
 
  private:
@@ -76,6 +173,7 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
   // CpuBackendGem operations to a library that permits such an optimization
   // (currently the Ruy library only).
   bool use_caching_;
+  std::shared_ptr<PrepackedWeightsCache> prepacked_weights_cache_;
 
   CpuBackendContext(const CpuBackendContext&) = delete;
 };
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_LITE_KERNELS_CPU_BACKEND_GEMM_H_
 
 #include <cstdint>
+#include <memory>
 
 #include "ruy/profiler/instrumentation.h"  // from @ruy
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
@@ -95,7 +96,16 @@ void Gemm(const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
           CpuBackendContext* context) {
   ruy::profiler::ScopeLabel label("cpu_backend_gemm::Gemm");
   ValidateParams(lhs_params, rhs_params, dst_params, params);
+  const bool do_custom_gemv = (dst_params.cols == 1);
   if (context->use_caching()) {
+    // GEMV case with weights prepacked by PrepackLhs: use the custom GEMV
+    // path reading them, as ruy has no GEMV path.
+    if (do_custom_gemv &&
+        detail::CustomGemvWithPrepackedLhs(lhs_params, lhs_data, rhs_params,
+                                           rhs_data, dst_params, dst_data,
+                                           params, context)) {
+      return;
+    }
     // Dispatch to backend that supports caching of prepacked weights
     // matrices.
     detail::GemmImplUsingRuy<LhsScalar, RhsScalar, AccumScalar, DstScalar,
@@ -105,7 +115,6 @@ void Gemm(const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
                                                        params, context);
     return;
   }
-  const bool do_custom_gemv = (dst_params.cols == 1);
   if (do_custom_gemv) {
     // GEMV case: try a custom fast GEMV path.
     if (detail::CustomGemv(lhs_params, lhs_data, rhs_params, rhs_data,
@@ -119,6 +128,39 @@ void Gemm(const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
                                      dst_params, dst_data, params, context);
 }
 
+// Prepacks a constant left-hand side, e.g. the weights of a FULLY_CONNECTED
+// or CONV_2D op, for the custom GEMV paths. These then read the prepacked copy
+// instead of `lhs_data` in the matrix*vector products of Gemm with the same
+// `lhs_params` and `lhs_data`, once `lhs_params.prepacked_data` is set to the
+// data of the returned reference. Like the caching of ruy, which would handle
+// these products otherwise, this is only done if `context->use_caching()`.
+//
+// The prepacked copy is kept in `context->prepacked_weights_cache()` as long
+// as the returned reference exists, and is shared with the other users of the
+// same data, e.g. other interpreters running the same model. Returns nullptr
+// if there is no custom GEMV path reading prepacked data for LhsScalar, or if
+// caching is disabled.
+template <typename LhsScalar>
+std::unique_ptr<PrepackedWeightsCache::Reference> PrepackLhs(
+    const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+    CpuBackendContext* context) {
+  if (!detail::HasPrepackedLhsCustomGemv<LhsScalar>::value ||
+      !context->use_caching() || lhs_params.order != Order::kRowMajor ||
+      lhs_params.rows < detail::kPrepackedLhsPanelRows) {
+    return nullptr;
+  }
+  ruy::profiler::ScopeLabel label("cpu_backend_gemm::PrepackLhs");
+  return PrepackedWeightsCache::Acquire(
+      context->prepacked_weights_cache(),
+      detail::PrepackedLhsKey(lhs_params, lhs_data),
+      detail::PrepackedLhsLayout<LhsScalar>::Size(lhs_params) *
+          sizeof(LhsScalar),
+      [&](void* prepacked_lhs_data) {
+        detail::PrepackLhsForCustomGemv(
+            lhs_params, lhs_data, static_cast<LhsScalar*>(prepacked_lhs_data));
+      });
+}
+
 // Special path for gemm with raw accumulator case. i.e. AccumScalar ==
 // DstScalar == int32 case.
 template <typename LhsScalar, typename RhsScalar,
@@ -91,8 +91,80 @@ struct CustomGemvImpl {
       const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
       const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
       int row_start, int row_end) {}
+
+  // Performs the Gemv like Run(), but reading the whole panels of the
+  // left-hand side from `prepacked_lhs_data`, see PrepackLhsForCustomGemv.
+  // `row_start` must be a multiple of kPrepackedLhsPanelRows. Only
+  // implementations for which HasPrepackedLhsCustomGemv is true need to
+  // implement it.
+  static void RunPrepacked(
+      const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+      const LhsScalar* prepacked_lhs_data,
+      const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
+      const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
+      const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
+      int row_start, int row_end) {}
+};
+
+// Whether the CustomGemvImpl specializations for this LhsScalar implement
+// RunPrepacked. Specialized below along with them.
+template <typename LhsScalar>
+struct HasPrepackedLhsCustomGemv : std::false_type {};
+
+// The layout of prepacked left-hand sides.
+//
+// Each panel of kPrepackedLhsPanelRows consecutive rows is split into chunks
+// of 16 bytes of each row, and the chunks of the rows of a panel covering the
+// same columns are stored next to each other. The kernels thus read a panel as
+// a single contiguous stream, instead of one stream per row. The last chunk of
+// each row is padded with the zero_point. The last rows, which don't make a
+// whole panel, aren't prepacked: the kernels read them from the original
+// matrix.
+constexpr int kPrepackedLhsPanelRows = 4;
+
+template <typename LhsScalar>
+struct PrepackedLhsLayout {
+  static constexpr int kChunkCols = 16 / sizeof(LhsScalar);
+
+  static int PaddedCols(const MatrixParams<LhsScalar>& lhs_params) {
+    return RoundUp<kChunkCols>(lhs_params.cols);
+  }
+
+  // The number of LhsScalar's in the prepacked matrix.
+  static int Size(const MatrixParams<LhsScalar>& lhs_params) {
+    return RoundDown<kPrepackedLhsPanelRows>(lhs_params.rows) *
+           PaddedCols(lhs_params);
+  }
 };
 
+template <typename LhsScalar>
+void PrepackLhsForCustomGemv(const MatrixParams<LhsScalar>& lhs_params,
+                             const LhsScalar* lhs_data,
+                             LhsScalar* prepacked_lhs_data) {
+  using Layout = PrepackedLhsLayout<LhsScalar>;
+  const int padded_cols = Layout::PaddedCols(lhs_params);
+  for (int row = 0; row + kPrepackedLhsPanelRows <= lhs_params.rows;
+       row += kPrepackedLhsPanelRows) {
+    for (int col = 0; col < padded_cols; col += Layout::kChunkCols) {
+      for (int r = row; r < row + kPrepackedLhsPanelRows; ++r) {
+        for (int c = col; c < col + Layout::kChunkCols; ++c) {
+          *prepacked_lhs_data++ = c < lhs_params.cols
+                                      ? lhs_data[r * lhs_params.cols + c]
+                                      : lhs_params.zero_point;
+        }
+      }
+    }
+  }
+}
+
+template <typename LhsScalar>
+PrepackedWeightsCache::Key PrepackedLhsKey(
+    const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data) {
+  return {lhs_data, lhs_params.rows, lhs_params.cols,
+          static_cast<int>(sizeof(LhsScalar)),
+          static_cast<std::int32_t>(lhs_params.zero_point)};
+}
+
 // Wraps CustomGemvImpl for multi-threaded operation.
 template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
           typename DstScalar, QuantizationFlavor quantization_flavor>
@@ -100,12 +172,14 @@ class CustomGemvTask : public cpu_backend_threadpool::Task {
  public:
   CustomGemvTask(
       const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+      const LhsScalar* prepacked_lhs_data,
       const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
       const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
       const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
       int row_start, int row_end)
       : lhs_params_(lhs_params),
         lhs_data_(lhs_data),
+        prepacked_lhs_data_(prepacked_lhs_data),
         rhs_params_(rhs_params),
         rhs_data_(rhs_data),
         dst_params_(dst_params),
@@ -117,13 +191,20 @@ class CustomGemvTask : public cpu_backend_threadpool::Task {
   void Run() override {
     using Impl = CustomGemvImpl<LhsScalar, RhsScalar, AccumScalar, DstScalar,
                                 quantization_flavor>;
-    Impl::Run(lhs_params_, lhs_data_, rhs_params_, rhs_data_, dst_params_,
-              dst_data_, params_, row_start_, row_end_);
+    if (prepacked_lhs_data_) {
+      Impl::RunPrepacked(lhs_params_, lhs_data_, prepacked_lhs_data_,
+                         rhs_params_, rhs_data_, dst_params_, dst_data_,
+                         params_, row_start_, row_end_);
+    } else {
+      Impl::Run(lhs_params_, lhs_data_, rhs_params_, rhs_data_, dst_params_,
+                dst_data_, params_, row_start_, row_end_);
+    }
   }
 
  private:
   const MatrixParams<LhsScalar>& lhs_params_;
   const LhsScalar* lhs_data_;
+  const LhsScalar* prepacked_lhs_data_;
   const MatrixParams<RhsScalar>& rhs_params_;
   const RhsScalar* rhs_data_;
   const MatrixParams<DstScalar>& dst_params_;
@@ -133,56 +214,113 @@ class CustomGemvTask : public cpu_backend_threadpool::Task {
   int row_end_;
 };
 
-// Either performs the requested Gemv operation and returns true,
-// or immediately returns false.
-//
-// See the comment at the top of the file for the scope of what this handles.
-// In summary: (row-major matrix) * (column-vector).
-//
-// Here is only high-level logic.
-// The actual implementation details are in specializations of
-// CustomGemvImpl.
+// Returns true if the Gemv shape is supported by CustomGemvImpl.
 template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
           typename DstScalar, QuantizationFlavor quantization_flavor>
-bool CustomGemv(
+bool IsCustomGemvSupported(
+    const MatrixParams<LhsScalar>& lhs_params,
+    const MatrixParams<RhsScalar>& rhs_params,
+    const MatrixParams<DstScalar>& dst_params,
+    const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params) {
+  using Impl = CustomGemvImpl<LhsScalar, RhsScalar, AccumScalar, DstScalar,
+                              quantization_flavor>;
+  if (lhs_params.rows < Impl::kKernelRows) {
+    return false;
+  }
+  return Impl::IsSupportedGivenSufficientlyManyRows(lhs_params, rhs_params,
+                                                    dst_params, params);
+}
+
+// Performs a supported Gemv, reading the left-hand side from
+// `prepacked_lhs_data` unless it is null.
+template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
+          typename DstScalar, QuantizationFlavor quantization_flavor>
+void RunCustomGemv(
     const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+    const LhsScalar* prepacked_lhs_data,
     const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
     const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
     const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
     CpuBackendContext* context) {
-  ruy::profiler::ScopeLabel label("cpu_backend_gemm::Gemm: CustomGemv");
   using Impl = CustomGemvImpl<LhsScalar, RhsScalar, AccumScalar, DstScalar,
                               quantization_flavor>;
-  if (lhs_params.rows < Impl::kKernelRows) {
-    return false;
-  }
-  if (!Impl::IsSupportedGivenSufficientlyManyRows(lhs_params, rhs_params,
-                                                  dst_params, params)) {
-    return false;
-  }
+  using Task = CustomGemvTask<LhsScalar, RhsScalar, AccumScalar, DstScalar,
+                              quantization_flavor>;
   TFLITE_DCHECK_GE(lhs_params.rows, Impl::kKernelRows);
   int thread_count = LegacyHowManyThreads<Impl::kKernelRows>(
       context->max_num_threads(), dst_params.rows, dst_params.cols,
       lhs_params.cols);
   if (thread_count == 1) {
-    Impl::Run(lhs_params, lhs_data, rhs_params, rhs_data, dst_params, dst_data,
-              params, 0, lhs_params.rows);
+    Task task(lhs_params, lhs_data, prepacked_lhs_data, rhs_params, rhs_data,
+              dst_params, dst_data, params, 0, lhs_params.rows);
+    task.Run();
   } else {
-    using Task = CustomGemvTask<LhsScalar, RhsScalar, AccumScalar, DstScalar,
-                                quantization_flavor>;
     std::vector<Task> tasks;
     tasks.reserve(thread_count);
+    // Rows are split at multiples of kKernelRows, which are also multiples of
+    // kPrepackedLhsPanelRows, as required by RunPrepacked.
     const int kRowsPerThread =
         RoundUp<Impl::kKernelRows>(CeilQuotient(dst_params.rows, thread_count));
     int row_start = 0;
     for (int i = 0; i < thread_count; i++) {
       int row_end = std::min(dst_params.rows, row_start + kRowsPerThread);
-      tasks.emplace_back(lhs_params, lhs_data, rhs_params, rhs_data, dst_params,
-                         dst_data, params, row_start, row_end);
+      tasks.emplace_back(lhs_params, lhs_data, prepacked_lhs_data, rhs_params,
+                         rhs_data, dst_params, dst_data, params, row_start,
+                         row_end);
       row_start = row_end;
     }
     cpu_backend_threadpool::Execute(tasks.size(), tasks.data(), context);
   }
+}
+
+// Either performs the requested Gemv operation and returns true,
+// or immediately returns false.
+//
+// See the comment at the top of the file for the scope of what this handles.
+// In summary: (row-major matrix) * (column-vector).
+//
+// Here is only high-level logic.
+// The actual implementation details are in specializations of
+// CustomGemvImpl.
+template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
+          typename DstScalar, QuantizationFlavor quantization_flavor>
+bool CustomGemv(
+    const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+    const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
+    const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
+    const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
+    CpuBackendContext* context) {
+  ruy::profiler::ScopeLabel label("cpu_backend_gemm::Gemm: CustomGemv");
+  if (!IsCustomGemvSupported(lhs_params, rhs_params, dst_params, params)) {
+    return false;
+  }
+  const LhsScalar* no_prepacked_lhs_data = nullptr;
+  RunCustomGemv(lhs_params, lhs_data, no_prepacked_lhs_data, rhs_params,
+                rhs_data, dst_params, dst_data, params, context);
+  return true;
+}
+
+// Like CustomGemv, but only performs the Gemv if the left-hand side was
+// prepacked, i.e. if `lhs_params.prepacked_data` is set.
+template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
+          typename DstScalar, QuantizationFlavor quantization_flavor>
+bool CustomGemvWithPrepackedLhs(
+    const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+    const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
+    const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
+    const GemmParams<AccumScalar, DstScalar, quantization_flavor>& params,
+    CpuBackendContext* context) {
+  if (!HasPrepackedLhsCustomGemv<LhsScalar>::value ||
+      lhs_params.prepacked_data == nullptr ||
+      !IsCustomGemvSupported(lhs_params, rhs_params, dst_params, params)) {
+    return false;
+  }
+  const LhsScalar* prepacked_lhs_data =
+      static_cast<const LhsScalar*>(lhs_params.prepacked_data);
+  ruy::profiler::ScopeLabel label(
+      "cpu_backend_gemm::Gemm: CustomGemv with prepacked LHS");
+  RunCustomGemv(lhs_params, lhs_data, prepacked_lhs_data, rhs_params, rhs_data,
+                dst_params, dst_data, params, context);
   return true;
 }
 
@@ -319,6 +457,109 @@ struct CustomGemvImpl<LhsScalar, RhsScalar, std::int32_t, DstScalar,
     return lhs_params.cols >= 8;
   }
 
+  static void MultiplyAccumulate16(
+      const int16x8x2_t& input_val, const int16x8x2_t& filter_val_0,
+      const int16x8x2_t& filter_val_1, const int16x8x2_t& filter_val_2,
+      const int16x8x2_t& filter_val_3, int32x4_t* acc0, int32x4_t* acc1,
+      int32x4_t* acc2, int32x4_t* acc3) {
+    *acc0 = vmlal_s16(*acc0, vget_low_s16(filter_val_0.val[0]),
+                      vget_low_s16(input_val.val[0]));
+    *acc1 = vmlal_s16(*acc1, vget_low_s16(filter_val_1.val[0]),
+                      vget_low_s16(input_val.val[0]));
+    *acc2 = vmlal_s16(*acc2, vget_low_s16(filter_val_2.val[0]),
+                      vget_low_s16(input_val.val[0]));
+    *acc3 = vmlal_s16(*acc3, vget_low_s16(filter_val_3.val[0]),
+                      vget_low_s16(input_val.val[0]));
+    *acc0 = vmlal_s16(*acc0, vget_low_s16(filter_val_0.val[1]),
+                      vget_low_s16(input_val.val[1]));
+    *acc1 = vmlal_s16(*acc1, vget_low_s16(filter_val_1.val[1]),
+                      vget_low_s16(input_val.val[1]));
+    *acc2 = vmlal_s16(*acc2, vget_low_s16(filter_val_2.val[1]),
+                      vget_low_s16(input_val.val[1]));
+    *acc3 = vmlal_s16(*acc3, vget_low_s16(filter_val_3.val[1]),
+                      vget_low_s16(input_val.val[1]));
+    *acc0 = vmlal_s16(*acc0, vget_high_s16(filter_val_0.val[0]),
+                      vget_high_s16(input_val.val[0]));
+    *acc1 = vmlal_s16(*acc1, vget_high_s16(filter_val_1.val[0]),
+                      vget_high_s16(input_val.val[0]));
+    *acc2 = vmlal_s16(*acc2, vget_high_s16(filter_val_2.val[0]),
+                      vget_high_s16(input_val.val[0]));
+    *acc3 = vmlal_s16(*acc3, vget_high_s16(filter_val_3.val[0]),
+                      vget_high_s16(input_val.val[0]));
+    *acc0 = vmlal_s16(*acc0, vget_high_s16(filter_val_0.val[1]),
+                      vget_high_s16(input_val.val[1]));
+    *acc1 = vmlal_s16(*acc1, vget_high_s16(filter_val_1.val[1]),
+                      vget_high_s16(input_val.val[1]));
+    *acc2 = vmlal_s16(*acc2, vget_high_s16(filter_val_2.val[1]),
+                      vget_high_s16(input_val.val[1]));
+    *acc3 = vmlal_s16(*acc3, vget_high_s16(filter_val_3.val[1]),
+                      vget_high_s16(input_val.val[1]));
+  }
+
+  // Reduces the accumulators of the 4 rows starting at `row`, then adds the
+  // bias, applies the multiplier, and clamps and stores the results.
+  static void ReduceAndStore(
+      int32x4_t acc0, int32x4_t acc1, int32x4_t acc2, int32x4_t acc3,
+      const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
+      const GemmParams<std::int32_t, DstScalar, quantization_flavor>& params,
+      int row) {
+    // Horizontally reduce accumulators
+    int32x2_t pairwise_reduced_acc_0 =
+        vpadd_s32(vget_low_s32(acc0), vget_high_s32(acc0));
+    int32x2_t pairwise_reduced_acc_1 =
+        vpadd_s32(vget_low_s32(acc1), vget_high_s32(acc1));
+    int32x2_t pairwise_reduced_acc_2 =
+        vpadd_s32(vget_low_s32(acc2), vget_high_s32(acc2));
+    int32x2_t pairwise_reduced_acc_3 =
+        vpadd_s32(vget_low_s32(acc3), vget_high_s32(acc3));
+    const int32x2_t reduced_lo =
+        vpadd_s32(pairwise_reduced_acc_0, pairwise_reduced_acc_1);
+    const int32x2_t reduced_hi =
+        vpadd_s32(pairwise_reduced_acc_2, pairwise_reduced_acc_3);
+    int32x4_t reduced = vcombine_s32(reduced_lo, reduced_hi);
+    // End of horizontal reduction: now `reduced` is a single int32x4
+    // containing the 4 int32 accumulators corresponding to the 4 rows
+    // being processed.
+
+    // Add bias values.
+    if (params.bias) {
+      int32x4_t bias_vec = vld1q_s32(params.bias + row);
+      reduced = vaddq_s32(reduced, bias_vec);
+    }
+
+    // Get multiplier parameters.
+    int32x4_t multiplier_fixedpoint;
+    int32x4_t multiplier_exponent;
+    if (quantization_flavor ==
+        QuantizationFlavor::kIntegerWithPerRowMultiplier) {
+      multiplier_exponent =
+          vld1q_s32(params.multiplier_exponent_perchannel + row);
+      multiplier_fixedpoint =
+          vld1q_s32(params.multiplier_fixedpoint_perchannel + row);
+    } else {
+      multiplier_exponent = vdupq_n_s32(params.multiplier_exponent);
+      multiplier_fixedpoint = vdupq_n_s32(params.multiplier_fixedpoint);
+    }
+
+    // If positive exponent, shift left.
+    int32x4_t exponent_positive_part =
+        vmaxq_s32(multiplier_exponent, vdupq_n_s32(0));
+    reduced = vshlq_s32(reduced, exponent_positive_part);
+    // Multiply by the fixed-point multiplier.
+    reduced = vqrdmulhq_s32(reduced, multiplier_fixedpoint);
+    // If negative exponent, rounding-shift-right.
+    int32x4_t exponent_negative_part =
+        vminq_s32(multiplier_exponent, vdupq_n_s32(0));
+    reduced = vrshlq_s32(reduced, exponent_negative_part);
+
+    // Add the output offset.
+    const int32x4_t output_offset_vec = vdupq_n_s32(dst_params.zero_point);
+    reduced = vaddq_s32(reduced, output_offset_vec);
+
+    // Finally, clamp and store to the destination.
+    ClampAndStore(reduced, params.clamp_min, params.clamp_max, dst_data + row);
+  }
+
   static void Run(
       const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
       const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
@@ -390,38 +631,9 @@ struct CustomGemvImpl<LhsScalar, RhsScalar, std::int32_t, DstScalar,
         optimized_ops_preload_l1_stream(local_filter_ptr +
                                         kPreloadAhead / sizeof(LhsScalar));
         filter_ptr += 16;
-        acc0 = vmlal_s16(acc0, vget_low_s16(filter_val_0.val[0]),
-                         vget_low_s16(input_val.val[0]));
-        acc1 = vmlal_s16(acc1, vget_low_s16(filter_val_1.val[0]),
-                         vget_low_s16(input_val.val[0]));
-        acc2 = vmlal_s16(acc2, vget_low_s16(filter_val_2.val[0]),
-                         vget_low_s16(input_val.val[0]));
-        acc3 = vmlal_s16(acc3, vget_low_s16(filter_val_3.val[0]),
-                         vget_low_s16(input_val.val[0]));
-        acc0 = vmlal_s16(acc0, vget_low_s16(filter_val_0.val[1]),
-                         vget_low_s16(input_val.val[1]));
-        acc1 = vmlal_s16(acc1, vget_low_s16(filter_val_1.val[1]),
-                         vget_low_s16(input_val.val[1]));
-        acc2 = vmlal_s16(acc2, vget_low_s16(filter_val_2.val[1]),
-                         vget_low_s16(input_val.val[1]));
-        acc3 = vmlal_s16(acc3, vget_low_s16(filter_val_3.val[1]),
-                         vget_low_s16(input_val.val[1]));
-        acc0 = vmlal_s16(acc0, vget_high_s16(filter_val_0.val[0]),
-                         vget_high_s16(input_val.val[0]));
-        acc1 = vmlal_s16(acc1, vget_high_s16(filter_val_1.val[0]),
-                         vget_high_s16(input_val.val[0]));
-        acc2 = vmlal_s16(acc2, vget_high_s16(filter_val_2.val[0]),
-                         vget_high_s16(input_val.val[0]));
-        acc3 = vmlal_s16(acc3, vget_high_s16(filter_val_3.val[0]),
-                         vget_high_s16(input_val.val[0]));
-        acc0 = vmlal_s16(acc0, vget_high_s16(filter_val_0.val[1]),
-                         vget_high_s16(input_val.val[1]));
-        acc1 = vmlal_s16(acc1, vget_high_s16(filter_val_1.val[1]),
-                         vget_high_s16(input_val.val[1]));
-        acc2 = vmlal_s16(acc2, vget_high_s16(filter_val_2.val[1]),
-                         vget_high_s16(input_val.val[1]));
-        acc3 = vmlal_s16(acc3, vget_high_s16(filter_val_3.val[1]),
-                         vget_high_s16(input_val.val[1]));
+        MultiplyAccumulate16(input_val, filter_val_0, filter_val_1,
+                             filter_val_2, filter_val_3, &acc0, &acc1, &acc2,
+                             &acc3);
       }
       // Less that 16 values remain. Try to handle 8 more.
       if (in <= lhs_params.cols - 8) {
@@ -528,66 +740,88 @@ struct CustomGemvImpl<LhsScalar, RhsScalar, std::int32_t, DstScalar,
                          vget_high_s16(input_val));
       }
 
-      // Horizontally reduce accumulators
-      int32x2_t pairwise_reduced_acc_0 =
-          vpadd_s32(vget_low_s32(acc0), vget_high_s32(acc0));
-      int32x2_t pairwise_reduced_acc_1 =
-          vpadd_s32(vget_low_s32(acc1), vget_high_s32(acc1));
-      int32x2_t pairwise_reduced_acc_2 =
-          vpadd_s32(vget_low_s32(acc2), vget_high_s32(acc2));
-      int32x2_t pairwise_reduced_acc_3 =
-          vpadd_s32(vget_low_s32(acc3), vget_high_s32(acc3));
-      const int32x2_t reduced_lo =
-          vpadd_s32(pairwise_reduced_acc_0, pairwise_reduced_acc_1);
-      const int32x2_t reduced_hi =
-          vpadd_s32(pairwise_reduced_acc_2, pairwise_reduced_acc_3);
-      int32x4_t reduced = vcombine_s32(reduced_lo, reduced_hi);
-      // End of horizontal reduction: now `reduced` is a single int32x4
-      // containing the 4 int32 accumulators corresponding to the 4 rows
-      // being processed.
+      ReduceAndStore(acc0, acc1, acc2, acc3, dst_params, dst_data, params,
+                     row);
+    }
+  }
+
+  static void RunPrepacked(
+      const MatrixParams<LhsScalar>& lhs_params, const LhsScalar* lhs_data,
+      const LhsScalar* prepacked_lhs_data,
+      const MatrixParams<RhsScalar>& rhs_params, const RhsScalar* rhs_data,
+      const MatrixParams<DstScalar>& dst_params, DstScalar* dst_data,
+      const GemmParams<std::int32_t, DstScalar, quantization_flavor>& params,
+      int row_start, int row_end) {
+    static_assert(kKernelRows == kPrepackedLhsPanelRows, "");
+    static_assert(PrepackedLhsLayout<LhsScalar>::kChunkCols == 16, "");
+    TFLITE_DCHECK_GE(row_end - row_start, kKernelRows);
+    TFLITE_DCHECK_EQ(row_start % kKernelRows, 0);
+    const int padded_cols =
+        PrepackedLhsLayout<LhsScalar>::PaddedCols(lhs_params);
+    // The columns of the last chunk of the prepacked rows are padded with the
+    // zero_point when there are fewer than 16 of them. Pad the corresponding
+    // values of the right-hand side likewise, in a copy, so that they can be
+    // handled like the others.
+    const int tail_start = RoundDown<16>(lhs_params.cols);
+    RhsScalar rhs_tail[16];
+    std::fill(std::copy(rhs_data + tail_start, rhs_data + lhs_params.cols,
+                        rhs_tail),
+              rhs_tail + 16, rhs_params.zero_point);
 
-      // Add bias values.
-      if (params.bias) {
-        int32x4_t bias_vec = vld1q_s32(params.bias + row);
-        reduced = vaddq_s32(reduced, bias_vec);
-      }
+    int row = row_start;
+    for (; row + kKernelRows <= row_end; row += kKernelRows) {
+      // The 4 rows are interleaved by chunks of 16 columns, so they make a
+      // single stream to load and to preload.
+      const LhsScalar* filter_ptr = prepacked_lhs_data + row * padded_cols;
 
-      // Get multiplier parameters.
-      int32x4_t multiplier_fixedpoint;
-      int32x4_t multiplier_exponent;
-      if (quantization_flavor ==
-          QuantizationFlavor::kIntegerWithPerRowMultiplier) {
-        multiplier_exponent =
-            vld1q_s32(params.multiplier_exponent_perchannel + row);
-        multiplier_fixedpoint =
-            vld1q_s32(params.multiplier_fixedpoint_perchannel + row);
-      } else {
-        multiplier_exponent = vdupq_n_s32(params.multiplier_exponent);
-        multiplier_fixedpoint = vdupq_n_s32(params.multiplier_fixedpoint);
+      static constexpr int kCacheLineSize = 64;
+      for (int k = 0; k < rhs_params.rows;
+           k += kCacheLineSize / sizeof(RhsScalar)) {
+        optimized_ops_preload_l1_keep(rhs_data + k);
       }
+      // Each iteration below reads a cache line of the stream.
+      static constexpr int kPreloadAhead = 4 * kCacheLineSize;
 
-      // If positive exponent, shift left.
-      int32x4_t exponent_positive_part =
-          vmaxq_s32(multiplier_exponent, vdupq_n_s32(0));
-      reduced = vshlq_s32(reduced, exponent_positive_part);
-      // Multiply by the fixed-point multiplier.
-      reduced = vqrdmulhq_s32(reduced, multiplier_fixedpoint);
-      // If negative exponent, rounding-shift-right.
-      int32x4_t exponent_negative_part =
-          vminq_s32(multiplier_exponent, vdupq_n_s32(0));
-      reduced = vrshlq_s32(reduced, exponent_negative_part);
-
-      // Add the output offset.
-      const int32x4_t output_offset_vec = vdupq_n_s32(dst_params.zero_point);
-      reduced = vaddq_s32(reduced, output_offset_vec);
-
-      // Finally, clamp and store to the destination.
-      ClampAndStore(reduced, params.clamp_min, params.clamp_max,
-                    dst_data + row);
+      int32x4_t acc0 = vdupq_n_s32(0);
+      int32x4_t acc1 = acc0;
+      int32x4_t acc2 = acc0;
+      int32x4_t acc3 = acc0;
+      for (int in = 0; in < padded_cols; in += 16) {
+        const RhsScalar* input_ptr = in < tail_start ? rhs_data + in : rhs_tail;
+        int16x8x2_t input_val =
+            Load16AndSubtractZeroPoint(input_ptr, rhs_params.zero_point);
+        optimized_ops_preload_l1_stream(filter_ptr +
+                                        kPreloadAhead / sizeof(LhsScalar));
+        int16x8x2_t filter_val_0 =
+            Load16AndSubtractZeroPoint(filter_ptr, lhs_params.zero_point);
+        int16x8x2_t filter_val_1 =
+            Load16AndSubtractZeroPoint(filter_ptr + 16, lhs_params.zero_point);
+        int16x8x2_t filter_val_2 =
+            Load16AndSubtractZeroPoint(filter_ptr + 32, lhs_params.zero_point);
+        int16x8x2_t filter_val_3 =
+            Load16AndSubtractZeroPoint(filter_ptr + 48, lhs_params.zero_point);
+        filter_ptr += 64;
+        MultiplyAccumulate16(input_val, filter_val_0, filter_val_1,
+                             filter_val_2, filter_val_3, &acc0, &acc1, &acc2,
+                             &acc3);
+      }
+      ReduceAndStore(acc0, acc1, acc2, acc3, dst_params, dst_data, params,
+                     row);
+    }
+    if (row < row_end) {
+      // The last rows, which don't make a whole panel, weren't prepacked.
+      Run(lhs_params, lhs_data, rhs_params, rhs_data, dst_params, dst_data,
+          params, row_end - kKernelRows, row_end);
     }
   }
 };
 
+template <>
+struct HasPrepackedLhsCustomGemv<std::uint8_t> : std::true_type {};
+
+template <>
+struct HasPrepackedLhsCustomGemv<std::int8_t> : std::true_type {};
+
 // The float specialization below is unconditionally faster than ruy
 // because ruy does not currently have any Gemv path.
 // But it is not unconditionally faster than Eigen, which is what is used
@@ -632,6 +866,42 @@ struct CustomGemvImpl<float, float, float, float,
     // at least 4 LHS columns.
     return lhs_params.cols >= 4;
   }
+
+  // Reduces the accumulators of the 4 rows starting at `row`, then adds the
+  // bias, and clamps and stores the results.
+  static void ReduceAndStore(float32x4_t acc0, float32x4_t acc1,
+                             float32x4_t acc2, float32x4_t acc3,
+                             float* dst_data,
+                             const GemmParams<float, float>& params, int row) {
+    // Horizontally reduce accumulators
+    float32x2_t pairwise_reduced_acc_0 =
+        vpadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    float32x2_t pairwise_reduced_acc_1 =
+        vpadd_f32(vget_low_f32(acc1), vget_high_f32(acc1));
+    float32x2_t pairwise_reduced_acc_2 =
+        vpadd_f32(vget_low_f32(acc2), vget_high_f32(acc2));
+    float32x2_t pairwise_reduced_acc_3 =
+        vpadd_f32(vget_low_f32(acc3), vget_high_f32(acc3));
+    float32x2_t reduced_lo =
+        vpadd_f32(pairwise_reduced_acc_0, pairwise_reduced_acc_1);
+    float32x2_t reduced_hi =
+        vpadd_f32(pairwise_reduced_acc_2, pairwise_reduced_acc_3);
+    float32x4_t reduced = vcombine_f32(reduced_lo, reduced_hi);
+    // End of horizontal reduction: now `reduced` is a single float32x4
+    // containing the 4 float32 accumulators corresponding to the 4 rows
+    // being processed.
+
+    if (params.bias) {
+      // Add bias values.
+      reduced = vaddq_f32(reduced, vld1q_f32(params.bias + row));
+    }
+
+    // Clamp and store to destination.
+    reduced = vminq_f32(reduced, vdupq_n_f32(params.clamp_max));
+    reduced = vmaxq_f32(reduced, vdupq_n_f32(params.clamp_min));
+    vst1q_f32(dst_data + row, reduced);
+  }
+
   static void Run(const MatrixParams<float>& lhs_params, const float* lhs_data,
                   const MatrixParams<float>& rhs_params, const float* rhs_data,
                   const MatrixParams<float>& dst_params, float* dst_data,
@@ -747,37 +1017,76 @@ struct CustomGemvImpl<float, float, float, float,
         acc3 = mul_add(acc3, filter_val_3, input_val);
       }
 
-      // Horizontally reduce accumulators
-      float32x2_t pairwise_reduced_acc_0 =
-          vpadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
-      float32x2_t pairwise_reduced_acc_1 =
-          vpadd_f32(vget_low_f32(acc1), vget_high_f32(acc1));
-      float32x2_t pairwise_reduced_acc_2 =
-          vpadd_f32(vget_low_f32(acc2), vget_high_f32(acc2));
-      float32x2_t pairwise_reduced_acc_3 =
-          vpadd_f32(vget_low_f32(acc3), vget_high_f32(acc3));
-      float32x2_t reduced_lo =
-          vpadd_f32(pairwise_reduced_acc_0, pairwise_reduced_acc_1);
-      float32x2_t reduced_hi =
-          vpadd_f32(pairwise_reduced_acc_2, pairwise_reduced_acc_3);
-      float32x4_t reduced = vcombine_f32(reduced_lo, reduced_hi);
-      // End of horizontal reduction: now `reduced` is a single float32x4
-      // containing the 4 float32 accumulators corresponding to the 4 rows
-      // being processed.
-
-      if (params.bias) {
-        // Add bias values.
-        reduced = vaddq_f32(reduced, vld1q_f32(params.bias + row));
+      ReduceAndStore(acc0, acc1, acc2, acc3, dst_data, params, row);
+    }
+  }
+
+  static void RunPrepacked(const MatrixParams<float>& lhs_params,
+                           const float* lhs_data,
+                           const float* prepacked_lhs_data,
+                           const MatrixParams<float>& rhs_params,
+                           const float* rhs_data,
+                           const MatrixParams<float>& dst_params,
+                           float* dst_data,
+                           const GemmParams<float, float>& params,
+                           int row_start, int row_end) {
+    static_assert(kKernelRows == kPrepackedLhsPanelRows, "");
+    static_assert(PrepackedLhsLayout<float>::kChunkCols == 4, "");
+    TFLITE_DCHECK_GE(row_end - row_start, kKernelRows);
+    TFLITE_DCHECK_EQ(row_start % kKernelRows, 0);
+    const int padded_cols = PrepackedLhsLayout<float>::PaddedCols(lhs_params);
+    // As in the quantized case, pad the last values of the right-hand side
+    // like the last chunk of the prepacked rows, with zeros.
+    const int tail_start = RoundDown<4>(lhs_params.cols);
+    float rhs_tail[4];
+    std::fill(std::copy(rhs_data + tail_start, rhs_data + lhs_params.cols,
+                        rhs_tail),
+              rhs_tail + 4, 0.0f);
+
+    int row = row_start;
+    for (; row + kKernelRows <= row_end; row += kKernelRows) {
+      const float* filter_ptr = prepacked_lhs_data + row * padded_cols;
+
+      static constexpr int kCacheLineSize = 64;
+      for (int k = 0; k < rhs_params.rows;
+           k += kCacheLineSize / sizeof(float)) {
+        optimized_ops_preload_l1_keep(rhs_data + k);
       }
+      // Each iteration below reads a cache line of the stream.
+      static constexpr int kPreloadAhead = 4 * kCacheLineSize;
 
-      // Clamp and store to destination.
-      reduced = vminq_f32(reduced, vdupq_n_f32(params.clamp_max));
-      reduced = vmaxq_f32(reduced, vdupq_n_f32(params.clamp_min));
-      vst1q_f32(dst_data + row, reduced);
+      float32x4_t acc0 = vdupq_n_f32(0);
+      float32x4_t acc1 = acc0;
+      float32x4_t acc2 = acc0;
+      float32x4_t acc3 = acc0;
+      for (int in = 0; in < padded_cols; in += 4) {
+        float32x4_t input_val =
+            vld1q_f32(in < tail_start ? rhs_data + in : rhs_tail);
+        optimized_ops_preload_l1_stream(filter_ptr +
+                                        kPreloadAhead / sizeof(float));
+        float32x4_t filter_val_0 = vld1q_f32(filter_ptr);
+        float32x4_t filter_val_1 = vld1q_f32(filter_ptr + 4);
+        float32x4_t filter_val_2 = vld1q_f32(filter_ptr + 8);
+        float32x4_t filter_val_3 = vld1q_f32(filter_ptr + 12);
+        filter_ptr += 16;
+        acc0 = mul_add(acc0, filter_val_0, input_val);
+        acc1 = mul_add(acc1, filter_val_1, input_val);
+        acc2 = mul_add(acc2, filter_val_2, input_val);
+        acc3 = mul_add(acc3, filter_val_3, input_val);
+      }
+      ReduceAndStore(acc0, acc1, acc2, acc3, dst_data, params, row);
+    }
+    if (row < row_end) {
+      // The last rows, which don't make a whole panel, weren't prepacked.
+      Run(lhs_params, lhs_data, rhs_params, rhs_data, dst_params, dst_data,
+          params, row_end - kKernelRows, row_end);
     }
   }
 };
 
+template <>
+struct HasPrepackedLhsCustomGemv<float> : std::true_type {};
+
 #endif  // TFLITE_WITH_RUY_ONLY
 
 #endif  // USE_NEON
@@ -65,6 +65,12 @@ struct MatrixParams {
   // cache the packing work, which can be a large speedup in matrix*vector
   // and other narrow shapes.
   CachePolicy cache_policy = CachePolicy::kNeverCache;
+  // For a left-hand side prepacked by PrepackLhs, the prepacked copy of the
+  // data, as returned by PrepackedWeightsCache::Reference::data(). The custom
+  // GEMV paths then read it instead of the data passed to Gemm. It must have
+  // been prepacked with the same params and data as the ones passed to Gemm.
+  // Ignored for the right-hand side and destination.
+  const void* prepacked_data = nullptr;
 };
 
 // Enumeration of broad categories of Gemm.
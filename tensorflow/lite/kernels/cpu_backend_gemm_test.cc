@@ -20,11 +20,15 @@ limitations under the License.
 #include <stdlib.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <type_traits>
 #include <vector>
@@ -366,12 +370,13 @@ void ReferenceGemm(
 template <typename LhsScalar, typename RhsScalar, typename AccumScalar,
           typename DstScalar>
 void TestSomeGemm(int rows, int depth, int cols,
-                  const std::vector<DstScalar>& golden) {
+                  const std::vector<DstScalar>& golden,
+                  bool prepack_lhs = false) {
   CpuBackendContext cpu_backend_context;
   std::default_random_engine random_engine;
   cpu_backend_context.SetMaxNumThreads(1 + (random_engine() % 8));
   bool use_caching = static_cast<bool>(random_engine() % 2);
-  cpu_backend_context.SetUseCaching(use_caching);
+  cpu_backend_context.SetUseCaching(use_caching || prepack_lhs);
   const bool use_golden = !golden.empty();
 
   std::vector<LhsScalar> lhs_data;
@@ -400,6 +405,15 @@ void TestSomeGemm(int rows, int depth, int cols,
     }
   }
 
+  std::unique_ptr<PrepackedWeightsCache::Reference> prepacked_lhs;
+  if (prepack_lhs) {
+    prepacked_lhs = cpu_backend_gemm::PrepackLhs(lhs_params, lhs_data.data(),
+                                                 &cpu_backend_context);
+    if (prepacked_lhs) {
+      lhs_params.prepacked_data = prepacked_lhs->data();
+    }
+  }
+
   MatrixParams<RhsScalar> rhs_params;
   rhs_params.order = cpu_backend_gemm::Order::kColMajor;
   rhs_params.rows = depth;
@@ -527,7 +541,8 @@ struct TypesTuple {
 };
 
 template <typename TypesTupleType>
-void TestRandomGemms(const std::vector<std::tuple<int, int, int>>& shapes) {
+void TestRandomGemms(const std::vector<std::tuple<int, int, int>>& shapes,
+                     bool prepack_lhs = false) {
   using LhsScalar = typename TypesTupleType::LhsScalar;
   using RhsScalar = typename TypesTupleType::RhsScalar;
   using AccumScalar = typename TypesTupleType::AccumScalar;
@@ -536,8 +551,8 @@ void TestRandomGemms(const std::vector<std::tuple<int, int, int>>& shapes) {
     int rows = std::get<0>(shape);
     int depth = std::get<1>(shape);
     int cols = std::get<2>(shape);
-    TestSomeGemm<LhsScalar, RhsScalar, AccumScalar, DstScalar>(rows, depth,
-                                                               cols, {});
+    TestSomeGemm<LhsScalar, RhsScalar, AccumScalar, DstScalar>(
+        rows, depth, cols, {}, prepack_lhs);
   }
 }
 
@@ -580,6 +595,15 @@ TYPED_TEST(CpuBackendGemmTest, MatrixTimesVector) {
   TestRandomGemms<TypeParam>(shapes);
 }
 
+TYPED_TEST(CpuBackendGemmTest, MatrixTimesVectorWithPrepackedLhs) {
+  std::vector<std::tuple<int, int, int>> shapes;
+  for (int size = 1; size < 200; size++) {
+    shapes.push_back(std::make_tuple(size, size, 1));
+    shapes.push_back(std::make_tuple(size, size + 13, 1));
+  }
+  TestRandomGemms<TypeParam>(shapes, /*prepack_lhs=*/true);
+}
+
 TYPED_TEST(CpuBackendGemmTest, VectorTimesMatrix) {
   std::vector<std::tuple<int, int, int>> shapes;
   for (int size = 1; size < 200; size++) {
@@ -634,6 +658,86 @@ TYPED_TEST(CpuBackendGemmTest, OuterProduct) {
   TestRandomGemms<TypeParam>(shapes);
 }
 
+TEST(CpuBackendGemmPrepackLhsTest, SharesPrepackedLhs) {
+  std::vector<std::uint8_t> lhs_data;
+  MakeDeterministicPseudoRandomVector(64 * 100, &lhs_data);
+  MatrixParams<std::uint8_t> lhs_params;
+  lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
+  lhs_params.rows = 64;
+  lhs_params.cols = 100;
+  lhs_params.zero_point = 3;
+
+  CpuBackendContext context1;
+  CpuBackendContext context2;
+  auto cache = std::make_shared<PrepackedWeightsCache>();
+  context1.SetPrepackedWeightsCache(cache);
+  context2.SetPrepackedWeightsCache(cache);
+  // Nothing is prepacked unless caching is enabled.
+  EXPECT_FALSE(
+      cpu_backend_gemm::PrepackLhs(lhs_params, lhs_data.data(), &context1));
+
+  context1.SetUseCaching(true);
+  context2.SetUseCaching(true);
+  auto prepacked_lhs1 =
+      cpu_backend_gemm::PrepackLhs(lhs_params, lhs_data.data(), &context1);
+  auto prepacked_lhs2 =
+      cpu_backend_gemm::PrepackLhs(lhs_params, lhs_data.data(), &context2);
+  if (!cpu_backend_gemm::detail::HasPrepackedLhsCustomGemv<
+          std::uint8_t>::value) {
+    EXPECT_FALSE(prepacked_lhs1);
+    EXPECT_FALSE(prepacked_lhs2);
+    return;
+  }
+  ASSERT_TRUE(prepacked_lhs1);
+  ASSERT_TRUE(prepacked_lhs2);
+  EXPECT_EQ(prepacked_lhs1->data(), prepacked_lhs2->data());
+  EXPECT_EQ(cache->num_entries(), 1);
+
+  // Other params make another entry.
+  lhs_params.zero_point = 4;
+  auto prepacked_lhs3 =
+      cpu_backend_gemm::PrepackLhs(lhs_params, lhs_data.data(), &context1);
+  EXPECT_NE(prepacked_lhs3->data(), prepacked_lhs1->data());
+  EXPECT_EQ(cache->num_entries(), 2);
+
+  // Entries are freed along with their last reference.
+  prepacked_lhs1.reset();
+  EXPECT_EQ(cache->num_entries(), 2);
+  prepacked_lhs2.reset();
+  EXPECT_EQ(cache->num_entries(), 1);
+  prepacked_lhs3.reset();
+  EXPECT_EQ(cache->num_entries(), 0);
+}
+
+TEST(CpuBackendGemmPrepackLhsTest, PacksEachEntryOnce) {
+  auto cache = std::make_shared<PrepackedWeightsCache>();
+  const PrepackedWeightsCache::Key key = {nullptr, 64, 100, 1, 0};
+  std::atomic<int> num_packs(0);
+  std::vector<std::unique_ptr<PrepackedWeightsCache::Reference>> references(8);
+  std::vector<std::thread> threads;
+  for (auto& reference : references) {
+    threads.emplace_back([&]() {
+      reference = PrepackedWeightsCache::Acquire(
+          cache, key, 64 * 100, [&](void* data) {
+            std::memset(data, 1, 64 * 100);
+            ++num_packs;
+          });
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_packs, 1);
+  EXPECT_EQ(cache->num_entries(), 1);
+  for (const auto& reference : references) {
+    ASSERT_TRUE(reference);
+    EXPECT_EQ(reference->data(), references[0]->data());
+    EXPECT_EQ(static_cast<const char*>(reference->data())[64 * 100 - 1], 1);
+  }
+  references.clear();
+  EXPECT_EQ(cache->num_entries(), 0);
+}
+
 }  // namespace
 
 }  // namespace tflite
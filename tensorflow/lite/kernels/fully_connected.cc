@@ -18,10 +18,14 @@ limitations under the License.
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm_params.h"
 #include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
 #include "tensorflow/lite/kernels/internal/optimized/sparse_ops/fully_connected.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
@@ -53,6 +57,36 @@ bool SupportedSparsityFormat(const TfLiteSparsity& sparsity) {
 static const int kDimMetadataSizeRandomSparse = 2;
 static const int kDimMetadataSizeBlockSparse = 3;
 
+// Returns true if `filter` holds weights in the block sparse formats of the
+// quantized kernels, with blocks of 1x4 or 1x16 elements.
+bool SupportedQuantizedSparsityFormat(const TfLiteTensor* filter) {
+  const TfLiteSparsity& sparsity = *filter->sparsity;
+  if (!SupportedSparsityFormat(sparsity) ||
+      sparsity.dim_metadata_size != kDimMetadataSizeBlockSparse ||
+      sparsity.block_map == nullptr || sparsity.block_map->size != 1 ||
+      sparsity.block_map->data[0] != 1) {
+    return false;
+  }
+  const int block_size = sparsity.dim_metadata[2].dense_size;
+  return (block_size == 4 || block_size == 16) &&
+         SizeOfDimension(filter, 1) % block_size == 0;
+}
+
+// Computes the sums of the rows of block sparse weights.
+void SparseRowSums(const TfLiteSparsity& sparsity, const int8_t* weights,
+                   int num_rows, int32_t* row_sums) {
+  const int block_size = sparsity.dim_metadata[2].dense_size;
+  const int* segments = sparsity.dim_metadata[1].array_segments->data;
+  for (int row = 0; row < num_rows; ++row) {
+    int32_t sum = 0;
+    for (int i = segments[row] * block_size; i < segments[row + 1] * block_size;
+         ++i) {
+      sum += weights[i];
+    }
+    row_sums[row] = sum;
+  }
+}
+
 }  // namespace
 
 // This file has four implementations of FullyConnected
@@ -74,6 +108,9 @@ struct OpData {
   // The index of the temporary tensor where the quantized inputs are cached.
   int scratch_tensor_index;
   bool compute_row_sums = false;
+  // Keeps the constant filter prepacked for the matrix*vector products of the
+  // optimized kernels, see cpu_backend_gemm::PrepackLhs.
+  std::unique_ptr<PrepackedWeightsCache::Reference> prepacked_filter;
 };
 
 constexpr int kInputTensor = 0;
@@ -116,6 +153,10 @@ inline TfLiteStatus CheckTypes(TfLiteContext* context,
       TF_LITE_ENSURE(context, output->type == kTfLiteUInt8 ||
                                   output->type == kTfLiteInt8 ||
                                   output->type == kTfLiteInt16);
+      // The sparse int8 kernels only produce int8 outputs.
+      if (filter->sparsity != nullptr && filter->type == kTfLiteInt8) {
+        TF_LITE_ENSURE_TYPES_EQ(context, output->type, kTfLiteInt8);
+      }
       TF_LITE_ENSURE_EQ(context, is_optional_bias_int, true);
     }
   } else {
@@ -295,6 +336,60 @@ TfLiteStatus PrepareImpl(TfLiteContext* context, TfLiteNode* node) {
   return kTfLiteOk;
 }
 
+template <typename T>
+std::unique_ptr<PrepackedWeightsCache::Reference> PrepackFilter(
+    TfLiteContext* context, const TfLiteTensor* filter, T zero_point) {
+  cpu_backend_gemm::MatrixParams<T> lhs_params;
+  lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
+  lhs_params.rows = SizeOfDimension(filter, 0);
+  lhs_params.cols = SizeOfDimension(filter, 1);
+  lhs_params.zero_point = zero_point;
+  return cpu_backend_gemm::PrepackLhs(
+      lhs_params, GetTensorData<T>(filter),
+      CpuBackendContext::GetFromContext(context));
+}
+
+// Prepacks the filter for the matrix*vector products of the optimized
+// kernels when it is constant, if the CPU backend caches prepacked weights.
+void PrepackFilterIfConstant(TfLiteContext* context, TfLiteNode* node) {
+  auto* params =
+      reinterpret_cast<TfLiteFullyConnectedParams*>(node->builtin_data);
+  OpData* data = reinterpret_cast<OpData*>(node->user_data);
+  const TfLiteTensor* input = GetInput(context, node, kInputTensor);
+  const TfLiteTensor* filter = GetInput(context, node, kWeightsTensor);
+  const TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
+
+  // The previous prepacked filter is only released after acquiring the new
+  // one, so that it isn't prepacked again if it is the same.
+  std::unique_ptr<PrepackedWeightsCache::Reference> prepacked_filter;
+  const int batch_size = NumElements(output) / SizeOfDimension(filter, 0);
+  if (IsConstantTensor(filter) && filter->sparsity == nullptr &&
+      params->weights_format == kTfLiteFullyConnectedWeightsFormatDefault &&
+      batch_size == 1 && input->type == filter->type) {
+    switch (filter->type) {
+      case kTfLiteFloat32:
+        prepacked_filter = PrepackFilter<float>(context, filter, 0.0f);
+        break;
+      case kTfLiteUInt8:
+        prepacked_filter = PrepackFilter<uint8_t>(context, filter,
+                                                  filter->params.zero_point);
+        break;
+      case kTfLiteInt8:
+        prepacked_filter = PrepackFilter<int8_t>(context, filter,
+                                                 filter->params.zero_point);
+        break;
+      default:
+        break;
+    }
+  }
+  data->prepacked_filter = std::move(prepacked_filter);
+}
+
+// Returns the filter prepacked by PrepackFilterIfConstant, if any.
+const void* PrepackedFilterData(const OpData* data) {
+  return data->prepacked_filter ? data->prepacked_filter->data() : nullptr;
+}
+
 template <KernelType kernel_type>
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   // Check for supported activation types.
@@ -315,7 +410,11 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
                                 params->activation == kTfLiteActRelu1 ||
                                 params->activation == kTfLiteActRelu6);
   }
-  return PrepareImpl(context, node);
+  TF_LITE_ENSURE_STATUS(PrepareImpl(context, node));
+  if (kernel_type == kGenericOptimized) {
+    PrepackFilterIfConstant(context, node);
+  }
+  return kTfLiteOk;
 }
 
 TfLiteStatus EvalPie(TfLiteContext* context, TfLiteNode* node,
@@ -407,12 +506,42 @@ TfLiteStatus EvalHybrid(TfLiteContext* context, TfLiteNode* node,
   }
 
   // Compute output += weight * quantized_input
-  int32_t* scratch = GetTensorData<int32_t>(accum_scratch);
-  tensor_utils::MatrixBatchVectorMultiplyAccumulate(
-      filter_data, num_units, input_size, quant_data, scaling_factors_ptr,
-      batch_size, GetTensorData<float>(output), /*per_channel_scale=*/nullptr,
-      input_offset_ptr, scratch, row_sums_ptr, &data->compute_row_sums,
-      CpuBackendContext::GetFromContext(context));
+  if (filter->sparsity != nullptr) {
+    const TfLiteSparsity& sparsity = *filter->sparsity;
+    const int* segments = sparsity.dim_metadata[1].array_segments->data;
+    const int* indices = sparsity.dim_metadata[1].array_indices->data;
+    float* output_ptr = GetTensorData<float>(output);
+    if (sparsity.dim_metadata[2].dense_size == 4) {
+      tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
+          filter_data, segments, indices, num_units, input_size, quant_data,
+          scaling_factors_ptr, batch_size, output_ptr);
+    } else {
+      tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
+          filter_data, segments, indices, num_units, input_size, quant_data,
+          scaling_factors_ptr, batch_size, output_ptr);
+    }
+    // The products above don't account for the offsets of asymmetrically
+    // quantized inputs.
+    if (params->asymmetric_quantize_inputs) {
+      if (data->compute_row_sums) {
+        SparseRowSums(sparsity, filter_data, num_units, row_sums_ptr);
+        data->compute_row_sums = false;
+      }
+      for (int b = 0; b < batch_size; ++b) {
+        const float offset_scale = input_offset_ptr[b] * scaling_factors_ptr[b];
+        for (int i = 0; i < num_units; ++i) {
+          output_ptr[b * num_units + i] -= row_sums_ptr[i] * offset_scale;
+        }
+      }
+    }
+  } else {
+    int32_t* scratch = GetTensorData<int32_t>(accum_scratch);
+    tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+        filter_data, num_units, input_size, quant_data, scaling_factors_ptr,
+        batch_size, GetTensorData<float>(output), /*per_channel_scale=*/nullptr,
+        input_offset_ptr, scratch, row_sums_ptr, &data->compute_row_sums,
+        CpuBackendContext::GetFromContext(context));
+  }
 
   // Apply activation function to floats.
   tensor_utils::ApplyActivationToVector(
@@ -437,7 +566,25 @@ void FullyConnectedInt8(const OpData* data, const TfLiteTensor* input,
   op_params.quantized_activation_max = data->output_activation_max;
   op_params.lhs_cacheable = IsConstantTensor(filter);
   op_params.rhs_cacheable = IsConstantTensor(input);
-  if (kernel_type == kReference) {
+  op_params.lhs_prepacked_data = PrepackedFilterData(data);
+  if (filter->sparsity != nullptr) {
+    const auto& sparsity = *filter->sparsity;
+    if (kernel_type == kReference) {
+      reference_ops::FullyConnectedSparseWeight(
+          sparsity, op_params, GetTensorShape(input),
+          GetTensorData<int8_t>(input), GetTensorShape(filter),
+          GetTensorData<int8_t>(filter), GetTensorShape(bias),
+          GetTensorData<int32_t>(bias), GetTensorShape(output),
+          GetTensorData<int8_t>(output));
+    } else {
+      optimized_ops::FullyConnectedSparseWeight1xN(
+          sparsity, op_params, GetTensorShape(input),
+          GetTensorData<int8_t>(input), GetTensorShape(filter),
+          GetTensorData<int8_t>(filter), GetTensorShape(bias),
+          GetTensorData<int32_t>(bias), GetTensorShape(output),
+          GetTensorData<int8_t>(output));
+    }
+  } else if (kernel_type == kReference) {
     reference_integer_ops::FullyConnected(
         op_params, GetTensorShape(input), GetTensorData<int8_t>(input),
         GetTensorShape(filter), GetTensorData<int8_t>(filter),
@@ -482,6 +629,18 @@ TfLiteStatus EvalQuantized(TfLiteContext* context, TfLiteNode* node,
   int32_t input_offset = -input->params.zero_point;
   int32_t filter_offset = -filter->params.zero_point;
   int32_t output_offset = output->params.zero_point;
+  if (filter->sparsity != nullptr) {
+    // Only symmetrically quantized int8 weights with 1x4 or 1x16 blocks are
+    // supported, for int8 or float (hybrid) inputs.
+    if (!SupportedQuantizedSparsityFormat(filter) ||
+        filter->type != kTfLiteInt8 ||
+        (input->type != kTfLiteInt8 && input->type != kTfLiteFloat32)) {
+      TF_LITE_KERNEL_LOG(context,
+                         "Unsupported sparse fully-connected weight format.");
+      return kTfLiteError;
+    }
+    TF_LITE_ENSURE_EQ(context, filter_offset, 0);
+  }
   // Only the Pie path supports quantized models and float inputs/outputs.
   if (input->type == kTfLiteFloat32) {
     TfLiteTensor* input_quantized = GetTemporary(context, node, /*index=*/0);
@@ -503,6 +662,7 @@ TfLiteStatus EvalQuantized(TfLiteContext* context, TfLiteNode* node,
     op_params.quantized_activation_max = data->output_activation_max;
     op_params.lhs_cacheable = IsConstantTensor(filter);
     op_params.rhs_cacheable = IsConstantTensor(input);
+    op_params.lhs_prepacked_data = PrepackedFilterData(data);
     switch (output->type) {
       case kTfLiteUInt8:
         if (kernel_type == kReference) {
@@ -675,6 +835,7 @@ TfLiteStatus EvalFloat(TfLiteContext* context, TfLiteNode* node,
     } else {
       op_params.lhs_cacheable = IsConstantTensor(filter);
       op_params.rhs_cacheable = IsConstantTensor(input);
+      op_params.lhs_prepacked_data = PrepackedFilterData(data);
       optimized_ops::FullyConnected(
           op_params, GetTensorShape(input), GetTensorData<float>(input),
           GetTensorShape(filter), GetTensorData<float>(filter),
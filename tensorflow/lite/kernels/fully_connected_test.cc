@@ -1355,6 +1355,190 @@ TEST_P(SparseFullyConnectedOpTest, Simple1x4TestMultiThreadedMoreBatches) {
                                            ));
   }
 }
+// Fully connected model with constant block sparse int8 weights, and either
+// int8 or float (hybrid) inputs.
+class SparseQuantizedFullyConnectedOpModel : public SingleOpModel {
+ public:
+  SparseQuantizedFullyConnectedOpModel(
+      TfLiteRegistration* registration, int units, int batches,
+      const TensorData& input, const TensorData& weights,
+      std::initializer_list<int8_t> weights_data, const TensorData& output,
+      bool asymmetric_inputs = false)
+      : batches_(batches), units_(units) {
+    input_ = AddInput(input);
+    weights_ = AddConstSparseInput(weights, weights_data);
+
+    if (input.type == TensorType_INT8) {
+      // The bias scale is the product of the input and weights scales.
+      auto bias_scale = GetScale(input_) * weights.scale;
+      TensorData bias{TensorType_INT32, {units_}, 0, 0, bias_scale};
+      bias_ = AddInput(bias);
+    } else {
+      bias_ = AddInput({TensorType_FLOAT32, {units_}});
+    }
+
+    output_ = AddOutput(output);
+
+    auto options = CreateFullyConnectedOptions(
+                       builder_, ActivationFunctionType_RELU,
+                       tflite::FullyConnectedOptionsWeightsFormat_DEFAULT,
+                       false, asymmetric_inputs)
+                       .Union();
+    SetBuiltinOp(BuiltinOperator_FULLY_CONNECTED,
+                 BuiltinOptions_FullyConnectedOptions, options);
+    resolver_ = absl::make_unique<SingleOpResolver>(
+        BuiltinOperator_FULLY_CONNECTED, registration);
+    BuildInterpreter({GetShape(input_), GetShape(weights_), GetShape(bias_)},
+                     /*num_threads=*/-1, /*allow_fp32_relax_to_fp16=*/false,
+                     /*apply_delegate=*/false);
+  }
+
+  void SetBias(const std::vector<float>& data) {
+    if (interpreter_->tensor(bias_)->type == kTfLiteInt32) {
+      QuantizeAndPopulate<int32_t>(bias_, data);
+    } else {
+      PopulateTensor(bias_, data);
+    }
+  }
+  void SetInput(const std::vector<float>& data) {
+    if (interpreter_->tensor(input_)->type == kTfLiteInt8) {
+      QuantizeAndPopulate<int8_t>(input_, data);
+    } else {
+      PopulateTensor(input_, data);
+    }
+  }
+
+  std::vector<int8_t> GetQuantizedOutput() {
+    return ExtractVector<int8_t>(output_);
+  }
+  std::vector<float> GetDequantizedOutput() {
+    return Dequantize<int8_t>(ExtractVector<int8_t>(output_),
+                              GetScale(output_), GetZeroPoint(output_));
+  }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+  std::vector<int> GetOutputShape() { return GetTensorShape(output_); }
+
+ protected:
+  int input_;
+  int weights_;
+  int bias_;
+  int output_;
+
+  int batches_;
+  int units_;
+};
+
+TensorData SparseInt8Weights(std::vector<int> shape, int block_size) {
+  TensorData weight = {};
+  weight.type = TensorType_INT8;
+  weight.shape = shape;
+  weight.scale = 1.0;
+  weight.traversal_order = {0, 1, 2};
+  weight.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  weight.block_map = {1};
+  weight.block_size = {block_size};
+  return weight;
+}
+
+TEST_P(SparseFullyConnectedOpTest, SimpleInt8Test1x4) {
+  SparseQuantizedFullyConnectedOpModel m(
+      GetRegistration(), /*units=*/3, /*batches=*/2,
+      /*input=*/{TensorType_INT8, {2, 8}, -63.5, 64},
+      SparseInt8Weights({3, 8}, /*block_size=*/4),
+      {
+          1, 2, 3, 4, 0, 0,  0, 0,   // u = 0
+          0, 0, 0, 0, 1, -1, 1, -1,  // u = 1
+          2, 0, 0, -2, 1, 1, 1, 1,   // u = 2
+      },
+      /*output=*/{TensorType_INT8, {}, -127, 128});
+  m.SetBias({1, 2, 3});
+
+  m.SetInput({
+      1, 2, 3, 4, 5, 6, 7, 8,      // b = 0
+      -1, 1, -2, 2, -3, 3, -4, 4,  // b = 1
+  });
+
+  m.Invoke();
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAre(2, 3));
+  EXPECT_THAT(m.GetDequantizedOutput(),
+              ElementsAreArray(ArrayFloatNear({31, 0, 23, 4, 0, 0})));
+  EXPECT_THAT(m.GetQuantizedOutput(), ElementsAre(30, -1, 22, 3, -1, -1));
+}
+
+TEST_P(SparseFullyConnectedOpTest, SimpleInt8Test1x16) {
+  std::vector<float> input(32);
+  for (int i = 0; i < 32; ++i) {
+    input[i] = i * 0.5;
+  }
+  SparseQuantizedFullyConnectedOpModel m(
+      GetRegistration(), /*units=*/2, /*batches=*/1,
+      /*input=*/{TensorType_INT8, {1, 32}, -63.5, 64},
+      SparseInt8Weights({2, 32}, /*block_size=*/16),
+      {
+          // u = 0
+          1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  //
+          0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //
+          // u = 1
+          0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,          //
+          1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1,  //
+      },
+      /*output=*/{TensorType_INT8, {}, -127, 128});
+  m.SetBias({1, 10});
+  m.SetInput(input);
+
+  m.Invoke();
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAre(1, 2));
+  EXPECT_THAT(m.GetDequantizedOutput(),
+              ElementsAreArray(ArrayFloatNear({61, 6})));
+  EXPECT_THAT(m.GetQuantizedOutput(), ElementsAre(60, 5));
+}
+
+TEST_P(SparseFullyConnectedOpTest, SimpleHybridTest1x4) {
+  for (bool asymmetric_inputs : {false, true}) {
+    SparseQuantizedFullyConnectedOpModel m(
+        GetRegistration(), /*units=*/3, /*batches=*/2,
+        /*input=*/{TensorType_FLOAT32, {2, 8}},
+        SparseInt8Weights({3, 8}, /*block_size=*/4),
+        {
+            1, 2, 3, 4, 0, 0,  0, 0,   // u = 0
+            0, 0, 0, 0, 1, -1, 1, -1,  // u = 1
+            2, 0, 0, -2, 1, 1, 1, 1,   // u = 2
+        },
+        /*output=*/{TensorType_FLOAT32}, asymmetric_inputs);
+    m.SetBias({1, 2, 3});
+
+    m.SetInput({
+        1, 2, 3, 4, 5, 6, 7, 8,      // b = 0
+        -1, 1, -2, 2, -3, 3, -4, 4,  // b = 1
+    });
+
+    m.Invoke();
+
+    EXPECT_THAT(m.GetOutputShape(), ElementsAre(2, 3));
+    EXPECT_THAT(m.GetOutput(),
+                ElementsAreArray(ArrayFloatNear({31, 0, 23, 4, 0, 0},
+                                                /*max_abs_error=*/0.5f)));
+  }
+}
+
+#ifdef GTEST_HAS_DEATH_TEST
+TEST_P(SparseFullyConnectedOpTest, Int8WeightsRequireInt8Output) {
+  EXPECT_DEATH(SparseQuantizedFullyConnectedOpModel m(
+                   GetRegistration(), /*units=*/3, /*batches=*/2,
+                   /*input=*/{TensorType_INT8, {2, 8}, -63.5, 64},
+                   SparseInt8Weights({3, 8}, /*block_size=*/4),
+                   {
+                       1, 2, 3, 4, 0, 0,  0, 0,   // u = 0
+                       0, 0, 0, 0, 1, -1, 1, -1,  // u = 1
+                       2, 0, 0, -2, 1, 1, 1, 1,   // u = 2
+                   },
+                   /*output=*/{TensorType_INT16, {}, -128, 127}),
+               "Cannot allocate tensors");
+}
+#endif
+
 // TODO(b/148391360): Add tests for unsupported sparsity format.
 // TEST_P(SparseFullyConnectedOpTest, TestUnsupportedSparsityFormat)
 
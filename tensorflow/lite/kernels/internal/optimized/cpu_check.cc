@@ -19,6 +19,11 @@ limitations under the License.
 #include <sys/auxv.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define TFLITE_DETECT_X86_FEATURES
+#endif
+
 namespace tflite {
 
 namespace {
@@ -37,6 +42,27 @@ bool DetectDotprodByLinuxAuxvMethod() {
 }
 #endif
 
+#ifdef TFLITE_DETECT_X86_FEATURES
+// Returns the extended features (leaf 7) in ebx and ecx, and the state
+// components enabled by the OS in xcr0, or false if either isn't available.
+bool GetX86Features(unsigned int* ebx, unsigned int* ecx, unsigned int* xcr0) {
+  unsigned int eax, edx;
+  // The OS must have enabled xgetbv, for the AVX registers to be saved.
+  const unsigned int kOsxsave = 1 << 27;
+  if (!__get_cpuid(1, &eax, ebx, ecx, &edx) || !(*ecx & kOsxsave)) {
+    return false;
+  }
+  if (__get_cpuid_max(0, nullptr) < 7) {
+    return false;
+  }
+  // xgetbv is emitted directly, as its intrinsic requires -mxsave.
+  __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  *xcr0 = eax;
+  __cpuid_count(7, 0, eax, *ebx, *ecx, edx);
+  return true;
+}
+#endif
+
 }  // namespace
 
 bool DetectArmNeonDotprod() {
@@ -47,4 +73,35 @@ bool DetectArmNeonDotprod() {
   return false;
 }
 
+bool DetectX86Avx2() {
+#ifdef TFLITE_DETECT_X86_FEATURES
+  unsigned int ebx, ecx, xcr0;
+  if (!GetX86Features(&ebx, &ecx, &xcr0)) {
+    return false;
+  }
+  // The XMM and YMM state.
+  const unsigned int kXcr0Avx = 0x6;
+  const unsigned int kAvx2 = 1 << 5;
+  return (xcr0 & kXcr0Avx) == kXcr0Avx && (ebx & kAvx2);
+#endif
+  return false;
+}
+
+bool DetectX86Avx512Vnni() {
+#ifdef TFLITE_DETECT_X86_FEATURES
+  unsigned int ebx, ecx, xcr0;
+  if (!GetX86Features(&ebx, &ecx, &xcr0)) {
+    return false;
+  }
+  // The XMM, YMM, opmask and ZMM state.
+  const unsigned int kXcr0Avx512 = 0xe6;
+  const unsigned int kAvx512F = 1 << 16;
+  const unsigned int kAvx512Bw = 1 << 30;
+  const unsigned int kAvx512Vnni = 1 << 11;
+  return (xcr0 & kXcr0Avx512) == kXcr0Avx512 && (ebx & kAvx512F) &&
+         (ebx & kAvx512Bw) && (ecx & kAvx512Vnni);
+#endif
+  return false;
+}
+
 }  // namespace tflite
@@ -27,6 +27,14 @@ namespace tflite {
 // On other architectures, returns false unconditionally.
 bool DetectArmNeonDotprod();
 
+// On x86, returns true if AVX2 is present and enabled by the OS.
+// On other architectures, returns false unconditionally.
+bool DetectX86Avx2();
+
+// On x86, returns true if AVX-512 F, BW and VNNI are present and enabled by
+// the OS. On other architectures, returns false unconditionally.
+bool DetectX86Avx512Vnni();
+
 struct CpuFlags {
   bool neon_dotprod = false;
 };
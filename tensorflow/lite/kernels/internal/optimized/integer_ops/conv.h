@@ -99,6 +99,7 @@ inline void ConvPerChannel(
   lhs_params.cols = filter_cols;
   lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
   lhs_params.zero_point = 0;  // filter is symmetric-quantized
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<int8> rhs_params;
   rhs_params.rows = gemm_input_rows;
   rhs_params.cols = gemm_input_cols;
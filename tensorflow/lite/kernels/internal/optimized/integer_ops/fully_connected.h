@@ -66,6 +66,7 @@ inline void FullyConnected(
   lhs_params.cols = filter_cols;
   lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
   lhs_params.zero_point = -filter_offset;
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<int8> rhs_params;
   rhs_params.rows = filter_cols;
   rhs_params.cols = batches;
@@ -2094,6 +2094,185 @@ void NeonSparseMatrixBatchVectorMultiplyAccumulate(
   free(aligned_vec_free);
 }
 
+namespace {
+
+// Loads the elements of `vector` multiplied by the next 16 / kBlockSize blocks
+// of a block sparse row, whose first columns are indices[i] * kBlockSize.
+template <int kBlockSize>
+inline int8x16_t LoadVectorBlocks(const int8_t* __restrict__ vector,
+                                  const int32_t* __restrict__ indices);
+
+template <>
+inline int8x16_t LoadVectorBlocks<4>(const int8_t* __restrict__ vector,
+                                     const int32_t* __restrict__ indices) {
+  int8_t blocks[16];
+  for (int i = 0; i < 4; ++i) {
+    memcpy(blocks + i * 4, vector + indices[i] * 4, 4);
+  }
+  return vld1q_s8(blocks);
+}
+
+template <>
+inline int8x16_t LoadVectorBlocks<16>(const int8_t* __restrict__ vector,
+                                      const int32_t* __restrict__ indices) {
+  return vld1q_s8(vector + indices[0] * 16);
+}
+
+// Returns the dot product of `vector` with the row of a block sparse matrix
+// whose blocks are `row_ptr` and whose block indices are indices[begin] to
+// indices[end - 1]. If kComputeRowSum, also stores the sum of the row.
+template <int kBlockSize, bool kComputeRowSum>
+inline int32_t NeonSparseRowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int32_t* __restrict__ indices,
+    int begin, int end, const int8_t* __restrict__ vector, int32_t* row_sum) {
+  static constexpr int kBlocksPerStep = 16 / kBlockSize;
+  int32x4_t dotprod_32x4 = vmovq_n_s32(0);
+  int32x4_t row_sum_32x4 = vmovq_n_s32(0);
+  int i = begin;
+  for (; i + kBlocksPerStep <= end; i += kBlocksPerStep) {
+    const int8x16_t vec_8x16 =
+        LoadVectorBlocks<kBlockSize>(vector, indices + i);
+    const int8x16_t row_8x16 = vld1q_s8(row_ptr);
+    // The row is symmetrically quantized to [-127, 127], so the sum of two
+    // products can't overflow 16 bits even if the vector holds -128.
+    int16x8_t prod_16x8 =
+        vmull_s8(vget_low_s8(vec_8x16), vget_low_s8(row_8x16));
+    prod_16x8 =
+        vmlal_s8(prod_16x8, vget_high_s8(vec_8x16), vget_high_s8(row_8x16));
+    dotprod_32x4 = vpadalq_s16(dotprod_32x4, prod_16x8);
+    if (kComputeRowSum) {
+      row_sum_32x4 = vpadalq_s16(row_sum_32x4, vpaddlq_s8(row_8x16));
+    }
+    row_ptr += 16;
+  }
+  int32_t dotprod = AccumulateNeonLane(dotprod_32x4);
+  int32_t sum = kComputeRowSum ? AccumulateNeonLane(row_sum_32x4) : 0;
+  // Postamble for the blocks which don't fill a NEON register.
+  for (; i < end; ++i) {
+    const int8_t* vector_block_ptr = vector + indices[i] * kBlockSize;
+    for (int c = 0; c < kBlockSize; ++c) {
+      if (kComputeRowSum) {
+        sum += *row_ptr;
+      }
+      dotprod += *row_ptr++ * *vector_block_ptr++;
+    }
+  }
+  if (kComputeRowSum) {
+    *row_sum = sum;
+  }
+  return dotprod;
+}
+
+// Each row is multiplied by all the vectors in turn, so that its blocks stay
+// in cache.
+template <int kBlockSize>
+void NeonSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (int row = 0; row < m_rows; ++row) {
+    const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+    for (int batch = 0; batch < n_batch; ++batch) {
+      const int32_t dotprod =
+          NeonSparseRowVectorDotProduct<kBlockSize, /*kComputeRowSum=*/false>(
+              row_ptr, indices, segments[row], segments[row + 1],
+              vectors + batch * m_cols, /*row_sum=*/nullptr);
+      result[batch * m_rows + row] += dotprod * scaling_factors[batch];
+    }  // for batch
+  }    // for row
+}
+
+template <int kBlockSize>
+void NeonSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (int row = 0; row < m_rows; ++row) {
+    const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+    const int32_t bias = bias_vector ? bias_vector[row] : 0;
+    int32_t row_sum = 0;
+    for (int batch = 0; batch < n_batch; ++batch) {
+      const int8_t* vector = vectors + batch * m_cols;
+      // The sum of the row is only needed once.
+      const int32_t dotprod =
+          batch == 0
+              ? NeonSparseRowVectorDotProduct<kBlockSize, true>(
+                    row_ptr, indices, segments[row], segments[row + 1], vector,
+                    &row_sum)
+              : NeonSparseRowVectorDotProduct<kBlockSize, false>(
+                    row_ptr, indices, segments[row], segments[row + 1], vector,
+                    nullptr);
+      // sum(row * (vector + input_offset)), computed from the raw vector.
+      int32_t acc = dotprod + input_offset * row_sum + bias;
+      acc = MultiplyByQuantizedMultiplier(acc, output_multiplier, output_shift);
+      acc += output_offset;
+      acc = std::max(acc, output_activation_min);
+      acc = std::min(acc, output_activation_max);
+      result[batch * m_rows + row] = static_cast<int8_t>(acc);
+    }  // for batch
+  }    // for row
+}
+
+}  // namespace
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  NeonSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  NeonSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  NeonSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  NeonSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
 void NeonSub1Vector(const float* vector, int v_size, float* result) {
   // If v_size is not divisible by the vector size, then we need to process the
   // final few elements sequentially. postamble_start shows the start index
@@ -388,6 +388,7 @@ inline void FullyConnected(
   lhs_params.rows = FlatSizeSkipDim(weights_shape, dims_count - 1);
   lhs_params.cache_policy =
       cpu_backend_gemm::DefaultCachePolicy(params.lhs_cacheable);
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<float> dst_params;
   dst_params.order = cpu_backend_gemm::Order::kColMajor;
   dst_params.rows = output_shape.Dims(output_shape.DimensionsCount() - 1);
@@ -442,6 +443,7 @@ inline void FullyConnected(
   lhs_params.zero_point = -filter_offset;
   lhs_params.cache_policy =
       cpu_backend_gemm::DefaultCachePolicy(params.lhs_cacheable);
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<uint8> rhs_params;
   rhs_params.rows = filter_cols;
   rhs_params.cols = batches;
@@ -503,6 +505,7 @@ inline void FullyConnected(
   lhs_params.zero_point = -filter_offset;
   lhs_params.cache_policy =
       cpu_backend_gemm::DefaultCachePolicy(params.lhs_cacheable);
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<uint8> rhs_params;
   rhs_params.rows = accum_depth;
   rhs_params.cols = batches;
@@ -1351,6 +1354,7 @@ inline void Conv(const ConvParams& params, const RuntimeShape& input_shape,
   lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
   lhs_params.rows = n;
   lhs_params.cols = k;
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<float> rhs_params;
   rhs_params.order = cpu_backend_gemm::Order::kColMajor;
   rhs_params.rows = k;
@@ -1647,6 +1651,7 @@ inline void Conv(const ConvParams& params, const RuntimeShape& input_shape,
   lhs_params.cols = filter_cols;
   lhs_params.order = cpu_backend_gemm::Order::kRowMajor;
   lhs_params.zero_point = -filter_offset;
+  lhs_params.prepacked_data = params.lhs_prepacked_data;
   cpu_backend_gemm::MatrixParams<uint8> rhs_params;
   rhs_params.rows = gemm_input_rows;
   rhs_params.cols = gemm_input_cols;
@@ -201,6 +201,48 @@ inline void FullyConnectedSparseWeight1x4(
                                   cpu_backend_context);
 }
 
+// Block sparse int8 weights with blocks of 1x4 or 1x16 elements, as given by
+// the last dimension of `sparsity`. The weights must be symmetrically
+// quantized.
+inline void FullyConnectedSparseWeight1xN(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data) {
+  ruy::profiler::ScopeLabel label("FullyConnected");
+  TFLITE_DCHECK_EQ(params.weights_offset, 0);
+
+  const int output_dims_count = output_shape.DimensionsCount();
+  const int weights_dims_count = weights_shape.DimensionsCount();
+  const int batches = FlatSizeSkipDim(output_shape, output_dims_count - 1);
+  const int output_depth = MatchingDim(weights_shape, weights_dims_count - 2,
+                                       output_shape, output_dims_count - 1);
+  const int accum_depth = weights_shape.Dims(weights_dims_count - 1);
+  const int block_size = sparsity.dim_metadata[2].dense_size;
+  const int* w1_segments = sparsity.dim_metadata[1].array_segments->data;
+  const int* w1_indices = sparsity.dim_metadata[1].array_indices->data;
+
+  if (block_size == 4) {
+    ruy::profiler::ScopeLabel inner_label("1x4 Block Sparse");
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        weights_data, w1_segments, w1_indices, output_depth, accum_depth,
+        input_data, bias_data, batches, params.input_offset,
+        params.output_multiplier, params.output_shift, params.output_offset,
+        params.quantized_activation_min, params.quantized_activation_max,
+        output_data);
+  } else {
+    TFLITE_DCHECK_EQ(block_size, 16);
+    ruy::profiler::ScopeLabel inner_label("1x16 Block Sparse");
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        weights_data, w1_segments, w1_indices, output_depth, accum_depth,
+        input_data, bias_data, batches, params.input_offset,
+        params.output_multiplier, params.output_shift, params.output_offset,
+        params.quantized_activation_min, params.quantized_activation_max,
+        output_data);
+  }
+}
+
 }  // namespace optimized_ops
 }  // namespace tflite
 #endif  // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_FULLY_CONNECTED_H_
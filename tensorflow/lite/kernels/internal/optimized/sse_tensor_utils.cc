@@ -22,10 +22,28 @@ limitations under the License.
 #include <smmintrin.h>  // SSE4.1
 #endif
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/internal/common.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/kernels/internal/optimized/cpu_check.h"
+
+// The AVX2 and AVX-512 VNNI kernels are compiled whatever the compiler flags,
+// with the target attribute, and only run if the CPU supports them.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TFLITE_SSE_DISPATCH_AVX2
+#define TFLITE_TARGET_AVX2 __attribute__((target("avx2")))
+// GCC supports AVX-512 VNNI from version 8.
+#if defined(__clang__) || __GNUC__ >= 8
+#define TFLITE_SSE_DISPATCH_AVX512_VNNI
+#define TFLITE_TARGET_AVX512_VNNI \
+  __attribute__((target("avx2,avx512f,avx512bw,avx512vnni")))
+#endif
+#endif
 
 namespace tflite {
 namespace tensor_utils {
@@ -88,6 +106,187 @@ float GetFloatVectorElement(__m128 v) {
   return _mm_cvtss_f32(v);
 }
 
+// The instruction sets the kernels dispatch to at runtime, in addition to
+// those the file is compiled for.
+enum class X86Isa { kSsse3, kAvx2, kAvx512Vnni };
+
+X86Isa GetX86Isa() {
+  static const X86Isa isa = []() {
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+    if (DetectX86Avx512Vnni()) return X86Isa::kAvx512Vnni;
+#endif
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+    if (DetectX86Avx2()) return X86Isa::kAvx2;
+#endif
+    return X86Isa::kSsse3;
+  }();
+  return isa;
+}
+
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+// Dot product of eight int8 vectors of 4 elements packed into a YMM register.
+// Result is eight int32 scalars packed into a YMM register.
+// int8x4x8 · int8x4x8 => int32x8
+TFLITE_TARGET_AVX2 inline __m256i DotProdInt8x4x8(__m256i a_8x32,
+                                                  __m256i b_8x32) {
+  // Transfer sign from 'a' to 'b', as _mm256_maddubs_epi16 treats 'a'
+  // unsigned.
+  b_8x32 = _mm256_sign_epi8(b_8x32, a_8x32);
+  a_8x32 = _mm256_abs_epi8(a_8x32);
+  const __m256i sumprod_16x16 = _mm256_maddubs_epi16(a_8x32, b_8x32);
+  return _mm256_madd_epi16(sumprod_16x16, _mm256_set1_epi16(1));
+}
+
+// Adds the high and low halves of a YMM register holding 8 int32 values.
+TFLITE_TARGET_AVX2 inline __m128i FoldInt32x8(__m256i acc) {
+  return _mm_add_epi32(_mm256_castsi256_si128(acc),
+                       _mm256_extracti128_si256(acc, 1));
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX2
+
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+// Adds to 'acc' the dot product of sixteen int8 vectors of 4 elements packed
+// into a ZMM register.
+// int32x16 + int8x4x16 · int8x4x16 => int32x16
+TFLITE_TARGET_AVX512_VNNI inline __m512i DotProdAccumulateInt8x4x16(
+    __m512i acc, __m512i a_8x64, __m512i b_8x64) {
+  // _mm512_dpbusd_epi32 treats 'a' unsigned, and AVX-512 has no equivalent of
+  // _mm_sign_epi8: negate 'b' where 'a' is negative instead.
+  const __mmask64 a_negative = _mm512_movepi8_mask(a_8x64);
+  b_8x64 = _mm512_mask_sub_epi8(b_8x64, a_negative, _mm512_setzero_si512(),
+                                b_8x64);
+  return _mm512_dpbusd_epi32(acc, _mm512_abs_epi8(a_8x64), b_8x64);
+}
+
+// Adds the four quarters of a ZMM register holding 16 int32 values.
+TFLITE_TARGET_AVX512_VNNI inline __m128i FoldInt32x16(__m512i acc) {
+  return FoldInt32x8(_mm256_add_epi32(_mm512_castsi512_si256(acc),
+                                      _mm512_extracti64x4_epi64(acc, 1)));
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX512_VNNI
+
+// Returns the dot product of the m_cols elements of 'row_ptr' and 'vector'.
+inline int32_t SseRowVectorDotProduct(const int8_t* __restrict__ row_ptr,
+                                      const int8_t* __restrict__ vector,
+                                      const int m_cols) {
+  // Initialize the dot product sum for the row to 0.
+  __m128i dotprod_32x4 = _mm_setzero_si128();
+  std::intptr_t col = 0;
+  // For every block of 16x 8-bit inputs.
+  while (col < (m_cols & ~15)) {
+    const __m128i vec_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector + col));
+    const __m128i row_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ptr + col));
+    // dotprod += vec · row
+    dotprod_32x4 =
+        _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, row_8x16));
+    col += 16;
+  }
+#ifdef __SSE4_1__
+  // Postamble for 8x 8-bit inputs.
+  if (col < (m_cols & ~7)) {
+    const __m128i vec_16x8 = _mm_cvtepi8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(vector + col)));
+    const __m128i row_16x8 = _mm_cvtepi8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row_ptr + col)));
+    // dotprod += vec · row
+    dotprod_32x4 =
+        _mm_add_epi32(dotprod_32x4, _mm_madd_epi16(vec_16x8, row_16x8));
+    col += 8;
+  }
+  // Postamble for 4x 8-bit inputs, loaded as 32-bit integers so as not to
+  // read past the end of the row.
+  if (col < (m_cols & ~3)) {
+    int32_t vec_8x4, row_8x4;
+    memcpy(&vec_8x4, vector + col, sizeof(vec_8x4));
+    memcpy(&row_8x4, row_ptr + col, sizeof(row_8x4));
+    const __m128i vec_32x4 = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(vec_8x4));
+    const __m128i row_32x4 = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(row_8x4));
+    // dotprod += vec · row
+    dotprod_32x4 =
+        _mm_add_epi32(dotprod_32x4, _mm_mullo_epi32(vec_32x4, row_32x4));
+    col += 4;
+  }
+#endif
+
+  // Horizontally add the 4 intermediate sum values to get the final
+  // dot-prod value for this row.
+  int32_t sum = ReduceInt32x4(dotprod_32x4);
+
+#if defined(__SSE4_1__) && defined(__clang__)
+  // SSE 4.1: Don't try to unroll and vectorize this, already done above.
+#pragma clang loop unroll(disable) vectorize(disable)
+#endif
+  // Postamble loop for <4x (<16x without SSE 4.1) remaining 8-bit inputs.
+  for (; col < m_cols; ++col) {
+    sum += row_ptr[col] * vector[col];
+  }  // for col
+  return sum;
+}
+
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+TFLITE_TARGET_AVX2 inline int32_t Avx2RowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int8_t* __restrict__ vector,
+    const int m_cols) {
+  __m256i dotprod_32x8 = _mm256_setzero_si256();
+  std::intptr_t col = 0;
+  // For every block of 32x 8-bit inputs.
+  for (; col < (m_cols & ~31); col += 32) {
+    const __m256i vec_8x32 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vector + col));
+    const __m256i row_8x32 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ptr + col));
+    // dotprod += vec · row
+    dotprod_32x8 =
+        _mm256_add_epi32(dotprod_32x8, DotProdInt8x4x8(vec_8x32, row_8x32));
+  }
+  // The postamble of <32x 8-bit inputs is done with SSE.
+  return ReduceInt32x4(FoldInt32x8(dotprod_32x8)) +
+         SseRowVectorDotProduct(row_ptr + col, vector + col, m_cols - col);
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX2
+
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+TFLITE_TARGET_AVX512_VNNI int32_t Avx512VnniRowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int8_t* __restrict__ vector,
+    const int m_cols) {
+  __m512i dotprod_32x16 = _mm512_setzero_si512();
+  std::intptr_t col = 0;
+  // For every block of 64x 8-bit inputs.
+  for (; col < (m_cols & ~63); col += 64) {
+    const __m512i vec_8x64 = _mm512_loadu_si512(vector + col);
+    const __m512i row_8x64 = _mm512_loadu_si512(row_ptr + col);
+    // dotprod += vec · row
+    dotprod_32x16 =
+        DotProdAccumulateInt8x4x16(dotprod_32x16, vec_8x64, row_8x64);
+  }
+  // The postamble of <64x 8-bit inputs is done with AVX2 and SSE.
+  return ReduceInt32x4(FoldInt32x16(dotprod_32x16)) +
+         Avx2RowVectorDotProduct(row_ptr + col, vector + col, m_cols - col);
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX512_VNNI
+
+// Returns the dot product of the m_cols elements of 'row_ptr' and 'vector',
+// with the widest instruction set 'isa'.
+inline int32_t RowVectorDotProduct(X86Isa isa,
+                                   const int8_t* __restrict__ row_ptr,
+                                   const int8_t* __restrict__ vector,
+                                   const int m_cols) {
+  switch (isa) {
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+    case X86Isa::kAvx512Vnni:
+      return Avx512VnniRowVectorDotProduct(row_ptr, vector, m_cols);
+#endif
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+    case X86Isa::kAvx2:
+      return Avx2RowVectorDotProduct(row_ptr, vector, m_cols);
+#endif
+    default:
+      return SseRowVectorDotProduct(row_ptr, vector, m_cols);
+  }
+}
+
 }  // namespace
 
 void SseMatrixBatchVectorMultiplyAccumulateImpl(
@@ -96,6 +295,7 @@ void SseMatrixBatchVectorMultiplyAccumulateImpl(
     const float* __restrict__ scaling_factors, int n_batch,
     float* __restrict__ result, const float* per_channel_scale,
     const int32_t* input_offset, const int32_t* row_sums) {
+  const X86Isa isa = GetX86Isa();
   for (std::intptr_t batch = 0; batch < n_batch; ++batch) {
     const float batch_scaling_factor = scaling_factors[batch];
     const int32_t batch_offset = input_offset ? input_offset[batch] : 0;
@@ -108,57 +308,7 @@ void SseMatrixBatchVectorMultiplyAccumulateImpl(
                             : batch_scaling_factor;
       const int32_t row_offset =
           row_sums && batch_offset ? batch_offset * row_sums[row] : 0;
-      // Initialize the dot product sum for the row to 0.
-      __m128i dotprod_32x4 = _mm_setzero_si128();
-      std::intptr_t col = 0;
-      // For every block of 16x 8-bit inputs.
-      while (col < (m_cols & ~15)) {
-        const __m128i vec_8x16 =
-            _mm_loadu_si128(reinterpret_cast<const __m128i*>(vectors + col));
-        const __m128i row_8x16 =
-            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ptr + col));
-        // dotprod += vec · row
-        dotprod_32x4 =
-            _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, row_8x16));
-        col += 16;
-      }
-#ifdef __SSE4_1__
-      // Postamble for 8x 8-bit inputs.
-      if (col < (m_cols & ~7)) {
-        const __m128i vec_16x8 = _mm_cvtepi8_epi16(
-            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(vectors + col)));
-        const __m128i row_16x8 = _mm_cvtepi8_epi16(
-            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row_ptr + col)));
-        // dotprod += vec · row
-        dotprod_32x4 =
-            _mm_add_epi32(dotprod_32x4, _mm_madd_epi16(vec_16x8, row_16x8));
-        col += 8;
-      }
-      // Postamble for 4x 8-bit inputs.
-      if (col < (m_cols & ~3)) {
-        const __m128i vec_32x4 = _mm_cvtepi8_epi32(
-            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(vectors + col)));
-        const __m128i row_32x4 = _mm_cvtepi8_epi32(
-            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row_ptr + col)));
-        // dotprod += vec · row
-        dotprod_32x4 =
-            _mm_add_epi32(dotprod_32x4, _mm_mullo_epi32(vec_32x4, row_32x4));
-        col += 4;
-      }
-#endif
-
-      // Horizontally add the 4 intermediate sum values to get the final
-      // dot-prod value for this row.
-      int32_t sum = ReduceInt32x4(dotprod_32x4);
-
-#if defined(__SSE4_1__) && defined(__clang__)
-      // SSE 4.1: Don't try to unroll and vectorize this, already done above.
-#pragma clang loop unroll(disable) vectorize(disable)
-#endif
-      // Postamble loop for <4x (<16x without SSE 4.1) remaining 8-bit inputs.
-      for (; col < m_cols; ++col) {
-        sum += row_ptr[col] * vectors[col];
-      }  // for col
+      int32_t sum = RowVectorDotProduct(isa, row_ptr, vectors, m_cols);
       if (row_offset) {
         sum -= row_offset;
       }
@@ -233,6 +383,146 @@ inline void SseSparseMatrixVectorMultiplyAccumulate(
   }  // for row
 }
 
+// Returns the dot products of a row of a sparse matrix, whose
+// 'num_nonzero_blocks' blocks are 'matrix' and whose block indices are
+// 'ledger', with 4 vectors. The stride between vectors must be equal to
+// m_cols.
+inline __m128i SseSparseRow4VectorsDotProduct(
+    const int8_t* __restrict__ matrix, const uint8_t* __restrict__ ledger,
+    std::intptr_t num_nonzero_blocks, const int m_cols,
+    const int8_t* __restrict__ vectors) {
+  static const std::intptr_t kBlockSize = 16;
+  const int8_t* __restrict__ vector0 = vectors + 0 * m_cols;
+  const int8_t* __restrict__ vector1 = vectors + 1 * m_cols;
+  const int8_t* __restrict__ vector2 = vectors + 2 * m_cols;
+  const int8_t* __restrict__ vector3 = vectors + 3 * m_cols;
+
+  // Initialize the dot product sum for the row to 0.
+  __m128i dp0_32x4 = _mm_setzero_si128();
+  __m128i dp1_32x4 = _mm_setzero_si128();
+  __m128i dp2_32x4 = _mm_setzero_si128();
+  __m128i dp3_32x4 = _mm_setzero_si128();
+
+  for (std::intptr_t i = 0; i < num_nonzero_blocks; i++) {
+    const std::intptr_t col_index = *ledger++ * kBlockSize;
+    // vecN are for different batches
+    const __m128i vec0_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector0 + col_index));
+    const __m128i vec1_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector1 + col_index));
+    const __m128i vec2_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector2 + col_index));
+    const __m128i vec3_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector3 + col_index));
+    const __m128i row_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix));
+    // dp += vec · row
+    // dpN are for different batches
+    dp0_32x4 = _mm_add_epi32(dp0_32x4, DotProdInt8x4x4(row_8x16, vec0_8x16));
+    dp1_32x4 = _mm_add_epi32(dp1_32x4, DotProdInt8x4x4(row_8x16, vec1_8x16));
+    dp2_32x4 = _mm_add_epi32(dp2_32x4, DotProdInt8x4x4(row_8x16, vec2_8x16));
+    dp3_32x4 = _mm_add_epi32(dp3_32x4, DotProdInt8x4x4(row_8x16, vec3_8x16));
+    matrix += kBlockSize;
+  }  // for col
+
+  // Horizontally add the 4 intermediate values.
+  return ReduceInt32x4x4(dp0_32x4, dp1_32x4, dp2_32x4, dp3_32x4);
+}
+
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+// Same as SseSparseRow4VectorsDotProduct, with the row multiplied by 2
+// vectors at once.
+TFLITE_TARGET_AVX2 __m128i Avx2SparseRow4VectorsDotProduct(
+    const int8_t* __restrict__ matrix, const uint8_t* __restrict__ ledger,
+    std::intptr_t num_nonzero_blocks, const int m_cols,
+    const int8_t* __restrict__ vectors) {
+  static const std::intptr_t kBlockSize = 16;
+  const int8_t* __restrict__ vector0 = vectors + 0 * m_cols;
+  const int8_t* __restrict__ vector1 = vectors + 1 * m_cols;
+  const int8_t* __restrict__ vector2 = vectors + 2 * m_cols;
+  const int8_t* __restrict__ vector3 = vectors + 3 * m_cols;
+
+  // The low and high halves are for different batches.
+  __m256i dp01_32x8 = _mm256_setzero_si256();
+  __m256i dp23_32x8 = _mm256_setzero_si256();
+
+  for (std::intptr_t i = 0; i < num_nonzero_blocks; i++) {
+    const std::intptr_t col_index = *ledger++ * kBlockSize;
+    const __m256i vec01_8x32 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(vector0 + col_index))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector1 + col_index)),
+        1);
+    const __m256i vec23_8x32 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(vector2 + col_index))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector3 + col_index)),
+        1);
+    const __m256i row_8x32 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix)));
+    // dp += vec · row
+    dp01_32x8 =
+        _mm256_add_epi32(dp01_32x8, DotProdInt8x4x8(row_8x32, vec01_8x32));
+    dp23_32x8 =
+        _mm256_add_epi32(dp23_32x8, DotProdInt8x4x8(row_8x32, vec23_8x32));
+    matrix += kBlockSize;
+  }  // for col
+
+  // Horizontally add the 4 intermediate values.
+  return ReduceInt32x4x4(_mm256_castsi256_si128(dp01_32x8),
+                         _mm256_extracti128_si256(dp01_32x8, 1),
+                         _mm256_castsi256_si128(dp23_32x8),
+                         _mm256_extracti128_si256(dp23_32x8, 1));
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX2
+
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+// Same as SseSparseRow4VectorsDotProduct, with the row multiplied by the 4
+// vectors at once.
+TFLITE_TARGET_AVX512_VNNI __m128i Avx512VnniSparseRow4VectorsDotProduct(
+    const int8_t* __restrict__ matrix, const uint8_t* __restrict__ ledger,
+    std::intptr_t num_nonzero_blocks, const int m_cols,
+    const int8_t* __restrict__ vectors) {
+  static const std::intptr_t kBlockSize = 16;
+  const int8_t* __restrict__ vector0 = vectors + 0 * m_cols;
+  const int8_t* __restrict__ vector1 = vectors + 1 * m_cols;
+  const int8_t* __restrict__ vector2 = vectors + 2 * m_cols;
+  const int8_t* __restrict__ vector3 = vectors + 3 * m_cols;
+
+  // Each quarter is for a different batch.
+  __m512i dp_32x16 = _mm512_setzero_si512();
+
+  for (std::intptr_t i = 0; i < num_nonzero_blocks; i++) {
+    const std::intptr_t col_index = *ledger++ * kBlockSize;
+    __m512i vec_8x64 = _mm512_castsi128_si512(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector0 + col_index)));
+    vec_8x64 = _mm512_inserti32x4(
+        vec_8x64,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector1 + col_index)),
+        1);
+    vec_8x64 = _mm512_inserti32x4(
+        vec_8x64,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector2 + col_index)),
+        2);
+    vec_8x64 = _mm512_inserti32x4(
+        vec_8x64,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector3 + col_index)),
+        3);
+    const __m512i row_8x64 = _mm512_broadcast_i32x4(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix)));
+    // dp += vec · row
+    dp_32x16 = DotProdAccumulateInt8x4x16(dp_32x16, row_8x64, vec_8x64);
+    matrix += kBlockSize;
+  }  // for col
+
+  // Horizontally add the 4 intermediate values.
+  return ReduceInt32x4x4(_mm512_extracti32x4_epi32(dp_32x16, 0),
+                         _mm512_extracti32x4_epi32(dp_32x16, 1),
+                         _mm512_extracti32x4_epi32(dp_32x16, 2),
+                         _mm512_extracti32x4_epi32(dp_32x16, 3));
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX512_VNNI
+
 // Implements sparse-matrix - batch-of-4-vectors multiply-accumulate.
 // The stride between vectors and results must be equal to m_cols.
 // Parameter 'batch' is the index of the first batch, must be a multiple of 4.
@@ -244,48 +534,35 @@ inline void SseSparseMatrix4VectorsMultiplyAccumulate(
   static const std::intptr_t kBlockSize = 16;
   TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
 
-  const int8_t* __restrict__ vector0 = vectors + 0 * m_cols;
-  const int8_t* __restrict__ vector1 = vectors + 1 * m_cols;
-  const int8_t* __restrict__ vector2 = vectors + 2 * m_cols;
-  const int8_t* __restrict__ vector3 = vectors + 3 * m_cols;
   float* __restrict__ result0 = results + 0 * m_rows;
   float* __restrict__ result1 = results + 1 * m_rows;
   float* __restrict__ result2 = results + 2 * m_rows;
   float* __restrict__ result3 = results + 3 * m_rows;
 
+  const X86Isa isa = GetX86Isa();
   for (std::intptr_t row = 0; row < m_rows; ++row) {
-    // Initialize the dot product sum for the row to 0.
-    __m128i dp0_32x4 = _mm_setzero_si128();
-    __m128i dp1_32x4 = _mm_setzero_si128();
-    __m128i dp2_32x4 = _mm_setzero_si128();
-    __m128i dp3_32x4 = _mm_setzero_si128();
-
     std::intptr_t num_nonzero_blocks = *ledger++;
-    for (std::intptr_t i = 0; i < num_nonzero_blocks; i++) {
-      const std::intptr_t col_index = *ledger++ * kBlockSize;
-      // vecN are for different batches
-      const __m128i vec0_8x16 = _mm_loadu_si128(
-          reinterpret_cast<const __m128i*>(vector0 + col_index));
-      const __m128i vec1_8x16 = _mm_loadu_si128(
-          reinterpret_cast<const __m128i*>(vector1 + col_index));
-      const __m128i vec2_8x16 = _mm_loadu_si128(
-          reinterpret_cast<const __m128i*>(vector2 + col_index));
-      const __m128i vec3_8x16 = _mm_loadu_si128(
-          reinterpret_cast<const __m128i*>(vector3 + col_index));
-      const __m128i row_8x16 =
-          _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix));
-      // dp += vec · row
-      // dpN are for different batches
-      dp0_32x4 = _mm_add_epi32(dp0_32x4, DotProdInt8x4x4(row_8x16, vec0_8x16));
-      dp1_32x4 = _mm_add_epi32(dp1_32x4, DotProdInt8x4x4(row_8x16, vec1_8x16));
-      dp2_32x4 = _mm_add_epi32(dp2_32x4, DotProdInt8x4x4(row_8x16, vec2_8x16));
-      dp3_32x4 = _mm_add_epi32(dp3_32x4, DotProdInt8x4x4(row_8x16, vec3_8x16));
-      matrix += kBlockSize;
-    }  // for col
+    __m128i dp_32x4;
+    switch (isa) {
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+      case X86Isa::kAvx512Vnni:
+        dp_32x4 = Avx512VnniSparseRow4VectorsDotProduct(
+            matrix, ledger, num_nonzero_blocks, m_cols, vectors);
+        break;
+#endif
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+      case X86Isa::kAvx2:
+        dp_32x4 = Avx2SparseRow4VectorsDotProduct(
+            matrix, ledger, num_nonzero_blocks, m_cols, vectors);
+        break;
+#endif
+      default:
+        dp_32x4 = SseSparseRow4VectorsDotProduct(
+            matrix, ledger, num_nonzero_blocks, m_cols, vectors);
+    }
+    ledger += num_nonzero_blocks;
+    matrix += num_nonzero_blocks * kBlockSize;
 
-    // Horizontally add the 4 intermediate values.
-    const __m128i dp_32x4 =
-        ReduceInt32x4x4(dp0_32x4, dp1_32x4, dp2_32x4, dp3_32x4);
     // Convert to float
     const __m128 dp_fx4 = _mm_cvtepi32_ps(dp_32x4);
     // Load the results (This is an Accumulate function..)
@@ -330,6 +607,324 @@ void SseSparseMatrixBatchVectorMultiplyAccumulate(
   }  // for batch
 }
 
+namespace {
+
+// Loads the elements of `vector` multiplied by the next 16 / kBlockSize blocks
+// of a block sparse row, whose first columns are indices[i] * kBlockSize.
+template <int kBlockSize>
+inline __m128i LoadVectorBlocks(const int8_t* __restrict__ vector,
+                                const int32_t* __restrict__ indices);
+
+template <>
+inline __m128i LoadVectorBlocks<4>(const int8_t* __restrict__ vector,
+                                   const int32_t* __restrict__ indices) {
+  int32_t blocks[4];
+  for (int i = 0; i < 4; ++i) {
+    memcpy(&blocks[i], vector + indices[i] * 4, sizeof(int32_t));
+  }
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks));
+}
+
+template <>
+inline __m128i LoadVectorBlocks<16>(const int8_t* __restrict__ vector,
+                                    const int32_t* __restrict__ indices) {
+  return _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(vector + indices[0] * 16));
+}
+
+// Returns the dot product of `vector` with the row of a block sparse matrix
+// whose blocks are `row_ptr` and whose block indices are indices[begin] to
+// indices[end - 1]. If kComputeRowSum, also stores the sum of the row.
+template <int kBlockSize, bool kComputeRowSum>
+inline int32_t SseSparseRowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int32_t* __restrict__ indices,
+    int begin, int end, const int8_t* __restrict__ vector, int32_t* row_sum) {
+  static constexpr int kBlocksPerStep = 16 / kBlockSize;
+  __m128i dotprod_32x4 = _mm_setzero_si128();
+  __m128i row_sum_32x4 = _mm_setzero_si128();
+  int i = begin;
+  for (; i + kBlocksPerStep <= end; i += kBlocksPerStep) {
+    const __m128i vec_8x16 = LoadVectorBlocks<kBlockSize>(vector, indices + i);
+    const __m128i row_8x16 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_ptr));
+    // DotProdInt8x4x4 may negate its second operand, which must be the
+    // symmetrically quantized row as the vector may hold -128.
+    dotprod_32x4 =
+        _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, row_8x16));
+    if (kComputeRowSum) {
+      const __m128i row_16x8 = _mm_maddubs_epi16(_mm_set1_epi8(1), row_8x16);
+      row_sum_32x4 = _mm_add_epi32(
+          row_sum_32x4, _mm_madd_epi16(row_16x8, _mm_set1_epi16(1)));
+    }
+    row_ptr += 16;
+  }
+  int32_t dotprod = ReduceInt32x4(dotprod_32x4);
+  int32_t sum = kComputeRowSum ? ReduceInt32x4(row_sum_32x4) : 0;
+  // Postamble for the blocks which don't fill a XMM register.
+  for (; i < end; ++i) {
+    const int8_t* vector_block_ptr = vector + indices[i] * kBlockSize;
+    for (int c = 0; c < kBlockSize; ++c) {
+      if (kComputeRowSum) {
+        sum += *row_ptr;
+      }
+      dotprod += *row_ptr++ * *vector_block_ptr++;
+    }
+  }
+  if (kComputeRowSum) {
+    *row_sum = sum;
+  }
+  return dotprod;
+}
+
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+// Same as LoadVectorBlocks, for the next 32 / kBlockSize blocks.
+template <int kBlockSize>
+TFLITE_TARGET_AVX2 inline __m256i Avx2LoadVectorBlocks(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices);
+
+template <>
+TFLITE_TARGET_AVX2 inline __m256i Avx2LoadVectorBlocks<4>(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices) {
+  return _mm256_i32gather_epi32(
+      reinterpret_cast<const int*>(vector),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4);
+}
+
+template <>
+TFLITE_TARGET_AVX2 inline __m256i Avx2LoadVectorBlocks<16>(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices) {
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(vector + indices[0] * 16))),
+      _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(vector + indices[1] * 16)),
+      1);
+}
+
+template <int kBlockSize, bool kComputeRowSum>
+TFLITE_TARGET_AVX2 inline int32_t Avx2SparseRowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int32_t* __restrict__ indices,
+    int begin, int end, const int8_t* __restrict__ vector, int32_t* row_sum) {
+  static constexpr int kBlocksPerStep = 32 / kBlockSize;
+  __m256i dotprod_32x8 = _mm256_setzero_si256();
+  __m256i row_sum_32x8 = _mm256_setzero_si256();
+  int i = begin;
+  for (; i + kBlocksPerStep <= end; i += kBlocksPerStep) {
+    const __m256i vec_8x32 =
+        Avx2LoadVectorBlocks<kBlockSize>(vector, indices + i);
+    const __m256i row_8x32 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ptr));
+    dotprod_32x8 =
+        _mm256_add_epi32(dotprod_32x8, DotProdInt8x4x8(vec_8x32, row_8x32));
+    if (kComputeRowSum) {
+      const __m256i row_16x16 =
+          _mm256_maddubs_epi16(_mm256_set1_epi8(1), row_8x32);
+      row_sum_32x8 = _mm256_add_epi32(
+          row_sum_32x8, _mm256_madd_epi16(row_16x16, _mm256_set1_epi16(1)));
+    }
+    row_ptr += 32;
+  }
+  // The blocks which don't fill a YMM register are done with SSE.
+  int32_t postamble_row_sum = 0;
+  const int32_t dotprod =
+      ReduceInt32x4(FoldInt32x8(dotprod_32x8)) +
+      SseSparseRowVectorDotProduct<kBlockSize, kComputeRowSum>(
+          row_ptr, indices, i, end, vector, &postamble_row_sum);
+  if (kComputeRowSum) {
+    *row_sum = ReduceInt32x4(FoldInt32x8(row_sum_32x8)) + postamble_row_sum;
+  }
+  return dotprod;
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX2
+
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+// Same as LoadVectorBlocks, for the next 64 / kBlockSize blocks.
+template <int kBlockSize>
+TFLITE_TARGET_AVX512_VNNI inline __m512i Avx512VnniLoadVectorBlocks(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices);
+
+template <>
+TFLITE_TARGET_AVX512_VNNI inline __m512i Avx512VnniLoadVectorBlocks<4>(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices) {
+  return _mm512_i32gather_epi32(_mm512_loadu_si512(indices), vector, 4);
+}
+
+template <>
+TFLITE_TARGET_AVX512_VNNI inline __m512i Avx512VnniLoadVectorBlocks<16>(
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ indices) {
+  return _mm512_inserti64x4(
+      _mm512_castsi256_si512(Avx2LoadVectorBlocks<16>(vector, indices)),
+      Avx2LoadVectorBlocks<16>(vector, indices + 2), 1);
+}
+
+template <int kBlockSize, bool kComputeRowSum>
+TFLITE_TARGET_AVX512_VNNI int32_t Avx512VnniSparseRowVectorDotProduct(
+    const int8_t* __restrict__ row_ptr, const int32_t* __restrict__ indices,
+    int begin, int end, const int8_t* __restrict__ vector, int32_t* row_sum) {
+  static constexpr int kBlocksPerStep = 64 / kBlockSize;
+  __m512i dotprod_32x16 = _mm512_setzero_si512();
+  __m512i row_sum_32x16 = _mm512_setzero_si512();
+  int i = begin;
+  for (; i + kBlocksPerStep <= end; i += kBlocksPerStep) {
+    const __m512i vec_8x64 =
+        Avx512VnniLoadVectorBlocks<kBlockSize>(vector, indices + i);
+    const __m512i row_8x64 = _mm512_loadu_si512(row_ptr);
+    dotprod_32x16 =
+        DotProdAccumulateInt8x4x16(dotprod_32x16, vec_8x64, row_8x64);
+    if (kComputeRowSum) {
+      row_sum_32x16 =
+          _mm512_dpbusd_epi32(row_sum_32x16, _mm512_set1_epi8(1), row_8x64);
+    }
+    row_ptr += 64;
+  }
+  // The blocks which don't fill a ZMM register are done with AVX2 and SSE.
+  int32_t postamble_row_sum = 0;
+  const int32_t dotprod =
+      ReduceInt32x4(FoldInt32x16(dotprod_32x16)) +
+      Avx2SparseRowVectorDotProduct<kBlockSize, kComputeRowSum>(
+          row_ptr, indices, i, end, vector, &postamble_row_sum);
+  if (kComputeRowSum) {
+    *row_sum = ReduceInt32x4(FoldInt32x16(row_sum_32x16)) + postamble_row_sum;
+  }
+  return dotprod;
+}
+#endif  // TFLITE_SSE_DISPATCH_AVX512_VNNI
+
+// Same as SseSparseRowVectorDotProduct, with the widest instruction set 'isa'.
+template <int kBlockSize, bool kComputeRowSum>
+inline int32_t SparseRowVectorDotProduct(
+    X86Isa isa, const int8_t* __restrict__ row_ptr,
+    const int32_t* __restrict__ indices, int begin, int end,
+    const int8_t* __restrict__ vector, int32_t* row_sum) {
+  switch (isa) {
+#ifdef TFLITE_SSE_DISPATCH_AVX512_VNNI
+    case X86Isa::kAvx512Vnni:
+      return Avx512VnniSparseRowVectorDotProduct<kBlockSize, kComputeRowSum>(
+          row_ptr, indices, begin, end, vector, row_sum);
+#endif
+#ifdef TFLITE_SSE_DISPATCH_AVX2
+    case X86Isa::kAvx2:
+      return Avx2SparseRowVectorDotProduct<kBlockSize, kComputeRowSum>(
+          row_ptr, indices, begin, end, vector, row_sum);
+#endif
+    default:
+      return SseSparseRowVectorDotProduct<kBlockSize, kComputeRowSum>(
+          row_ptr, indices, begin, end, vector, row_sum);
+  }
+}
+
+// Each row is multiplied by all the vectors in turn, so that its blocks stay
+// in cache.
+template <int kBlockSize>
+void SseSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  const X86Isa isa = GetX86Isa();
+  for (int row = 0; row < m_rows; ++row) {
+    const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+    for (int batch = 0; batch < n_batch; ++batch) {
+      const int32_t dotprod =
+          SparseRowVectorDotProduct<kBlockSize, /*kComputeRowSum=*/false>(
+              isa, row_ptr, indices, segments[row], segments[row + 1],
+              vectors + batch * m_cols, /*row_sum=*/nullptr);
+      result[batch * m_rows + row] += dotprod * scaling_factors[batch];
+    }  // for batch
+  }    // for row
+}
+
+template <int kBlockSize>
+void SseSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  const X86Isa isa = GetX86Isa();
+  for (int row = 0; row < m_rows; ++row) {
+    const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+    const int32_t bias = bias_vector ? bias_vector[row] : 0;
+    int32_t row_sum = 0;
+    for (int batch = 0; batch < n_batch; ++batch) {
+      const int8_t* vector = vectors + batch * m_cols;
+      // The sum of the row is only needed once.
+      const int32_t dotprod =
+          batch == 0
+              ? SparseRowVectorDotProduct<kBlockSize, true>(
+                    isa, row_ptr, indices, segments[row], segments[row + 1],
+                    vector, &row_sum)
+              : SparseRowVectorDotProduct<kBlockSize, false>(
+                    isa, row_ptr, indices, segments[row], segments[row + 1],
+                    vector, nullptr);
+      // sum(row * (vector + input_offset)), computed from the raw vector.
+      int32_t acc = dotprod + input_offset * row_sum + bias;
+      acc = MultiplyByQuantizedMultiplier(acc, output_multiplier, output_shift);
+      acc += output_offset;
+      acc = std::max(acc, output_activation_min);
+      acc = std::min(acc, output_activation_max);
+      result[batch * m_rows + row] = static_cast<int8_t>(acc);
+    }  // for batch
+  }    // for row
+}
+
+}  // namespace
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  SseSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  SseSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  SseSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  SseSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
 void SseReductionSumVector(const int8_t* input_vector, int32_t* output_vector,
                            const int output_size, const int reduction_size) {
   static constexpr std::intptr_t kBlockSize = 16;
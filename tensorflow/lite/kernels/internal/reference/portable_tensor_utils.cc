@@ -291,6 +291,122 @@ void PortableSparseMatrixBatchVectorMultiplyAccumulate(
   }    // for batch
 }
 
+namespace {
+
+// Implementations of the block sparse int8 functions below, for blocks of
+// kBlockSize consecutive elements of a row.
+template <int kBlockSize>
+void PortableSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    for (int row = 0; row < m_rows; ++row) {
+      const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+      int32_t dotprod = 0;
+      for (int i = segments[row]; i < segments[row + 1]; ++i) {
+        const int8_t* vector_block_ptr = vectors + indices[i] * kBlockSize;
+        for (int c = 0; c < kBlockSize; ++c) {
+          dotprod += *row_ptr++ * *vector_block_ptr++;
+        }
+      }
+      result[batch * m_rows + row] += dotprod * batch_scaling_factor;
+    }
+  }
+}
+
+template <int kBlockSize>
+void PortableSparseMatrixBatchVectorMultiplyAccumulateImpl(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    for (int row = 0; row < m_rows; ++row) {
+      const int8_t* row_ptr = matrix + segments[row] * kBlockSize;
+      int32_t dotprod = 0;
+      int32_t row_sum = 0;
+      for (int i = segments[row]; i < segments[row + 1]; ++i) {
+        const int8_t* vector_block_ptr = vectors + indices[i] * kBlockSize;
+        for (int c = 0; c < kBlockSize; ++c) {
+          row_sum += *row_ptr;
+          dotprod += *row_ptr++ * *vector_block_ptr++;
+        }
+      }
+      // sum(row * (vector + input_offset)), computed from the raw vector.
+      int32_t acc = dotprod + input_offset * row_sum;
+      if (bias_vector) {
+        acc += bias_vector[row];
+      }
+      acc = MultiplyByQuantizedMultiplier(acc, output_multiplier, output_shift);
+      acc += output_offset;
+      acc = std::max(acc, output_activation_min);
+      acc = std::min(acc, output_activation_max);
+      result[batch * m_rows + row] = static_cast<int8_t>(acc);
+    }
+  }
+}
+
+}  // namespace
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  PortableSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result) {
+  PortableSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, scaling_factors,
+      n_batch, result);
+}
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  PortableSparseMatrixBatchVectorMultiplyAccumulateImpl<4>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vectors, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  PortableSparseMatrixBatchVectorMultiplyAccumulateImpl<16>(
+      matrix, segments, indices, m_rows, m_cols, vectors, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
 template <typename T>
 void PortableMatrixBatchVectorMultiplyAccumulateImpl(
     const int8_t* input, const int32_t* bias,
@@ -16,6 +16,8 @@ limitations under the License.
 
 #include <math.h>
 
+#include <algorithm>
+
 #include <gmock/gmock.h>
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
@@ -25,6 +27,8 @@ limitations under the License.
 
 #ifdef DOTPROD_BENCHMARKS
 #include "testing/base/public/benchmark.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm.h"
+#include "tensorflow/lite/kernels/cpu_backend_gemm_params.h"
 #endif  // DOTPROD_BENCHMARKS
 
 namespace tflite {
@@ -1131,6 +1135,121 @@ std::vector<float> TestSparseDotprodMatrixBatchVectorMultiply(
   return data.results;
 }
 
+// The non-zero blocks of 1 x block_size elements of a matrix, in the
+// compressed sparse row format of TfLiteSparsity.
+struct BlockSparseMatrixData {
+  std::vector<int8_t> matrix;
+  std::vector<int32_t> segments;
+  std::vector<int32_t> indices;
+};
+
+BlockSparseMatrixData SetupBlockSparseMatrixData(const MatrixVectorData& data,
+                                                 int block_size) {
+  BlockSparseMatrixData sparse;
+  sparse.segments.push_back(0);
+  for (int i = 0; i < data.rows; i++) {
+    for (int j = 0; j < data.cols / block_size; j++) {
+      const int8_t* block = &data.zeroed_matrix[i * data.cols + j * block_size];
+      if (std::all_of(block, block + block_size,
+                      [](int8_t value) { return value == 0; })) {
+        continue;
+      }
+      sparse.matrix.insert(sparse.matrix.end(), block, block + block_size);
+      sparse.indices.push_back(j);
+    }
+    sparse.segments.push_back(sparse.indices.size());
+  }
+  return sparse;
+}
+
+// Returns the results of the block sparse kernel of `block_size` on the
+// sparse form of `data.zeroed_matrix`.
+std::vector<float> TestSparseBlockMatrixBatchVectorMultiply(
+    int block_size, int rows, int cols, int batch, bool negative = false) {
+  MatrixVectorData data = SetupMatrixVectorData(rows, cols, batch, negative);
+  BlockSparseMatrixData sparse = SetupBlockSparseMatrixData(data, block_size);
+  if (block_size == 4) {
+    SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        rows, cols, data.vectors.data(), data.scale_factors.data(), batch,
+        &data.results[0]);
+  } else {
+    SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        rows, cols, data.vectors.data(), data.scale_factors.data(), batch,
+        &data.results[0]);
+  }
+  return data.results;
+}
+
+// Returns the results of the dense kernel on `data.zeroed_matrix`, which the
+// block sparse kernels must match exactly.
+std::vector<float> TestZeroedMatrixBatchVectorMultiply(int rows, int cols,
+                                                       int batch,
+                                                       bool negative = false) {
+  MatrixVectorData data = SetupMatrixVectorData(rows, cols, batch, negative);
+  MatrixBatchVectorMultiplyAccumulate(
+      data.zeroed_matrix.data(), rows, cols, data.vectors.data(),
+      data.scale_factors.data(), batch, &data.results[0]);
+  return data.results;
+}
+
+// Returns the results of the fully quantized block sparse kernel of
+// `block_size` on the sparse form of `data.zeroed_matrix`, or of a scalar
+// implementation on `data.zeroed_matrix` if `golden` is true.
+std::vector<int8_t> TestSparseBlockMatrixBatchVectorMultiplyQuantized(
+    int block_size, int rows, int cols, int batch, bool golden) {
+  MatrixVectorData data =
+      SetupMatrixVectorData(rows, cols, batch, /*negative=*/true);
+  std::vector<int32_t> bias(rows);
+  for (int i = 0; i < rows; i++) {
+    bias[i] = 100 * i - 1000;
+  }
+  const int32_t input_offset = 7;
+  const int32_t output_offset = -3;
+  const int32_t output_activation_min = -120;
+  const int32_t output_activation_max = 127;
+  int32_t output_multiplier;
+  int output_shift;
+  QuantizeMultiplier(1.0 / 3000, &output_multiplier, &output_shift);
+
+  std::vector<int8_t> results(rows * batch);
+  if (golden) {
+    for (int b = 0; b < batch; b++) {
+      for (int i = 0; i < rows; i++) {
+        int32_t acc = bias[i];
+        for (int j = 0; j < cols; j++) {
+          acc += data.zeroed_matrix[i * cols + j] *
+                 (data.vectors[b * cols + j] + input_offset);
+        }
+        acc = MultiplyByQuantizedMultiplier(acc, output_multiplier,
+                                            output_shift);
+        acc += output_offset;
+        acc = std::max(acc, output_activation_min);
+        acc = std::min(acc, output_activation_max);
+        results[b * rows + i] = static_cast<int8_t>(acc);
+      }
+    }
+    return results;
+  }
+
+  BlockSparseMatrixData sparse = SetupBlockSparseMatrixData(data, block_size);
+  if (block_size == 4) {
+    SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        rows, cols, data.vectors.data(), bias.data(), batch, input_offset,
+        output_multiplier, output_shift, output_offset, output_activation_min,
+        output_activation_max, results.data());
+  } else {
+    SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        rows, cols, data.vectors.data(), bias.data(), batch, input_offset,
+        output_multiplier, output_shift, output_offset, output_activation_min,
+        output_activation_max, results.data());
+  }
+  return results;
+}
+
 std::vector<float> TestPerChannelDotprodMatrixBatchVectorMultiply(
     int rows, int cols, int batch, bool negative = false,
     bool is_per_channel = true) {
@@ -1204,6 +1323,35 @@ TEST(uKernels, PerChannelDotprodMatrixBatchVectorMultiplyAccumulateTest) {
            2629188 / 2, 2515824, 2598390 / 2, 2569236, 2537352 / 2, 2645118}));
 }
 
+TEST(uKernels, PerChannelDotprodMatrixBatchVectorMultiplyAccumulateColumns) {
+  // Exercises the widest SIMD loops available as well as all the postambles
+  // for the columns left in a row.
+  for (int cols : {1, 3, 4, 7, 8, 12, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65,
+                   100, 127, 128, 129, 191, 255, 1000}) {
+    SCOPED_TRACE(testing::Message() << "cols: " << cols);
+    const int rows = 5;
+    const int batch = 3;
+    MatrixVectorData data =
+        SetupMatrixVectorData(rows, cols, batch, /*negative=*/true,
+                              /*is_per_channel=*/true);
+    std::vector<float> expected(rows * batch);
+    for (int b = 0; b < batch; b++) {
+      for (int i = 0; i < rows; i++) {
+        int32_t dotprod = 0;
+        for (int j = 0; j < cols; j++) {
+          dotprod += data.matrix[i * cols + j] *
+                     (data.vectors[b * cols + j] - data.input_offsets[b]);
+        }
+        expected[b * rows + i] =
+            dotprod * data.per_channel_scales[i] * data.scale_factors[b];
+      }
+    }
+    EXPECT_THAT(TestPerChannelDotprodMatrixBatchVectorMultiply(
+                    rows, cols, batch, /*negative=*/true),
+                testing::ElementsAreArray(expected));
+  }
+}
+
 TEST(uKernels, DotprodMatrixBatchFourVectorMultiplyAccumulateDotprodTest) {
   ASSERT_THAT(TestDotprodMatrixBatchVectorMultiply(2, 16, 4),
               testing::ElementsAreArray(
@@ -1324,6 +1472,68 @@ TEST(uKernels, DotprodSparseMatrixBatchVectorMultiplyAccumulate) {
               testing::ElementsAre(8764, 5196, 7204, 11148));
 }
 
+TEST(uKernels, SparseMatrixBatchVectorMultiplyAccumulate1x16) {
+  // Same sparsity pattern as the ledger test, hence the same results.
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 1, 32, 1),
+              testing::ElementsAre(1240));
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 1, 64, 1),
+              testing::ElementsAre(26544));
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 1, 64, 2),
+              testing::ElementsAre(26544, 24344));
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 4, 64, 4),
+              testing::ElementsAreArray(
+                  {26544, 15866, 22140, 11408, 24344, 53248, 42704, 39900,
+                   48000, 94146, 101892, 81876, 87712, 105160, 148304, 75936}));
+
+  const bool kNegative = true;
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 1, 64, 1, kNegative),
+              testing::ElementsAre(8764));
+  EXPECT_THAT(TestSparseBlockMatrixBatchVectorMultiply(16, 2, 64, 2, kNegative),
+              testing::ElementsAre(8764, 5196, 7204, 11148));
+}
+
+TEST(uKernels, SparseMatrixBatchVectorMultiplyAccumulateBlocks) {
+  // Exercises the SIMD loops over several blocks as well as the postambles
+  // for the blocks left in a row.
+  const int kShapes[][3] = {{1, 16, 1},   {3, 48, 2},  {4, 64, 4},
+                            {5, 96, 3},   {7, 112, 5}, {16, 256, 8},
+                            {9, 176, 16}, {6, 400, 3}, {4, 1024, 4}};
+  for (int block_size : {4, 16}) {
+    for (const auto& shape : kShapes) {
+      for (bool negative : {false, true}) {
+        SCOPED_TRACE(testing::Message()
+                     << "block_size: " << block_size << " shape: " << shape[0]
+                     << "x" << shape[1] << " batch: " << shape[2]
+                     << " negative: " << negative);
+        EXPECT_THAT(
+            TestSparseBlockMatrixBatchVectorMultiply(
+                block_size, shape[0], shape[1], shape[2], negative),
+            testing::ElementsAreArray(TestZeroedMatrixBatchVectorMultiply(
+                shape[0], shape[1], shape[2], negative)));
+      }
+    }
+  }
+}
+
+TEST(uKernels, SparseMatrixBatchVectorMultiplyAccumulateQuantized) {
+  const int kShapes[][3] = {{1, 16, 1},  {3, 48, 2},   {4, 64, 4},
+                            {5, 96, 3},  {16, 256, 8}, {9, 176, 16},
+                            {6, 400, 3}, {4, 1024, 4}};
+  for (int block_size : {4, 16}) {
+    for (const auto& shape : kShapes) {
+      SCOPED_TRACE(testing::Message()
+                   << "block_size: " << block_size << " shape: " << shape[0]
+                   << "x" << shape[1] << " batch: " << shape[2]);
+      EXPECT_THAT(
+          TestSparseBlockMatrixBatchVectorMultiplyQuantized(
+              block_size, shape[0], shape[1], shape[2], /*golden=*/false),
+          testing::ElementsAreArray(
+              TestSparseBlockMatrixBatchVectorMultiplyQuantized(
+                  block_size, shape[0], shape[1], shape[2], /*golden=*/true)));
+    }
+  }
+}
+
 #ifdef __ANDROID__
 TEST(uKernels, MatrixBatchVectorMultiplyAccumulateSymmetricQuantizedTest) {
   // Note we use 29 columns as this exercises all the neon kernel: the
@@ -2206,4 +2416,238 @@ BENCHMARK(BM_DotprodSparseMultiply)
     ->Args({2048, 2048, 1, 1})
     ->Args({2048, 2048, 8, 1});
 
+void BM_DotprodSparse1x16Multiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+
+  const int copies = state.range(3);
+
+  std::vector<tflite::tensor_utils::MatrixVectorData> datas;
+  std::vector<tflite::tensor_utils::BlockSparseMatrixData> sparse_datas;
+  for (int i = 0; i < copies; i++) {
+    datas.push_back(
+        tflite::tensor_utils::SetupMatrixVectorData(rows, cols, batch));
+    sparse_datas.push_back(
+        tflite::tensor_utils::SetupBlockSparseMatrixData(datas.back(), 16));
+  }
+
+  int copy = 0;
+  for (auto _ : state) {
+    copy = (copy + 1) % datas.size();
+    auto& data = datas[copy];
+    auto& sparse = sparse_datas[copy];
+    tflite::tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        data.rows, data.cols, data.vectors.data(), data.scale_factors.data(),
+        data.batch, &data.results[0]);
+    testing::DoNotOptimize(data.results[2]);
+  }
+}
+BENCHMARK(BM_DotprodSparse1x16Multiply)
+    ->Args({128, 128, 1, 1})
+    ->Args({128, 128, 4, 1})
+    ->Args({640, 640, 4, 1})
+    ->Args({992, 992, 8, 1})
+    ->Args({1024, 1024, 1, 1})
+    ->Args({1024, 1024, 4, 1})
+    ->Args({1024, 1024, 8, 1})
+    ->Args({640, 2048, 1, 1})
+    ->Args({640, 2048, 4, 1})
+    ->Args({640, 2048, 8, 1})
+    ->Args({2048, 2048, 1, 1})
+    ->Args({2048, 2048, 8, 1});
+
+// Dense baseline for the hybrid sparse benchmarks above: the same products
+// computed by cpu_backend_gemm (i.e. ruy) on the dense matrix, followed by the
+// scaling of the accumulators done by the hybrid kernels.
+void BM_DotprodDenseGemmMultiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+
+  const int copies = state.range(3);
+
+  std::vector<tflite::tensor_utils::MatrixVectorData> datas;
+  for (int i = 0; i < copies; i++) {
+    datas.push_back(
+        tflite::tensor_utils::SetupMatrixVectorData(rows, cols, batch));
+  }
+
+  tflite::cpu_backend_gemm::MatrixParams<int8_t> lhs_params;
+  lhs_params.order = tflite::cpu_backend_gemm::Order::kRowMajor;
+  lhs_params.rows = rows;
+  lhs_params.cols = cols;
+  tflite::cpu_backend_gemm::MatrixParams<int8_t> rhs_params;
+  rhs_params.order = tflite::cpu_backend_gemm::Order::kColMajor;
+  rhs_params.rows = cols;
+  rhs_params.cols = batch;
+  tflite::cpu_backend_gemm::MatrixParams<int32_t> dst_params;
+  dst_params.order = tflite::cpu_backend_gemm::Order::kColMajor;
+  dst_params.rows = rows;
+  dst_params.cols = batch;
+  tflite::cpu_backend_gemm::GemmParams<int32_t, int32_t> gemm_params;
+  tflite::CpuBackendContext context;
+  std::vector<int32_t> scratch(rows * batch);
+
+  int copy = 0;
+  for (auto _ : state) {
+    copy = (copy + 1) % datas.size();
+    auto& data = datas[copy];
+    tflite::cpu_backend_gemm::Gemm(lhs_params, data.matrix.data(), rhs_params,
+                                   data.vectors.data(), dst_params,
+                                   scratch.data(), gemm_params, &context);
+    for (int b = 0; b < batch; b++) {
+      for (int i = 0; i < rows; i++) {
+        data.results[b * rows + i] +=
+            data.scale_factors[b] * scratch[b * rows + i];
+      }
+    }
+    testing::DoNotOptimize(data.results[2]);
+  }
+}
+BENCHMARK(BM_DotprodDenseGemmMultiply)
+    ->Args({128, 128, 1, 1})
+    ->Args({128, 128, 4, 1})
+    ->Args({640, 640, 4, 1})
+    ->Args({992, 992, 8, 1})
+    ->Args({1024, 1024, 1, 1})
+    ->Args({1024, 1024, 4, 1})
+    ->Args({1024, 1024, 8, 1})
+    ->Args({640, 2048, 1, 1})
+    ->Args({640, 2048, 4, 1})
+    ->Args({640, 2048, 8, 1})
+    ->Args({2048, 2048, 1, 1})
+    ->Args({2048, 2048, 8, 1});
+
+// Parameters of the fully-quantized benchmarks, the same as in
+// TestSparseBlockMatrixBatchVectorMultiplyQuantized.
+struct QuantizedFullyConnectedParams {
+  explicit QuantizedFullyConnectedParams(int rows) : bias(rows) {
+    for (int i = 0; i < rows; i++) {
+      bias[i] = 100 * i - 1000;
+    }
+    tflite::QuantizeMultiplier(1.0 / 3000, &output_multiplier, &output_shift);
+  }
+
+  std::vector<int32_t> bias;
+  const int32_t input_offset = 7;
+  const int32_t output_offset = -3;
+  const int32_t output_activation_min = -120;
+  const int32_t output_activation_max = 127;
+  int32_t output_multiplier;
+  int output_shift;
+};
+
+void BM_Int8Sparse1x16Multiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+
+  const int copies = state.range(3);
+
+  std::vector<tflite::tensor_utils::MatrixVectorData> datas;
+  std::vector<tflite::tensor_utils::BlockSparseMatrixData> sparse_datas;
+  for (int i = 0; i < copies; i++) {
+    datas.push_back(tflite::tensor_utils::SetupMatrixVectorData(
+        rows, cols, batch, /*negative=*/true));
+    sparse_datas.push_back(
+        tflite::tensor_utils::SetupBlockSparseMatrixData(datas.back(), 16));
+  }
+  const QuantizedFullyConnectedParams params(rows);
+  std::vector<int8_t> results(rows * batch);
+
+  int copy = 0;
+  for (auto _ : state) {
+    copy = (copy + 1) % datas.size();
+    auto& data = datas[copy];
+    auto& sparse = sparse_datas[copy];
+    tflite::tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        sparse.matrix.data(), sparse.segments.data(), sparse.indices.data(),
+        data.rows, data.cols, data.vectors.data(), params.bias.data(),
+        data.batch, params.input_offset, params.output_multiplier,
+        params.output_shift, params.output_offset,
+        params.output_activation_min, params.output_activation_max,
+        results.data());
+    testing::DoNotOptimize(results[2]);
+  }
+}
+BENCHMARK(BM_Int8Sparse1x16Multiply)
+    ->Args({128, 128, 1, 1})
+    ->Args({128, 128, 4, 1})
+    ->Args({640, 640, 4, 1})
+    ->Args({992, 992, 8, 1})
+    ->Args({1024, 1024, 1, 1})
+    ->Args({1024, 1024, 4, 1})
+    ->Args({1024, 1024, 8, 1})
+    ->Args({640, 2048, 1, 1})
+    ->Args({640, 2048, 4, 1})
+    ->Args({640, 2048, 8, 1})
+    ->Args({2048, 2048, 1, 1})
+    ->Args({2048, 2048, 8, 1});
+
+// Dense baseline for BM_Int8Sparse1x16Multiply: the int8 fully-connected
+// product computed by cpu_backend_gemm (i.e. ruy) on the dense matrix, with
+// the same output pipeline.
+void BM_Int8DenseGemmMultiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+
+  const int copies = state.range(3);
+
+  std::vector<tflite::tensor_utils::MatrixVectorData> datas;
+  for (int i = 0; i < copies; i++) {
+    datas.push_back(tflite::tensor_utils::SetupMatrixVectorData(
+        rows, cols, batch, /*negative=*/true));
+  }
+  const QuantizedFullyConnectedParams params(rows);
+
+  tflite::cpu_backend_gemm::MatrixParams<int8_t> lhs_params;
+  lhs_params.order = tflite::cpu_backend_gemm::Order::kRowMajor;
+  lhs_params.rows = rows;
+  lhs_params.cols = cols;
+  tflite::cpu_backend_gemm::MatrixParams<int8_t> rhs_params;
+  rhs_params.order = tflite::cpu_backend_gemm::Order::kColMajor;
+  rhs_params.rows = cols;
+  rhs_params.cols = batch;
+  rhs_params.zero_point = -params.input_offset;
+  tflite::cpu_backend_gemm::MatrixParams<int8_t> dst_params;
+  dst_params.order = tflite::cpu_backend_gemm::Order::kColMajor;
+  dst_params.rows = rows;
+  dst_params.cols = batch;
+  dst_params.zero_point = params.output_offset;
+  tflite::cpu_backend_gemm::GemmParams<int32_t, int8_t> gemm_params;
+  gemm_params.bias = params.bias.data();
+  gemm_params.multiplier_fixedpoint = params.output_multiplier;
+  gemm_params.multiplier_exponent = params.output_shift;
+  gemm_params.clamp_min = params.output_activation_min;
+  gemm_params.clamp_max = params.output_activation_max;
+  tflite::CpuBackendContext context;
+  std::vector<int8_t> results(rows * batch);
+
+  int copy = 0;
+  for (auto _ : state) {
+    copy = (copy + 1) % datas.size();
+    auto& data = datas[copy];
+    tflite::cpu_backend_gemm::Gemm(lhs_params, data.matrix.data(), rhs_params,
+                                   data.vectors.data(), dst_params,
+                                   results.data(), gemm_params, &context);
+    testing::DoNotOptimize(results[2]);
+  }
+}
+BENCHMARK(BM_Int8DenseGemmMultiply)
+    ->Args({128, 128, 1, 1})
+    ->Args({128, 128, 4, 1})
+    ->Args({640, 640, 4, 1})
+    ->Args({992, 992, 8, 1})
+    ->Args({1024, 1024, 1, 1})
+    ->Args({1024, 1024, 4, 1})
+    ->Args({1024, 1024, 8, 1})
+    ->Args({640, 2048, 1, 1})
+    ->Args({640, 2048, 4, 1})
+    ->Args({640, 2048, 8, 1})
+    ->Args({2048, 2048, 1, 1})
+    ->Args({2048, 2048, 8, 1});
+
 #endif  // DOTPROD_BENCHMARKS
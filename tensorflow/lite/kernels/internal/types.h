@@ -827,6 +827,8 @@ struct ConvParams {
   // float activation params.
   float float_activation_min;
   float float_activation_max;
+  // The filter prepacked by cpu_backend_gemm::PrepackLhs, if any.
+  const void* lhs_prepacked_data = nullptr;
 };
 
 struct DepthToSpaceParams {
@@ -892,6 +894,8 @@ struct FullyConnectedParams {
   bool lhs_cacheable;
   bool rhs_cacheable;
   FullyConnectedWeightsFormat weights_format;
+  // The weights prepacked by cpu_backend_gemm::PrepackLhs, if any.
+  const void* lhs_prepacked_data = nullptr;
 };
 
 struct GatherParams {
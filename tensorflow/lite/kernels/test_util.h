@@ -255,6 +255,15 @@ class SingleOpModel {
         builder_.CreateVector(t.block_map),
         builder_.CreateVector(fb_dim_metadata));
 
+    // Quantized sparse tensors hold already quantized data.
+    flatbuffers::Offset<QuantizationParameters> q_params = 0;
+    if (t.scale != 0) {
+      q_params = CreateQuantizationParameters(
+          builder_, /*min=*/0, /*max=*/0,
+          builder_.CreateVector<float>({t.scale}),
+          builder_.CreateVector<int64_t>({t.zero_point}));
+    }
+
     int buffer_id = 0;
     if (data.size()) {
       // Initialize buffers list with empty buffer to allow for non-const
@@ -274,7 +283,7 @@ class SingleOpModel {
     tensors_.push_back(CreateTensor(
         builder_, builder_.CreateVector<int>(t.shape), t.type,
         /*buffer=*/buffer_id,
-        /*name=*/0, /*quantization=*/0, /*is_variable=*/false, s_param));
+        /*name=*/0, q_params, /*is_variable=*/false, s_param));
 
     inputs_.push_back(id);
     tensor_data_[id] = t;
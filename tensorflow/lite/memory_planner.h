@@ -59,6 +59,10 @@ class MemoryPlanner {
 
   // Returns true if the non-persistent memory is available.
   virtual bool HasNonPersistentMemory() = 0;
+
+  // Returns the number of bytes required by the allocations planned so far
+  // for the tensors of the given allocation type, e.g. kTfLiteArenaRw.
+  virtual size_t RequiredBytes(TfLiteAllocationType type) = 0;
 };
 
 }  // namespace tflite
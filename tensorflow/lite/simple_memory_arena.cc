@@ -153,6 +153,20 @@ TfLiteStatus SimpleMemoryArena::ClearPlan() {
   return kTfLiteOk;
 }
 
+SimpleMemoryArena::Plan SimpleMemoryArena::GetPlan() const {
+  Plan plan;
+  plan.high_water_mark = high_water_mark_;
+  plan.ordered_allocs = ordered_allocs_;
+  return plan;
+}
+
+TfLiteStatus SimpleMemoryArena::RestorePlan(const Plan& plan) {
+  committed_ = false;
+  high_water_mark_ = plan.high_water_mark;
+  ordered_allocs_ = plan.ordered_allocs;
+  return kTfLiteOk;
+}
+
 TfLiteStatus SimpleMemoryArena::ReleaseBuffer() {
   committed_ = false;
   underlying_buffer_size_ = 0;
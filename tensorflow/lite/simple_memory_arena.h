@@ -94,6 +94,21 @@ class SimpleMemoryArena {
   // again.
   TfLiteStatus ClearPlan();
 
+  // The allocation details, as produced by a series of calls to Allocate()
+  // and Deallocate().
+  struct Plan {
+    size_t high_water_mark = 0;
+    std::vector<ArenaAllocWithUsageInterval> ordered_allocs;
+  };
+
+  // Returns the current allocation details.
+  Plan GetPlan() const;
+
+  // Replaces the allocation details with 'plan', which was returned by
+  // GetPlan(), without releasing the underlying buffer. As with ClearPlan(),
+  // allocations should be committed & resolved before using this arena again.
+  TfLiteStatus RestorePlan(const Plan& plan);
+
   // This releases the underlying buffer but does not clear the allocation plan.
   // Since all associated pointers are invalidated, the arena cannot be used
   // again until Commit() is called & tensor allocations are resolved.
@@ -101,6 +116,9 @@ class SimpleMemoryArena {
 
   size_t GetBufferSize() { return underlying_buffer_size_; }
 
+  // Returns the number of bytes used by the allocations, excluding padding.
+  size_t GetHighWaterMark() const { return high_water_mark_; }
+
   std::intptr_t BasePointer() const {
     return reinterpret_cast<std::intptr_t>(underlying_buffer_aligned_ptr_);
   }
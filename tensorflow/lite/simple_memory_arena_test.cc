@@ -118,6 +118,36 @@ TEST(SimpleMemoryArenaTest, TestClearPlan) {
   EXPECT_EQ(allocs[8].offset, 8192);
 }
 
+TEST(SimpleMemoryArenaTest, TestRestorePlan) {
+  TfLiteContext context;
+  SimpleMemoryArena arena(64);
+  ArenaAllocWithUsageInterval allocs[5];
+
+  arena.Allocate(&context, 32, 2047, 0, 0, 2, &allocs[0]);
+  arena.Allocate(&context, 32, 2047, 1, 1, 2, &allocs[1]);
+  const SimpleMemoryArena::Plan plan = arena.GetPlan();
+  EXPECT_EQ(plan.ordered_allocs.size(), 2);
+
+  arena.ClearPlan();
+  arena.Allocate(&context, 32, 4095, 2, 0, 2, &allocs[2]);
+  ASSERT_EQ(arena.Commit(&context), kTfLiteOk);
+  EXPECT_EQ(arena.GetPlan().ordered_allocs.size(), 1);
+
+  // The restored plan behaves as if the first allocations had been made
+  // again.
+  ASSERT_EQ(arena.RestorePlan(plan), kTfLiteOk);
+  arena.Allocate(&context, 32, 2047, 3, 1, 2, &allocs[3]);
+  arena.Allocate(&context, 32, 2047, 4, 3, 4, &allocs[4]);
+  ASSERT_EQ(arena.Commit(&context), kTfLiteOk);
+  EXPECT_EQ(allocs[3].offset, 4096);
+  EXPECT_EQ(allocs[4].offset, 0);
+
+  char* resolved_ptr = nullptr;
+  ASSERT_EQ(arena.ResolveAlloc(&context, allocs[1], &resolved_ptr), kTfLiteOk);
+  EXPECT_EQ(resolved_ptr - reinterpret_cast<char*>(arena.BasePointer()),
+            2048);
+}
+
 TEST(SimpleMemoryArenaTest, TestClearBuffer) {
   TfLiteContext context;
   context.ReportError = ReportError;
@@ -88,6 +88,13 @@ BenchmarkParams CreateParams(int32_t num_runs, float min_secs, float max_secs,
                   BenchmarkParam::Create<std::string>(""));
   params.AddParam("enable_platform_tracing",
                   BenchmarkParam::Create<bool>(false));
+  params.AddParam("compare_arena_planning",
+                  BenchmarkParam::Create<bool>(false));
+  params.AddParam("serving_workers", BenchmarkParam::Create<int32_t>(0));
+  params.AddParam("serving_request_rate", BenchmarkParam::Create<float>(0.0f));
+  params.AddParam("serving_secs", BenchmarkParam::Create<float>(10.0f));
+  params.AddParam("serving_execution_contexts",
+                  BenchmarkParam::Create<bool>(true));
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -190,6 +197,31 @@ TEST(BenchmarkTest, DoesntCrashStringModel) {
   benchmark.Run();
 }
 
+TEST(BenchmarkTest, ServesFp32Model) {
+  ASSERT_THAT(g_fp32_model_path, testing::NotNull());
+
+  for (bool use_execution_contexts : {true, false}) {
+    BenchmarkParams params = CreateFp32Params();
+    params.Set<int32_t>("serving_workers", 2);
+    params.Set<float>("serving_secs", 0.2f);
+    params.Set<bool>("serving_execution_contexts", use_execution_contexts);
+    TestBenchmark benchmark(std::move(params));
+    EXPECT_EQ(kTfLiteOk, benchmark.Run());
+  }
+}
+
+TEST(BenchmarkTest, ServesInt8ModelAtRequestRateWithProfiling) {
+  ASSERT_THAT(g_int8_model_path, testing::NotNull());
+
+  BenchmarkParams params = CreateInt8Params();
+  params.Set<bool>("enable_op_profiling", true);
+  params.Set<int32_t>("serving_workers", 2);
+  params.Set<float>("serving_request_rate", 100.0f);
+  params.Set<float>("serving_secs", 0.2f);
+  TestBenchmark benchmark(std::move(params));
+  EXPECT_EQ(kTfLiteOk, benchmark.Run());
+}
+
 class TestMultiRunStatsRecorder : public MultiRunStatsRecorder {
  public:
   void OutputStats() override {
@@ -21,9 +21,11 @@ limitations under the License.
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <random>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "absl/base/attributes.h"
@@ -34,11 +36,14 @@ limitations under the License.
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
 #include "tensorflow/lite/op_resolver.h"
+#include "tensorflow/lite/profiling/buffered_profiler.h"
 #include "tensorflow/lite/profiling/platform_profiler.h"
+#include "tensorflow/lite/profiling/profile_summarizer.h"
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 #include "tensorflow/lite/string_util.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_utils.h"
 #include "tensorflow/lite/tools/benchmark/profiling_listener.h"
+#include "tensorflow/lite/tools/benchmark/serving_benchmark.h"
 #include "tensorflow/lite/tools/delegates/delegate_provider.h"
 #include "tensorflow/lite/tools/logging.h"
 
@@ -273,6 +278,16 @@ BenchmarkParams BenchmarkTfLiteModel::DefaultParams() {
                           BenchmarkParam::Create<std::string>(""));
   default_params.AddParam("enable_platform_tracing",
                           BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("compare_arena_planning",
+                          BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("serving_workers",
+                          BenchmarkParam::Create<int32_t>(0));
+  default_params.AddParam("serving_request_rate",
+                          BenchmarkParam::Create<float>(0.0f));
+  default_params.AddParam("serving_secs",
+                          BenchmarkParam::Create<float>(10.0f));
+  default_params.AddParam("serving_execution_contexts",
+                          BenchmarkParam::Create<bool>(true));
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -331,7 +346,28 @@ std::vector<Flag> BenchmarkTfLiteModel::GetFlags() {
           "prints to stdout."),
       CreateFlag<bool>("enable_platform_tracing", &params_,
                        "enable platform-wide tracing, only meaningful when "
-                       "--enable_op_profiling is set to true.")};
+                       "--enable_op_profiling is set to true."),
+      CreateFlag<bool>("compare_arena_planning", &params_,
+                       "report the size of the arena with each memory "
+                       "planning strategy"),
+      CreateFlag<int32_t>(
+          "serving_workers", &params_,
+          "if positive, after the benchmark, serve requests with this many "
+          "workers concurrently and report the throughput and the latency "
+          "percentiles, see also serving_request_rate, serving_secs"),
+      CreateFlag<float>(
+          "serving_request_rate", &params_,
+          "mean number of requests arriving per second in the serving "
+          "benchmark, independently of how fast they are served. If not "
+          "positive, each worker serves requests back to back instead."),
+      CreateFlag<float>("serving_secs", &params_,
+                        "duration of the serving benchmark in seconds"),
+      CreateFlag<bool>(
+          "serving_execution_contexts", &params_,
+          "whether the serving workers share the weights and the prepared "
+          "graph of the benchmarked interpreter through execution contexts, "
+          "rather than using interpreters of their own. Models with "
+          "delegates or control flow ops need interpreters of their own.")};
 
   flags.insert(flags.end(), specific_flags.begin(), specific_flags.end());
 
@@ -375,6 +411,16 @@ void BenchmarkTfLiteModel::LogParams() {
                    << "]";
   TFLITE_LOG(INFO) << "Enable platform-wide tracing: ["
                    << params_.Get<bool>("enable_platform_tracing") << "]";
+  TFLITE_LOG(INFO) << "Compare arena planning strategies: ["
+                   << params_.Get<bool>("compare_arena_planning") << "]";
+  TFLITE_LOG(INFO) << "Serving workers: ["
+                   << params_.Get<int32_t>("serving_workers") << "]";
+  TFLITE_LOG(INFO) << "Serving request rate: ["
+                   << params_.Get<float>("serving_request_rate") << "]";
+  TFLITE_LOG(INFO) << "Serving duration (seconds): ["
+                   << params_.Get<float>("serving_secs") << "]";
+  TFLITE_LOG(INFO) << "Serve with execution contexts: ["
+                   << params_.Get<bool>("serving_execution_contexts") << "]";
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -388,6 +434,11 @@ TfLiteStatus BenchmarkTfLiteModel::ValidateParams() {
         << "Please specify the name of your TF Lite input file with --graph";
     return kTfLiteError;
   }
+  if (params_.Get<int32_t>("serving_workers") > 0 &&
+      params_.Get<float>("serving_secs") <= 0) {
+    TFLITE_LOG(ERROR) << "--serving_secs must be positive.";
+    return kTfLiteError;
+  }
 
   return PopulateInputLayerInfo(
       params_.Get<std::string>("input_layer"),
@@ -572,11 +623,19 @@ TfLiteStatus BenchmarkTfLiteModel::PrepareInputData() {
 }
 
 TfLiteStatus BenchmarkTfLiteModel::ResetInputsAndOutputs() {
-  auto interpreter_inputs = interpreter_->inputs();
+  std::vector<TfLiteTensor*> tensors;
+  for (int i : interpreter_->inputs()) {
+    tensors.push_back(interpreter_->tensor(i));
+  }
+  PopulateInputTensors(tensors);
+  return kTfLiteOk;
+}
+
+void BenchmarkTfLiteModel::PopulateInputTensors(
+    const std::vector<TfLiteTensor*>& tensors) {
   // Set the values of the input tensors from inputs_data_.
-  for (int j = 0; j < interpreter_inputs.size(); ++j) {
-    int i = interpreter_inputs[j];
-    TfLiteTensor* t = interpreter_->tensor(i);
+  for (int j = 0; j < tensors.size(); ++j) {
+    TfLiteTensor* t = tensors[j];
     if (t->type == kTfLiteString) {
       if (inputs_data_[j].data) {
         static_cast<DynamicBuffer*>(inputs_data_[j].data.get())
@@ -594,8 +653,6 @@ TfLiteStatus BenchmarkTfLiteModel::ResetInputsAndOutputs() {
                   inputs_data_[j].bytes);
     }
   }
-
-  return kTfLiteOk;
 }
 
 TfLiteStatus BenchmarkTfLiteModel::InitInterpreter() {
@@ -707,6 +764,14 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
     TFLITE_LOG(ERROR) << "Failed to allocate tensors!";
     return kTfLiteError;
   }
+  TFLITE_LOG(INFO) << "Arena sizes: "
+                   << interpreter_->GetArenaSize(kTfLiteArenaRw)
+                   << " bytes of activations, "
+                   << interpreter_->GetArenaSize(kTfLiteArenaRwPersistent)
+                   << " bytes persistent.";
+  if (params_.Get<bool>("compare_arena_planning")) {
+    TF_LITE_ENSURE_STATUS(CompareArenaPlanningStrategies());
+  }
 
   ruy_profiling_listener_.reset(new RuyProfileListener());
   AddListener(ruy_profiling_listener_.get());
@@ -714,6 +779,193 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   return kTfLiteOk;
 }
 
+TfLiteStatus BenchmarkTfLiteModel::CompareArenaPlanningStrategies() {
+  const std::pair<ArenaPlanningStrategy, const char*> strategies[] = {
+      {ArenaPlanningStrategy::kGreedyBySize, "greedy by size"},
+      {ArenaPlanningStrategy::kGreedyByBreadth, "greedy by breadth"},
+      {ArenaPlanningStrategy::kSmallest, "smallest"},
+  };
+  auto resolver = GetOpResolver();
+  for (const auto& strategy : strategies) {
+    std::unique_ptr<Interpreter> interpreter;
+    tflite::InterpreterBuilder(*model_, *resolver)(&interpreter);
+    if (!interpreter ||
+        interpreter->SetArenaPlanningStrategy(strategy.first) != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to initialize the interpreter";
+      return kTfLiteError;
+    }
+    for (int j = 0; j < inputs_.size(); ++j) {
+      const int i = interpreter->inputs()[j];
+      if (interpreter->tensor(i)->type != kTfLiteString) {
+        interpreter->ResizeInputTensor(i, inputs_[j].shape);
+      }
+    }
+    if (interpreter->AllocateTensors() != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to allocate tensors!";
+      return kTfLiteError;
+    }
+    TFLITE_LOG(INFO) << "Arena size with " << strategy.second
+                     << " planning (without delegates): "
+                     << interpreter->GetArenaSize(kTfLiteArenaRw)
+                     << " bytes of activations.";
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::Run() {
+  TF_LITE_ENSURE_STATUS(BenchmarkModel::Run());
+  if (params_.Get<int32_t>("serving_workers") > 0) {
+    return ServeRequests();
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::CreateServingInterpreter(
+    std::unique_ptr<Interpreter>* interpreter,
+    std::vector<Interpreter::TfLiteDelegatePtr>* delegates) {
+  auto resolver = GetOpResolver();
+  tflite::InterpreterBuilder(*model_, *resolver)(
+      interpreter, params_.Get<int32_t>("num_threads"));
+  if (!*interpreter) {
+    TFLITE_LOG(ERROR) << "Failed to initialize the interpreter";
+    return kTfLiteError;
+  }
+  (*interpreter)->UseNNAPI(params_.Get<bool>("use_legacy_nnapi"));
+  (*interpreter)
+      ->SetAllowFp16PrecisionForFp32(params_.Get<bool>("allow_fp16"));
+  for (const auto& delegate_provider :
+       tools::GetRegisteredDelegateProviders()) {
+    auto delegate = delegate_provider->CreateTfLiteDelegate(params_);
+    if (delegate == nullptr) continue;
+    if ((*interpreter)->ModifyGraphWithDelegate(delegate.get()) != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to apply " << delegate_provider->GetName()
+                        << " delegate.";
+      return kTfLiteError;
+    }
+    delegates->emplace_back(std::move(delegate));
+  }
+  for (int j = 0; j < inputs_.size(); ++j) {
+    const int i = (*interpreter)->inputs()[j];
+    if ((*interpreter)->tensor(i)->type != kTfLiteString) {
+      (*interpreter)->ResizeInputTensor(i, inputs_[j].shape);
+    }
+  }
+  if ((*interpreter)->AllocateTensors() != kTfLiteOk) {
+    TFLITE_LOG(ERROR) << "Failed to allocate tensors!";
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::ServeRequests() {
+  const int num_workers = params_.Get<int32_t>("serving_workers");
+  const bool use_execution_contexts =
+      params_.Get<bool>("serving_execution_contexts");
+  // Operators are profiled by each worker, and summarized together, which
+  // adds to the latencies of the requests.
+  const bool enable_op_profiling =
+      params_.Get<bool>("enable_op_profiling") &&
+      !params_.Get<bool>("enable_platform_tracing");
+
+  // The profiler and the delegates must outlive the interpreter or the
+  // context of a worker.
+  struct Worker {
+    std::unique_ptr<profiling::BufferedProfiler> profiler;
+    std::vector<Interpreter::TfLiteDelegatePtr> delegates;
+    std::unique_ptr<Interpreter> interpreter;
+    std::unique_ptr<ExecutionContext> context;
+    std::vector<TfLiteTensor*> inputs;
+  };
+  std::vector<Worker> workers(num_workers);
+  for (Worker& worker : workers) {
+    if (use_execution_contexts) {
+      if (interpreter_->CreateExecutionContext(&worker.context) !=
+          kTfLiteOk) {
+        TFLITE_LOG(ERROR) << "Failed to create an execution context, try "
+                             "--serving_execution_contexts=false.";
+        return kTfLiteError;
+      }
+      for (int i : worker.context->inputs()) {
+        worker.inputs.push_back(worker.context->tensor(i));
+      }
+    } else {
+      TF_LITE_ENSURE_STATUS(
+          CreateServingInterpreter(&worker.interpreter, &worker.delegates));
+      for (int i : worker.interpreter->inputs()) {
+        worker.inputs.push_back(worker.interpreter->tensor(i));
+      }
+    }
+    if (enable_op_profiling) {
+      worker.profiler.reset(new profiling::BufferedProfiler(
+          params_.Get<int32_t>("max_profiling_buffer_entries")));
+      if (worker.context) {
+        worker.context->SetProfiler(worker.profiler.get());
+      } else {
+        worker.interpreter->SetProfiler(worker.profiler.get());
+      }
+    }
+  }
+
+  std::mutex summarizer_mutex;
+  profiling::ProfileSummarizer summarizer(
+      CreateProfileSummaryFormatter(/*format_as_csv=*/false));
+  std::vector<ServingWorker> serving_workers;
+  for (Worker& worker : workers) {
+    serving_workers.push_back([this, &worker, &summarizer,
+                               &summarizer_mutex]() {
+      PopulateInputTensors(worker.inputs);
+      if (worker.profiler) {
+        worker.profiler->Reset();
+        worker.profiler->StartProfiling();
+      }
+      const TfLiteStatus status = worker.context
+                                      ? worker.context->Invoke()
+                                      : worker.interpreter->Invoke();
+      if (worker.profiler) {
+        worker.profiler->StopProfiling();
+        std::lock_guard<std::mutex> lock(summarizer_mutex);
+        summarizer.ProcessProfiles(
+            worker.profiler->GetProfileEvents(),
+            worker.context ? *interpreter_ : *worker.interpreter);
+      }
+      return status;
+    });
+  }
+
+  ServingOptions options;
+  options.request_rate = params_.Get<float>("serving_request_rate");
+  options.duration_secs = params_.Get<float>("serving_secs");
+  options.seed = random_engine_();
+  TFLITE_LOG(INFO) << "Serving requests with " << num_workers
+                   << " workers for " << options.duration_secs << " seconds.";
+  const ServingResults results =
+      tflite::benchmark::RunServingBenchmark(options, serving_workers);
+
+  TFLITE_LOG(INFO) << "Served " << results.num_requests << " requests in "
+                   << results.elapsed_secs << " seconds: "
+                   << results.requests_per_second() << " requests/s.";
+  TFLITE_LOG(INFO) << "Request latencies in us: "
+                   << "p50: " << results.LatencyPercentileUs(50) << ", "
+                   << "p90: " << results.LatencyPercentileUs(90) << ", "
+                   << "p99: " << results.LatencyPercentileUs(99) << ", "
+                   << "p999: " << results.LatencyPercentileUs(99.9) << ", "
+                   << "max: " << results.LatencyPercentileUs(100);
+  if (results.num_unserved_requests > 0) {
+    TFLITE_LOG(WARN) << results.num_unserved_requests
+                     << " requests were still queued at the end: the "
+                        "workers can't sustain the request rate.";
+  }
+  if (summarizer.HasProfiles()) {
+    TFLITE_LOG(INFO) << "Operator-wise Profiling Info for Served Requests:";
+    TFLITE_LOG(INFO) << summarizer.GetOutputString();
+  }
+  if (results.num_failed_requests > 0) {
+    TFLITE_LOG(ERROR) << results.num_failed_requests << " requests failed.";
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus BenchmarkTfLiteModel::LoadModel() {
   std::string graph = params_.Get<std::string>("graph");
   model_ = tflite::FlatBufferModel::BuildFromFile(graph.c_str());
@@ -63,6 +63,11 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   TfLiteStatus RunImpl() override;
   static BenchmarkParams DefaultParams();
 
+  using BenchmarkModel::Run;
+  // Runs the benchmark, followed by the serving benchmark if
+  // --serving_workers is set.
+  TfLiteStatus Run() override;
+
  protected:
   TfLiteStatus PrepareInputData() override;
   TfLiteStatus ResetInputsAndOutputs() override;
@@ -118,6 +123,24 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   InputTensorData LoadInputTensorData(const TfLiteTensor& t,
                                       const std::string& input_file_path);
 
+  // Logs the size of the arena of activations when planned with each
+  // strategy, without delegates.
+  TfLiteStatus CompareArenaPlanningStrategies();
+
+  // Copies the input data into `tensors`, the input tensors of an interpreter
+  // or of an execution context.
+  void PopulateInputTensors(const std::vector<TfLiteTensor*>& tensors);
+
+  // Creates another interpreter for the model, with the same delegates.
+  TfLiteStatus CreateServingInterpreter(
+      std::unique_ptr<Interpreter>* interpreter,
+      std::vector<Interpreter::TfLiteDelegatePtr>* delegates);
+
+  // Serves requests with several workers concurrently, and logs the
+  // throughput and the percentiles of the latencies. The workers run
+  // execution contexts of `interpreter_`, or interpreters of their own.
+  TfLiteStatus ServeRequests();
+
   std::vector<InputLayerInfo> inputs_;
   std::vector<InputTensorData> inputs_data_;
   std::unique_ptr<BenchmarkListener> profiling_listener_ = nullptr;
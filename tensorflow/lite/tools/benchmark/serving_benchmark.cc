@@ -0,0 +1,139 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/serving_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <deque>
+#include <mutex>  // NOLINT(build/c++11)
+#include <random>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "tensorflow/lite/profiling/time.h"
+
+namespace tflite {
+namespace benchmark {
+
+int64_t ServingResults::LatencyPercentileUs(double percentile) const {
+  if (latencies_us.empty()) return -1;
+  // Nearest-rank percentile, with some slack for the rounding errors of
+  // e.g. 99.9 / 100 * 1000.
+  const int64_t rank = static_cast<int64_t>(
+      std::ceil(percentile / 100.0 * latencies_us.size() - 1e-6));
+  const int64_t index =
+      std::min<int64_t>(std::max<int64_t>(rank - 1, 0),
+                        static_cast<int64_t>(latencies_us.size()) - 1);
+  return latencies_us[index];
+}
+
+ServingResults RunServingBenchmark(const ServingOptions& options,
+                                   const std::vector<ServingWorker>& workers) {
+  const bool open_loop = options.request_rate > 0;
+
+  // Arrival times of the requests not served yet, when `open_loop`.
+  std::mutex mutex;
+  std::condition_variable arrived;
+  std::deque<int64_t> arrivals_us;
+  bool done = false;
+
+  struct WorkerResults {
+    std::vector<int64_t> latencies_us;
+    int64_t num_requests = 0;
+    int64_t last_end_us = 0;
+  };
+  std::vector<WorkerResults> worker_results(workers.size());
+
+  const int64_t start_us = profiling::time::NowMicros();
+  const int64_t end_us =
+      start_us + static_cast<int64_t>(options.duration_secs * 1e6);
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      WorkerResults& results = worker_results[i];
+      while (true) {
+        int64_t arrival_us;
+        if (open_loop) {
+          std::unique_lock<std::mutex> lock(mutex);
+          arrived.wait(lock, [&]() { return done || !arrivals_us.empty(); });
+          if (arrivals_us.empty()) break;
+          arrival_us = arrivals_us.front();
+          arrivals_us.pop_front();
+        } else {
+          arrival_us = profiling::time::NowMicros();
+          if (arrival_us >= end_us) break;
+        }
+        const TfLiteStatus status = workers[i]();
+        results.last_end_us = profiling::time::NowMicros();
+        ++results.num_requests;
+        if (status == kTfLiteOk) {
+          results.latencies_us.push_back(results.last_end_us - arrival_us);
+        }
+      }
+    });
+  }
+
+  ServingResults results;
+  if (open_loop) {
+    std::mt19937 random_engine(options.seed);
+    std::exponential_distribution<double> interarrival_secs(
+        options.request_rate);
+    double next_arrival_us = start_us;
+    while (true) {
+      next_arrival_us += interarrival_secs(random_engine) * 1e6;
+      if (next_arrival_us >= end_us) break;
+      // Requests which are late because of the granularity of sleeping keep
+      // their scheduled arrival time.
+      const int64_t now_us = profiling::time::NowMicros();
+      if (next_arrival_us > now_us) {
+        profiling::time::SleepForMicros(next_arrival_us - now_us);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        arrivals_us.push_back(static_cast<int64_t>(next_arrival_us));
+      }
+      arrived.notify_one();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+      results.num_unserved_requests = arrivals_us.size();
+      arrivals_us.clear();
+    }
+    arrived.notify_all();
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  int64_t last_end_us = start_us;
+  for (const WorkerResults& worker : worker_results) {
+    results.num_requests += worker.num_requests;
+    results.num_failed_requests +=
+        worker.num_requests - worker.latencies_us.size();
+    results.latencies_us.insert(results.latencies_us.end(),
+                                worker.latencies_us.begin(),
+                                worker.latencies_us.end());
+    last_end_us = std::max(last_end_us, worker.last_end_us);
+  }
+  std::sort(results.latencies_us.begin(), results.latencies_us.end());
+  results.elapsed_secs = (last_end_us - start_us) / 1e6;
+  return results;
+}
+
+}  // namespace benchmark
+}  // namespace tflite
@@ -0,0 +1,84 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_TOOLS_BENCHMARK_SERVING_BENCHMARK_H_
+#define TENSORFLOW_LITE_TOOLS_BENCHMARK_SERVING_BENCHMARK_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+
+namespace tflite {
+namespace benchmark {
+
+struct ServingOptions {
+  // Mean number of requests arriving per second. Requests arrive following a
+  // Poisson process, independently of how fast they are served. If not
+  // positive, each worker serves requests back to back instead, which
+  // measures the maximum throughput.
+  float request_rate = 0.0f;
+
+  // Duration over which requests arrive.
+  float duration_secs = 10.0f;
+
+  // Seed of the arrival times of the requests.
+  uint32_t seed = 0;
+};
+
+struct ServingResults {
+  // Number of requests served, including those which failed.
+  int64_t num_requests = 0;
+  int64_t num_failed_requests = 0;
+
+  // Number of requests which arrived but weren't served by the end of the
+  // benchmark, because the workers couldn't keep up with the request rate.
+  int64_t num_unserved_requests = 0;
+
+  // Time from the start of the benchmark to the end of the last request.
+  double elapsed_secs = 0.0;
+
+  // Latencies of the requests which succeeded, in increasing order. A
+  // latency goes from the arrival of a request, rather than from the time a
+  // worker started serving it, to the end of the request.
+  std::vector<int64_t> latencies_us;
+
+  // Number of requests served per second.
+  double requests_per_second() const {
+    return elapsed_secs > 0 ? num_requests / elapsed_secs : 0.0;
+  }
+
+  // Returns the latency under which `percentile` percents of the requests
+  // which succeeded completed, or -1 if none did.
+  int64_t LatencyPercentileUs(double percentile) const;
+};
+
+// Serves a request on a worker. Only one request at a time is served on each
+// worker.
+using ServingWorker = std::function<TfLiteStatus()>;
+
+// Simulates a server with one thread per worker, for `options.duration_secs`.
+//
+// Requests are served in the order they arrive, by the first worker which is
+// idle. Requests which arrive while all workers are busy are queued, and the
+// latencies hence account for the time spent in the queue.
+ServingResults RunServingBenchmark(const ServingOptions& options,
+                                   const std::vector<ServingWorker>& workers);
+
+}  // namespace benchmark
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_TOOLS_BENCHMARK_SERVING_BENCHMARK_H_
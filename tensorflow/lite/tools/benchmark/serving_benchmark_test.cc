@@ -0,0 +1,109 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/serving_benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/profiling/time.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+TEST(ServingBenchmarkTest, LatencyPercentiles) {
+  ServingResults results;
+  EXPECT_EQ(results.LatencyPercentileUs(50), -1);
+  for (int i = 1; i <= 1000; ++i) {
+    results.latencies_us.push_back(i);
+  }
+  EXPECT_EQ(results.LatencyPercentileUs(0), 1);
+  EXPECT_EQ(results.LatencyPercentileUs(50), 500);
+  EXPECT_EQ(results.LatencyPercentileUs(99), 990);
+  EXPECT_EQ(results.LatencyPercentileUs(99.9), 999);
+  EXPECT_EQ(results.LatencyPercentileUs(100), 1000);
+}
+
+TEST(ServingBenchmarkTest, ClosedLoop) {
+  std::atomic<int> num_requests(0);
+  const ServingWorker worker = [&num_requests]() {
+    // Every other request fails.
+    const int request = num_requests++;
+    profiling::time::SleepForMicros(1000);
+    return request % 2 == 0 ? kTfLiteOk : kTfLiteError;
+  };
+  ServingOptions options;
+  options.duration_secs = 0.2f;
+  const ServingResults results =
+      RunServingBenchmark(options, {worker, worker});
+
+  EXPECT_EQ(results.num_requests, num_requests);
+  EXPECT_GT(results.num_requests, 2);
+  EXPECT_EQ(results.num_failed_requests, results.num_requests / 2);
+  EXPECT_EQ(results.latencies_us.size(),
+            results.num_requests - results.num_failed_requests);
+  EXPECT_EQ(results.num_unserved_requests, 0);
+  EXPECT_GE(results.LatencyPercentileUs(0), 1000);
+  EXPECT_GE(results.elapsed_secs, 0.2);
+  EXPECT_GT(results.requests_per_second(), 0);
+}
+
+TEST(ServingBenchmarkTest, OpenLoop) {
+  std::atomic<int> num_requests(0);
+  const ServingWorker worker = [&num_requests]() {
+    ++num_requests;
+    return kTfLiteOk;
+  };
+  ServingOptions options;
+  options.request_rate = 1000.0f;
+  options.duration_secs = 0.5f;
+  const ServingResults results = RunServingBenchmark(options, {worker});
+
+  // About 500 requests arrive, which are all served but for those which
+  // arrived just before the end.
+  EXPECT_EQ(results.num_requests, num_requests);
+  EXPECT_GT(results.num_requests, 250);
+  EXPECT_LT(results.num_requests, 1000);
+  EXPECT_EQ(results.num_failed_requests, 0);
+  EXPECT_LT(results.num_unserved_requests, 10);
+  EXPECT_EQ(results.latencies_us.size(), results.num_requests);
+  EXPECT_TRUE(std::is_sorted(results.latencies_us.begin(),
+                             results.latencies_us.end()));
+}
+
+TEST(ServingBenchmarkTest, OpenLoopOverloaded) {
+  const ServingWorker worker = []() {
+    profiling::time::SleepForMicros(20000);
+    return kTfLiteOk;
+  };
+  ServingOptions options;
+  options.request_rate = 1000.0f;
+  options.duration_secs = 0.2f;
+  const ServingResults results = RunServingBenchmark(options, {worker});
+
+  // The worker serves at most 50 requests per second, so requests queue up,
+  // and their latencies grow with the time they spent in the queue.
+  EXPECT_GT(results.num_unserved_requests, 0);
+  EXPECT_GT(results.LatencyPercentileUs(100),
+            2 * results.LatencyPercentileUs(0));
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace tflite
@@ -24,6 +24,10 @@ class XnnpackDelegateProvider : public DelegateProvider {
  public:
   XnnpackDelegateProvider() {
     default_params_.AddParam("use_xnnpack", ToolParam::Create<bool>(false));
+    default_params_.AddParam("xnnpack_cache_dir",
+                             ToolParam::Create<std::string>(""));
+    default_params_.AddParam("xnnpack_model_token",
+                             ToolParam::Create<std::string>(""));
   }
 
   std::vector<Flag> CreateFlags(ToolParams* params) const final;
@@ -39,20 +43,36 @@ REGISTER_DELEGATE_PROVIDER(XnnpackDelegateProvider);
 std::vector<Flag> XnnpackDelegateProvider::CreateFlags(
     ToolParams* params) const {
   std::vector<Flag> flags = {
-      CreateFlag<bool>("use_xnnpack", params, "use XNNPack")};
+      CreateFlag<bool>("use_xnnpack", params, "use XNNPack"),
+      CreateFlag<std::string>(
+          "xnnpack_cache_dir", params,
+          "existing directory to cache the XNNPack partitioning of the model "
+          "in, to speed up later runs; requires xnnpack_model_token"),
+      CreateFlag<std::string>(
+          "xnnpack_model_token", params,
+          "token that uniquely identifies the model in the XNNPack cache, "
+          "e.g. a hash of the model file")};
   return flags;
 }
 
 void XnnpackDelegateProvider::LogParams(const ToolParams& params) const {
   TFLITE_LOG(INFO) << "Use xnnpack : [" << params.Get<bool>("use_xnnpack")
                    << "]";
+  if (!params.Get<std::string>("xnnpack_cache_dir").empty()) {
+    TFLITE_LOG(INFO) << "XNNPack cache dir : ["
+                     << params.Get<std::string>("xnnpack_cache_dir") << "]";
+    TFLITE_LOG(INFO) << "XNNPack model token : ["
+                     << params.Get<std::string>("xnnpack_model_token") << "]";
+  }
 }
 
 TfLiteDelegatePtr XnnpackDelegateProvider::CreateTfLiteDelegate(
     const ToolParams& params) const {
   if (params.Get<bool>("use_xnnpack")) {
     return evaluation::CreateXNNPACKDelegate(
-        params.Get<int32_t>("num_threads"));
+        params.Get<int32_t>("num_threads"),
+        params.Get<std::string>("xnnpack_cache_dir"),
+        params.Get<std::string>("xnnpack_model_token"));
   }
   return TfLiteDelegatePtr(nullptr, [](TfLiteDelegate*) {});
 }
@@ -172,6 +172,12 @@ TfLiteDelegatePtr CreateHexagonDelegate(
 TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads) {
   return CreateNullDelegate();
 }
+
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& cache_dir,
+                                        const std::string& model_token) {
+  return CreateNullDelegate();
+}
 #else
 TfLiteDelegatePtr CreateXNNPACKDelegate() {
   TfLiteXNNPackDelegateOptions xnnpack_options =
@@ -193,6 +199,19 @@ TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads) {
   opts.num_threads = num_threads > 1 ? num_threads : 0;
   return CreateXNNPACKDelegate(&opts);
 }
+
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& cache_dir,
+                                        const std::string& model_token) {
+  auto opts = TfLiteXNNPackDelegateOptionsDefault();
+  opts.num_threads = num_threads > 1 ? num_threads : 0;
+  if (!cache_dir.empty() && !model_token.empty()) {
+    // The delegate copies both strings on creation.
+    opts.cache_dir = cache_dir.c_str();
+    opts.model_token = model_token.c_str();
+  }
+  return CreateXNNPACKDelegate(&opts);
+}
 #endif
 }  // namespace evaluation
 }  // namespace tflite
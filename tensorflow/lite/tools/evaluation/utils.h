@@ -86,6 +86,11 @@ TfLiteDelegatePtr CreateXNNPACKDelegate(
     const TfLiteXNNPackDelegateOptions* options);
 #endif
 TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads);
+// Creates an XNNPACK delegate which caches the partitioning of the model in
+// `cache_dir`. Caching is disabled if either string is empty.
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& cache_dir,
+                                        const std::string& model_token);
 }  // namespace evaluation
 }  // namespace tflite
 
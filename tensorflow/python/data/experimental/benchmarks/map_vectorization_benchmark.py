@@ -31,6 +31,7 @@ from tensorflow.python.framework import dtypes
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import parsing_ops
+from tensorflow.python.ops import string_ops
 from tensorflow.python.platform import test
 
 
@@ -177,6 +178,45 @@ class MapVectorizationBenchmark(test.Benchmark):
     self._benchmark_helper(parse_fn, "parse_single_example",
                            lambda: [parse_factory()])
 
+  # String ops
+  def benchmark_string_to_hash_bucket_fast(self):
+    self._benchmark_helper(
+        lambda x: string_ops.string_to_hash_bucket_fast(x, 1000),
+        "string_to_hash_bucket_fast", self._string_dataset_factory)
+
+  def benchmark_substr(self):
+    self._benchmark_helper(lambda x: string_ops.substr(x, 2, 8), "substr",
+                           self._string_dataset_factory)
+
+  def benchmark_regex_replace(self):
+    self._benchmark_helper(
+        lambda x: string_ops.regex_replace(x, "[0-9]", "#"), "regex_replace",
+        self._string_dataset_factory)
+
+  def benchmark_decode_raw(self):
+    self._benchmark_helper(lambda x: parsing_ops.decode_raw(x, dtypes.uint8),
+                           "decode_raw", self._string_dataset_factory)
+
+  def benchmark_string_pipeline(self):
+
+    def string_pipeline_fn(x):
+      x = string_ops.string_lower(x)
+      x = string_ops.regex_replace(x, "[0-9]", "#")
+      return string_ops.string_to_hash_bucket_fast(
+          string_ops.substr(x, 0, 8), 1000)
+
+    self._benchmark_helper(string_pipeline_fn, "string_pipeline",
+                           self._string_dataset_factory)
+
+  def _string_dataset_factory(self):
+    # Strings of the same length, so that `decode_raw` is applicable.
+    input_sizes = [(10,), (10, 100)]
+    for sz in input_sizes:
+      values = np.array([
+          "Token{:011d}".format(i) for i in range(int(np.prod(sz)))
+      ]).reshape(sz)
+      yield dataset_ops.Dataset.from_tensor_slices(values)
+
   def _default_dataset_factory(self):
     input_sizes = [(10, 10, 3), (10, 100, 300)]
     for sz in input_sizes:
@@ -45,6 +45,7 @@ from tensorflow.python.ops import nn
 from tensorflow.python.ops import parsing_ops
 from tensorflow.python.ops import script_ops
 from tensorflow.python.ops import special_math_ops
+from tensorflow.python.ops import string_ops
 from tensorflow.python.platform import test
 
 
@@ -188,6 +189,31 @@ def _binary_real_test_combinations():
   return _generate_test_combinations(cases)
 
 
+def _string_test_combinations():
+  cases = [
+      ("AsString", lambda x: string_ops.as_string(string_ops.string_length(x))),
+      ("DecodeRaw", lambda x: parsing_ops.decode_raw(x, dtypes.uint8)),
+      # The patterns are passed as tensors, since `regex_full_match` and
+      # `regex_replace` lower constant patterns to the Static* ops.
+      ("RegexFullMatch", lambda x: string_ops.regex_full_match(
+          x, constant_op.constant("[a-z]+"))),
+      ("RegexReplace", lambda x: string_ops.regex_replace(
+          x, constant_op.constant("[0-9]"), constant_op.constant("#"))),
+      ("StaticRegexFullMatch",
+       lambda x: string_ops.regex_full_match(x, "[a-z]+")),
+      ("StaticRegexReplace",
+       lambda x: string_ops.static_regex_replace(x, "[0-9]", "#")),
+      ("StringLength", string_ops.string_length),
+      ("StringLower", string_ops.string_lower),
+      ("StringStrip", string_ops.string_strip),
+      ("StringToHashBucketFast",
+       lambda x: string_ops.string_to_hash_bucket_fast(x, 1000)),
+      ("StringUpper", string_ops.string_upper),
+      ("Substr", lambda x: string_ops.substr(x, 1, 3)),
+  ]
+  return _generate_test_combinations(cases)
+
+
 # TODO(rachelim): Consolidate tests with pfor when APIs are somewhat shared.
 class MapVectorizationTest(test_base.DatasetTestBase, parameterized.TestCase):
 
@@ -393,6 +419,17 @@ class MapVectorizationTest(test_base.DatasetTestBase, parameterized.TestCase):
     dataset_factory = lambda: dataset_ops.Dataset.from_tensors((x, y))
     self._testOptimization(map_fn, dataset_factory, num_parallel_calls)
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         _string_test_combinations(),
+                         combinations.combine(num_parallel_calls=[None, 12])))
+  def testStringOperations(self, map_fn, num_parallel_calls):
+    # Strings of the same length, so that `decode_raw` is applicable.
+    data = [["ab1", "Cd2", " e3"], ["fgh", "IJ4", "k5 "]]
+    dataset_factory = (
+        lambda: dataset_ops.Dataset.from_tensor_slices(data).repeat(5))
+    self._testOptimization(map_fn, dataset_factory, num_parallel_calls)
+
   @combinations.generate(
       combinations.times(test_base.default_test_combinations(),
                          combinations.combine(num_parallel_calls=[None, 12])))
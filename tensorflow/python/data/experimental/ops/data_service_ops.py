@@ -56,7 +56,10 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
                protocol,
                job_name=None,
                max_outstanding_requests=None,
-               task_refresh_interval_hint_ms=None):
+               task_refresh_interval_hint_ms=None,
+               elements_per_request=None,
+               requests_per_task=None,
+               batch_compression=None):
     """Constructs a _DataServiceDatasetV2.
 
     Args:
@@ -75,9 +78,22 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
       max_outstanding_requests: (Optional.) A limit on how many elements may be
         requested at the same time. You can use this option to control the
         amount of memory used, since `distribute` won't use more than
-        `element_size` * `max_outstanding_requests` of memory.
+        `element_size` * `max_outstanding_requests` of memory. When fetching
+        several elements per request, the limit is in units of
+        `elements_per_request` elements.
       task_refresh_interval_hint_ms: (Optional.) A hint for how often to query
         the master for task changes.
+      elements_per_request: (Optional.) The maximum number of elements to
+        fetch from a worker in a single request. A request returns as soon as
+        one element is ready, together with the elements the worker has
+        already produced. Defaults to 1.
+      requests_per_task: (Optional.) The maximum number of requests to keep in
+        flight for each task, pipelining the requests to each worker. Defaults
+        to 1.
+      batch_compression: (Optional.) The codec applied to each batch of
+        elements as a whole when `elements_per_request` is greater than 1, in
+        which case the elements are not compressed individually. Either "" (no
+        compression) or "SNAPPY". Defaults to "".
     """
 
     if job_name is None:
@@ -86,6 +102,12 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
       max_outstanding_requests = dataset_ops.AUTOTUNE
     if task_refresh_interval_hint_ms is None:
       task_refresh_interval_hint_ms = dataset_ops.AUTOTUNE
+    if elements_per_request is None:
+      elements_per_request = 1
+    if requests_per_task is None:
+      requests_per_task = 1
+    if batch_compression is None:
+      batch_compression = ""
 
     self._input_dataset = input_dataset
     self._dataset_id = ops.convert_to_tensor(
@@ -112,6 +134,9 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
         job_name=self._job_name,
         max_outstanding_requests=self._max_outstanding_requests,
         task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
+        elements_per_request=elements_per_request,
+        requests_per_task=requests_per_task,
+        batch_compression=batch_compression,
         iteration_counter=gen_experimental_dataset_ops.dummy_iteration_counter(
         ),
         **self._flat_structure)
@@ -128,7 +153,8 @@ class _DataServiceDatasetV1(dataset_ops.DatasetV1Adapter):
   @functools.wraps(_DataServiceDatasetV2.__init__)
   def __init__(self, input_dataset, dataset_id, processing_mode, address,
                protocol, job_name, max_outstanding_requests,
-               task_refresh_interval_hint_ms):
+               task_refresh_interval_hint_ms, elements_per_request,
+               requests_per_task, batch_compression):
 
     self._wrapped = _DataServiceDatasetV2(
         input_dataset=input_dataset,
@@ -138,7 +164,10 @@ class _DataServiceDatasetV1(dataset_ops.DatasetV1Adapter):
         protocol=protocol,
         job_name=job_name,
         max_outstanding_requests=max_outstanding_requests,
-        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms)
+        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
+        elements_per_request=elements_per_request,
+        requests_per_task=requests_per_task,
+        batch_compression=batch_compression)
     super(_DataServiceDatasetV1, self).__init__(self._wrapped)
 
 
@@ -152,7 +181,10 @@ def _distribute(processing_mode,
                 service,
                 job_name=None,
                 max_outstanding_requests=None,
-                task_refresh_interval_hint_ms=None):
+                task_refresh_interval_hint_ms=None,
+                elements_per_request=None,
+                requests_per_task=None,
+                batch_compression=None):
   """A transformation that moves dataset processing to the tf.data service.
 
   This transformation is similar to `distribute`, but supports additional
@@ -171,9 +203,23 @@ def _distribute(processing_mode,
     max_outstanding_requests: (Optional.) A limit on how many elements may be
       requested at the same time. You can use this option to control the amount
       of memory used, since `distribute` won't use more than `element_size` *
-      `max_outstanding_requests` of memory.
+      `max_outstanding_requests` of memory. When fetching several elements per
+      request, the limit is in units of `elements_per_request` elements.
     task_refresh_interval_hint_ms: (Optional.) A hint for how often to query the
       master for task changes.
+    elements_per_request: (Optional.) The maximum number of elements to fetch
+      from a worker in a single request. Batching requests reduces the per-RPC
+      overhead for small elements. A request returns as soon as one element is
+      ready, together with the elements the worker has already produced, so
+      requests only fill up when the workers run producer threads. Defaults to
+      1.
+    requests_per_task: (Optional.) The maximum number of requests to keep in
+      flight for each task, pipelining the requests to each worker. Defaults to
+      1.
+    batch_compression: (Optional.) The codec applied to each batch of elements
+      as a whole when `elements_per_request` is greater than 1, in which case
+      the elements are not compressed individually. Either "" (no compression)
+      or "SNAPPY". Defaults to "".
 
   Returns:
     Dataset: A `Dataset` of the elements produced by the data service.
@@ -211,13 +257,17 @@ def _distribute(processing_mode,
       external_state_policy = ExternalStatePolicy.WARN
 
     uncompressed_spec = dataset.element_spec
-    # Compress the dataset elements to reduce the amount of data that needs to
-    # be sent over the network.
-    # TODO(b/157105111): Make this an autotuned parallel map when we have a way
-    # to limit memory usage.
-    dataset = dataset.map(lambda *x: compression_ops.compress(x))
-    # Prefetch one compressed element to reduce latency when requesting data
-    # from tf.data workers.
+    # Elements fetched in batches are compressed with the batch codec instead,
+    # so they are not compressed individually.
+    batched = elements_per_request is not None and elements_per_request > 1
+    if not batched:
+      # Compress the dataset elements to reduce the amount of data that needs
+      # to be sent over the network.
+      # TODO(b/157105111): Make this an autotuned parallel map when we have a
+      # way to limit memory usage.
+      dataset = dataset.map(lambda *x: compression_ops.compress(x))
+    # Prefetch one element to reduce latency when requesting data from tf.data
+    # workers.
     # TODO(b/157105111): Set this to autotune when we have a way to limit
     # memory usage
     dataset = dataset.prefetch(1)
@@ -237,14 +287,20 @@ def _distribute(processing_mode,
         protocol=protocol,
         job_name=job_name,
         max_outstanding_requests=max_outstanding_requests,
-        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms)
-    # TODO(b/157105111): Make this an autotuned parallel map when we have a way
-    # to limit memory usage.
-    # The value 16 is chosen based on experience with pipelines that require
-    # more than 8 parallel calls to prevent this stage from being a bottleneck.
-    dataset = dataset.map(
-        lambda x: compression_ops.uncompress(x, output_spec=uncompressed_spec),
-        num_parallel_calls=16)
+        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
+        elements_per_request=elements_per_request,
+        requests_per_task=requests_per_task,
+        batch_compression=batch_compression)
+    if not batched:
+      # TODO(b/157105111): Make this an autotuned parallel map when we have a
+      # way to limit memory usage.
+      # The value 16 is chosen based on experience with pipelines that require
+      # more than 8 parallel calls to prevent this stage from being a
+      # bottleneck.
+      dataset = dataset.map(
+          lambda x: compression_ops.uncompress(
+              x, output_spec=uncompressed_spec),
+          num_parallel_calls=16)
 
     # Disable autosharding for shared jobs.
     if job_name:
@@ -232,6 +232,55 @@ class DataServiceOpsTest(test_base.DatasetTestBase, parameterized.TestCase):
     self.assertCountEqual(num_workers * list(range(num_elements)),
                           self.getDatasetOutput(ds))
 
+  @combinations.generate(
+      combinations.times(
+          test_base.eager_only_combinations(),
+          combinations.combine(batch_compression=["", "SNAPPY"])))
+  def testBatchedRequests(self, batch_compression):
+    num_elements = 100
+    num_workers = 3
+    address = self.create_cluster(num_workers)
+    ds = dataset_ops.Dataset.range(num_elements)
+    ds = ds.apply(
+        data_service_ops._distribute(
+            "parallel_epochs",
+            "{0}://{1}".format(PROTOCOL, address),
+            task_refresh_interval_hint_ms=20,
+            elements_per_request=16,
+            batch_compression=batch_compression))
+    self.assertCountEqual(num_workers * list(range(num_elements)),
+                          self.getDatasetOutput(ds))
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testPipelinedRequests(self):
+    num_elements = 100
+    num_workers = 2
+    address = self.create_cluster(num_workers)
+    ds = dataset_ops.Dataset.range(num_elements)
+    ds = ds.apply(
+        data_service_ops._distribute(
+            "parallel_epochs",
+            "{0}://{1}".format(PROTOCOL, address),
+            task_refresh_interval_hint_ms=20,
+            elements_per_request=4,
+            requests_per_task=3))
+    self.assertCountEqual(num_workers * list(range(num_elements)),
+                          self.getDatasetOutput(ds))
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testInvalidBatchCompression(self):
+    address = self.create_cluster(1)
+    ds = dataset_ops.Dataset.range(10)
+    with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                "Unrecognized batch compression"):
+      ds = ds.apply(
+          data_service_ops._distribute(
+              "parallel_epochs",
+              "{0}://{1}".format(PROTOCOL, address),
+              elements_per_request=4,
+              batch_compression="LZ4"))
+      self.getDatasetOutput(ds)
+
   @combinations.generate(test_base.eager_only_combinations())
   def testInsideFunction(self):
     num_workers = 3
@@ -17,6 +17,7 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+from tensorflow.python.eager import context
 from tensorflow.python.ops import gen_collective_ops
 
 
@@ -28,7 +29,11 @@ def all_reduce(t,
                final_op,
                subdiv_offsets=(0,),
                communication_hint='auto',
-               timeout=0):
+               timeout=0,
+               compression='none',
+               compression_topk_ratio=0.01,
+               bucket_key=0,
+               bucket_size=1):
   """Reduces tensors collectively, across devices.
 
   Args:
@@ -45,11 +50,31 @@ def all_reduce(t,
       independent subdivision should begin.  Use [0] if no subdivision should
       be done.
     communication_hint: preferred collective communication.  The implementation
-      may fall back to another mechanism.  Options include `auto`, `ring`, and
-      `nccl`.
+      may fall back to another mechanism.  Options include `auto`, `ring`,
+      `hierarchical`, and `nccl`.  `hierarchical` reduces within each task
+      before reducing between tasks, and is the default on CPU for groups
+      spanning several tasks with the same number of devices each.
     timeout: If set to a non zero, set a completion timeout to detect staleness.
       If the timer goes off, a DeadlineExceededError is raised.
       The timeout value in seconds. This feature is experimental.
+    compression: encoding of the values exchanged between devices by the ring
+      implementation on CPU, for float tensors.  Options are `none`, `float16`
+      and `bfloat16`, which round the values sent but accumulate in float, and
+      `topk`, which only sends the `compression_topk_ratio` fraction of values
+      of largest magnitude and adds the others to the input of the next
+      execution with the same `instance_key`.  `topk` requires `merge_op`
+      'Add'.  All members must use the same compression.  This feature is
+      experimental.
+    compression_topk_ratio: fraction of values sent with `topk` compression,
+      in (0, 1].
+    bucket_key: an integer identifying the bucket of this reduction among the
+      reductions of the same group on the same device.
+    bucket_size: if greater than 1, the reductions of a bucket are fused into
+      a single reduction once all `bucket_size` of them have been launched.
+      All members of a bucket must have the same type, `merge_op` and
+      `final_op`, must not depend on each other, and must be bucketed the same
+      way on every device.  Only supported on CPU and in graphs.  This feature
+      is experimental.
 
   Returns:
     An Op implementing the distributed reduction.
@@ -68,7 +93,84 @@ def all_reduce(t,
       final_op=final_op,
       subdiv_offsets=subdiv_offsets,
       communication_hint=communication_hint.lower(),
-      timeout_seconds=timeout)
+      timeout_seconds=timeout,
+      compression=compression.lower(),
+      compression_topk_ratio=compression_topk_ratio,
+      bucket_key=bucket_key,
+      bucket_size=bucket_size)
+
+
+def bucketed_all_reduce(tensors,
+                        group_size,
+                        group_key,
+                        instance_key,
+                        merge_op,
+                        final_op,
+                        bucket_bytes=4 * 1024 * 1024,
+                        communication_hint='auto',
+                        timeout=0):
+  """Reduces a list of tensors collectively, fusing them into buckets.
+
+  Consecutive tensors are assigned to the same bucket until its size reaches
+  `bucket_bytes`, and each bucket is reduced as a single tensor as soon as all
+  of its tensors have been computed.  Passing gradients in the order in which
+  backpropagation produces them lets the reduction of the first buckets
+  overlap with the computation of the others.
+
+  Args:
+    tensors: the tensors to be reduced, in the order in which they are
+      expected to be computed.  Must be the same on every device, up to their
+      values.
+    group_size: the total number of devices in the group.
+    group_key: an integer identifying the group of devices.
+    instance_key: the instance key of the first reduction.  The reductions use
+      instance keys `instance_key` to `instance_key + len(tensors) - 1`.
+    merge_op: string naming the binary Op to be applied to compute each
+      partial reduction.
+    final_op: string naming the unary Op to be applied to each fully
+      reduced value.  Can be 'Id' for no operation.
+    bucket_bytes: target size of a bucket, in bytes.
+    communication_hint: preferred collective communication.
+    timeout: If set to a non zero, set a completion timeout to detect staleness.
+
+  Returns:
+    The list of reduced tensors, in the order of `tensors`.
+
+  Raises:
+    RuntimeError: if called eagerly, where each reduction would wait for the
+      others of its bucket before returning.
+    ValueError: if the shape of a tensor is not fully defined.
+  """
+  if context.executing_eagerly():
+    raise RuntimeError('bucketed_all_reduce is not supported in eager mode; '
+                       'call it inside a tf.function.')
+  buckets = []
+  bucket_size_bytes = bucket_bytes
+  for i, t in enumerate(tensors):
+    num_elements = t.shape.num_elements()
+    if num_elements is None:
+      raise ValueError('bucketed_all_reduce requires tensors of known shape, '
+                       'got %s' % t)
+    if bucket_size_bytes >= bucket_bytes:
+      buckets.append([])
+      bucket_size_bytes = 0
+    buckets[-1].append(i)
+    bucket_size_bytes += num_elements * t.dtype.size
+  results = [None] * len(tensors)
+  for bucket in buckets:
+    for i in bucket:
+      results[i] = all_reduce(
+          tensors[i],
+          group_size,
+          group_key,
+          instance_key + i,
+          merge_op,
+          final_op,
+          communication_hint=communication_hint,
+          timeout=timeout,
+          bucket_key=instance_key + bucket[0],
+          bucket_size=len(bucket))
+  return results
 
 
 def all_gather(t,
@@ -110,6 +212,54 @@ def all_gather(t,
       timeout_seconds=timeout)
 
 
+def all_to_all(t,
+               split_sizes,
+               group_size,
+               group_key,
+               instance_key,
+               communication_hint='auto',
+               timeout=0):
+  """Exchanges slices of tensors collectively, between all pairs of devices.
+
+  `t` is split along its first dimension into `group_size` slices, of
+  `split_sizes[i]` rows each, and slice `i` is sent to the device of rank `i`.
+  This is the exchange needed e.g. for lookups into embedding tables that are
+  sharded across devices.  Only CPU devices are supported.
+
+  Args:
+    t: the tensor to split and exchange.  Must have at least one dimension.
+    split_sizes: an int32 vector of `group_size` elements, the number of rows
+      of `t` to send to each device, which must add up to the first dimension
+      of `t`.
+    group_size: the total number of tensors to be collectively exchanged.
+      Each must reside on a different device.  Should be a positive integer.
+    group_key: an integer identifying the group of devices.
+    instance_key: an integer identifying the participating group of Ops.
+    communication_hint: preferred collective communication.  The implementation
+      may fall back to another mechanism.
+    timeout: If set to a non zero, set a completion timeout to detect staleness.
+      If the timer goes off, a DeadlineExceededError is raised.
+      The timeout value in seconds. This feature is experimental.
+
+  Returns:
+    A pair of the rows received from all devices, concatenated in rank order,
+    and an int32 vector of the number of rows received from each device.
+
+  Raises:
+    ValueError: if any of the input parameter constraints are not met.
+  """
+  if group_size < 1:
+    raise ValueError('Parameter group_size to all_to_all must be at least 1.')
+  return gen_collective_ops.collective_all_to_all(
+      t,
+      split_sizes,
+      group_size=group_size,
+      group_key=group_key,
+      instance_key=instance_key,
+      communication_hint=communication_hint.lower(),
+      timeout_seconds=timeout)
+
+
 def broadcast_send(t,
                    shape,
                    dtype,
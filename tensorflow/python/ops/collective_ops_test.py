@@ -460,6 +460,82 @@ class CollectiveOpTest(test.TestCase):
       self.assertAllClose(results_[0], expected_output_, rtol=1e-5, atol=1e-5)
       self.assertAllClose(results_[1], expected_output_, rtol=1e-5, atol=1e-5)
 
+  def _testBucketedAllReduce(self, deterministic):
+    group_key = 1
+    group_size = 2
+    config = config_pb2.ConfigProto(device_count={'CPU': group_size})
+    config.experimental.collective_deterministic_sequential_execution = (
+        deterministic)
+    inputs = [[[1., 2.], [3.], [4., 5., 6.]],
+              [[10., 20.], [30.], [40., 50., 60.]]]
+    with self.session(config=config) as sess:
+      reduced = []
+      for cpu in range(group_size):
+        with ops.device('/CPU:%d' % cpu):
+          tensors = [constant_op.constant(t) for t in inputs[cpu]]
+          # The first two tensors share a bucket of 12 bytes.
+          reduced.append(
+              collective_ops.bucketed_all_reduce(
+                  tensors, group_size, group_key, 1, 'Add', 'Id',
+                  bucket_bytes=12))
+      results = sess.run(reduced)
+    for cpu in range(group_size):
+      self.assertAllClose(results[cpu][0], [11., 22.])
+      self.assertAllClose(results[cpu][1], [33.])
+      self.assertAllClose(results[cpu][2], [44., 55., 66.])
+
+  @test_util.run_deprecated_v1
+  def testBucketedAllReduce(self):
+    self._testBucketedAllReduce(deterministic=False)
+
+  @test_util.run_deprecated_v1
+  def testBucketedAllReduceDeterministic(self):
+    self._testBucketedAllReduce(deterministic=True)
+
+  def testBucketedAllReduceEager(self):
+    with context.eager_mode():
+      with self.assertRaisesRegexp(RuntimeError, 'eager mode'):
+        collective_ops.bucketed_all_reduce(
+            [constant_op.constant([1.])], 1, 1, 1, 'Add', 'Id')
+
+  @test_util.run_deprecated_v1
+  def testCollectiveAllToAll(self):
+    group_key = 1
+    instance_key = 1
+    with self.session(
+        config=config_pb2.ConfigProto(device_count={'CPU': 2})) as sess:
+      with ops.device('/CPU:0'):
+        in0 = constant_op.constant([[0, 1], [2, 3], [4, 5]])
+        c0, sizes0 = collective_ops.all_to_all(in0, [1, 2], 2, group_key,
+                                               instance_key)
+      with ops.device('/CPU:1'):
+        in1 = constant_op.constant([[10, 11], [12, 13]])
+        c1, sizes1 = collective_ops.all_to_all(in1, [0, 2], 2, group_key,
+                                               instance_key)
+      results = sess.run([c0, sizes0, c1, sizes1])
+    self.assertAllEqual(results[0], [[0, 1]])
+    self.assertAllEqual(results[1], [1, 0])
+    self.assertAllEqual(results[2], [[2, 3], [4, 5], [10, 11], [12, 13]])
+    self.assertAllEqual(results[3], [2, 2])
+
+  @test_util.run_deprecated_v1
+  def testCollectiveAllToAllInvalidSplitSizes(self):
+    group_key = 1
+    instance_key = 1
+    with self.session(
+        config=config_pb2.ConfigProto(device_count={'CPU': 2})) as sess:
+      with ops.device('/CPU:0'):
+        in0 = constant_op.constant([1, 2, 3])
+        c0, _ = collective_ops.all_to_all(in0, [1, 1], 2, group_key,
+                                          instance_key, timeout=10)
+      with ops.device('/CPU:1'):
+        in1 = constant_op.constant([4, 5])
+        c1, _ = collective_ops.all_to_all(in1, [1, 1], 2, group_key,
+                                          instance_key, timeout=10)
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   'add up to 2 but the input has 3 rows'):
+        sess.run([c0, c1])
+
   @test_util.run_v2_only
   def testCollectiveGroupSizeMismatch(self):
     cpus = config.list_physical_devices('CPU')